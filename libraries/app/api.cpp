@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  */
 #include <cctype>
+#include <set>
 
 #include <deip/app/api.hpp>
 #include <deip/app/api_access.hpp>
@@ -33,6 +34,7 @@
 #include <deip/chain/database/database.hpp>
 #include <deip/chain/schema/deip_objects.hpp>
 #include <deip/chain/schema/transaction_object.hpp>
+#include <fc/rpc/websocket_api.hpp>
 #include <fc/time.hpp>
 
 #include <graphene/utilities/key_conversion.hpp>
@@ -118,6 +120,83 @@ fc::api_ptr login_api::get_api_by_name(const string& api_name) const
     return it->second;
 }
 
+void validate_api_batch(const std::vector<api_batch_call>& calls, uint32_t max_calls)
+{
+    FC_ASSERT(calls.size() <= max_calls, "Batch of ${n} calls exceeds the limit of ${max}",
+              ("n", calls.size())("max", max_calls));
+
+    // the batch runs under a read lock, so anything that writes (debug_node_api, raw_block_api), waits for the
+    // network or hands out further APIs would deadlock or race the writer
+    static const std::set<std::string> read_only_apis = { "database_api",
+                                                          "account_by_key_api",
+                                                          "account_history_api",
+                                                          "account_stats_api",
+                                                          "auth_util_api",
+                                                          "block_info_api",
+                                                          "blockchain_history_api",
+                                                          "chain_stats_api",
+                                                          "eci_history_api",
+                                                          "fo_history_api",
+                                                          "investments_history_api",
+                                                          "proposal_history_api",
+                                                          "research_content_reference_history_api",
+                                                          "tsc_history_api" };
+
+    for (const api_batch_call& call : calls)
+        FC_ASSERT(read_only_apis.count(call.api), "${api} calls can't be batched", ("api", call.api));
+}
+
+std::vector<api_batch_result> login_api::call_batch(const std::vector<api_batch_call>& calls) const
+{
+    std::shared_ptr<api_session_data> session = _ctx.session.lock();
+    FC_ASSERT(session);
+
+    validate_api_batch(calls, _ctx.app.get_max_api_batch_size());
+
+    // APIs looked up once per batch, a batch usually calls a few APIs many times
+    std::map<std::string, fc::api_id_type> api_ids;
+    for (const api_batch_call& call : calls)
+    {
+        if (api_ids.count(call.api))
+            continue;
+
+        auto it = session->api_map.find(call.api);
+        if (it != session->api_map.end() && it->second)
+            api_ids[call.api] = it->second->register_api(*session->wsc);
+    }
+
+    const bool timing = _ctx.app.is_api_batch_timing_enabled();
+
+    // the calls take the read lock themselves, nested in this one they run without taking it again
+    return _ctx.app.chain_database()->with_read_lock([&]() {
+        std::vector<api_batch_result> results;
+        results.reserve(calls.size());
+
+        for (const api_batch_call& call : calls)
+        {
+            api_batch_result result;
+            const fc::time_point start = fc::time_point::now();
+            try
+            {
+                auto api_id = api_ids.find(call.api);
+                FC_ASSERT(api_id != api_ids.end(), "API ${api} is not available", ("api", call.api));
+                result.result = session->wsc->receive_call(api_id->second, call.method, call.params);
+            }
+            catch (const fc::exception& e)
+            {
+                result.error = e.to_string();
+            }
+
+            if (timing)
+                result.duration_us = (fc::time_point::now() - start).count();
+
+            results.push_back(std::move(result));
+        }
+
+        return results;
+    });
+}
+
 deip_version_info login_api::get_version()
 {
     return deip_version_info(fc::string(DEIP_BLOCKCHAIN_VERSION), fc::string(graphene::utilities::git_revision_sha),
@@ -0,0 +1,137 @@
+#include <deip/app/api_response_cache.hpp>
+
+namespace deip {
+namespace app {
+
+api_response_cache::api_response_cache(uint64_t max_size_in_bytes)
+    : _max_size_in_bytes(max_size_in_bytes)
+{
+}
+
+std::shared_ptr<const void>
+api_response_cache::lookup(uint64_t version, const std::string& method, const std::string& key)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    api_response_cache_method_stats& method_stats = _stats.methods[method];
+
+    bool waited = false;
+    for (;;)
+    {
+        auto itr = _entries.find(key);
+        if (itr != _entries.end() && itr->second.version == version)
+        {
+            _lru.splice(_lru.begin(), _lru, itr->second.lru);
+            if (!waited)
+            {
+                ++_stats.hits;
+                ++method_stats.hits;
+            }
+            return itr->second.response;
+        }
+
+        // nobody computes the response of this state, so it is up to the caller. That includes a call computing
+        // it having failed, then the waiting calls try themselves
+        auto computing = _computing.find(key);
+        if (computing == _computing.end() || computing->second != version)
+        {
+            _computing[key] = version;
+            if (!waited)
+            {
+                ++_stats.misses;
+                ++method_stats.misses;
+            }
+            return std::shared_ptr<const void>();
+        }
+
+        if (!waited)
+        {
+            ++_stats.coalesced;
+            ++method_stats.coalesced;
+            waited = true;
+        }
+        _computed.wait(lock);
+    }
+}
+
+void api_response_cache::store(uint64_t version,
+                               const std::string& key,
+                               std::shared_ptr<const void> response,
+                               uint64_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto computing = _computing.find(key);
+        if (computing != _computing.end() && computing->second == version)
+            _computing.erase(computing);
+
+        auto itr = _entries.find(key);
+        if (itr != _entries.end())
+        {
+            // a call of a later state got there first
+            if (itr->second.version >= version)
+            {
+                _computed.notify_all();
+                return;
+            }
+            _erase(itr);
+        }
+
+        if (size <= _max_size_in_bytes)
+        {
+            while (_size_in_bytes + size > _max_size_in_bytes)
+            {
+                _erase(_entries.find(_lru.back()));
+                ++_stats.evictions;
+            }
+
+            _lru.push_front(key);
+            entry& e = _entries[key];
+            e.version = version;
+            e.response = std::move(response);
+            e.size = size;
+            e.lru = _lru.begin();
+            _size_in_bytes += size;
+        }
+    }
+    _computed.notify_all();
+}
+
+void api_response_cache::abandon(uint64_t version, const std::string& key)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto computing = _computing.find(key);
+        if (computing != _computing.end() && computing->second == version)
+            _computing.erase(computing);
+    }
+    _computed.notify_all();
+}
+
+void api_response_cache::clear()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stats.invalidations += _entries.size();
+    _entries.clear();
+    _lru.clear();
+    _size_in_bytes = 0;
+}
+
+api_response_cache_stats api_response_cache::get_stats() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    api_response_cache_stats stats = _stats;
+    stats.entries = _entries.size();
+    stats.size_in_bytes = _size_in_bytes;
+    stats.max_size_in_bytes = _max_size_in_bytes;
+    return stats;
+}
+
+void api_response_cache::_erase(std::unordered_map<std::string, entry>::iterator itr)
+{
+    _size_in_bytes -= itr->second.size;
+    _lru.erase(itr->second.lru);
+    _entries.erase(itr);
+}
+}
+} // deip::app
@@ -328,6 +328,15 @@ public:
             if (_options->count("disable_get_block"))
                 _self->_disable_get_block = true;
 
+            _self->set_api_batch_options(_options->at("api-batch-max-calls").as<uint32_t>(),
+                                         _options->at("api-batch-timing").as<bool>());
+
+            _api_response_cache = std::make_shared<api_response_cache>(
+                fc::parse_size(_options->at("api-response-cache-size").as<std::string>()));
+            // cached responses of the previous head block can't be hit any more
+            _api_response_cache_connection
+                = _chain_db->applied_block.connect([this](const signed_block&) { _api_response_cache->clear(); });
+
             if (!read_only)
             {
                 _self->_read_only = false;
@@ -338,6 +347,25 @@ public:
                     _chain_db->wipe(_data_dir / "blockchain", _shared_dir, true);
 
                 _chain_db->set_flush_interval(_options->at("flush").as<uint32_t>());
+                _chain_db->set_shared_memory_growth(
+                    fc::parse_size(_options->at("shared-file-min-free").as<std::string>()),
+                    fc::parse_size(_options->at("shared-file-grow-size").as<std::string>()));
+                _chain_db->set_signature_recovery_threads(_options->at("signature-recovery-threads").as<uint32_t>());
+                _chain_db->set_max_fork_bytes(fc::parse_size(_options->at("fork-db-max-fork-size").as<std::string>()));
+                _chain_db->set_mempool_limits(_options->at("mempool-max-transactions").as<uint32_t>(),
+                                              fc::parse_size(_options->at("mempool-max-size").as<std::string>()),
+                                              _options->at("mempool-max-account-transactions").as<uint32_t>());
+
+                const std::string block_log_fsync = _options->at("block-log-fsync").as<std::string>();
+                chain::block_log::fsync_mode fsync_mode = chain::block_log::fsync_mode::none;
+                if (block_log_fsync == "batch")
+                    fsync_mode = chain::block_log::fsync_mode::every_batch;
+                else if (block_log_fsync == "interval")
+                    fsync_mode = chain::block_log::fsync_mode::interval;
+                else
+                    FC_ASSERT(block_log_fsync == "none", "Unknown block-log-fsync mode ${m}", ("m", block_log_fsync));
+                _chain_db->set_block_log_writer(_options->at("block-log-writer-queue").as<uint32_t>(), fsync_mode,
+                                                _options->at("block-log-fsync-interval").as<uint32_t>());
 
                 flat_map<uint32_t, block_id_type> loaded_checkpoints;
                 if (_options->count("checkpoint"))
@@ -352,7 +380,19 @@ public:
                 }
                 _chain_db->add_checkpoints(loaded_checkpoints);
 
-                if (_options->count("replay-blockchain"))
+                if (_options->count("compact-shared-file"))
+                {
+                    ilog("Compacting shared memory file on user request.");
+                    _chain_db->compact(_data_dir / "blockchain", _shared_dir, genesis_state);
+                }
+
+                if (_options->count("snapshot-import"))
+                {
+                    ilog("Importing state snapshot on user request.");
+                    _chain_db->import_snapshot(_data_dir / "blockchain", _shared_dir, _shared_file_size, genesis_state,
+                                               _options->at("snapshot-import").as<boost::filesystem::path>());
+                }
+                else if (_options->count("replay-blockchain"))
                 {
                     ilog("Replaying blockchain on user request.");
                     _chain_db->reindex(_data_dir / "blockchain", _shared_dir, _shared_file_size, genesis_state);
@@ -381,6 +421,13 @@ public:
                     }
                 }
 
+                if (_options->count("snapshot-export"))
+                {
+                    _chain_db->with_read_lock([&]() {
+                        _chain_db->export_snapshot(_options->at("snapshot-export").as<boost::filesystem::path>());
+                    });
+                }
+
                 if (_options->count("force-validate"))
                 {
                     ilog("All transaction signatures will be validated");
@@ -562,10 +609,22 @@ public:
                     // you can help the network code out by throwing a block_older_than_undo_history exception.
                     // when the net code sees that, it will stop trying to push blocks from that chain, but
                     // leave that peer connected so that they can get sync blocks from us
+                    std::shared_future<void> signees_recovered;
+                    auto recovery = _signee_recovery_by_block.find(
+                        std::make_pair(blk_msg.block.block_num(), blk_msg.block_id));
+                    if (recovery != _signee_recovery_by_block.end())
+                        signees_recovered = recovery->second;
+                    // blocks up to this one are either pushed or on a fork we no longer ask for
+                    _signee_recovery_by_block.erase(
+                        _signee_recovery_by_block.begin(),
+                        _signee_recovery_by_block.lower_bound(
+                            std::make_pair(blk_msg.block.block_num() + 1, block_id_type())));
+
                     bool result = _chain_db->push_block(blk_msg.block,
                                                         (_is_block_producer | _force_validate)
                                                             ? database::skip_nothing
-                                                            : database::skip_transaction_signatures);
+                                                            : database::skip_transaction_signatures,
+                                                        signees_recovered);
 
                     if (!sync_mode)
                     {
@@ -599,6 +658,26 @@ public:
         FC_CAPTURE_AND_RETHROW((blk_msg)(sync_mode))
     }
 
+    /**
+     * Starts recovering the witness and transaction signatures of a queued sync block on the
+     * signature recovery threads, so they are ready by the time the block is pushed.
+     */
+    virtual void prevalidate_sync_block(const graphene::net::block_message& blk_msg) override
+    {
+        try
+        {
+            if (!_running)
+                return;
+
+            // the witness signature is checked for every block, transaction signatures only when validating
+            _chain_db->precompute_block_signee(blk_msg.block);
+            if (_is_block_producer | _force_validate)
+                _signee_recovery_by_block[std::make_pair(blk_msg.block.block_num(), blk_msg.block_id)]
+                    = _chain_db->precompute_transaction_signees(blk_msg.block);
+        }
+        FC_CAPTURE_AND_RETHROW((blk_msg.block_id))
+    }
+
     virtual void handle_transaction(const graphene::net::trx_message& transaction_message) override
     {
         try
@@ -703,16 +782,26 @@ public:
             // ilog("Request for item ${id}", ("id", id));
             if (id.item_type == graphene::net::block_message_type)
             {
-                return _chain_db->with_read_lock([&]() {
-                    auto opt_block = _chain_db->fetch_block_by_id(id.item_hash);
-                    if (!opt_block)
+                auto opt_block = _chain_db->with_read_lock([&]() {
+                    auto b = _chain_db->fetch_serialized_block_by_id(id.item_hash);
+                    if (!b)
                         elog("Couldn't find block ${id} -- corresponding ID in our chain is ${id2}",
                              ("id", id.item_hash)(
                                  "id2", _chain_db->get_block_id_for_num(block_header::num_from_id(id.item_hash))));
-                    FC_ASSERT(opt_block.valid());
-                    // ilog("Serving up block #${num}", ("num", opt_block->block_num()));
-                    return block_message(std::move(*opt_block));
+                    return b;
                 });
+                FC_ASSERT(opt_block.valid());
+
+                // block_message is packed as the block followed by its id,
+                // so the stored bytes are sent as they are, without unpacking the block
+                const auto packed_id = fc::raw::pack(id.item_hash);
+                message result;
+                result.msg_type = block_message::type;
+                result.data.reserve(opt_block->size + packed_id.size());
+                result.data.insert(result.data.end(), opt_block->data.get(), opt_block->data.get() + opt_block->size);
+                result.data.insert(result.data.end(), packed_id.begin(), packed_id.end());
+                result.size = (uint32_t)result.data.size();
+                return result;
             }
             return _chain_db->with_read_lock(
                 [&]() { return trx_message(_chain_db->get_recent_transaction(id.item_hash)); });
@@ -1021,10 +1110,17 @@ public:
     flat_map<std::string, std::function<fc::api_ptr(const api_context&)>> _api_factories_by_name;
     std::vector<std::string> _public_apis;
     int32_t _max_block_age = -1;
+    uint32_t _max_api_batch_size = 100;
+    bool _api_batch_timing = false;
+    std::shared_ptr<api_response_cache> _api_response_cache = std::make_shared<api_response_cache>(0);
+    boost::signals2::scoped_connection _api_response_cache_connection;
     uint64_t _shared_file_size;
 
     bool _running;
 
+    /// signature recoveries started for queued sync blocks, by block number and id. Only used on the p2p thread
+    std::map<std::pair<uint32_t, block_id_type>, std::shared_future<void>> _signee_recovery_by_block;
+
     uint32_t allow_future_time = 5;
 };
 }
@@ -1077,6 +1173,8 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("data-dir,d", bpo::value<boost::filesystem::path>()->default_value("witness_node_data_dir"), "Directory containing databases, configuration file, etc.")
          ("shared-file-dir", bpo::value<string>(), "Location of the shared memory file. Defaults to data_dir/blockchain")
          ("shared-file-size", bpo::value<string>()->default_value("54G"), "Size of the shared memory file. Default: 54G")
+         ("shared-file-min-free", bpo::value<string>()->default_value("1G"), "Grow the shared memory file when its free memory drops below this size, 0 disables growth")
+         ("shared-file-grow-size", bpo::value<string>()->default_value("8G"), "Size the shared memory file is grown by when it is almost full")
          ("rpc-endpoint", bpo::value<string>()->implicit_value("127.0.0.1:8090"), "Endpoint for websocket RPC to listen on")
          ("rpc-tls-endpoint", bpo::value<string>()->implicit_value("127.0.0.1:8089"), "Endpoint for TLS websocket RPC to listen on")
          ("read-forward-rpc", bpo::value<string>(), "Endpoint to forward write API calls to for a read node" )
@@ -1086,13 +1184,27 @@ void application::set_program_options(boost::program_options::options_descriptio
          ("public-api", bpo::value< vector<string> >()->composing()->default_value(default_apis, str_default_apis), "Set an API to be publicly available, may be specified multiple times")
          ("enable-plugin", bpo::value< vector<string> >()->composing()->default_value(default_plugins, str_default_plugins), "Plugin(s) to enable, may be specified multiple times")
          ("max-block-age", bpo::value< int32_t >()->default_value(200), "Maximum age of head block when broadcasting tx via API")
+         ("api-batch-max-calls", bpo::value< uint32_t >()->default_value(100), "Maximum number of calls in one login_api.call_batch request")
+         ("api-batch-timing", bpo::value< bool >()->default_value(false), "Report how long every call of a login_api.call_batch request took, for debugging")
+         ("api-response-cache-size", bpo::value<string>()->default_value("32M"), "Memory for responses of database_api calls shared by all connections until the state changes, 0 disables the cache")
          ("flush", bpo::value< uint32_t >()->default_value(100000), "Flush shared memory file to disk this many blocks")
+         ("block-log-writer-queue", bpo::value< uint32_t >()->default_value(1000), "Irreversible blocks queued for the background block log writer, 0 writes them on the block application thread")
+         ("block-log-fsync", bpo::value<string>()->default_value("none"), "When the block log writer syncs the log to disk: none, batch (after every group of blocks) or interval")
+         ("block-log-fsync-interval", bpo::value< uint32_t >()->default_value(1000), "Milliseconds between block log syncs with block-log-fsync = interval")
+         ("fork-db-max-fork-size", bpo::value<string>()->default_value("64M"), "Memory the fork database may use for blocks off the main branch, the oldest are dropped first")
+         ("mempool-max-transactions", bpo::value< uint32_t >()->default_value(100000), "Maximum number of pending transactions kept by the node")
+         ("mempool-max-size", bpo::value<string>()->default_value("64M"), "Memory the pending transactions may use, packed")
+         ("mempool-max-account-transactions", bpo::value< uint32_t >()->default_value(1000), "Maximum number of pending transactions requiring the authority of one account")
+         ("signature-recovery-threads", bpo::value< uint32_t >()->default_value(4), "Number of threads used to recover transaction signatures ahead of block application, 0 to recover them on the apply thread")
          ("genesis-json,g", bpo::value<boost::filesystem::path>(), "File to read genesis state from")
          ("tenant", bpo::value<string>()->default_value(""), "Tenant marker for transactions");
     command_line_options.add(configuration_file_options);
     command_line_options.add_options()
          ("replay-blockchain", "Rebuild object graph by replaying all blocks")
          ("resync-blockchain", "Delete all blocks and re-sync with network from scratch")
+         ("snapshot-import", bpo::value<boost::filesystem::path>(), "Rebuild object graph from a state snapshot and replay the blocks following it")
+         ("snapshot-export", bpo::value<boost::filesystem::path>(), "Write a state snapshot at the head block after the database is opened")
+         ("compact-shared-file", "Copy the state into a fresh shared memory file before opening the database, releasing fragmented free space")
          ("force-validate", "Force validation of all transactions")
          ("read-only", "Node will not connect to p2p network and can only read from the chain state" )
          ("check-locks", "Check correctness of chainbase locking")
@@ -1287,6 +1399,27 @@ void application::get_max_block_age(int32_t& result)
     my->get_max_block_age(result);
 }
 
+uint32_t application::get_max_api_batch_size() const
+{
+    return my->_max_api_batch_size;
+}
+
+bool application::is_api_batch_timing_enabled() const
+{
+    return my->_api_batch_timing;
+}
+
+void application::set_api_batch_options(uint32_t max_calls, bool timing)
+{
+    my->_max_api_batch_size = max_calls;
+    my->_api_batch_timing = timing;
+}
+
+api_response_cache& application::get_api_response_cache() const
+{
+    return *my->_api_response_cache;
+}
+
 void application::connect_to_write_node()
 {
     if (_remote_endpoint)
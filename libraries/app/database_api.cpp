@@ -47,6 +47,67 @@
 namespace deip {
 namespace app {
 
+/**
+ *  Assembles research_api_obj for the researches of one response. Disciplines and research groups shared by
+ *  the researches are looked up and converted once.
+ */
+class research_api_obj_builder
+{
+public:
+    explicit research_api_obj_builder(const chain::database& db)
+        : _db(db)
+    {
+    }
+
+    research_api_obj build(const research_object& research)
+    {
+        vector<discipline_api_obj> disciplines;
+        const auto& relations = _db.get_index<research_discipline_relation_index>().indices().get<by_research_id>();
+        for (auto it_pair = relations.equal_range(research.id); it_pair.first != it_pair.second; ++it_pair.first)
+        {
+            disciplines.push_back(get_discipline(it_pair.first->discipline_id));
+        }
+
+        return research_api_obj(research, disciplines, get_research_group(research.research_group_id));
+    }
+
+    template <typename Researches> vector<research_api_obj> build_all(const Researches& researches)
+    {
+        vector<research_api_obj> result;
+        result.reserve(researches.size());
+        for (const research_object& research : researches)
+        {
+            result.push_back(build(research));
+        }
+        return result;
+    }
+
+private:
+    const discipline_api_obj& get_discipline(const discipline_id_type& id)
+    {
+        auto it = _disciplines.find(id);
+        if (it == _disciplines.end())
+        {
+            it = _disciplines.emplace(id, discipline_api_obj(_db.get<discipline_object>(id))).first;
+        }
+        return it->second;
+    }
+
+    const research_group_api_obj& get_research_group(const research_group_id_type& id)
+    {
+        auto it = _research_groups.find(id);
+        if (it == _research_groups.end())
+        {
+            it = _research_groups.emplace(id, research_group_api_obj(_db.get<research_group_object>(id))).first;
+        }
+        return it->second;
+    }
+
+    const chain::database& _db;
+    std::map<discipline_id_type, discipline_api_obj> _disciplines;
+    std::map<research_group_id_type, research_group_api_obj> _research_groups;
+};
+
 class database_api_impl;
 
 class database_api_impl : public std::enable_shared_from_this<database_api_impl>
@@ -250,12 +311,20 @@ public:
     bool verify_authority(const signed_transaction& trx) const;
     bool verify_account_authority(const string& name_or_id, const flat_set<public_key_type>& signers) const;
 
+    /// the response of the method for the current state, computed once for all connections
+    template <typename Result, typename Compute>
+    Result cached(const std::string& method, const fc::variants& params, Compute&& compute) const
+    {
+        return _cache.get_or_compute<Result>(_db.head_sequence(), method, params, std::forward<Compute>(compute));
+    }
+
     // signal handlers
     void on_applied_block(const chain::signed_block& b);
 
     std::function<void(const fc::variant&)> _block_applied_callback;
 
     deip::chain::database& _db;
+    api_response_cache& _cache;
 
     boost::signals2::scoped_connection _block_applied_connection;
 
@@ -309,6 +378,7 @@ database_api::~database_api()
 
 database_api_impl::database_api_impl(const deip::app::api_context& ctx)
     : _db(*ctx.app.chain_database())
+    , _cache(ctx.app.get_api_response_cache())
 {
     wlog("creating database api ${x}", ("x", int64_t(this)));
 
@@ -361,7 +431,10 @@ fc::variant_object database_api_impl::get_config() const
 
 dynamic_global_property_api_obj database_api::get_dynamic_global_properties() const
 {
-    return my->_db.with_read_lock([&]() { return my->get_dynamic_global_properties(); });
+    return my->_db.with_read_lock([&]() {
+        return my->cached<dynamic_global_property_api_obj>("database_api.get_dynamic_global_properties", {},
+                                                           [&]() { return my->get_dynamic_global_properties(); });
+    });
 }
 
 chain_properties database_api::get_chain_properties() const
@@ -381,7 +454,11 @@ chain_id_type database_api_impl::get_chain_id() const
 
 witness_schedule_api_obj database_api::get_witness_schedule() const
 {
-    return my->_db.with_read_lock([&]() { return my->_db.get(witness_schedule_id_type()); });
+    return my->_db.with_read_lock([&]() {
+        return my->cached<witness_schedule_api_obj>("database_api.get_witness_schedule", {}, [&]() {
+            return witness_schedule_api_obj(my->_db.get(witness_schedule_id_type()));
+        });
+    });
 }
 
 hardfork_version database_api::get_hardfork_version() const
@@ -389,6 +466,17 @@ hardfork_version database_api::get_hardfork_version() const
     return my->_db.with_read_lock([&]() { return my->_db.get(hardfork_property_id_type()).current_hardfork_version; });
 }
 
+chainbase::lock_stats database_api::get_lock_stats() const
+{
+    // taking the lock would count the call itself
+    return my->_db.get_lock_stats();
+}
+
+api_response_cache_stats database_api::get_api_response_cache_stats() const
+{
+    return my->_cache.get_stats();
+}
+
 scheduled_hardfork database_api::get_next_scheduled_hardfork() const
 {
     return my->_db.with_read_lock([&]() {
@@ -852,104 +940,111 @@ vector<account_name_type> database_api::get_active_witnesses() const
 state database_api::get_state(string path) const
 {
     return my->_db.with_read_lock([&]() {
-        state _state;
-        _state.props = get_dynamic_global_properties();
-        _state.current_route = path;
-
-        const auto& account_balances_service = my->_db.obtain_service<chain::dbs_account_balance>();
-        const auto& accounts_service = my->_db.obtain_service<chain::dbs_account>();
+        // the path is normalized below, the response is cached for the path as requested
+        return my->cached<state>("database_api.get_state", { fc::variant(path) }, [&]() {
+            state _state;
+            _state.props = get_dynamic_global_properties();
+            _state.current_route = path;
 
-        try
-        {
-            if (path.size() && path[0] == '/')
-                path = path.substr(1); /// remove '/' from front
+            const auto& account_balances_service = my->_db.obtain_service<chain::dbs_account_balance>();
+            const auto& accounts_service = my->_db.obtain_service<chain::dbs_account>();
 
-            if (!path.size())
-                path = "trending";
+            try
+            {
+                if (path.size() && path[0] == '/')
+                    path = path.substr(1); /// remove '/' from front
 
-            set<string> accounts;
+                if (!path.size())
+                    path = "trending";
 
-            vector<string> part;
-            part.reserve(4);
-            boost::split(part, path, boost::is_any_of("/"));
-            part.resize(std::max(part.size(), size_t(4))); // at least 4
+                set<string> accounts;
 
-            auto tag = fc::to_lower(part[1]);
+                vector<string> part;
+                part.reserve(4);
+                boost::split(part, path, boost::is_any_of("/"));
+                part.resize(std::max(part.size(), size_t(4))); // at least 4
 
-            if (part[0].size() && part[0][0] == '@')
-            {
-                auto acnt = part[0].substr(1);
+                auto tag = fc::to_lower(part[1]);
 
-                const auto& account = accounts_service.get_account(acnt);
-                const auto& auth = accounts_service.get_account_authority(acnt);
-                const auto balances = account_balances_service.get_account_balances_by_owner(acnt);
+                if (part[0].size() && part[0][0] == '@')
+                {
+                    auto acnt = part[0].substr(1);
+
+                    const auto& account = accounts_service.get_account(acnt);
+                    const auto& auth = accounts_service.get_account_authority(acnt);
+                    const auto balances = account_balances_service.get_account_balances_by_owner(acnt);
+
+                    _state.accounts[acnt] = account_api_obj(account, auth, balances);
+
+                    // auto& eacnt = _state.accounts[acnt];
+                    if (part[1] == "transfers")
+                    {
+                        // TODO: rework this garbage method - split it into sensible parts
+                        // auto history = get_account_history(acnt, uint64_t(-1), 10000);
+                        // for (auto& item : history)
+                        // {
+                        //     switch (item.second.op.which())
+                        //     {
+                        //     case operation::tag<withdraw_common_tokens_operation>::value:
+                        //     case operation::tag<transfer_operation>::value:
+                        //     case operation::tag<account_witness_vote_operation>::value:
+                        //     case operation::tag<account_witness_proxy_operation>::value:
+                        //         //   eacnt.vote_history[item.first] =  item.second;
+                        //         break;
+                        //     case operation::tag<create_account_operation>::value:
+                        //     case operation::tag<update_account_operation>::value:
+                        //     case operation::tag<witness_update_operation>::value:
+                        //     case operation::tag<producer_reward_operation>::value:
+                        //     default:
+                        //         eacnt.other_history[item.first] = item.second;
+                        //     }
+                        // }
+                    }
+                }
+                /// pull a complete discussion
 
-                _state.accounts[acnt] = account_api_obj(account, auth, balances);
+                else if (part[0] == "witnesses" || part[0] == "~witnesses")
+                {
+                    auto wits = get_witnesses_by_vote("", 50);
+                    for (const auto& w : wits)
+                    {
+                        _state.witnesses[w.owner] = w;
+                    }
+                }
 
-                // auto& eacnt = _state.accounts[acnt];
-                if (part[1] == "transfers")
+                else
                 {
-                    // TODO: rework this garbage method - split it into sensible parts
-                    // auto history = get_account_history(acnt, uint64_t(-1), 10000);
-                    // for (auto& item : history)
-                    // {
-                    //     switch (item.second.op.which())
-                    //     {
-                    //     case operation::tag<withdraw_common_tokens_operation>::value:
-                    //     case operation::tag<transfer_operation>::value:
-                    //     case operation::tag<account_witness_vote_operation>::value:
-                    //     case operation::tag<account_witness_proxy_operation>::value:
-                    //         //   eacnt.vote_history[item.first] =  item.second;
-                    //         break;
-                    //     case operation::tag<create_account_operation>::value:
-                    //     case operation::tag<update_account_operation>::value:
-                    //     case operation::tag<witness_update_operation>::value:
-                    //     case operation::tag<producer_reward_operation>::value:
-                    //     default:
-                    //         eacnt.other_history[item.first] = item.second;
-                    //     }
-                    // }
+                    elog("What... no matches");
                 }
-            }
-            /// pull a complete discussion
 
-            else if (part[0] == "witnesses" || part[0] == "~witnesses")
-            {
-                auto wits = get_witnesses_by_vote("", 50);
-                for (const auto& w : wits)
+                for (const auto& a : accounts)
                 {
-                    _state.witnesses[w.owner] = w;
+                    _state.accounts.erase("");
+                    const auto& account = accounts_service.get_account(a);
+                    const auto& auth = accounts_service.get_account_authority(a);
+                    const auto balances = account_balances_service.get_account_balances_by_owner(a);
+                    _state.accounts[a] = account_api_obj(account, auth, balances);
                 }
-            }
 
-            else
-            {
-                elog("What... no matches");
+                _state.witness_schedule = my->_db.get_witness_schedule_object();
             }
-
-            for (const auto& a : accounts)
+            catch (const fc::exception& e)
             {
-                _state.accounts.erase("");
-                const auto& account = accounts_service.get_account(a);
-                const auto& auth = accounts_service.get_account_authority(a);
-                const auto balances = account_balances_service.get_account_balances_by_owner(a);
-                _state.accounts[a] = account_api_obj(account, auth, balances);
+                _state.error = e.to_detail_string();
             }
-
-            _state.witness_schedule = my->_db.get_witness_schedule_object();
-        }
-        catch (const fc::exception& e)
-        {
-            _state.error = e.to_detail_string();
-        }
-        return _state;
+            return _state;
+        });
     });
 }
 
 vector<discipline_api_obj> database_api::lookup_disciplines(const discipline_id_type& lower_bound, uint32_t limit) const
 {
     FC_ASSERT(limit <= DEIP_API_BULK_FETCH_LIMIT);
-    return my->_db.with_read_lock([&]() { return my->lookup_disciplines(lower_bound, limit); });
+    return my->_db.with_read_lock([&]() {
+        return my->cached<vector<discipline_api_obj>>("database_api.lookup_disciplines",
+                                                      { fc::variant(lower_bound), fc::variant(limit) },
+                                                      [&]() { return my->lookup_disciplines(lower_bound, limit); });
+    });
 }
 
 vector<discipline_api_obj> database_api_impl::lookup_disciplines(const discipline_id_type& lower_bound, uint32_t limit) const
@@ -1014,26 +1109,12 @@ fc::optional<research_api_obj> database_api_impl::get_research(const external_id
 {
     optional<research_api_obj> result;
     const auto& research_service = _db.obtain_service<chain::dbs_research>();
-    const auto& research_groups_service = _db.obtain_service<chain::dbs_research_group>();
-    const auto& discipline_service = _db.obtain_service<chain::dbs_discipline>();
-    const auto& research_discipline_relation_service = _db.obtain_service<chain::dbs_research_discipline_relation>();
 
     const auto& research_opt = research_service.get_research_if_exists(id);
 
     if (research_opt.valid())
     {
-        const auto& research = (*research_opt).get();
-        vector<discipline_api_obj> disciplines;
-        const auto& discipline_relations
-            = research_discipline_relation_service.get_research_discipline_relations_by_research(research.id);
-
-        for (const chain::research_discipline_relation_object& discipline_relation : discipline_relations)
-        {
-            disciplines.push_back(discipline_service.get_discipline(discipline_relation.discipline_external_id));
-        }
-
-        const auto& research_group = research_groups_service.get_research_group(research.research_group_id);
-        result = research_api_obj(research, disciplines, research_group_api_obj(research_group));
+        result = research_api_obj_builder(_db).build((*research_opt).get());
     }
 
     return result;
@@ -1048,10 +1129,8 @@ vector<research_api_obj> database_api::get_researches(const set<external_id_type
 vector<research_api_obj> database_api_impl::get_researches(const set<external_id_type>& ids) const
 {
     const auto& research_service = _db.obtain_service<chain::dbs_research>();
-    const auto& discipline_service = _db.obtain_service<chain::dbs_discipline>();
-    const auto& research_discipline_relation_service = _db.obtain_service<chain::dbs_research_discipline_relation>();
-    const auto& research_groups_service = _db.obtain_service<chain::dbs_research_group>();
 
+    research_api_obj_builder builder(_db);
     vector<research_api_obj> result;
     for (const auto& external_id : ids)
     {
@@ -1059,17 +1138,7 @@ vector<research_api_obj> database_api_impl::get_researches(const set<external_id
 
         if (research_opt.valid())
         {
-            const auto& research = (*research_opt).get();
-            vector<discipline_api_obj> disciplines;
-
-            const auto& discipline_relations = research_discipline_relation_service.get_research_discipline_relations_by_research(research.id);
-            for (const chain::research_discipline_relation_object& discipline_relation : discipline_relations)
-            {
-                disciplines.push_back(discipline_service.get_discipline(discipline_relation.discipline_external_id));
-            }
-
-            const auto& research_group = research_groups_service.get_research_group(research.research_group_id);
-            result.push_back(research_api_obj(research, disciplines, research_group_api_obj(research_group)));
+            result.push_back(builder.build((*research_opt).get()));
         }
     }
 
@@ -1085,25 +1154,12 @@ fc::optional<research_api_obj> database_api_impl::get_research_by_id(const resea
 {
     fc::optional<research_api_obj> result;
     const auto& research_service = _db.obtain_service<chain::dbs_research>();
-    const auto& discipline_service = _db.obtain_service<chain::dbs_discipline>();
-    const auto& research_discipline_relation_service = _db.obtain_service<chain::dbs_research_discipline_relation>();
-    const auto& research_groups_service = _db.obtain_service<chain::dbs_research_group>();
 
     const auto& research_opt = research_service.get_research_if_exists(research_id);
 
     if (research_opt.valid())
     {
-        const auto& research = (*research_opt).get();
-        vector<discipline_api_obj> disciplines;
-
-        const auto& discipline_relations = research_discipline_relation_service.get_research_discipline_relations_by_research(research_id);
-        for (const chain::research_discipline_relation_object& discipline_relation : discipline_relations)
-        {
-            disciplines.push_back(discipline_service.get_discipline(discipline_relation.discipline_external_id));
-        }
-
-        const auto& research_group = research_groups_service.get_research_group(research.research_group_id);
-        result = research_api_obj(research, disciplines, research_group_api_obj(research_group));
+        result = research_api_obj_builder(_db).build((*research_opt).get());
     }
 
     return result;
@@ -1117,35 +1173,18 @@ vector<research_api_obj> database_api::get_researches_by_research_group(const ex
 
 vector<research_api_obj> database_api_impl::get_researches_by_research_group(const external_id_type& external_id) const
 {
-    vector<research_api_obj> result;
-
     const auto& research_service = _db.obtain_service<chain::dbs_research>();
     const auto& research_groups_service = _db.obtain_service<chain::dbs_research_group>();
-    const auto& disciplines_service = _db.obtain_service<chain::dbs_discipline>();
-    const auto& research_discipline_relation_service = _db.obtain_service<chain::dbs_research_discipline_relation>();
 
     const auto& research_group_opt = research_groups_service.get_research_group_by_account_if_exists(external_id);
     if (!research_group_opt.valid())
     {
-        return result;
+        return vector<research_api_obj>();
     }
 
     const auto& research_group = (*research_group_opt).get();
     const auto& researches = research_service.get_researches_by_research_group(research_group.id);
-    for (const research_object& research : researches)
-    {
-        vector<discipline_api_obj> disciplines;
-        const auto& research_discipline_relations = research_discipline_relation_service.get_research_discipline_relations_by_research(research.id);
-        for (const research_discipline_relation_object& research_discipline_relation : research_discipline_relations)
-        {
-            disciplines.push_back(disciplines_service.get_discipline(research_discipline_relation.discipline_external_id));
-        }
-
-        const auto& research_group = research_groups_service.get_research_group(research.research_group_id);
-        result.push_back(research_api_obj(research, disciplines, research_group_api_obj(research_group)));
-    }
-
-    return result;
+    return research_api_obj_builder(_db).build_all(researches);
 }
 
 vector<research_api_obj> database_api::get_researches_by_research_group_member(const account_name_type& member) const
@@ -1156,27 +1195,9 @@ vector<research_api_obj> database_api::get_researches_by_research_group_member(c
 vector<research_api_obj> database_api_impl::get_researches_by_research_group_member(const account_name_type& member) const
 {
     const auto& research_service = _db.obtain_service<chain::dbs_research>();
-    const auto& research_groups_service = _db.obtain_service<chain::dbs_research_group>();
-    const auto& research_discipline_relation_service = _db.obtain_service<chain::dbs_research_discipline_relation>();
-    const auto& disciplines_service = _db.obtain_service<chain::dbs_discipline>();
-
-    vector<research_api_obj> result;
 
     const auto& researches = research_service.get_researches_by_member(member);
-    for (const research_object& research : researches)
-    {
-        vector<discipline_api_obj> disciplines;
-        const auto& research_discipline_relations = research_discipline_relation_service.get_research_discipline_relations_by_research(research.id);
-        for (const research_discipline_relation_object& research_discipline_relation : research_discipline_relations)
-        {
-            disciplines.push_back(disciplines_service.get_discipline(research_discipline_relation.discipline_external_id));
-        }
-
-        const auto& research_group = research_groups_service.get_research_group(research.research_group_id);
-        result.push_back(research_api_obj(research, disciplines, research_group_api_obj(research_group)));
-    }
-
-    return result;
+    return research_api_obj_builder(_db).build_all(researches);
 }
 
 vector<research_api_obj> database_api::lookup_researches(const research_id_type& lower_bound,
@@ -1190,27 +1211,9 @@ vector<research_api_obj> database_api_impl::lookup_researches(const research_id_
                                                               uint32_t limit) const
 {
     const auto& research_service = _db.obtain_service<chain::dbs_research>();
-    const auto& research_groups_service = _db.obtain_service<chain::dbs_research_group>();
-    const auto& research_discipline_relation_service = _db.obtain_service<chain::dbs_research_discipline_relation>();
-    const auto& disciplines_service = _db.obtain_service<chain::dbs_discipline>();
-
-    vector<research_api_obj> result;
 
     const auto& researches = research_service.lookup_researches(lower_bound, limit);
-    for (const research_object& research : researches)
-    {
-        vector<discipline_api_obj> disciplines;
-        const auto& research_discipline_relations = research_discipline_relation_service.get_research_discipline_relations_by_research(research.id);
-        for (const research_discipline_relation_object& research_discipline_relation : research_discipline_relations)
-        {
-            disciplines.push_back(disciplines_service.get_discipline(research_discipline_relation.discipline_external_id));
-        }
-
-        const auto& research_group = research_groups_service.get_research_group(research.research_group_id);
-        result.push_back(research_api_obj(research, disciplines, research_group_api_obj(research_group)));
-    }
-
-    return result;
+    return research_api_obj_builder(_db).build_all(researches);
 }
 
 
@@ -1618,7 +1621,11 @@ vector<proposal_api_obj> database_api_impl::get_proposals_by_creator(const accou
 
 fc::optional<research_group_api_obj> database_api::get_research_group(const account_name_type& account) const
 {
-    return my->_db.with_read_lock([&]() { return my->get_research_group(account); });
+    return my->_db.with_read_lock([&]() {
+        return my->cached<fc::optional<research_group_api_obj>>("database_api.get_research_group",
+                                                                { fc::variant(account) },
+                                                                [&]() { return my->get_research_group(account); });
+    });
 }
 
 fc::optional<research_group_api_obj> database_api_impl::get_research_group(const account_name_type& id) const
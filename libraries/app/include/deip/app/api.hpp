@@ -192,6 +192,31 @@ struct deip_version_info
     fc::string fc_revision;
 };
 
+/// A call of a batch, e.g. { "api": "database_api", "method": "get_accounts", "params": [["alice"]] }
+struct api_batch_call
+{
+    std::string api;
+    std::string method;
+    fc::variants params;
+};
+
+struct api_batch_result
+{
+    fc::optional<fc::variant> result;
+    fc::optional<std::string> error; ///< set instead of the result if the call failed
+    fc::optional<int64_t> duration_us; ///< with api-batch-timing enabled
+};
+
+/**
+ * @brief Check a batch before running it
+ * @param calls Calls of the batch
+ * @param max_calls Limit of calls in a batch
+ *
+ * Only the read-only APIs may be batched, the batch runs them all under one read lock. APIs that write, wait
+ * for the network or hand out further APIs are rejected, as are the ones a batch doesn't know about.
+ */
+void validate_api_batch(const std::vector<api_batch_call>& calls, uint32_t max_calls);
+
 /**
  * @brief The login_api class implements the bottom layer of the RPC API
  *
@@ -218,6 +243,16 @@ public:
 
     deip_version_info get_version();
 
+    /**
+     * @brief Run several calls of the APIs available to this connection in one request
+     * @param calls Calls to run, in order, at most api-batch-max-calls of them
+     * @return The result or error of every call, in the same order
+     *
+     * All calls run under one read lock and see the state of the same head block. A failing call doesn't
+     * stop the ones after it. Only calls of the read-only APIs are allowed in a batch.
+     */
+    std::vector<api_batch_result> call_batch(const std::vector<api_batch_call>& calls) const;
+
     /// internal method, not exposed via JSON RPC
     void on_api_startup();
 
@@ -229,6 +264,8 @@ private:
 
 FC_REFLECT(deip::app::network_broadcast_api::transaction_confirmation, (id)(block_num)(trx_num)(expired))
 FC_REFLECT(deip::app::deip_version_info, (blockchain_version)(deip_revision)(fc_revision))
+FC_REFLECT(deip::app::api_batch_call, (api)(method)(params))
+FC_REFLECT(deip::app::api_batch_result, (result)(error)(duration_us))
 // FC_REFLECT_TYPENAME( fc::ecc::compact_signature );
 // FC_REFLECT_TYPENAME( fc::ecc::commitment_type );
 
@@ -236,4 +273,4 @@ FC_API(deip::app::network_broadcast_api, (broadcast_transaction)(broadcast_trans
                                                broadcast_transaction_synchronous)(broadcast_block)(set_max_block_age))
 FC_API(deip::app::network_node_api, (get_info)(add_node)(get_connected_peers)(get_potential_peers)(
                                           get_advanced_node_parameters)(set_advanced_node_parameters))
-FC_API(deip::app::login_api, (login)(get_api_by_name)(get_version))
+FC_API(deip::app::login_api, (login)(get_api_by_name)(get_version)(call_batch))
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <fc/io/json.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/reflect/reflect.hpp>
+#include <fc/variant.hpp>
+
+#include <condition_variable>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace deip {
+namespace app {
+
+struct api_response_cache_method_stats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t coalesced = 0;
+};
+
+struct api_response_cache_stats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t coalesced = 0; ///< misses that waited for another call computing the same response
+    uint64_t evictions = 0;
+    uint64_t invalidations = 0; ///< entries dropped because a block was applied
+    uint64_t entries = 0;
+    uint64_t size_in_bytes = 0;
+    uint64_t max_size_in_bytes = 0;
+    std::map<std::string, api_response_cache_method_stats> methods;
+};
+
+/**
+ *  Responses of API calls that only depend on the chain state, shared by all connections.
+ *
+ *  Entries are keyed by the method and its serialized parameters and tagged with the state version they were
+ *  computed at, the head sequence of the database. Every write, a block as well as a pending transaction,
+ *  moves the sequence on, so a lookup only hits responses of the state it reads. Entries of past states can't
+ *  hit any more and are dropped when a block is applied. Identical misses for the same state wait for the call
+ *  already computing the response. Least recently used entries are evicted to keep the estimated size of the
+ *  responses under the limit.
+ */
+class api_response_cache
+{
+public:
+    /// a cache of size 0 is disabled and computes every response
+    explicit api_response_cache(uint64_t max_size_in_bytes);
+
+    /**
+     *  @return the cached response of the method for the state version, or the result of compute, which is
+     *  then cached. Must be called under the database read lock the version was taken in.
+     */
+    template <typename Result, typename Compute>
+    Result get_or_compute(uint64_t version, const std::string& method, const fc::variants& params, Compute&& compute)
+    {
+        if (!_max_size_in_bytes)
+            return compute();
+
+        const std::string key = method + fc::json::to_string(params);
+
+        std::shared_ptr<const void> cached = lookup(version, method, key);
+        if (cached)
+            return *std::static_pointer_cast<const Result>(cached);
+
+        std::shared_ptr<const Result> response;
+        try
+        {
+            response = std::make_shared<const Result>(compute());
+        }
+        catch (...)
+        {
+            abandon(version, key);
+            throw;
+        }
+
+        store(version, key, response, fc::raw::pack_size(*response));
+        return *response;
+    }
+
+    void clear();
+
+    api_response_cache_stats get_stats() const;
+
+private:
+    struct entry
+    {
+        uint64_t version = 0;
+        std::shared_ptr<const void> response;
+        uint64_t size = 0;
+        std::list<std::string>::iterator lru;
+    };
+
+    /// @return the response, or null if the caller has to compute it
+    std::shared_ptr<const void> lookup(uint64_t version, const std::string& method, const std::string& key);
+    void store(uint64_t version, const std::string& key, std::shared_ptr<const void> response, uint64_t size);
+    void abandon(uint64_t version, const std::string& key);
+
+    void _erase(std::unordered_map<std::string, entry>::iterator itr);
+
+    mutable std::mutex _mutex;
+    std::condition_variable _computed;
+
+    std::unordered_map<std::string, entry> _entries;
+    std::list<std::string> _lru; ///< keys of the entries, most recently used first
+    std::unordered_map<std::string, uint64_t> _computing; ///< keys being computed and the version they are for
+
+    uint64_t _size_in_bytes = 0;
+    const uint64_t _max_size_in_bytes;
+
+    api_response_cache_stats _stats;
+};
+}
+}
+
+FC_REFLECT(deip::app::api_response_cache_method_stats, (hits)(misses)(coalesced))
+FC_REFLECT(deip::app::api_response_cache_stats,
+           (hits)(misses)(coalesced)(evictions)(invalidations)(entries)(size_in_bytes)(max_size_in_bytes)(methods))
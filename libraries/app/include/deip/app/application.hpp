@@ -25,6 +25,7 @@
 
 #include <deip/app/api_access.hpp>
 #include <deip/app/api_context.hpp>
+#include <deip/app/api_response_cache.hpp>
 #include <deip/chain/database/database.hpp>
 
 #include <graphene/net/node.hpp>
@@ -132,6 +133,13 @@ public:
 
     void get_max_block_age(int32_t& result);
 
+    uint32_t get_max_api_batch_size() const;
+    bool is_api_batch_timing_enabled() const;
+    void set_api_batch_options(uint32_t max_calls, bool timing);
+
+    /// responses of database_api calls shared by all connections
+    api_response_cache& get_api_response_cache() const;
+
     void connect_to_write_node();
 
     bool _read_only = true;
@@ -1,4 +1,5 @@
 #pragma once
+#include <deip/app/api_response_cache.hpp>
 #include <deip/app/state.hpp>
 
 #include <deip/chain/database/database.hpp>
@@ -114,6 +115,16 @@ public:
     hardfork_version get_hardfork_version() const;
     scheduled_hardfork get_next_scheduled_hardfork() const;
 
+    /**
+     * @brief Retrieve wait times of the chain state lock for API reads and block application in this node
+     */
+    chainbase::lock_stats get_lock_stats() const;
+
+    /**
+     * @brief Retrieve hit rates and size of the response cache of this node, shared by all connections
+     */
+    api_response_cache_stats get_api_response_cache_stats() const;
+
 
     //////////////
     // Accounts //
@@ -504,6 +515,9 @@ FC_REFLECT( deip::app::withdraw_route, (from_account)(to_account)(percent)(auto_
 
 FC_REFLECT_ENUM( deip::app::withdraw_route_type, (incoming)(outgoing)(all) )
 
+FC_REFLECT( chainbase::lock_wait_stats, (locks)(waits)(wait_micro)(max_wait_micro)(timeouts) )
+FC_REFLECT( chainbase::lock_stats, (read)(write)(lock_num)(torn_reads)(head_sequence) )
+
 FC_API(deip::app::database_api,
    // Subscriptions
    (set_block_applied_callback)
@@ -519,6 +533,8 @@ FC_API(deip::app::database_api,
    (get_witness_schedule)
    (get_hardfork_version)
    (get_next_scheduled_hardfork)
+   (get_lock_stats)
+   (get_api_response_cache_stats)
 
    // Accounts
    (get_accounts)
@@ -1,78 +1,510 @@
 #include <deip/chain/block_log.hpp>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <mutex>
+#include <thread>
 #include <fc/io/raw.hpp>
+#include <fc/thread/thread.hpp>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
 
-#define LOG_READ (std::ios::in | std::ios::binary)
 #define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
 
 namespace deip {
 namespace chain {
 
+namespace bip = boost::interprocess;
+
 namespace detail {
+
+/* Read only mapping of a log file. It may reach past the end of the file, appends to the file
+ * become readable through it as they are flushed, without mapping the file again. Bytes past
+ * the end of the file must not be touched.
+ */
+class log_region
+{
+public:
+    log_region(const fc::path& file, uint64_t capacity)
+        : _file(file.generic_string().c_str(), bip::read_only)
+        , _region(_file, bip::read_only, 0, capacity)
+    {
+    }
+
+    const char* data() const
+    {
+        return static_cast<const char*>(_region.get_address());
+    }
+
+    uint64_t capacity() const
+    {
+        return _region.get_size();
+    }
+
+private:
+    bip::file_mapping _file;
+    bip::mapped_region _region;
+};
+
+/* Read only view of the first `size` bytes of a log file. A view is never modified, so it can
+ * be shared with the serialized blocks handed out by the log and outlive the next one.
+ */
+class log_mapping
+{
+public:
+    log_mapping(const fc::path& file, uint64_t size)
+        : log_mapping(std::make_shared<const log_region>(file, size), size)
+    {
+    }
+
+    log_mapping(std::shared_ptr<const log_region> region, uint64_t size)
+        : _region(std::move(region))
+        , _size(size)
+    {
+    }
+
+    const char* data() const
+    {
+        return _region->data();
+    }
+
+    uint64_t size() const
+    {
+        return _size;
+    }
+
+    uint64_t read_pos(uint64_t offset) const
+    {
+        FC_ASSERT(offset + sizeof(uint64_t) <= _size, "Position is out of the mapped log bounds.",
+                  ("offset", offset)("size", _size));
+        uint64_t pos;
+        memcpy(&pos, data() + offset, sizeof(pos));
+        return pos;
+    }
+
+private:
+    std::shared_ptr<const log_region> _region;
+    uint64_t _size;
+};
+
+typedef std::shared_ptr<const log_mapping> log_mapping_ptr;
+
 class block_log_impl
 {
 public:
+    block_log_impl()
+    {
+        block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+        index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
+    }
+
+    ~block_log_impl()
+    {
+        stop_writer();
+    }
+
     optional<signed_block> head;
     block_id_type head_id;
+
+    // streams are used for appends only, all reads go through the mappings
     std::fstream block_stream;
     std::fstream index_stream;
     fc::path block_file;
     fc::path index_file;
-    bool block_write;
-    bool index_write;
 
-    inline void check_block_read()
+    // bytes appended to the files so far, buffered ones included
+    uint64_t block_size = 0;
+    uint64_t index_size = 0;
+    // bytes known to be in the files, always whole blocks and their index entries
+    uint64_t block_flushed = 0;
+    uint64_t index_flushed = 0;
+
+    std::shared_ptr<const log_region> block_region;
+    std::shared_ptr<const log_region> index_region;
+    // views of the flushed bytes, handed out until more bytes are flushed
+    log_mapping_ptr block_mapping;
+    log_mapping_ptr index_mapping;
+
+    // guards the streams, the sizes and the mappings
+    std::mutex mutex;
+
+    struct queued_block
     {
-        try
+        uint32_t block_num;
+        std::shared_ptr<const std::vector<char>> packed;
+    };
+
+    // blocks waiting for the background writer, in block number order. The writer leaves a
+    // block in the queue until it is written and flushed, so a reader finds every block either
+    // here or in the files
+    std::deque<queued_block> queue;
+    // guards the queue and the writer state
+    mutable std::mutex queue_mutex;
+    std::condition_variable queue_changed;
+    std::thread writer;
+    bool stopping = false;
+    // see block_log::hold_writer()
+    bool held = false;
+    optional<fc::exception> writer_error;
+
+    // the last block written and flushed to the files, see block_log::written_head_num()
+    std::atomic<uint32_t> written_num{ 0 };
+
+    uint32_t max_queued_blocks = block_log::default_max_queued_blocks;
+    block_log::fsync_mode fsync = block_log::fsync_mode::none;
+    fc::microseconds fsync_interval;
+    fc::time_point last_fsync;
+
+    /* Appends packed block data and its position to the log and the index. The caller holds mutex.
+     */
+    uint64_t write_block(const char* data, size_t size, uint32_t block_num)
+    {
+        uint64_t pos = block_size;
+        FC_ASSERT(index_size == sizeof(uint64_t) * ((uint64_t)block_num - 1),
+                  "Append to index file occuring at wrong position.",
+                  ("position", index_size)("expected", ((uint64_t)block_num - 1) * sizeof(uint64_t)));
+        block_stream.write(data, size);
+        block_stream.write((char*)&pos, sizeof(pos));
+        index_stream.write((char*)&pos, sizeof(pos));
+        block_size += size + sizeof(pos);
+        index_size += sizeof(pos);
+        return pos;
+    }
+
+    /* Flushes both files, so the index never refers to a block that can't be read. The caller holds mutex.
+     */
+    void flush_streams()
+    {
+        block_stream.flush();
+        index_stream.flush();
+        block_flushed = block_size;
+        index_flushed = index_size;
+    }
+
+    std::shared_ptr<const std::vector<char>> find_queued(uint32_t block_num) const
+    {
+        std::lock_guard<std::mutex> guard(queue_mutex);
+        if (queue.empty() || block_num < queue.front().block_num || block_num > queue.back().block_num)
+            return std::shared_ptr<const std::vector<char>>();
+        return queue[block_num - queue.front().block_num].packed;
+    }
+
+    void start_writer(uint32_t max_blocks, block_log::fsync_mode mode, uint32_t interval_ms)
+    {
+        FC_ASSERT(!writer.joinable(), "Block log writer is already running.");
+        FC_ASSERT(max_blocks > 0);
+        max_queued_blocks = max_blocks;
+        fsync = mode;
+        fsync_interval = fc::milliseconds(interval_ms);
+        last_fsync = fc::time_point::now();
+        stopping = false;
+        held = false;
+        writer_error.reset();
+        writer = std::thread([this]() { write_queue(); });
+    }
+
+    void stop_writer()
+    {
+        if (!writer.joinable())
+            return;
         {
-            if (block_write)
-            {
-                block_stream.close();
-                block_stream.open(block_file.generic_string().c_str(), LOG_READ);
-                block_write = false;
-            }
+            std::lock_guard<std::mutex> guard(queue_mutex);
+            stopping = true;
         }
-        FC_LOG_AND_RETHROW()
+        queue_changed.notify_all();
+        writer.join();
+
+        if (!queue.empty())
+            elog("Block log writer stopped with ${n} blocks that could not be written: ${e}",
+                 ("n", queue.size())("e", writer_error ? writer_error->to_detail_string() : std::string()));
+        queue.clear();
     }
 
-    inline void check_block_write()
+    void enqueue(uint32_t block_num, std::shared_ptr<const std::vector<char>> packed)
     {
-        try
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        queue_changed.wait(lock, [&]() { return writer_error || queue.size() < max_queued_blocks; });
+        if (writer_error)
+            throw *writer_error;
+        FC_ASSERT(queue.empty() || queue.back().block_num + 1 == block_num,
+                  "Append to block log queue occuring at wrong position.",
+                  ("block_num", block_num)("expected", queue.back().block_num + 1));
+        queue.push_back({ block_num, std::move(packed) });
+        lock.unlock();
+        queue_changed.notify_all();
+    }
+
+    /// waits until the writer has written everything queued so far
+    void drain()
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        queue_changed.wait(lock, [&]() { return writer_error || queue.empty(); });
+        if (writer_error)
+            throw *writer_error;
+    }
+
+    /* The writer loop. Every pass writes all the blocks queued at its start and flushes once,
+     * so the flush and the sync are shared by every block that arrived during the previous pass.
+     */
+    void write_queue()
+    {
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        while (true)
         {
-            if (!block_write)
+            queue_changed.wait(lock, [&]() { return stopping || (!held && !queue.empty()); });
+            if (queue.empty() || held)
+                break;
+
+            const std::vector<queued_block> batch(queue.begin(), queue.end());
+            lock.unlock();
+
+            optional<fc::exception> error;
+            try
+            {
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    for (const queued_block& b : batch)
+                        write_block(b.packed->data(), b.packed->size(), b.block_num);
+                    flush_streams();
+                }
+                sync_files(false);
+                written_num.store(batch.back().block_num);
+            }
+            catch (const fc::exception& e)
             {
-                block_stream.close();
-                block_stream.open(block_file.generic_string().c_str(), LOG_WRITE);
-                block_write = true;
+                error = e;
             }
+            catch (const std::exception& e)
+            {
+                error = fc::std_exception_wrapper::from_current_exception(e);
+            }
+
+            lock.lock();
+            if (error)
+            {
+                elog("Block log writer failed: ${e}", ("e", error->to_detail_string()));
+                writer_error = error;
+                queue_changed.notify_all();
+                break;
+            }
+            queue.erase(queue.begin(), queue.begin() + batch.size());
+            queue_changed.notify_all();
         }
-        FC_LOG_AND_RETHROW()
+        lock.unlock();
+
+        if (!writer_error)
+            sync_files(true);
+    }
+
+    void sync_files(bool stopping_writer)
+    {
+        if (fsync == block_log::fsync_mode::none)
+            return;
+
+        const auto now = fc::time_point::now();
+        if (fsync == block_log::fsync_mode::interval && !stopping_writer && now - last_fsync < fsync_interval)
+            return;
+
+        sync_file(block_file);
+        sync_file(index_file);
+        last_fsync = now;
     }
 
-    inline void check_index_read()
+    static void sync_file(const fc::path& file)
+    {
+        int fd = ::open(file.generic_string().c_str(), O_RDONLY);
+        FC_ASSERT(fd >= 0, "Can not open ${file} to sync it.", ("file", file));
+        int result = ::fsync(fd);
+        ::close(fd);
+        FC_ASSERT(result == 0, "Can not sync ${file}.", ("file", file));
+    }
+
+    /* Returns where the complete block starting at pos ends, its trailing position included,
+     * or block_log::npos if the block there is missing or partially written.
+     */
+    static uint64_t complete_block_end(const log_mapping& blocks, uint64_t pos)
     {
         try
         {
-            if (index_write)
+            if (pos >= blocks.size())
+                return block_log::npos;
+
+            fc::datastream<const char*> ds(blocks.data() + pos, blocks.size() - pos);
+            signed_block b;
+            fc::raw::unpack(ds, b);
+            const uint64_t trailing = pos + ds.tellp();
+            if (trailing + sizeof(uint64_t) > blocks.size() || blocks.read_pos(trailing) != pos)
+                return block_log::npos;
+            return trailing + sizeof(uint64_t);
+        }
+        catch (const fc::exception&)
+        {
+            return block_log::npos;
+        }
+    }
+
+    /* A crash while appending can leave a partially written block at the end of the log. Cuts the
+     * log back to the end of its last complete block, found by unpacking forward from the last
+     * intact block the index points to. The index is reconciled with the log afterwards.
+     */
+    void recover_torn_tail()
+    {
+        const uint64_t size = fc::file_size(block_file);
+        if (size == 0)
+            return;
+
+        uint64_t end = 0;
+        {
+            log_mapping blocks(block_file, size);
+            if (size >= sizeof(uint64_t)
+                && complete_block_end(blocks, blocks.read_pos(size - sizeof(uint64_t))) == size)
+                return;
+
+            wlog("Block log ends with a partially written block, looking for the last complete one");
+
+            const uint64_t index_bytes = fc::exists(index_file) ? fc::file_size(index_file) : 0;
+            const uint64_t index_count = index_bytes / sizeof(uint64_t);
+            if (index_count)
             {
-                index_stream.close();
-                index_stream.open(index_file.generic_string().c_str(), LOG_READ);
-                index_write = false;
+                log_mapping index(index_file, index_count * sizeof(uint64_t));
+                for (uint64_t i = index_count; i > 0; --i)
+                {
+                    const uint64_t pos = index.read_pos((i - 1) * sizeof(uint64_t));
+                    if (complete_block_end(blocks, pos) != block_log::npos)
+                    {
+                        end = pos;
+                        break;
+                    }
+                }
             }
+
+            for (uint64_t next = complete_block_end(blocks, end); next != block_log::npos;
+                 next = complete_block_end(blocks, end))
+                end = next;
         }
-        FC_LOG_AND_RETHROW()
+
+        wlog("Truncating block log from ${size} to ${end} bytes", ("size", size)("end", end));
+        boost::filesystem::resize_file(boost::filesystem::path(block_file.generic_string()), end);
+    }
+
+    /* The map functions return views of the flushed part of the files. The files are only flushed
+     * when a read needs more than that, reading the first `needed` bytes.
+     */
+    log_mapping_ptr map_blocks(uint64_t needed = block_log::npos)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (std::min(needed, block_size) > block_flushed)
+            flush_streams();
+        return view(block_file, block_flushed, block_region, block_mapping);
+    }
+
+    log_mapping_ptr map_index(uint64_t needed = block_log::npos)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (std::min(needed, index_size) > index_flushed)
+            flush_streams();
+        return view(index_file, index_flushed, index_region, index_mapping);
+    }
+
+    /* Maps both files at the same point of time, so every block referenced by the index
+     * view is covered by the block view.
+     */
+    void map(log_mapping_ptr& blocks, log_mapping_ptr& index, uint64_t index_needed)
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        if (std::min(index_needed, index_size) > index_flushed)
+            flush_streams();
+        blocks = view(block_file, block_flushed, block_region, block_mapping);
+        index = view(index_file, index_flushed, index_region, index_mapping);
+    }
+
+    void reset_index()
+    {
+        index_stream.close();
+        fc::remove_all(index_file);
+        index_stream.open(index_file.generic_string().c_str(), LOG_WRITE);
+        index_size = 0;
+        index_flushed = 0;
+        index_region.reset();
+        index_mapping.reset();
+    }
+
+    /* Collects the positions of all blocks by following the position stored after every block,
+     * from the head block back to the first one. Blocks are not deserialized.
+     */
+    static std::vector<uint64_t> collect_block_positions(const log_mapping& blocks, uint32_t block_count)
+    {
+        std::vector<uint64_t> positions(block_count);
+        uint64_t end = blocks.size();
+        for (uint32_t block_num = block_count; block_num > 0; --block_num)
+        {
+            FC_ASSERT(end >= sizeof(uint64_t), "Block log is shorter than expected.", ("block_num", block_num));
+            uint64_t pos = blocks.read_pos(end - sizeof(uint64_t));
+            FC_ASSERT(pos + sizeof(uint64_t) < end, "Block log position is corrupted.",
+                      ("block_num", block_num)("pos", pos)("end", end));
+            positions[block_num - 1] = pos;
+            end = pos;
+        }
+        FC_ASSERT(end == 0, "Block log has data before the first block.", ("pos", end));
+        return positions;
     }
 
-    inline void check_index_write()
+    /* Checks that the blocks [first, last) are found at the collected positions. Only the previous
+     * block id at the beginning of every block header is read.
+     */
+    static void verify_block_positions(const log_mapping& blocks,
+                                       const std::vector<uint64_t>& positions,
+                                       uint32_t first,
+                                       uint32_t last)
+    {
+        block_id_type previous;
+        for (uint32_t i = first; i < last; ++i)
+        {
+            FC_ASSERT(positions[i] + previous.data_size() <= blocks.size());
+            memcpy(previous.data(), blocks.data() + positions[i], previous.data_size());
+            FC_ASSERT(block_header::num_from_id(previous) == i, "Wrong block was found in block log.",
+                      ("returned", block_header::num_from_id(previous) + 1)("expected", i + 1));
+        }
+    }
+
+    static void log_index_throughput(uint32_t block_count, uint64_t log_size, const fc::time_point& start)
+    {
+        const double seconds = std::max<int64_t>((fc::time_point::now() - start).count(), 1) / 1000000.0;
+        const double mib = log_size / double(1024 * 1024);
+        ilog("Block log index reconstructed: ${n} blocks, ${mib} MiB in ${s} sec (${bps} blocks/sec, ${mibps} MiB/sec)",
+             ("n", block_count)("mib", uint64_t(mib))("s", seconds)("bps", uint64_t(block_count / seconds))(
+                 "mibps", uint64_t(mib / seconds)));
+    }
+
+private:
+    /* Returns a view of the first `size` bytes of the file. The file is only mapped again once the
+     * view outgrows the region, which reserves block_log::mapping_reserve bytes past the end.
+     */
+    static log_mapping_ptr view(const fc::path& file,
+                                uint64_t size,
+                                std::shared_ptr<const log_region>& region,
+                                log_mapping_ptr& mapping)
     {
         try
         {
-            if (!index_write)
+            if (size == 0)
+                return log_mapping_ptr();
+
+            if (!mapping || mapping->size() != size)
             {
-                index_stream.close();
-                index_stream.open(index_file.generic_string().c_str(), LOG_WRITE);
-                index_write = true;
+                if (!region || region->capacity() < size)
+                    region = std::make_shared<const log_region>(file, size + block_log::mapping_reserve);
+                mapping = std::make_shared<const log_mapping>(region, size);
             }
+
+            return mapping;
         }
         FC_LOG_AND_RETHROW()
     }
@@ -82,17 +514,20 @@ public:
 block_log::block_log()
     : my(new detail::block_log_impl())
 {
-    my->block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
-    my->index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
 }
 
 block_log::~block_log()
 {
-    flush();
+    try
+    {
+        flush();
+    }
+    FC_CAPTURE_AND_LOG(())
 }
 
 void block_log::open(const fc::path& file)
 {
+    my->stop_writer();
     if (my->block_stream.is_open())
         my->block_stream.close();
     if (my->index_stream.is_open())
@@ -100,11 +535,16 @@ void block_log::open(const fc::path& file)
 
     my->block_file = file;
     my->index_file = fc::path(file.generic_string() + ".index");
+    my->block_region.reset();
+    my->index_region.reset();
+    my->block_mapping.reset();
+    my->index_mapping.reset();
+
+    if (fc::exists(my->block_file))
+        my->recover_torn_tail();
 
     my->block_stream.open(my->block_file.generic_string().c_str(), LOG_WRITE);
     my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-    my->block_write = true;
-    my->index_write = true;
 
     /* On startup of the block log, there are several states the log file and the index file can be
      * in relation to eachother.
@@ -127,6 +567,11 @@ void block_log::open(const fc::path& file)
     auto log_size = fc::file_size(my->block_file);
     auto index_size = fc::file_size(my->index_file);
 
+    my->block_size = log_size;
+    my->index_size = index_size;
+    my->block_flushed = log_size;
+    my->index_flushed = index_size;
+
     if (log_size)
     {
         ilog("Log is nonempty");
@@ -135,17 +580,9 @@ void block_log::open(const fc::path& file)
 
         if (index_size)
         {
-            my->check_block_read();
-            my->check_index_read();
-
             ilog("Index is nonempty");
-            uint64_t block_pos;
-            my->block_stream.seekg(-sizeof(uint64_t), std::ios::end);
-            my->block_stream.read((char*)&block_pos, sizeof(block_pos));
-
-            uint64_t index_pos;
-            my->index_stream.seekg(-sizeof(uint64_t), std::ios::end);
-            my->index_stream.read((char*)&index_pos, sizeof(index_pos));
+            uint64_t block_pos = my->map_blocks()->read_pos(log_size - sizeof(uint64_t));
+            uint64_t index_pos = my->map_index()->read_pos(index_size - sizeof(uint64_t));
 
             if (block_pos < index_pos)
             {
@@ -167,15 +604,15 @@ void block_log::open(const fc::path& file)
     else if (index_size)
     {
         ilog("Index is nonempty, remove and recreate it");
-        my->index_stream.close();
-        fc::remove_all(my->index_file);
-        my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-        my->index_write = true;
+        my->reset_index();
     }
+
+    my->written_num.store(log_size ? my->head->block_num() : 0);
 }
 
 void block_log::close()
 {
+    my->stop_writer();
     my.reset(new detail::block_log_impl());
 }
 
@@ -188,19 +625,15 @@ uint64_t block_log::append(const signed_block& b)
 {
     try
     {
-        my->check_block_write();
-        my->check_index_write();
+        // blocks have to reach the log in order, so whatever is queued goes first
+        if (my->writer.joinable())
+            my->drain();
+
+        std::lock_guard<std::mutex> guard(my->mutex);
 
-        uint64_t pos = my->block_stream.tellp();
-        FC_ASSERT((uint64_t)my->index_stream.tellp()
-                      == (std::fstream::streampos)sizeof(uint64_t) * ((uint64_t)b.block_num() - 1),
-                  "Append to index file occuring at wrong position.",
-                  ("position", (uint64_t)my->index_stream.tellp())("expected",
-                                                                   ((uint64_t)b.block_num() - 1) * sizeof(uint64_t)));
         auto data = fc::raw::pack(b);
-        my->block_stream.write(data.data(), data.size());
-        my->block_stream.write((char*)&pos, sizeof(pos));
-        my->index_stream.write((char*)&pos, sizeof(pos));
+        uint64_t pos = my->write_block(data.data(), data.size(), b.block_num());
+        my->written_num.store(b.block_num());
         my->head = b;
         my->head_id = b.id();
 
@@ -209,22 +642,79 @@ uint64_t block_log::append(const signed_block& b)
     FC_LOG_AND_RETHROW()
 }
 
+void block_log::append_async(const signed_block& b)
+{
+    try
+    {
+        if (!my->writer.joinable())
+        {
+            append(b);
+            return;
+        }
+
+        my->enqueue(b.block_num(), std::make_shared<const std::vector<char>>(fc::raw::pack(b)));
+        my->head = b;
+        my->head_id = b.id();
+    }
+    FC_LOG_AND_RETHROW()
+}
+
 void block_log::flush()
 {
-    my->block_stream.flush();
-    my->index_stream.flush();
+    if (my->writer.joinable())
+        my->drain();
+
+    std::lock_guard<std::mutex> guard(my->mutex);
+    my->flush_streams();
+}
+
+void block_log::start_writer(uint32_t max_queued_blocks, fsync_mode mode, uint32_t fsync_interval_ms)
+{
+    my->start_writer(max_queued_blocks, mode, fsync_interval_ms);
+}
+
+void block_log::stop_writer()
+{
+    my->stop_writer();
+}
+
+bool block_log::has_writer() const
+{
+    return my->writer.joinable();
+}
+
+uint32_t block_log::written_head_num() const
+{
+    return my->written_num.load();
+}
+
+void block_log::hold_writer(bool hold)
+{
+    {
+        std::lock_guard<std::mutex> guard(my->queue_mutex);
+        my->held = hold;
+    }
+    my->queue_changed.notify_all();
+}
+
+size_t block_log::queued_blocks() const
+{
+    std::lock_guard<std::mutex> guard(my->queue_mutex);
+    return my->queue.size();
 }
 
 std::pair<signed_block, uint64_t> block_log::read_block(uint64_t pos) const
 {
     try
     {
-        my->check_block_read();
+        // blocks are flushed whole, so having the first byte of the block means having all of it
+        auto blocks = my->map_blocks(pos + 1);
+        FC_ASSERT(blocks && pos < blocks->size(), "Block position is out of the block log bounds.", ("pos", pos));
 
-        my->block_stream.seekg(pos);
+        fc::datastream<const char*> ds(blocks->data() + pos, blocks->size() - pos);
         std::pair<signed_block, uint64_t> result;
-        fc::raw::unpack(my->block_stream, result.first);
-        result.second = uint64_t(my->block_stream.tellg()) + 8;
+        fc::raw::unpack(ds, result.first);
+        result.second = pos + ds.tellp() + sizeof(uint64_t);
         return result;
     }
     FC_LOG_AND_RETHROW()
@@ -235,6 +725,12 @@ optional<signed_block> block_log::read_block_by_num(uint32_t block_num) const
     try
     {
         optional<signed_block> b;
+        if (auto packed = my->find_queued(block_num))
+        {
+            b = fc::raw::unpack<signed_block>(*packed);
+            return b;
+        }
+
         uint64_t pos = get_block_pos(block_num);
         if (pos != npos)
         {
@@ -247,18 +743,61 @@ optional<signed_block> block_log::read_block_by_num(uint32_t block_num) const
     FC_LOG_AND_RETHROW()
 }
 
-uint64_t block_log::get_block_pos(uint32_t block_num) const
+optional<serialized_block> block_log::read_serialized_block_by_num(uint32_t block_num) const
 {
     try
     {
-        my->check_index_read();
+        optional<serialized_block> result;
+
+        if (auto packed = my->find_queued(block_num))
+        {
+            serialized_block b;
+            b.data = std::shared_ptr<const char>(packed, packed->data());
+            b.size = packed->size();
+            result = std::move(b);
+            return result;
+        }
+
+        detail::log_mapping_ptr blocks;
+        detail::log_mapping_ptr index;
+        my->map(blocks, index, sizeof(uint64_t) * block_num);
 
-        if (!(my->head.valid() && block_num <= protocol::block_header::num_from_id(my->head_id) && block_num > 0))
+        const uint64_t last_block_num = index ? index->size() / sizeof(uint64_t) : 0;
+        if (block_num == 0 || block_num > last_block_num)
+            return result;
+
+        // a block ends where its trailing position starts
+        const uint64_t pos = index->read_pos(sizeof(uint64_t) * (block_num - 1));
+        const uint64_t end = block_num < last_block_num ? index->read_pos(sizeof(uint64_t) * block_num)
+                                                        : blocks->size();
+        FC_ASSERT(pos + sizeof(uint64_t) < end && end <= blocks->size(), "Block log index is corrupted.",
+                  ("block_num", block_num)("pos", pos)("end", end));
+
+        serialized_block b;
+        b.data = std::shared_ptr<const char>(blocks, blocks->data() + pos);
+        b.size = end - pos - sizeof(uint64_t);
+
+        fc::datastream<const char*> ds(b.data.get(), b.size);
+        signed_block_header header;
+        fc::raw::unpack(ds, header);
+        FC_ASSERT(header.block_num() == block_num, "Wrong block was read from block log.",
+                  ("returned", header.block_num())("expected", block_num));
+
+        result = std::move(b);
+        return result;
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+uint64_t block_log::get_block_pos(uint32_t block_num) const
+{
+    try
+    {
+        auto index = my->map_index(sizeof(uint64_t) * block_num);
+        if (!index || block_num == 0 || sizeof(uint64_t) * block_num > index->size())
             return npos;
-        my->index_stream.seekg(sizeof(uint64_t) * (block_num - 1));
-        uint64_t pos;
-        my->index_stream.read((char*)&pos, sizeof(pos));
-        return pos;
+
+        return index->read_pos(sizeof(uint64_t) * (block_num - 1));
     }
     FC_LOG_AND_RETHROW()
 }
@@ -267,12 +806,9 @@ signed_block block_log::read_head() const
 {
     try
     {
-        my->check_block_read();
-
-        uint64_t pos;
-        my->block_stream.seekg(-sizeof(pos), std::ios::end);
-        my->block_stream.read((char*)&pos, sizeof(pos));
-        return read_block(pos).first;
+        auto blocks = my->map_blocks();
+        FC_ASSERT(blocks, "Block log is empty.");
+        return read_block(blocks->read_pos(blocks->size() - sizeof(uint64_t))).first;
     }
     FC_LOG_AND_RETHROW()
 }
@@ -282,32 +818,109 @@ const optional<signed_block>& block_log::head() const
     return my->head;
 }
 
-void block_log::construct_index()
+void block_log::construct_index(uint32_t threads)
 {
     try
     {
         ilog("Reconstructing Block Log Index...");
-        my->index_stream.close();
-        fc::remove_all(my->index_file);
-        my->index_stream.open(my->index_file.generic_string().c_str(), LOG_WRITE);
-        my->index_write = true;
+        const auto start = fc::time_point::now();
+        my->reset_index();
 
-        uint64_t pos = 0;
-        uint64_t end_pos;
-        my->check_block_read();
+        auto blocks = my->map_blocks();
+        FC_ASSERT(blocks && my->head.valid(), "Block log is empty.");
+        const uint32_t block_count = my->head->block_num();
+
+        std::vector<uint64_t> positions;
+        try
+        {
+            positions = detail::block_log_impl::collect_block_positions(*blocks, block_count);
+
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            threads = std::min(threads, std::max(1u, block_count / min_blocks_per_index_thread));
+
+            std::vector<std::shared_ptr<fc::thread>> workers;
+            std::vector<fc::future<void>> verified;
+            const uint32_t blocks_per_thread = (block_count + threads - 1) / threads;
+            for (uint32_t first = 0; first < block_count; first += blocks_per_thread)
+            {
+                const uint32_t last = std::min(block_count, first + blocks_per_thread);
+                workers.push_back(std::make_shared<fc::thread>("block_log_index_" + std::to_string(workers.size())));
+                verified.push_back(workers.back()->async(
+                    [&blocks, &positions, first, last]() {
+                        detail::block_log_impl::verify_block_positions(*blocks, positions, first, last);
+                    },
+                    "verify_block_positions"));
+            }
+            // workers reference the positions, so all of them are waited for before reporting a failure
+            optional<fc::exception> error;
+            for (auto& f : verified)
+            {
+                try
+                {
+                    f.wait();
+                }
+                catch (const fc::exception& e)
+                {
+                    if (!error)
+                        error = e;
+                }
+            }
+            if (error)
+                throw *error;
+        }
+        catch (const fc::exception& e)
+        {
+            wlog("Can not follow block positions, falling back to unpacking every block: ${e}",
+                 ("e", e.to_detail_string()));
+            construct_index_by_unpacking();
+            return;
+        }
+
+        const size_t chunk = index_write_chunk;
+        for (size_t i = 0; i < positions.size(); i += chunk)
+        {
+            const size_t count = std::min(chunk, positions.size() - i);
+            my->index_stream.write((const char*)(positions.data() + i), count * sizeof(uint64_t));
+        }
+        my->index_stream.flush();
+        my->index_size = positions.size() * sizeof(uint64_t);
+        my->index_flushed = my->index_size;
 
-        my->block_stream.seekg(-sizeof(uint64_t), std::ios::end);
-        my->block_stream.read((char*)&end_pos, sizeof(end_pos));
+        detail::block_log_impl::log_index_throughput(block_count, blocks->size(), start);
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+void block_log::construct_index_by_unpacking()
+{
+    try
+    {
+        ilog("Reconstructing Block Log Index by unpacking blocks...");
+        const auto start = fc::time_point::now();
+        my->reset_index();
+
+        auto blocks = my->map_blocks();
+        FC_ASSERT(blocks, "Block log is empty.");
+        uint64_t end_pos = blocks->read_pos(blocks->size() - sizeof(uint64_t));
+        uint64_t pos = 0;
+        uint32_t block_count = 0;
         signed_block tmp;
 
-        my->block_stream.seekg(pos);
+        fc::datastream<const char*> ds(blocks->data(), blocks->size());
 
         while (pos < end_pos)
         {
-            fc::raw::unpack(my->block_stream, tmp);
-            my->block_stream.read((char*)&pos, sizeof(pos));
+            fc::raw::unpack(ds, tmp);
+            ds.read((char*)&pos, sizeof(pos));
             my->index_stream.write((char*)&pos, sizeof(pos));
+            my->index_size += sizeof(pos);
+            ++block_count;
         }
+        my->index_stream.flush();
+        my->index_flushed = my->index_size;
+
+        detail::block_log_impl::log_index_throughput(block_count, blocks->size(), start);
     }
     FC_LOG_AND_RETHROW()
 }
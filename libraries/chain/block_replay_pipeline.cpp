@@ -0,0 +1,122 @@
+#include <deip/chain/block_replay_pipeline.hpp>
+
+#include <fc/thread/thread.hpp>
+
+namespace deip {
+namespace chain {
+
+block_replay_pipeline::block_replay_pipeline(const block_log& log, uint32_t first_block_num, size_t capacity)
+    : _log(log)
+    , _first_block_num(std::max(first_block_num, 1u))
+    , _ring(std::max<size_t>(capacity, 1))
+    , _decode_time_us(0)
+    , _decoded_bytes(0)
+{
+    _reader = std::make_shared<fc::thread>("block_replay_reader");
+    _reading = _reader->async([this]() { _read(); }, "block_replay_read");
+}
+
+block_replay_pipeline::~block_replay_pipeline()
+{
+    _stop();
+    try
+    {
+        _reading.wait();
+    }
+    catch (const fc::exception& e)
+    {
+        wlog("Block replay reader failed: ${e}", ("e", e.to_detail_string()));
+    }
+}
+
+bool block_replay_pipeline::next(decoded_block& b)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _not_empty.wait(lock, [this]() { return _count > 0 || _finished; });
+
+    if (_count == 0)
+    {
+        if (_error)
+            throw *_error;
+        return false;
+    }
+
+    b = std::move(_ring[_first]);
+    _first = (_first + 1) % _ring.size();
+    --_count;
+
+    lock.unlock();
+    _not_full.notify_one();
+    return true;
+}
+
+fc::microseconds block_replay_pipeline::decode_time() const
+{
+    return fc::microseconds(_decode_time_us.load());
+}
+
+uint64_t block_replay_pipeline::decoded_bytes() const
+{
+    return _decoded_bytes.load();
+}
+
+void block_replay_pipeline::_read()
+{
+    try
+    {
+        const auto& head = _log.head();
+        const uint32_t last_block_num = head.valid() ? head->block_num() : 0;
+
+        uint64_t pos = _log.get_block_pos(_first_block_num);
+        for (uint32_t block_num = _first_block_num; block_num <= last_block_num; ++block_num)
+        {
+            const auto start = fc::time_point::now();
+
+            decoded_block b;
+            auto itr = _log.read_block(pos);
+            b.block = std::move(itr.first);
+            b.size = itr.second - pos - sizeof(uint64_t);
+            b.block_id = b.block.id();
+            b.transaction_ids.reserve(b.block.transactions.size());
+            for (const auto& trx : b.block.transactions)
+                b.transaction_ids.push_back(trx.id());
+            pos = itr.second;
+
+            _decode_time_us += (fc::time_point::now() - start).count();
+            _decoded_bytes += b.size;
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            _not_full.wait(lock, [this]() { return _count < _ring.size() || _stopped; });
+            if (_stopped)
+                return;
+
+            _ring[(_first + _count) % _ring.size()] = std::move(b);
+            ++_count;
+
+            lock.unlock();
+            _not_empty.notify_one();
+        }
+    }
+    catch (const fc::exception& e)
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _error = e;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _finished = true;
+    }
+    _not_empty.notify_all();
+}
+
+void block_replay_pipeline::_stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _stopped = true;
+    }
+    _not_full.notify_all();
+}
+}
+} // deip::chain
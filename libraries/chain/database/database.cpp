@@ -3,6 +3,7 @@
 #include <deip/chain/database/database.hpp>
 #include <deip/chain/database/database_exceptions.hpp>
 #include <deip/chain/database/db_with.hpp>
+#include <deip/chain/block_replay_pipeline.hpp>
 
 #include <deip/chain/deip_evaluator.hpp>
 #include <deip/chain/evaluator_registry.hpp>
@@ -55,7 +56,9 @@
 #include <fc/container/deque.hpp>
 #include <fc/io/fstream.hpp>
 #include <fc/io/json.hpp>
+#include <fc/thread/thread.hpp>
 
+#include <atomic>
 #include <cstdint>
 #include <deque>
 #include <fstream>
@@ -112,14 +115,96 @@ class database_impl
 public:
     database_impl(database& self);
 
+    transaction_signees get_transaction_signees(const signed_transaction& trx) const;
+    fc::ecc::public_key get_block_signee(const signed_block& b) const;
+
+    block_id_type get_block_id(const signed_block& b) const;
+    transaction_id_type get_transaction_id(const signed_transaction& trx) const;
+    uint64_t get_block_size(const signed_block& b) const;
+
     database& _self;
     evaluator_registry<operation> _evaluator_registry;
+
+    chain_id_type _chain_id;
+    std::shared_ptr<transaction_signees_cache> _signees_cache;
+    std::shared_ptr<block_signee_cache> _block_signees;
+    std::atomic<uint32_t> _next_signature_recovery_thread;
+    std::vector<std::shared_ptr<fc::thread>> _signature_recovery_threads;
+
+    // block being replayed with its precomputed ids, set only while it is applied
+    const decoded_block* _replayed_block = nullptr;
+
+    // block being applied with its id, hashed once for the signee lookup, checks and summaries
+    const signed_block* _applied_block = nullptr;
+    block_id_type _applied_block_id;
 };
 
 database_impl::database_impl(database& self)
     : _self(self)
     , _evaluator_registry(self)
+    , _signees_cache(std::make_shared<transaction_signees_cache>())
+    , _block_signees(std::make_shared<block_signee_cache>())
+    , _next_signature_recovery_thread(0)
+{
+}
+
+transaction_signees database_impl::get_transaction_signees(const signed_transaction& trx) const
+{
+    const auto chain_id = _self.get_chain_id();
+
+    optional<digest_type> key;
+    if (!_signature_recovery_threads.empty())
+    {
+        key = transaction_signees_cache::key(trx);
+        auto cached = _signees_cache->find(*key);
+        if (cached.valid())
+            return *cached;
+    }
+
+    transaction_signees result;
+    result.signature_keys = trx.get_signature_keys(chain_id);
+    result.tenant_signature_key = trx.get_tenant_signature_key(chain_id);
+
+    if (key.valid())
+        _signees_cache->insert(*key, result);
+
+    return result;
+}
+
+fc::ecc::public_key database_impl::get_block_signee(const signed_block& b) const
+{
+    if (!_signature_recovery_threads.empty())
+        return _block_signees->take_or_recover(b, get_block_id(b));
+    return b.signee();
+}
+
+block_id_type database_impl::get_block_id(const signed_block& b) const
 {
+    if (_applied_block == &b)
+        return _applied_block_id;
+    if (_replayed_block && &_replayed_block->block == &b)
+        return _replayed_block->block_id;
+    return b.id();
+}
+
+transaction_id_type database_impl::get_transaction_id(const signed_transaction& trx) const
+{
+    if (_replayed_block)
+    {
+        const signed_transaction* first = _replayed_block->block.transactions.data();
+        const signed_transaction* last = first + _replayed_block->block.transactions.size();
+        std::less<const signed_transaction*> less;
+        if (!less(&trx, first) && less(&trx, last))
+            return _replayed_block->transaction_ids[&trx - first];
+    }
+    return trx.id();
+}
+
+uint64_t database_impl::get_block_size(const signed_block& b) const
+{
+    if (_replayed_block && &_replayed_block->block == &b)
+        return _replayed_block->size;
+    return fc::raw::pack_size(b);
 }
 
 database::database()
@@ -150,12 +235,15 @@ void database::open(const fc::path& data_dir,
         if (chainbase_flags & chainbase::database::read_write)
         {
             if (!find<dynamic_global_property_object>())
-                with_write_lock([&]() { init_genesis(genesis_state); });
+                with_write_lock([&]() { with_deferred_flush([&]() { init_genesis(genesis_state); }); });
 
             if (!fc::exists(data_dir))
                 fc::create_directories(data_dir);
 
             _block_log.open(data_dir / "block_log");
+            if (_block_log_writer_queue_size)
+                _block_log.start_writer(_block_log_writer_queue_size, _block_log_fsync_mode,
+                                        _block_log_fsync_interval_ms);
 
             auto log_head = _block_log.head();
 
@@ -166,6 +254,15 @@ void database::open(const fc::path& data_dir,
                           ("rev", revision())("head_block", head_block_num()));
 
                 validate_invariants();
+
+                // the state is only committed up to blocks the block log writer has written, the log can be
+                // ahead of it after a crash. Those blocks are irreversible, so they are replayed from the log
+                if (log_head && log_head->block_num() > head_block_num())
+                {
+                    ilog("Replaying blocks ${f}..${n} the block log has ahead of the chain state",
+                         ("f", head_block_num() + 1)("n", log_head->block_num()));
+                    _replay_block_log(head_block_num() + 1, fc::time_point::now());
+                }
             });
 
             if (head_block_num())
@@ -181,6 +278,7 @@ void database::open(const fc::path& data_dir,
 
         with_read_lock([&]() {
             init_hardforks(genesis_state.initial_timestamp); // Writes to local state, but reads from db
+            _my->_chain_id = get_chain_id();
         });
     }
     FC_CAPTURE_LOG_AND_RETHROW((data_dir)(shared_mem_dir)(shared_file_size))
@@ -203,35 +301,223 @@ void database::reindex(const fc::path& data_dir,
 
         ilog("Replaying blocks...");
 
-        uint64_t skip_flags = skip_witness_signature | skip_transaction_signatures | skip_transaction_dupe_check
-            | skip_tapos_check | skip_merkle_check | skip_witness_schedule_check | skip_authority_check | skip_validate
-            | /// no need to validate operations
-            skip_validate_invariants | skip_block_log;
+        // flushes are not deferred, so an interrupted reindex resumes from the last periodic flush
+        with_write_lock([&]() { _replay_block_log(1, start); });
+
+        if (_block_log.head()->block_num())
+            _fork_db.start_block(*_block_log.head());
+
+        auto end = fc::time_point::now();
+        ilog("Done reindexing, elapsed time: ${t} sec", ("t", double((end - start).count()) / 1000000.0));
+    }
+    FC_CAPTURE_AND_RETHROW((data_dir)(shared_mem_dir))
+}
+
+void database::_replay_block_log(uint32_t first_block_num, const fc::time_point& start)
+{
+    uint64_t skip_flags = skip_witness_signature | skip_transaction_signatures | skip_transaction_dupe_check
+        | skip_tapos_check | skip_merkle_check | skip_witness_schedule_check | skip_authority_check | skip_validate
+        | /// no need to validate operations
+        skip_validate_invariants | skip_block_log;
+
+    // blocks are read, unpacked and hashed ahead on the pipeline thread
+    block_replay_pipeline pipeline(_block_log, first_block_num);
+    auto last_block_num = _block_log.head()->block_num();
+    fc::microseconds apply_time;
+    decoded_block b;
+
+    while (pipeline.next(b))
+    {
+        auto cur_block_num = b.block.block_num();
+        if (cur_block_num % 100000 == 0)
+        {
+            const double seconds = double((fc::time_point::now() - start).count()) / 1000000.0;
+            std::cerr << "   " << double(cur_block_num * 100) / last_block_num << "%   " << cur_block_num << " of "
+                      << last_block_num << "   (" << (get_free_memory() / (1024 * 1024)) << "M free)   "
+                      << uint64_t((cur_block_num - first_block_num + 1) / seconds) << " blocks/s   "
+                      << uint64_t(pipeline.decoded_bytes() / seconds / 1024) << " KiB/s   apply "
+                      << double(apply_time.count()) / 1000000.0 << "s   decode "
+                      << double(pipeline.decode_time().count()) / 1000000.0 << "s\n";
+        }
+
+        const auto apply_start = fc::time_point::now();
+        _my->_replayed_block = &b;
+        try
+        {
+            apply_block(b.block, skip_flags);
+        }
+        catch (...)
+        {
+            _my->_replayed_block = nullptr;
+            throw;
+        }
+        _my->_replayed_block = nullptr;
+        apply_time += fc::time_point::now() - apply_start;
+
+        _check_free_memory();
+        FC_ASSERT(!_shared_file_grow_failed, "Shared memory file is full, replay stopped at block ${n}",
+                  ("n", cur_block_num));
+    }
+
+    set_revision(head_block_num());
+
+    ilog("Replayed blocks ${f}..${n}, ${mib} MiB: apply ${a} sec, decode ${d} sec",
+         ("f", first_block_num)("n", last_block_num)("mib", pipeline.decoded_bytes() / (1024 * 1024))(
+             "a", double(apply_time.count()) / 1000000.0)("d", double(pipeline.decode_time().count()) / 1000000.0));
+}
+
+void database::import_snapshot(const fc::path& data_dir,
+                               const fc::path& shared_mem_dir,
+                               uint64_t shared_file_size,
+                               const genesis_state_type& genesis_state,
+                               const fc::path& snapshot_file)
+{
+    try
+    {
+        ilog("Importing state snapshot ${f}", ("f", snapshot_file));
+        wipe(data_dir, shared_mem_dir, false);
+        open(data_dir, shared_mem_dir, shared_file_size, chainbase::database::read_write, genesis_state);
+        _fork_db.reset(); // override effect of _fork_db.start_block() call in open()
+
+        auto start = fc::time_point::now();
+
+        std::ifstream in(snapshot_file.generic_string().c_str(), std::ios::in | std::ios::binary);
+        FC_ASSERT(in.is_open(), "Can not open snapshot file ${f}", ("f", snapshot_file));
+        in.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+        const snapshot_header header = snapshot_header::read(in);
+        const uint32_t snapshot_block_num = protocol::block_header::num_from_id(header.head_block_id);
+
+        FC_ASSERT(header.chain_id == get_chain_id(), "Snapshot belongs to another chain",
+                  ("snapshot", header.chain_id)("chain", get_chain_id()));
+
+        auto snapshot_block = _block_log.read_serialized_block_by_num(snapshot_block_num);
+        DEIP_ASSERT(snapshot_block && unpack_block_header(*snapshot_block).id() == header.head_block_id,
+                    block_log_exception, "Snapshot head block ${n} is not in block log", ("n", snapshot_block_num));
 
         with_write_lock([&]() {
-            auto itr = _block_log.read_block(0);
-            auto last_block_num = _block_log.head()->block_num();
+            with_deferred_flush([&]() {
+                std::map<std::string, std::shared_ptr<abstract_snapshot_index>> indexes;
+                for_each_index_extension<abstract_snapshot_index>([&](std::shared_ptr<abstract_snapshot_index> idx) {
+                    idx->clear();
+                    indexes[idx->type_name()] = idx;
+                });
 
-            while (itr.first.block_num() != last_block_num)
-            {
-                auto cur_block_num = itr.first.block_num();
-                if (cur_block_num % 100000 == 0)
-                    std::cerr << "   " << double(cur_block_num * 100) / last_block_num << "%   " << cur_block_num
-                              << " of " << last_block_num << "   (" << (get_free_memory() / (1024 * 1024))
-                              << "M free)\n";
-                apply_block(itr.first, skip_flags);
-                itr = _block_log.read_block(itr.second);
-            }
+                for (const snapshot_index_header& section : header.indexes)
+                {
+                    auto itr = indexes.find(section.type_name);
+                    if (itr == indexes.end())
+                    {
+                        wlog("Index ${i} of snapshot is not registered, skipping it", ("i", section.type_name));
+                        continue;
+                    }
+
+                    in.seekg(section.offset);
+                    snapshot_reader reader(in);
+                    itr->second->import_objects(reader, section);
+                    FC_ASSERT(reader.checksum() == section.checksum, "Index ${i} of snapshot is corrupted",
+                              ("i", section.type_name));
 
-            apply_block(itr.first, skip_flags);
-            set_revision(head_block_num());
+                    ilog("Imported ${n} objects of ${i}", ("n", section.object_count)("i", section.type_name));
+                    indexes.erase(itr);
+                }
+
+                for (const auto& missing : indexes)
+                {
+                    FC_ASSERT(!missing.second->required(), "Index ${i} is missing in snapshot", ("i", missing.first));
+                    wlog("Index ${i} is missing in snapshot, it stays empty", ("i", missing.first));
+                }
+
+                FC_ASSERT(head_block_id() == header.head_block_id, "Snapshot head block does not match its state");
+                set_revision(head_block_num());
+            });
+
+            ilog("Replaying blocks after snapshot...");
+            _replay_block_log(snapshot_block_num + 1, start);
         });
 
-        if (_block_log.head()->block_num())
-            _fork_db.start_block(*_block_log.head());
+        _fork_db.start_block(*_block_log.head());
 
         auto end = fc::time_point::now();
-        ilog("Done reindexing, elapsed time: ${t} sec", ("t", double((end - start).count()) / 1000000.0));
+        ilog("Done importing snapshot, elapsed time: ${t} sec", ("t", double((end - start).count()) / 1000000.0));
+    }
+    FC_CAPTURE_AND_RETHROW((data_dir)(shared_mem_dir)(snapshot_file))
+}
+
+void database::export_snapshot(const fc::path& snapshot_file) const
+{
+    try
+    {
+        ilog("Exporting state snapshot ${f} at block ${n}", ("f", snapshot_file)("n", head_block_num()));
+        auto start = fc::time_point::now();
+
+        std::ofstream out(snapshot_file.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        FC_ASSERT(out.is_open(), "Can not create snapshot file ${f}", ("f", snapshot_file));
+        out.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+
+        snapshot_header header;
+        header.chain_id = get_chain_id();
+        header.head_block_id = head_block_id();
+
+        for_each_index_extension<abstract_snapshot_index>([&](std::shared_ptr<abstract_snapshot_index> idx) {
+            snapshot_index_header section;
+            section.type_name = idx->type_name();
+            section.offset = out.tellp();
+
+            snapshot_writer writer(out);
+            idx->export_objects(writer, section);
+            section.checksum = writer.checksum();
+
+            header.indexes.push_back(section);
+        });
+
+        header.write(out);
+        out.flush();
+
+        auto end = fc::time_point::now();
+        ilog("Done exporting snapshot: ${n} indexes, ${mib} MiB, elapsed time: ${t} sec",
+             ("n", header.indexes.size())("mib", uint64_t(out.tellp()) / (1024 * 1024))(
+                 "t", double((end - start).count()) / 1000000.0));
+    }
+    FC_CAPTURE_AND_RETHROW((snapshot_file))
+}
+
+void database::compact(const fc::path& data_dir,
+                       const fc::path& shared_mem_dir,
+                       const genesis_state_type& genesis_state)
+{
+    try
+    {
+        ilog("Compacting shared memory file in ${d}", ("d", shared_mem_dir));
+        auto start = fc::time_point::now();
+
+        // open() rewinds the state to the last irreversible block, which is in the block log
+        open(data_dir, shared_mem_dir, 0, chainbase::database::read_write, genesis_state);
+        if (head_block_num() == 0)
+        {
+            ilog("Nothing to compact, the chain has no blocks");
+            close();
+            return;
+        }
+
+        const uint64_t old_size = get_max_memory();
+        const uint64_t used_size = old_size - get_free_memory();
+
+        const fc::path snapshot_file = shared_mem_dir / "compact.snapshot";
+        with_read_lock([&]() { export_snapshot(snapshot_file); });
+
+        // fragmentation only adds to the used size, so the copied objects fit into it
+        const uint64_t reserve = 64 * 1024 * 1024;
+        import_snapshot(data_dir, shared_mem_dir, used_size + used_size / 4 + reserve, genesis_state, snapshot_file);
+        close();
+
+        chainbase::database::shrink_to_fit(shared_mem_dir);
+        fc::remove(snapshot_file);
+
+        auto end = fc::time_point::now();
+        ilog("Done compacting shared memory file: ${o}M -> ${n}M, elapsed time: ${t} sec",
+             ("o", old_size / (1024 * 1024))("n", fc::file_size(shared_mem_dir / "shared_memory.bin") / (1024 * 1024))(
+                 "t", double((end - start).count()) / 1000000.0));
     }
     FC_CAPTURE_AND_RETHROW((data_dir)(shared_mem_dir))
 }
@@ -308,9 +594,9 @@ block_id_type database::find_block_id_for_num(uint32_t block_num) const
         }
 
         // Next we query the block log.   Irreversible blocks are here.
-        auto b = _block_log.read_block_by_num(block_num);
+        auto b = _block_log.read_serialized_block_by_num(block_num);
         if (b.valid())
-            return b->id();
+            return unpack_block_header(*b).id();
 
         // Finally we query the fork DB.
         shared_ptr<fork_item> fitem = _fork_db.fetch_block_on_main_branch_by_number(block_num);
@@ -367,6 +653,63 @@ optional<signed_block> database::fetch_block_by_number(uint32_t block_num) const
     FC_LOG_AND_RETHROW()
 }
 
+optional<serialized_block> database::fetch_serialized_block_by_id(const block_id_type& id) const
+{
+    try
+    {
+        optional<serialized_block> result;
+
+        auto b = _fork_db.fetch_block(id);
+        if (b)
+        {
+            result = serialize_block(b->data);
+            return result;
+        }
+
+        result = _block_log.read_serialized_block_by_num(protocol::block_header::num_from_id(id));
+        if (result && unpack_block_header(*result).id() != id)
+            result.reset();
+
+        return result;
+    }
+    FC_CAPTURE_AND_RETHROW()
+}
+
+optional<serialized_block> database::fetch_serialized_block_by_number(uint32_t block_num) const
+{
+    try
+    {
+        optional<serialized_block> result;
+
+        auto results = _fork_db.fetch_block_by_number(block_num);
+        if (results.size() == 1)
+            result = serialize_block(results[0]->data);
+        else
+            result = _block_log.read_serialized_block_by_num(block_num);
+
+        return result;
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+serialized_block database::serialize_block(const signed_block& b)
+{
+    auto packed = std::make_shared<std::vector<char>>(fc::raw::pack(b));
+
+    serialized_block result;
+    result.data = std::shared_ptr<const char>(packed, packed->data());
+    result.size = packed->size();
+    return result;
+}
+
+signed_block_header database::unpack_block_header(const serialized_block& b)
+{
+    fc::datastream<const char*> ds(b.data.get(), b.size);
+    signed_block_header header;
+    fc::raw::unpack(ds, header);
+    return header;
+}
+
 const signed_transaction database::get_recent_transaction(const transaction_id_type& trx_id) const
 {
     try
@@ -507,26 +850,149 @@ bool database::before_last_checkpoint() const
     return (_checkpoints.size() > 0) && (_checkpoints.rbegin()->first >= head_block_num());
 }
 
+void database::set_signature_recovery_threads(uint32_t threads_count)
+{
+    _my->_signature_recovery_threads.clear();
+    _my->_signees_cache->clear();
+    _my->_block_signees->clear();
+
+    if (threads_count == 0)
+        return;
+
+    ilog("Starting ${n} signature recovery threads", ("n", threads_count));
+    _my->_signature_recovery_threads.reserve(threads_count);
+    for (uint32_t i = 0; i < threads_count; ++i)
+        _my->_signature_recovery_threads.push_back(std::make_shared<fc::thread>("signature_recovery"));
+}
+
+std::shared_future<void> database::precompute_transaction_signees(const signed_block& b)
+{
+    // the block is copied once and shared by the workers, the caller is not required
+    // to keep it alive until the recovery is finished
+    return precompute_transaction_signees(std::make_shared<const signed_block>(b));
+}
+
+std::shared_future<void> database::precompute_transaction_signees(std::shared_ptr<const signed_block> block)
+{
+    struct precompute_state
+    {
+        std::atomic<uint32_t> pending_workers;
+        std::promise<void> done;
+    };
+
+    auto state = std::make_shared<precompute_state>();
+    std::shared_future<void> result = state->done.get_future().share();
+
+    const auto& pool = _my->_signature_recovery_threads;
+    if (pool.empty() || block->transactions.empty())
+    {
+        state->done.set_value();
+        return result;
+    }
+
+    auto cache = _my->_signees_cache;
+    const chain_id_type chain_id = _my->_chain_id;
+
+    const uint32_t workers_count = std::min<uint32_t>(pool.size(), block->transactions.size());
+    const uint32_t first_thread = _my->_next_signature_recovery_thread.fetch_add(workers_count);
+    state->pending_workers = workers_count;
+
+    for (uint32_t worker = 0; worker < workers_count; ++worker)
+    {
+        pool[(first_thread + worker) % pool.size()]->async(
+            [block, cache, chain_id, state, worker, workers_count]() {
+                try
+                {
+                    for (size_t i = worker; i < block->transactions.size(); i += workers_count)
+                    {
+                        const auto& trx = block->transactions[i];
+                        const auto key = transaction_signees_cache::key(trx);
+                        if (cache->contains(key))
+                            continue;
+
+                        auto signees = transaction_signees_cache::recover(trx, chain_id);
+                        if (signees.valid())
+                            cache->insert(key, *signees);
+                    }
+                }
+                catch (...)
+                {
+                    // whatever failed here will be recomputed and reported during block application
+                }
+
+                if (--state->pending_workers == 0)
+                    state->done.set_value();
+            },
+            "precompute_transaction_signees");
+    }
+
+    return result;
+}
+
+void database::precompute_block_signee(const signed_block& b)
+{
+    const auto& pool = _my->_signature_recovery_threads;
+    if (pool.empty())
+        return;
+
+    // only the header is needed, the block id binds the recovered key to it
+    auto header = std::make_shared<signed_block_header>(b);
+    auto cache = _my->_block_signees;
+
+    pool[_my->_next_signature_recovery_thread.fetch_add(1) % pool.size()]->async(
+        [header, cache]() {
+            try
+            {
+                cache->insert(header->id(), header->signee());
+            }
+            catch (...)
+            {
+                // an invalid signature is reported when the block is applied
+            }
+        },
+        "precompute_block_signee");
+}
+
 /**
  * Push block "may fail" in which case every partial change is unwound.  After
  * push block is successful the block is appended to the chain database on disk.
  *
  * @return true if we switched forks as a result of this push.
  */
-bool database::push_block(const signed_block& new_block, uint32_t skip)
+bool database::push_block(const signed_block& new_block, uint32_t skip, std::shared_future<void> signees_recovered)
 {
     // fc::time_point begin_time = fc::time_point::now();
 
+    // Recover transaction signatures in parallel before taking the write lock, unless the
+    // caller started that when the block was received. std::shared_future::wait() does not
+    // yield the current fiber, so blocks are still pushed in the order they were handed to us.
+    if (!(skip & (skip_transaction_signatures | skip_authority_check)))
+    {
+        // the block outlives the workers as we wait for them, so they need no copy of it
+        if (!signees_recovered.valid())
+            signees_recovered = precompute_transaction_signees(
+                std::shared_ptr<const signed_block>(&new_block, [](const signed_block*) {}));
+        signees_recovered.wait();
+    }
+
     bool result;
     detail::with_skip_flags(*this, skip, [&]() {
         with_write_lock([&]() {
-            detail::without_pending_transactions(*this, std::move(_pending_tx), [&]() {
+            // must be counted before the pending state is undone
+            _preverified_trx_count = count_preverified_transactions(new_block);
+            if (_preverified_trx_count != 0)
+                _preverified_block_id = new_block.id();
+
+            detail::without_pending_transactions(*this, [&]() {
                 try
                 {
                     result = _push_block(new_block);
                 }
                 FC_CAPTURE_AND_RETHROW((new_block))
             });
+
+            // between blocks, where the write lock keeps readers out and no object references are held
+            _check_free_memory();
         });
     });
 
@@ -636,7 +1102,9 @@ bool database::_push_block(const signed_block& new_block)
         }
         catch (const fc::exception& e)
         {
-            elog("Failed to push new block:\n${e}", ("e", e.to_detail_string()));
+            // a failing candidate of _generate_block() is expected and reported there
+            if (!_pushing_block_candidate)
+                elog("Failed to push new block:\n${e}", ("e", e.to_detail_string()));
             _fork_db.remove(new_block.id());
             throw;
         }
@@ -664,7 +1132,8 @@ void database::push_transaction(const signed_transaction& trx, uint32_t skip)
             size_t trx_size = fc::raw::pack_size(trx);
             FC_ASSERT(trx_size <= (get_dynamic_global_properties().maximum_block_size - 256));
             set_producing(true);
-            detail::with_skip_flags(*this, skip, [&]() { with_write_lock([&]() { _push_transaction(trx); }); });
+            detail::with_skip_flags(*this, skip,
+                                    [&]() { with_write_lock([&]() { _push_transaction(trx, (uint32_t)trx_size); }); });
             set_producing(false);
         }
         catch (...)
@@ -677,6 +1146,11 @@ void database::push_transaction(const signed_transaction& trx, uint32_t skip)
 }
 
 void database::_push_transaction(const signed_transaction& trx)
+{
+    _push_transaction(trx, (uint32_t)fc::raw::pack_size(trx));
+}
+
+void database::_push_transaction(const signed_transaction& trx, uint32_t packed_size)
 {
     // If this is the first transaction pushed after applying a block, start a new undo session.
     // This allows us to quickly rewind to the clean state of the head block, in case a new block arrives.
@@ -685,12 +1159,12 @@ void database::_push_transaction(const signed_transaction& trx)
 
     // Create a temporary undo session as a child of _pending_tx_session.
     // The temporary session will be discarded by the destructor if
-    // _apply_transaction fails.  If we make it to merge(), we
-    // apply the changes.
+    // _apply_transaction fails or the mempool refuses the transaction.
+    // If we make it to merge(), we apply the changes.
 
     auto temp_session = start_undo_session(true);
     _apply_transaction(trx);
-    _pending_tx.push_back(trx);
+    _mempool.mark_applied(_mempool.insert(trx, packed_size), is_verifying_transactions());
 
     notify_changed_objects();
     // The transaction applied successfully. Merge its changes into the pending block session.
@@ -743,10 +1217,51 @@ signed_block database::_generate_block(fc::time_point_sec when,
 
     static const size_t max_block_header_size = fc::raw::pack_size(signed_block_header()) + 4;
     auto maximum_block_size = get_dynamic_global_properties().maximum_block_size; // DEIP_MAX_BLOCK_SIZE;
-    size_t total_block_size = max_block_header_size;
 
     signed_block pending_block;
 
+    with_write_lock([&]() {
+        //
+        // The pending state already holds the next block candidate: the
+        // mempool applies transactions on top of the head block as they
+        // arrive, oldest first, and keeps the order they were applied in.
+        // Taking them from there keeps the work at the slot independent of
+        // the size of the mempool.  Transactions that expire before "when"
+        // are left out; if that or anything else time based makes the
+        // candidate invalid, push_block() fails and we fall back to
+        // rebuilding the block below.
+        //
+        size_t total_block_size = max_block_header_size;
+        for (const pending_transaction* entry : _mempool.get_applied())
+        {
+            if (entry->expiration < when)
+                continue;
+
+            if (total_block_size + entry->packed_size >= maximum_block_size)
+                break;
+
+            total_block_size += entry->packed_size;
+            pending_block.transactions.push_back(entry->trx);
+        }
+    });
+
+    _finalize_block(pending_block, when, witness_owner, block_signing_private_key);
+
+    try
+    {
+        _pushing_block_candidate = true;
+        push_block(pending_block, skip);
+        _pushing_block_candidate = false;
+        return pending_block;
+    }
+    catch (const fc::exception& e)
+    {
+        _pushing_block_candidate = false;
+        wlog("The block candidate built from the pending state did not apply, rebuilding it: ${e}",
+             ("e", e.to_detail_string()));
+    }
+
+    pending_block = signed_block();
     with_write_lock([&]() {
         //
         // The following code throws away existing pending_tx_session and
@@ -759,20 +1274,21 @@ signed_block database::_generate_block(fc::time_point_sec when,
         // the value of the "when" variable is known, which means we need to
         // re-apply pending transactions in this method.
         //
-        _pending_tx_session.reset();
+        reset_pending_state();
         _pending_tx_session = start_undo_session(true);
 
+        size_t total_block_size = max_block_header_size;
         uint64_t postponed_tx_count = 0;
         // pop pending state (reset to head block state)
-        for (const signed_transaction& tx : _pending_tx)
+        for (const pending_transaction* entry : _mempool.get_all())
         {
             // Only include transactions that have not expired yet for currently generating block,
             // this should clear problem transactions and allow block production to continue
 
-            if (tx.expiration < when)
+            if (entry->expiration < when)
                 continue;
 
-            uint64_t new_total_size = total_block_size + fc::raw::pack_size(tx);
+            uint64_t new_total_size = total_block_size + entry->packed_size;
 
             // postpone transaction if it would make block too big
             if (new_total_size >= maximum_block_size)
@@ -784,11 +1300,11 @@ signed_block database::_generate_block(fc::time_point_sec when,
             try
             {
                 auto temp_session = start_undo_session(true);
-                _apply_transaction(tx);
+                _apply_transaction(entry->trx);
                 temp_session.squash();
 
-                total_block_size += fc::raw::pack_size(tx);
-                pending_block.transactions.push_back(tx);
+                total_block_size = new_total_size;
+                pending_block.transactions.push_back(entry->trx);
             }
             catch (const fc::exception& e)
             {
@@ -805,11 +1321,23 @@ signed_block database::_generate_block(fc::time_point_sec when,
         _pending_tx_session.reset();
     });
 
-    // We have temporarily broken the invariant that
-    // _pending_tx_session is the result of applying _pending_tx, as
-    // _pending_tx now consists of the set of postponed transactions.
-    // However, the push_block() call below will re-create the
-    // _pending_tx_session.
+    // The pending state is empty at this point, and every transaction is
+    // back in the mempool unapplied. The push_block() call below will
+    // re-create the _pending_tx_session.
+
+    _finalize_block(pending_block, when, witness_owner, block_signing_private_key);
+
+    push_block(pending_block, skip);
+
+    return pending_block;
+}
+
+void database::_finalize_block(signed_block& pending_block,
+                               const fc::time_point_sec when,
+                               const account_name_type& witness_owner,
+                               const fc::ecc::private_key& block_signing_private_key)
+{
+    uint32_t skip = get_node_properties().skip_flags;
 
     pending_block.previous = head_block_id();
     pending_block.timestamp = when;
@@ -851,10 +1379,6 @@ signed_block database::_generate_block(fc::time_point_sec when,
     {
         FC_ASSERT(fc::raw::pack_size(pending_block) <= DEIP_MAX_BLOCK_SIZE);
     }
-
-    push_block(pending_block, skip);
-
-    return pending_block;
 }
 
 /**
@@ -865,7 +1389,7 @@ void database::pop_block()
 {
     try
     {
-        _pending_tx_session.reset();
+        reset_pending_state();
         auto head_id = head_block_id();
 
         /// save the head block so we can recover its transactions
@@ -884,13 +1408,130 @@ void database::clear_pending()
 {
     try
     {
-        assert((_pending_tx.size() == 0) || _pending_tx_session.valid());
-        _pending_tx.clear();
+        assert((_mempool.applied_size_in_bytes() == 0) || _pending_tx_session.valid());
+        _mempool.clear();
         _pending_tx_session.reset();
     }
     FC_CAPTURE_AND_RETHROW()
 }
 
+void database::reset_pending_state()
+{
+    _pending_tx_session.reset();
+    _mempool.reset_applied();
+}
+
+/**
+ * Reapplies transactions on top of a new head block.  Transactions from popped blocks go
+ * first, then waiting transactions in arrival order, but only until there are enough to fill
+ * the next block.  The rest stay queued unapplied for a later block instead of being replayed
+ * after every block, so the cost of a new head no longer grows with the size of the mempool.
+ * Transactions the new head included were already dropped by _apply_block(), and expired
+ * ones are dropped by expiration here.
+ */
+void database::restore_pending_transactions()
+{
+    _preverified_trx_count = 0;
+
+    for (const auto& tx : _popped_tx)
+    {
+        try
+        {
+            if (!is_known_transaction(tx.id()))
+            {
+                // since push_transaction() takes a signed_transaction,
+                // the operation_results field will be ignored.
+                _push_transaction(tx);
+            }
+        }
+        catch (const fc::exception&)
+        {
+        }
+    }
+    _popped_tx.clear();
+
+    _mempool.remove_expired(head_block_time());
+
+    // every entry taken is either applied or removed, so the next one is always further on
+    const uint64_t maximum_block_size = get_dynamic_global_properties().maximum_block_size;
+    while (_mempool.applied_size_in_bytes() < maximum_block_size)
+    {
+        const pending_transaction* entry = _mempool.next_unapplied();
+        if (entry == nullptr)
+            break;
+
+        const transaction_id_type id = entry->id;
+        try
+        {
+            if (!_pending_tx_session.valid())
+                _pending_tx_session = start_undo_session(true);
+
+            auto temp_session = start_undo_session(true);
+            _apply_transaction(entry->trx);
+            _mempool.mark_applied(*entry, is_verifying_transactions());
+
+            notify_changed_objects();
+            temp_session.squash();
+
+            notify_on_pending_transaction(entry->trx);
+        }
+        catch (const transaction_exception& e)
+        {
+            dlog("Pending transaction became invalid after switching to block ${b} ${n} ${t}",
+                 ("b", head_block_id())("n", head_block_num())("t", head_block_time()));
+            dlog("The invalid transaction caused exception ${e}", ("e", e.to_detail_string()));
+            dlog("${t}", ("t", entry->trx));
+            _mempool.remove(id);
+        }
+        catch (const fc::exception& e)
+        {
+            _mempool.remove(id);
+        }
+    }
+}
+
+/**
+ * The pending state applies transactions on top of the head in the same order a block built on
+ * that head applies them, so for every leading transaction of such a block that matches the
+ * pending state byte for byte, signatures and tenant signature included, the signature, authority
+ * and tenant authority checks saw exactly the state the block would show them and need not run
+ * again.  The evaluators do run again: the block header changes state before the first
+ * transaction, and plugins record operations by their position in the block.
+ */
+uint32_t database::count_preverified_transactions(const signed_block& next_block) const
+{
+    if (!_pending_tx_session.valid() || next_block.previous != head_block_id() || next_block.transactions.empty())
+        return 0;
+
+    const auto applied = _mempool.get_applied();
+    const size_t n = std::min(applied.size(), next_block.transactions.size());
+
+    uint32_t count = 0;
+    while (count < n)
+    {
+        const pending_transaction& entry = *applied[count];
+        const signed_transaction& trx = next_block.transactions[count];
+        if (!entry.verified || entry.id != _my->get_transaction_id(trx))
+            break;
+        // the id leaves out the signatures and the tenant signature, which the skipped checks verify
+        if (entry.packed_size != fc::raw::pack_size(trx) || fc::raw::pack(entry.trx) != fc::raw::pack(trx))
+            break;
+        ++count;
+    }
+    return count;
+}
+
+bool database::is_verifying_transactions() const
+{
+    return !(get_node_properties().skip_flags & (skip_validate | skip_transaction_signatures | skip_authority_check));
+}
+
+void database::set_mempool_limits(size_t max_transactions, uint64_t max_bytes, uint32_t max_transactions_per_account)
+{
+    with_write_lock(
+        [&]() { _mempool.set_limits(max_transactions, max_bytes, max_transactions_per_account); });
+}
+
 void database::notify_pre_apply_operation(operation_notification& note)
 {
     note.trx_id = _current_trx_id;
@@ -1768,54 +2409,55 @@ void database::initialize_evaluators()
 
 void database::initialize_indexes()
 {
-    add_index<dynamic_global_property_index>();
-    add_index<chain_property_index>();
-    add_index<account_index>();
-    add_index<account_authority_index>();
-    add_index<witness_index>();
-    add_index<transaction_index>();
-    add_index<block_summary_index>();
-    add_index<witness_schedule_index>();
-    add_index<witness_vote_index>();
-    add_index<hardfork_property_index>();
-    add_index<withdraw_common_tokens_route_index>();
-    add_index<owner_authority_history_index>();
-    add_index<account_recovery_request_index>();
-    add_index<change_recovery_account_request_index>();
-    add_index<discipline_supply_index>();
-    add_index<proposal_index>();
-    add_index<recent_entity_index>();
-    add_index<research_group_index>();
-    add_index<research_group_token_index>();
-    add_index<discipline_index>();
-    add_index<research_discipline_relation_index>();
-    add_index<research_index>();
-    add_index<research_content_index>();
-    add_index<expert_token_index>();
-    add_index<research_token_index>();
-    add_index<research_token_sale_index>();
-    add_index<research_token_sale_contribution_index>();
-    add_index<expertise_contribution_index>();
-    add_index<review_index>();
-    add_index<review_vote_index>();
-    add_index<vesting_balance_index>();
-    add_index<reward_pool_index>();
-    add_index<expertise_allocation_proposal_index>();
-    add_index<expertise_allocation_proposal_vote_index>();
-    add_index<grant_application_index>();
-    add_index<grant_application_review_index>();
-    add_index<funding_opportunity_index>();
-    add_index<account_balance_index>();
-    add_index<asset_index>();
-    add_index<award_index>();
-    add_index<award_recipient_index>();
-    add_index<award_withdrawal_request_index>();
-    add_index<nda_contract_index>();
-    add_index<nda_contract_content_access_index>();
-    add_index<assessment_index>();
-    add_index<assessment_stage_index>();
-    add_index<assessment_stage_phase_index>();
-    add_index<research_license_index>();
+    add_snapshot_index<dynamic_global_property_index>();
+    add_snapshot_index<chain_property_index>();
+    add_snapshot_index<account_index>();
+    add_snapshot_index<account_authority_index>();
+    add_snapshot_index<witness_index>();
+    add_snapshot_index<transaction_index>();
+    add_snapshot_index<block_summary_index>();
+    add_snapshot_index<witness_schedule_index>();
+    add_snapshot_index<witness_vote_index>();
+    add_snapshot_index<hardfork_property_index>();
+    add_snapshot_index<withdraw_common_tokens_route_index>();
+    add_snapshot_index<owner_authority_history_index>();
+    add_snapshot_index<account_recovery_request_index>();
+    add_snapshot_index<change_recovery_account_request_index>();
+    add_snapshot_index<discipline_supply_index>();
+    add_snapshot_index<proposal_index>();
+    add_snapshot_index<recent_entity_index>();
+    add_snapshot_index<research_group_index>();
+    add_snapshot_index<research_group_token_index>();
+    add_snapshot_index<discipline_index>();
+    add_snapshot_index<research_discipline_relation_index>();
+    add_snapshot_index<research_index>();
+    add_snapshot_index<research_content_index>();
+    add_snapshot_index<expert_token_index>();
+    add_snapshot_index<research_token_index>();
+    add_snapshot_index<research_token_sale_index>();
+    add_snapshot_index<research_token_sale_contribution_index>();
+    add_snapshot_index<expertise_contribution_index>();
+    add_snapshot_index<review_index>();
+    add_snapshot_index<review_vote_index>();
+    add_snapshot_index<vesting_balance_index>();
+    add_snapshot_index<reward_pool_index>();
+    add_snapshot_index<expertise_allocation_proposal_index>();
+    add_snapshot_index<expertise_allocation_proposal_vote_index>();
+    add_snapshot_index<grant_application_index>();
+    add_snapshot_index<grant_application_review_index>();
+    add_snapshot_index<funding_opportunity_index>();
+    add_snapshot_index<account_balance_index>();
+    add_snapshot_index<asset_index>();
+    add_snapshot_index<award_index>();
+    add_snapshot_index<award_recipient_index>();
+    add_snapshot_index<award_withdrawal_request_index>();
+    add_snapshot_index<nda_contract_index>();
+    add_snapshot_index<nda_contract_content_access_index>();
+    add_snapshot_index<assessment_index>();
+    add_snapshot_index<assessment_stage_index>();
+    add_snapshot_index<assessment_stage_phase_index>();
+    add_snapshot_index<research_license_index>();
+    add_snapshot_index<research_member_index>();
 
     _plugin_index_signal();
 }
@@ -1924,6 +2566,26 @@ void database::set_flush_interval(uint32_t flush_blocks)
     _next_flush_block = 0;
 }
 
+void database::set_block_log_writer(uint32_t max_queued_blocks,
+                                    block_log::fsync_mode mode,
+                                    uint32_t fsync_interval_ms)
+{
+    _block_log_writer_queue_size = max_queued_blocks;
+    _block_log_fsync_mode = mode;
+    _block_log_fsync_interval_ms = fsync_interval_ms;
+}
+
+void database::set_max_fork_bytes(uint64_t max_bytes)
+{
+    _fork_db.set_max_fork_bytes(max_bytes);
+}
+
+void database::set_shared_memory_growth(uint64_t min_free, uint64_t grow_size)
+{
+    _shared_file_min_free = min_free;
+    _shared_file_grow_size = grow_size;
+}
+
 //////////////////// private methods ////////////////////
 
 void database::apply_block(const signed_block& next_block, uint32_t skip)
@@ -1933,12 +2595,13 @@ void database::apply_block(const signed_block& next_block, uint32_t skip)
         // fc::time_point begin_time = fc::time_point::now();
 
         auto block_num = next_block.block_num();
+        const block_id_type next_block_id = _my->get_block_id(next_block);
         if (_checkpoints.size() && _checkpoints.rbegin()->second != block_id_type())
         {
             auto itr = _checkpoints.find(block_num);
             if (itr != _checkpoints.end())
-                FC_ASSERT(next_block.id() == itr->second, "Block did not match checkpoint",
-                          ("checkpoint", *itr)("block_id", next_block.id()));
+                FC_ASSERT(next_block_id == itr->second, "Block did not match checkpoint",
+                          ("checkpoint", *itr)("block_id", next_block_id));
 
             if (_checkpoints.rbegin()->first >= block_num)
                 skip = skip_witness_signature | skip_transaction_signatures | skip_transaction_dupe_check | skip_fork_db
@@ -1949,7 +2612,18 @@ void database::apply_block(const signed_block& next_block, uint32_t skip)
                     | skip_undo_history_check | skip_witness_schedule_check | skip_validate | skip_validate_invariants;
         }
 
-        detail::with_skip_flags(*this, skip, [&]() { _apply_block(next_block); });
+        _my->_applied_block = &next_block;
+        _my->_applied_block_id = next_block_id;
+        try
+        {
+            detail::with_skip_flags(*this, skip, [&]() { _apply_block(next_block); });
+        }
+        catch (...)
+        {
+            _my->_applied_block = nullptr;
+            throw;
+        }
+        _my->_applied_block = nullptr;
 
         /*try
         {
@@ -1993,6 +2667,33 @@ void database::apply_block(const signed_block& next_block, uint32_t skip)
     FC_CAPTURE_AND_RETHROW((next_block))
 }
 
+void database::_check_free_memory()
+{
+    if (_shared_file_min_free == 0 || get_free_memory() >= _shared_file_min_free)
+        return;
+
+    // remapping invalidates object references, callers hold the write lock between blocks where none are held
+    const uint64_t grow_size = std::max(_shared_file_grow_size, _shared_file_min_free);
+    wlog("Free memory is ${f}M, growing shared memory file by ${g}M",
+         ("f", get_free_memory() / (1024 * 1024))("g", grow_size / (1024 * 1024)));
+
+    try
+    {
+        grow(grow_size);
+    }
+    catch (const std::exception& e)
+    {
+        // the block is already applied, so the node keeps the old mapping and stops producing instead
+        if (!_shared_file_grow_failed)
+            elog("Could not grow shared memory file, block production is halted: ${e}", ("e", e.what()));
+        _shared_file_grow_failed = true;
+        return;
+    }
+
+    _shared_file_grow_failed = false;
+    ilog("Shared memory file is now ${n}M", ("n", get_max_memory() / (1024 * 1024)));
+}
+
 void database::show_free_memory(bool force)
 {
 #ifdef IS_TEST_NET
@@ -2020,7 +2721,7 @@ void database::_apply_block(const signed_block& next_block)
     try
     {
         uint32_t next_block_num = next_block.block_num();
-        // block_id_type next_block_id = next_block.id();
+        const block_id_type next_block_id = _my->get_block_id(next_block);
 
         uint32_t skip = get_node_properties().skip_flags;
 
@@ -2032,7 +2733,7 @@ void database::_apply_block(const signed_block& next_block)
             {
                 FC_ASSERT(next_block.transaction_merkle_root == merkle_root, "Merkle check failed",
                           ("next_block.transaction_merkle_root", next_block.transaction_merkle_root)(
-                              "calc", merkle_root)("next_block", next_block)("id", next_block.id()));
+                              "calc", merkle_root)("next_block", next_block)("id", next_block_id));
             }
             catch (fc::assert_exception& e)
             {
@@ -2058,7 +2759,7 @@ void database::_apply_block(const signed_block& next_block)
         _current_trx_in_block = 0;
 
         const auto& gprops = get_dynamic_global_properties();
-        auto block_size = fc::raw::pack_size(next_block);
+        auto block_size = _my->get_block_size(next_block);
         FC_ASSERT(block_size <= gprops.maximum_block_size, "Block Size is too Big",
                   ("next_block_num", next_block_num)("block_size", block_size)("max", gprops.maximum_block_size));
 
@@ -2075,6 +2776,12 @@ void database::_apply_block(const signed_block& next_block)
                   "Block produced by witness that is not running current hardfork",
                   ("witness", witness)("next_block.witness", next_block.witness)("hardfork_state", hardfork_state));
 
+        // the leading transactions the pending state already verified on this head,
+        // see count_preverified_transactions()
+        const uint32_t preverified_trx_count
+            = (_preverified_trx_count != 0 && _preverified_block_id == next_block_id) ? _preverified_trx_count : 0;
+        static const uint32_t skip_preverified = skip_validate | skip_transaction_signatures | skip_authority_check;
+
         for (const auto& trx : next_block.transactions)
         {
             /* We do not need to push the undo state for each transaction
@@ -2083,7 +2790,7 @@ void database::_apply_block(const signed_block& next_block)
              * for transactions when validating broadcast transactions or
              * when building a block.
              */
-            apply_transaction(trx, skip);
+            apply_transaction(trx, _current_trx_in_block < preverified_trx_count ? skip | skip_preverified : skip);
             ++_current_trx_in_block;
         }
 
@@ -2112,6 +2819,11 @@ void database::_apply_block(const signed_block& next_block)
         expertise_allocation_proposal_service.process_expertise_allocation_proposals();
         nda_contract_service.process_nda_contracts();
 
+        // the block's transactions no longer need to wait in the mempool
+        if (_mempool.size() != 0)
+            for (const auto& trx : next_block.transactions)
+                _mempool.remove(_my->get_transaction_id(trx));
+
         // notify observers that the block has been applied
         notify_applied_block(next_block);
 
@@ -2175,7 +2887,7 @@ void database::_apply_transaction(const signed_transaction& trx)
 {
     try
     {
-        _current_trx_id = trx.id();
+        _current_trx_id = _my->get_transaction_id(trx);
         _current_trx_ref_block_num = trx.ref_block_num;
         _current_trx_ref_block_prefix = trx.ref_block_prefix;
 
@@ -2185,13 +2897,15 @@ void database::_apply_transaction(const signed_transaction& trx)
             trx.validate();
 
         auto& trx_idx = get_index<transaction_index>();
-        auto trx_id = trx.id();
+        auto trx_id = _current_trx_id;
         // idump((trx_id)(skip&skip_transaction_dupe_check));
         FC_ASSERT((skip & skip_transaction_dupe_check) || trx_idx.indices().get<by_trx_id>().find(trx_id) == trx_idx.indices().get<by_trx_id>().end(),
           "Duplicate transaction check failed", ("trx_ix", trx_id));
 
         if (!(skip & (skip_transaction_signatures | skip_authority_check)))
         {
+            const transaction_signees signees = _my->get_transaction_signees(trx);
+
             try
             {
                 auto get_active = [&](const string& name) { 
@@ -2213,7 +2927,7 @@ void database::_apply_transaction(const signed_transaction& trx)
                 };
 
                 trx.verify_authority(
-                    get_chain_id(), 
+                    signees.signature_keys, 
                     get_active,
                     get_owner, 
                     get_active_overrides
@@ -2243,7 +2957,7 @@ void database::_apply_transaction(const signed_transaction& trx)
                     return result;
                 };
 
-                trx.verify_tenant_authority(get_chain_id(), get_tenant);
+                trx.verify_tenant_authority(signees.tenant_signature_key, get_tenant);
             }
             catch (protocol::tx_missing_tenant_auth& e)
             {
@@ -2326,7 +3040,7 @@ const witness_object& database::validate_block_header(uint32_t skip, const signe
         const witness_object& witness = get_witness(next_block.witness);
 
         if (!(skip & skip_witness_signature))
-            FC_ASSERT(next_block.validate_signee(witness.signing_key));
+            FC_ASSERT(_my->get_block_signee(next_block) == fc::ecc::public_key(witness.signing_key));
 
         if (!(skip & skip_witness_schedule_check))
         {
@@ -2349,7 +3063,8 @@ void database::create_block_summary(const signed_block& next_block)
     try
     {
         block_summary_id_type sid(next_block.block_num() & 0xffff);
-        modify(get<block_summary_object>(sid), [&](block_summary_object& p) { p.block_id = next_block.id(); });
+        modify(get<block_summary_object>(sid),
+               [&](block_summary_object& p) { p.block_id = _my->get_block_id(next_block); });
     }
     FC_CAPTURE_AND_RETHROW()
 }
@@ -2395,7 +3110,7 @@ void database::update_global_dynamic_data(const signed_block& b)
             }
 
             dgp.head_block_number = b.block_num();
-            dgp.head_block_id = b.id();
+            dgp.head_block_id = _my->get_block_id(b);
             dgp.time = b.timestamp;
             dgp.current_aslot += missed_blocks + 1;
         });
@@ -2479,7 +3194,7 @@ void database::update_last_irreversible_block()
             }
         }
 
-        commit(dpo.last_irreversible_block_num);
+        uint32_t commit_block_num = dpo.last_irreversible_block_num;
 
         if (!(get_node_properties().skip_flags & skip_block_log))
         {
@@ -2496,14 +3211,22 @@ void database::update_last_irreversible_block()
                 {
                     shared_ptr<fork_item> block = _fork_db.fetch_block_on_main_branch_by_number(log_head_num + 1);
                     FC_ASSERT(block, "Current fork in the fork database does not contain the last_irreversible_block");
-                    _block_log.append(block->data);
+                    _block_log.append_async(block->data);
                     log_head_num++;
                 }
 
-                _block_log.flush();
+                // the background writer flushes on its own, in groups
+                if (!_block_log.has_writer())
+                    _block_log.flush();
             }
+
+            // Keep the undo state of the blocks still queued for the writer. If the process dies before they
+            // are written, open() rewinds the state to a block the log has instead of finding it ahead of the log.
+            commit_block_num = std::min(commit_block_num, _block_log.written_head_num());
         }
 
+        commit(commit_block_num);
+
         _fork_db.set_max_size(dpo.head_block_number - dpo.last_irreversible_block_num + 1);
     }
     FC_CAPTURE_AND_RETHROW()
@@ -10,8 +10,9 @@ fork_database::fork_database()
 }
 void fork_database::reset()
 {
-    _head.reset();
+    _set_head(item_ptr());
     _index.clear();
+    _size_in_bytes = 0;
 }
 
 void fork_database::pop_block()
@@ -19,14 +20,15 @@ void fork_database::pop_block()
     FC_ASSERT(_head, "cannot pop an empty fork database");
     auto prev = _head->prev.lock();
     FC_ASSERT(prev, "popping head block would leave fork DB empty");
-    _head = prev;
+    _set_head(prev);
 }
 
 void fork_database::start_block(signed_block b)
 {
     auto item = std::make_shared<fork_item>(std::move(b));
-    _index.insert(item);
-    _head = item;
+    if (_index.insert(item).second)
+        _size_in_bytes += item->packed_size;
+    _set_head(item);
 }
 
 /**
@@ -68,9 +70,12 @@ void fork_database::_push_block(const item_ptr& item)
         item->prev = *itr;
     }
 
-    _index.insert(item);
+    if (_index.insert(item).second)
+        _size_in_bytes += item->packed_size;
     if (!_head || item->num > _head->num)
-        _head = item;
+        _set_head(item);
+
+    _enforce_max_fork_bytes();
 }
 
 /**
@@ -100,32 +105,119 @@ void fork_database::set_max_size(uint32_t s)
     if (!_head)
         return;
 
-    { /// index
-        auto& by_num_idx = _index.get<block_num>();
-        auto itr = by_num_idx.begin();
-        while (itr != by_num_idx.end())
+    const uint32_t min_num = uint32_t(std::max(int64_t(0), int64_t(_head->num) - _max_size));
+
+    _erase_older_than(_index, min_num);
+    _erase_older_than(_unlinked_index, min_num);
+
+    while (!_main_branch.empty() && _main_branch.front()->num < min_num)
+    {
+        _main_branch_size_in_bytes -= _main_branch.front()->packed_size;
+        _main_branch.pop_front();
+    }
+}
+
+void fork_database::set_max_fork_bytes(uint64_t s)
+{
+    _max_fork_bytes = s;
+    _enforce_max_fork_bytes();
+}
+
+void fork_database::_erase_older_than(fork_multi_index_type& index, uint32_t num)
+{
+    auto& by_num_idx = index.get<block_num>();
+    auto itr = by_num_idx.begin();
+    while (itr != by_num_idx.end() && (*itr)->num < num)
+    {
+        if (&index == &_index)
+            _size_in_bytes -= (*itr)->packed_size;
+        itr = by_num_idx.erase(itr);
+    }
+}
+
+/**
+ *  Blocks on the main branch are never dropped here: until they become irreversible
+ *  they are the only copy the block log can be written from, and set_max_size()
+ *  already bounds them by the distance to the last irreversible block.
+ */
+void fork_database::_enforce_max_fork_bytes()
+{
+    if (_size_in_bytes <= _main_branch_size_in_bytes + _max_fork_bytes)
+        return;
+
+    auto& by_num_idx = _index.get<block_num>();
+    auto& prev_idx = _index.get<by_previous>();
+    auto itr = by_num_idx.begin();
+    while (itr != by_num_idx.end() && _size_in_bytes > _main_branch_size_in_bytes + _max_fork_bytes)
+    {
+        if (is_on_main_branch(*itr))
         {
-            if ((*itr)->num < std::max(int64_t(0), int64_t(_head->num) - _max_size))
-                by_num_idx.erase(itr);
-            else
-                break;
-            itr = by_num_idx.begin();
+            ++itr;
+            continue;
         }
-    }
-    { /// unlinked_index
-        auto& by_num_idx = _unlinked_index.get<block_num>();
-        auto itr = by_num_idx.begin();
-        while (itr != by_num_idx.end())
+
+        // blocks building on a dropped block could no longer be linked back to the main branch
+        vector<block_id_type> dropped{ (*itr)->id };
+        while (!dropped.empty())
         {
-            if ((*itr)->num < std::max(int64_t(0), int64_t(_head->num) - _max_size))
-                by_num_idx.erase(itr);
-            else
-                break;
-            itr = by_num_idx.begin();
+            const block_id_type id = dropped.back();
+            dropped.pop_back();
+            for (auto child = prev_idx.find(id); child != prev_idx.end(); child = prev_idx.find(id))
+            {
+                dropped.push_back((*child)->id);
+                _size_in_bytes -= (*child)->packed_size;
+                prev_idx.erase(child);
+            }
         }
+        _size_in_bytes -= (*itr)->packed_size;
+        itr = by_num_idx.erase(itr);
+    }
+}
+
+/**
+ *  Makes h the head and brings the main branch array in line with it by walking back
+ *  from h until the walk meets the old main branch.  That costs as many steps as the
+ *  new branch has blocks the old one didn't, so moving the head by one block is O(1).
+ */
+void fork_database::_set_head(const item_ptr& h)
+{
+    _head = h;
+    if (!_head)
+    {
+        _main_branch.clear();
+        _main_branch_size_in_bytes = 0;
+        return;
+    }
+
+    branch_type added;
+    item_ptr item = _head;
+    while (item && !is_on_main_branch(item))
+    {
+        added.push_back(item);
+        item = item->prev.lock();
+    }
+
+    const uint32_t keep = item ? item->num - _main_branch.front()->num + 1 : 0;
+    while (_main_branch.size() > keep)
+    {
+        _main_branch_size_in_bytes -= _main_branch.back()->packed_size;
+        _main_branch.pop_back();
+    }
+
+    for (auto ritr = added.rbegin(); ritr != added.rend(); ++ritr)
+    {
+        _main_branch_size_in_bytes += (*ritr)->packed_size;
+        _main_branch.push_back(*ritr);
     }
 }
 
+bool fork_database::is_on_main_branch(const item_ptr& item) const
+{
+    if (_main_branch.empty() || item->num < _main_branch.front()->num || item->num > _main_branch.back()->num)
+        return false;
+    return _main_branch[item->num - _main_branch.front()->num] == item;
+}
+
 bool fork_database::is_known_block(const block_id_type& id) const
 {
     auto& index = _index.get<block_id>();
@@ -177,6 +269,14 @@ fork_database::fetch_branch_from(block_id_type first, block_id_type second) cons
         // This function gets a branch (i.e. vector<fork_item>) leading
         // back to the most recent common ancestor.
         pair<branch_type, branch_type> result;
+        if (_fetch_branch_to_main(fetch_block(first), fetch_block(second), result))
+            return result;
+        if (_fetch_branch_to_main(fetch_block(second), fetch_block(first), result))
+        {
+            std::swap(result.first, result.second);
+            return result;
+        }
+
         auto first_branch_itr = _index.get<block_id>().find(first);
         FC_ASSERT(first_branch_itr != _index.get<block_id>().end());
         auto first_branch = *first_branch_itr;
@@ -216,12 +316,49 @@ fork_database::fetch_branch_from(block_id_type first, block_id_type second) cons
     FC_CAPTURE_AND_RETHROW((first)(second))
 }
 
+/**
+ *  The common case of fetch_branch_from(): one head is on the main branch and the other
+ *  is not.  The fork is walked back until it meets the main branch, and the main side is
+ *  read straight out of the main branch array.
+ *
+ *  @return false if the heads are not in that arrangement and the caller has to walk both
+ */
+bool fork_database::_fetch_branch_to_main(const item_ptr& fork_head,
+                                          const item_ptr& main_head,
+                                          pair<branch_type, branch_type>& result) const
+{
+    if (!fork_head || !main_head || is_on_main_branch(fork_head) || !is_on_main_branch(main_head))
+        return false;
+
+    branch_type fork_branch;
+    item_ptr item = fork_head;
+    while (item && !is_on_main_branch(item))
+    {
+        fork_branch.push_back(item);
+        item = item->prev.lock();
+    }
+
+    // the fork must leave the main branch below main_head, otherwise main_head is an ancestor
+    if (!item || item->num >= main_head->num)
+        return false;
+
+    result.first = std::move(fork_branch);
+    result.second.clear();
+    for (uint32_t num = main_head->num; num > item->num; --num)
+        result.second.push_back(_main_branch[num - _main_branch.front()->num]);
+    return true;
+}
+
 shared_ptr<fork_item> fork_database::walk_main_branch_to_num(uint32_t block_num) const
 {
-    shared_ptr<fork_item> next = head();
-    if (block_num > next->num)
+    if (_main_branch.empty() || block_num > _main_branch.back()->num)
         return shared_ptr<fork_item>();
 
+    if (block_num >= _main_branch.front()->num)
+        return _main_branch[block_num - _main_branch.front()->num];
+
+    // older than anything the fork database holds on to
+    shared_ptr<fork_item> next = _main_branch.front()->prev.lock();
     while (next.get() != nullptr && next->num > block_num)
         next = next->prev.lock();
     return next;
@@ -229,22 +366,31 @@ shared_ptr<fork_item> fork_database::walk_main_branch_to_num(uint32_t block_num)
 
 shared_ptr<fork_item> fork_database::fetch_block_on_main_branch_by_number(uint32_t block_num) const
 {
-    vector<item_ptr> blocks = fetch_block_by_number(block_num);
-    if (blocks.size() == 1)
-        return blocks[0];
-    if (blocks.size() == 0)
-        return shared_ptr<fork_item>();
     return walk_main_branch_to_num(block_num);
 }
 
 void fork_database::set_head(shared_ptr<fork_item> h)
 {
-    _head = h;
+    _set_head(h);
 }
 
+/**
+ *  A removed block on the main branch takes the blocks after it off the main branch too, the
+ *  head moves back to its predecessor so a replacement block of the same number becomes the head.
+ */
 void fork_database::remove(block_id_type id)
 {
-    _index.get<block_id>().erase(id);
+    auto& index = _index.get<block_id>();
+    auto itr = index.find(id);
+    if (itr == index.end())
+        return;
+
+    const item_ptr item = *itr;
+    _size_in_bytes -= item->packed_size;
+    index.erase(itr);
+
+    if (is_on_main_branch(item))
+        _set_head(item->prev.lock());
 }
 }
 } // deip::chain
@@ -0,0 +1,72 @@
+#include <deip/chain/database/state_snapshot.hpp>
+
+namespace deip {
+namespace chain {
+
+snapshot_header snapshot_header::read(std::istream& in)
+{
+    try
+    {
+        uint64_t pos;
+        in.seekg(-sizeof(pos), std::ios::end);
+        in.read((char*)&pos, sizeof(pos));
+        in.seekg(pos);
+
+        snapshot_header header;
+        fc::raw::unpack(in, header);
+        FC_ASSERT(header.version == current_version, "Unsupported snapshot version ${v}", ("v", header.version));
+        return header;
+    }
+    FC_CAPTURE_AND_RETHROW()
+}
+
+void snapshot_header::write(std::ostream& out) const
+{
+    try
+    {
+        uint64_t pos = out.tellp();
+        auto packed = fc::raw::pack(*this);
+        out.write(packed.data(), packed.size());
+        out.write((const char*)&pos, sizeof(pos));
+    }
+    FC_CAPTURE_AND_RETHROW()
+}
+
+snapshot_writer::snapshot_writer(std::ostream& out)
+    : _out(out)
+{
+}
+
+void snapshot_writer::write(const char* data, size_t size)
+{
+    _out.write(data, size);
+    _encoder.write(data, size);
+}
+
+fc::sha256 snapshot_writer::checksum()
+{
+    return _encoder.result();
+}
+
+snapshot_reader::snapshot_reader(std::istream& in)
+    : _in(in)
+{
+}
+
+void snapshot_reader::read(char* data, size_t size)
+{
+    _in.read(data, size);
+    _encoder.write(data, size);
+}
+
+void snapshot_reader::get(char& c)
+{
+    read(&c, 1);
+}
+
+fc::sha256 snapshot_reader::checksum()
+{
+    return _encoder.result();
+}
+}
+} // deip::chain
@@ -11,6 +11,16 @@ namespace detail {
 class block_log_impl;
 }
 
+/**
+ * Packed bytes of a block as they are stored in the block log. The data is shared with the
+ * underlying storage and stays valid as long as the object is alive.
+ */
+struct serialized_block
+{
+    std::shared_ptr<const char> data;
+    size_t size = 0;
+};
+
 /* The block log is an external append only log of the blocks. Blocks should only be written
  * to the log after they irreverisble as the log is append only. The log is a doubly linked
  * list of blocks. There is a secondary index file of only block positions that enables O(1)
@@ -34,11 +44,28 @@ class block_log_impl;
  *
  * The main file is the only file that needs to persist. The index file can be reconstructed during a
  * linear scan of the main file.
+ *
+ * Both files are written through append only streams and read through read only memory mappings,
+ * so concurrent readers do not contend for a file handle. The mappings are extended on demand
+ * when a read reaches the data appended after the last mapping.
+ *
+ * Blocks can also be handed to a background writer thread with append_async(). The writer takes
+ * every block queued since its last pass, writes them, flushes both files once for the group and
+ * syncs them to disk as the fsync mode asks. Until a queued block is written it is read from the
+ * queue, and head() already returns it. If the process dies while writing, open() cuts the log
+ * back to its last complete block before reconciling the index with it.
  */
 
 class block_log
 {
 public:
+    enum class fsync_mode
+    {
+        none, ///< leave it to the OS to write the flushed data out
+        every_batch, ///< sync after every group of blocks the writer writes
+        interval ///< sync at most once per fsync interval
+    };
+
     block_log();
     ~block_log();
 
@@ -47,10 +74,41 @@ public:
     bool is_open() const;
 
     uint64_t append(const signed_block& b);
+
+    /**
+     * Queue the block for the background writer, or append it right away if the writer is not
+     * running. Blocks the caller while max_queued_blocks blocks are waiting to be written.
+     */
+    void append_async(const signed_block& b);
+
+    /**
+     * Flush everything appended so far, waiting for the background writer to write the queue.
+     */
     void flush();
+
+    void start_writer(uint32_t max_queued_blocks = default_max_queued_blocks,
+                      fsync_mode mode = fsync_mode::none,
+                      uint32_t fsync_interval_ms = default_fsync_interval_ms);
+    /// writes whatever is queued and stops the background writer
+    void stop_writer();
+    bool has_writer() const;
+    /* For testing and debugging only. While held, the writer leaves the queue as it is, as if it fell
+       behind, and stop_writer() drops the queued blocks as a crash would. flush() waits for the release. */
+    void hold_writer(bool hold);
+    size_t queued_blocks() const;
+    /**
+     * Number of the last block that is in the files rather than only in the writer queue. The
+     * writer moves it on once a group is written and flushed (and synced if the fsync mode asks).
+     */
+    uint32_t written_head_num() const;
     std::pair<signed_block, uint64_t> read_block(uint64_t file_pos) const;
     optional<signed_block> read_block_by_num(uint32_t block_num) const;
 
+    /**
+     * Return packed block without unpacking it, or an empty optional if it does not exist.
+     */
+    optional<serialized_block> read_serialized_block_by_num(uint32_t block_num) const;
+
     /**
      * Return offset of block in file, or block_log::npos if it does not exist.
      */
@@ -58,11 +116,29 @@ public:
     signed_block read_head() const;
     const optional<signed_block>& head() const;
 
+    /**
+     * Rebuild the index file by following the position stored after every block, from the head
+     * block back to the first one, without deserializing blocks. Block numbers are verified on
+     * `threads` worker threads (0 means one per hardware thread). Falls back to
+     * construct_index_by_unpacking if the positions are inconsistent.
+     */
+    void construct_index(uint32_t threads = 0);
+
+    /**
+     * Rebuild the index file by unpacking every block of the log in order.
+     */
+    void construct_index_by_unpacking();
+
     static const uint64_t npos = std::numeric_limits<uint64_t>::max();
 
-private:
-    void construct_index();
+    static const uint32_t min_blocks_per_index_thread = 100000;
+    static const size_t index_write_chunk = 128 * 1024; ///< positions per index file write
+    static const uint32_t default_max_queued_blocks = 1000;
+    static const uint32_t default_fsync_interval_ms = 1000;
+    /// address space mapped past the end of a log file, so reads of appended blocks rarely map it again
+    static const uint64_t mapping_reserve = 64 * 1024 * 1024;
 
+private:
     std::unique_ptr<detail::block_log_impl> my;
 };
 }
@@ -0,0 +1,76 @@
+#pragma once
+#include <deip/chain/block_log.hpp>
+
+#include <fc/thread/future.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+namespace fc {
+class thread;
+}
+
+namespace deip {
+namespace chain {
+
+/**
+ *  Block read from the block log together with the values that are otherwise hashed
+ *  again and again while the block is applied.
+ */
+struct decoded_block
+{
+    signed_block block;
+    block_id_type block_id;
+    std::vector<transaction_id_type> transaction_ids;
+    uint64_t size = 0; ///< packed size of the block
+};
+
+/**
+ *  Reads and deserializes the blocks of a block log on a separate thread into a bounded
+ *  ring buffer, so that replay only has to apply them.
+ */
+class block_replay_pipeline
+{
+public:
+    static const size_t default_capacity = 1024;
+
+    block_replay_pipeline(const block_log& log, uint32_t first_block_num = 1, size_t capacity = default_capacity);
+    ~block_replay_pipeline();
+
+    /**
+     *  Moves the next block out of the ring buffer, waiting for the reader if needed.
+     *  @return false once all blocks of the log were returned
+     */
+    bool next(decoded_block& b);
+
+    /// total time spent by the reader on reading, unpacking and hashing blocks
+    fc::microseconds decode_time() const;
+    uint64_t decoded_bytes() const;
+
+private:
+    void _read();
+    void _stop();
+
+    const block_log& _log;
+    const uint32_t _first_block_num;
+
+    std::vector<decoded_block> _ring;
+    size_t _first = 0;
+    size_t _count = 0;
+    bool _finished = false;
+    bool _stopped = false;
+    optional<fc::exception> _error;
+
+    std::mutex _mutex;
+    std::condition_variable _not_empty;
+    std::condition_variable _not_full;
+
+    std::atomic<int64_t> _decode_time_us;
+    std::atomic<uint64_t> _decoded_bytes;
+
+    std::shared_ptr<fc::thread> _reader;
+    fc::future<void> _reading;
+};
+}
+} // deip::chain
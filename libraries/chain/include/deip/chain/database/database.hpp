@@ -7,8 +7,11 @@
 #include <deip/chain/hardfork.hpp>
 #include <deip/chain/schema/node_property_object.hpp>
 #include <deip/chain/database/fork_database.hpp>
+#include <deip/chain/database/state_snapshot.hpp>
 #include <deip/chain/block_log.hpp>
 #include <deip/chain/operation_notification.hpp>
+#include <deip/chain/transaction_signees_cache.hpp>
+#include <deip/chain/transaction_mempool.hpp>
 
 #include <deip/protocol/protocol.hpp>
 
@@ -19,6 +22,7 @@
 #include <fc/shared_string.hpp>
 #include <fc/log/logger.hpp>
 
+#include <future>
 #include <map>
 #include <memory>
 
@@ -99,6 +103,32 @@ public:
                  uint64_t shared_file_size,
                  const genesis_state_type& genesis_state);
 
+    /**
+     * @brief Rebuild object graph from a state snapshot and open database
+     *
+     * Objects of every snapshot index are loaded from the snapshot, then the blocks of the block log
+     * following the snapshot head block are replayed. The block log must contain the snapshot head block.
+     */
+    void import_snapshot(const fc::path& data_dir,
+                         const fc::path& shared_mem_dir,
+                         uint64_t shared_file_size,
+                         const genesis_state_type& genesis_state,
+                         const fc::path& snapshot_file);
+
+    /**
+     * @brief Write objects of every snapshot index at the current head block to a state snapshot
+     */
+    void export_snapshot(const fc::path& snapshot_file) const;
+
+    /**
+     * @brief Copy the state into a fresh shared memory file sized to fit it
+     *
+     * The state is rewound to the last irreversible block, copied through a state snapshot and the file is
+     * truncated after the copied objects, releasing the fragmented free space. Database is closed when
+     * this function returns.
+     */
+    void compact(const fc::path& data_dir, const fc::path& shared_mem_dir, const genesis_state_type& genesis_state);
+
     /**
      * @brief wipe Delete database from disk, and potentially the raw chain as well.
      * @param include_blocks If true, delete the raw chain as well as the database.
@@ -124,6 +154,17 @@ public:
     block_id_type get_block_id_for_num(uint32_t block_num) const;
     optional<signed_block> fetch_block_by_id(const block_id_type& id) const;
     optional<signed_block> fetch_block_by_number(uint32_t num) const;
+
+    /**
+     *  Packed counterparts of fetch_block_by_id and fetch_block_by_number. Irreversible blocks
+     *  are served straight from the block log without unpacking them.
+     */
+    optional<serialized_block> fetch_serialized_block_by_id(const block_id_type& id) const;
+    optional<serialized_block> fetch_serialized_block_by_number(uint32_t num) const;
+
+    static serialized_block serialize_block(const signed_block& b);
+    static signed_block_header unpack_block_header(const serialized_block& b);
+
     template <typename T>
     void get_blocks_history_by_number(std::map<uint32_t, T>& result, uint32_t block_num, uint32_t limit) const
     {
@@ -189,12 +230,38 @@ public:
     }
     bool before_last_checkpoint() const;
 
-    bool push_block(const signed_block& b, uint32_t skip = skip_nothing);
+    /**
+     *  Recovers the signature keys of every transaction in the block on the signature recovery
+     *  threads and stores them in the signees cache, so that block application only has to do
+     *  the authority check. Does not touch the chain state and may be called without holding
+     *  any lock, e.g. for blocks that are still waiting in the sync queue.
+     *
+     *  @return future that becomes ready once all keys are recovered
+     */
+    std::shared_future<void> precompute_transaction_signees(const signed_block& b);
+    std::shared_future<void> precompute_transaction_signees(std::shared_ptr<const signed_block> b);
+
+    /**
+     *  Recovers the witness key from the block signature on a signature recovery thread, so
+     *  that applying the block only compares it with the scheduled witness key. Like
+     *  precompute_transaction_signees() it may be called without holding any lock.
+     */
+    void precompute_block_signee(const signed_block& b);
+    void set_signature_recovery_threads(uint32_t threads_count);
+
+    /**
+     *  @param signees_recovered future of precompute_transaction_signees() started for this block when it
+     *  was received, the recovery is started here if it is not given
+     */
+    bool push_block(const signed_block& b,
+                    uint32_t skip = skip_nothing,
+                    std::shared_future<void> signees_recovered = std::shared_future<void>());
     void push_transaction(const signed_transaction& trx, uint32_t skip = skip_nothing);
     void push_proposal(const proposal_object& proposal) override;
     void _maybe_warn_multiple_production(uint32_t height) const;
     bool _push_block(const signed_block& b);
     void _push_transaction(const signed_transaction& trx);
+    void _push_transaction(const signed_transaction& trx, uint32_t packed_size);
 
     signed_block generate_block(const fc::time_point_sec when,
                                 const account_name_type& witness_owner,
@@ -203,10 +270,25 @@ public:
     signed_block _generate_block(const fc::time_point_sec when,
                                  const account_name_type& witness_owner,
                                  const fc::ecc::private_key& block_signing_private_key);
+    void _finalize_block(signed_block& pending_block,
+                         const fc::time_point_sec when,
+                         const account_name_type& witness_owner,
+                         const fc::ecc::private_key& block_signing_private_key);
     
     void pop_block();
     void clear_pending();
 
+    /// drops the pending state but keeps the transactions in the mempool, to be reapplied later
+    void reset_pending_state();
+    /// reapplies popped and waiting transactions on top of a new head block
+    void restore_pending_transactions();
+    /// @return how many leading transactions of a block on top of the head the pending state already verified
+    uint32_t count_preverified_transactions(const signed_block& next_block) const;
+    bool is_verifying_transactions() const;
+
+    const transaction_mempool& get_mempool() const { return _mempool; }
+    void set_mempool_limits(size_t max_transactions, uint64_t max_bytes, uint32_t max_transactions_per_account);
+
     /**
      *  This method is used to track applied operations during the evaluation of a block, these
      *  operations should include any operation actually included in a transaction as well
@@ -366,6 +448,34 @@ public:
     void set_flush_interval(uint32_t flush_blocks);
     void show_free_memory(bool force);
 
+    /**
+     * Grow the shared memory file by grow_size at a block boundary once free memory drops below min_free.
+     * Zero min_free disables growth.
+     */
+    void set_shared_memory_growth(uint64_t min_free, uint64_t grow_size);
+
+    /// True if the shared memory file needed to grow and could not, blocks must not be produced then
+    bool is_shared_memory_exhausted() const
+    {
+        return _shared_file_grow_failed;
+    }
+
+    /// Limits the bytes of blocks the fork database keeps off the main branch.
+    void set_max_fork_bytes(uint64_t max_bytes);
+
+    /**
+     * Write irreversible blocks to the block log on a background thread, which queues up to
+     * max_queued_blocks of them. Zero max_queued_blocks writes them on the apply thread.
+     * Takes effect when the database is opened.
+     */
+    void set_block_log_writer(uint32_t max_queued_blocks, block_log::fsync_mode mode, uint32_t fsync_interval_ms);
+
+    /* For testing and debugging only */
+    block_log& get_block_log()
+    {
+        return _block_log;
+    }
+
     // witness_schedule
 
     void update_witness_schedule();
@@ -374,10 +484,22 @@ public:
 
     template <typename MultiIndexType> void add_plugin_index()
     {
-        _plugin_index_signal.connect([this]() { this->add_index<MultiIndexType>(); });
+        _plugin_index_signal.connect([this]() { this->add_snapshot_index<MultiIndexType>(false); });
+    }
+
+    /**
+     *  Adds an index whose objects are included into state snapshots.
+     */
+    template <typename MultiIndexType> void add_snapshot_index(bool required = true)
+    {
+        add_index<MultiIndexType>();
+        add_index_extension<MultiIndexType>(std::make_shared<snapshot_index<MultiIndexType>>(*this, required));
     }
 
 private:
+    void _replay_block_log(uint32_t first_block_num, const fc::time_point& start);
+    void _check_free_memory();
+
     void _reset_virtual_schedule_time();
 
     void _update_median_witness_props();
@@ -443,7 +565,17 @@ private:
 
     optional<chainbase::database::session> _pending_tx_session;
 
-    vector<signed_transaction> _pending_tx;
+    transaction_mempool _mempool;
+    /// _generate_block() is trying the pending state as the next block, a failure isn't an error
+    bool _pushing_block_candidate = false;
+
+    uint32_t _block_log_writer_queue_size = 0;
+    block_log::fsync_mode _block_log_fsync_mode = block_log::fsync_mode::none;
+    uint32_t _block_log_fsync_interval_ms = block_log::default_fsync_interval_ms;
+
+    /// The block being pushed and how many of its leading transactions the pending state already verified
+    block_id_type _preverified_block_id;
+    uint32_t _preverified_trx_count = 0;
     fork_database _fork_db;
     fc::time_point_sec _hardfork_times[DEIP_NUM_HARDFORKS + 1];
     protocol::hardfork_version _hardfork_versions[DEIP_NUM_HARDFORKS + 1];
@@ -473,6 +605,10 @@ private:
     uint32_t _flush_blocks = 0;
     uint32_t _next_flush_block = 0;
 
+    uint64_t _shared_file_min_free = 0;
+    uint64_t _shared_file_grow_size = 0;
+    bool _shared_file_grow_failed = false;
+
     uint32_t _last_free_gb_printed = 0;
     fc::time_point_sec _const_genesis_time; // should be const
 };
@@ -49,64 +49,18 @@ struct skip_flags_restorer
  */
 struct pending_transactions_restorer
 {
-    pending_transactions_restorer(database& db, std::vector<signed_transaction>&& pending_transactions)
+    pending_transactions_restorer(database& db)
         : _db(db)
-        , _pending_transactions(std::move(pending_transactions))
     {
-        _db.clear_pending();
+        _db.reset_pending_state();
     }
 
     ~pending_transactions_restorer()
     {
-        for (const auto& tx : _db._popped_tx)
-        {
-            try
-            {
-                if (!_db.is_known_transaction(tx.id()))
-                {
-                    // since push_transaction() takes a signed_transaction,
-                    // the operation_results field will be ignored.
-                    _db._push_transaction(tx);
-                }
-            }
-            catch (const fc::exception&)
-            {
-            }
-        }
-        _db._popped_tx.clear();
-        for (const signed_transaction& tx : _pending_transactions)
-        {
-            try
-            {
-                if (!_db.is_known_transaction(tx.id()))
-                {
-                    // since push_transaction() takes a signed_transaction,
-                    // the operation_results field will be ignored.
-                    _db._push_transaction(tx);
-                }
-            }
-            catch (const transaction_exception& e)
-            {
-                dlog("Pending transaction became invalid after switching to block ${b} ${n} ${t}",
-                     ("b", _db.head_block_id())("n", _db.head_block_num())("t", _db.head_block_time()));
-                dlog("The invalid transaction caused exception ${e}", ("e", e.to_detail_string()));
-                dlog("${t}", ("t", tx));
-            }
-            catch (const fc::exception& e)
-            {
-
-                /*
-                dlog( "Pending transaction became invalid after switching to block ${b} ${n} ${t}",
-                   ("b", _db.head_block_id())("n", _db.head_block_num())("t", _db.head_block_time()) );
-                dlog( "The invalid pending transaction caused exception ${e}", ("e", e.to_detail_string() ) );
-                dlog( "${t}", ("t", tx) );
-                */
-            }
-        }
+        _db.restore_pending_transactions();
     }
 
     database& _db;
-    std::vector<signed_transaction> _pending_transactions;
 };
 
 /**
@@ -124,15 +78,14 @@ template <typename Lambda> void with_skip_flags(database& db, uint32_t skip_flag
 }
 
 /**
- * Empty pending_transactions, call callback,
- * then reset pending_transactions after callback is done.
+ * Undo the pending state, call callback,
+ * then reapply pending transactions after callback is done.
  *
  * Pending transactions which no longer validate will be culled.
  */
-template <typename Lambda>
-void without_pending_transactions(database& db, std::vector<signed_transaction>&& pending_transactions, Lambda callback)
+template <typename Lambda> void without_pending_transactions(database& db, Lambda callback)
 {
-    pending_transactions_restorer restorer(db, std::move(pending_transactions));
+    pending_transactions_restorer restorer(db);
     callback();
     return;
 }
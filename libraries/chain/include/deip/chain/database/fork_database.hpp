@@ -1,12 +1,16 @@
 #pragma once
 #include <deip/protocol/block.hpp>
 
+#include <fc/io/raw.hpp>
+
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
 
+#include <deque>
+
 namespace deip {
 namespace chain {
 using boost::multi_index_container;
@@ -20,6 +24,7 @@ struct fork_item
     fork_item(signed_block d)
         : num(d.block_num())
         , id(d.id())
+        , packed_size(fc::raw::pack_size(d))
         , data(std::move(d))
     {
     }
@@ -37,6 +42,7 @@ struct fork_item
      */
     bool invalid = false;
     block_id_type id;
+    uint32_t packed_size; // initialized in ctor
     signed_block data;
 };
 typedef shared_ptr<fork_item> item_ptr;
@@ -50,6 +56,14 @@ typedef shared_ptr<fork_item> item_ptr;
  *
  *  Every time a block is pushed into the fork DB the
  *  block with the highest block_num will be returned.
+ *
+ *  The branch ending at the head is also kept in an array indexed by
+ *  block number, so looking up a block on the main branch by number
+ *  takes constant time and a fork switch only walks the blocks of the
+ *  losing and winning branches.  Besides the depth limit, the blocks
+ *  off the main branch are bounded by a byte budget, so a long stall
+ *  of irreversibility with many competing forks can't grow without
+ *  bound.
  */
 class fork_database
 {
@@ -57,6 +71,8 @@ public:
     typedef vector<item_ptr> branch_type;
     /// The maximum number of blocks that may be skipped in an out-of-order push
     const static int MAX_BLOCK_REORDERING = 1024;
+    /// The default budget for blocks that are not on the main branch
+    const static uint64_t DEFAULT_MAX_FORK_BYTES = 64 * 1024 * 1024;
 
     fork_database();
     void reset();
@@ -103,17 +119,37 @@ public:
         fork_multi_index_type;
 
     void set_max_size(uint32_t s);
+    /// limits the bytes of blocks off the main branch, the oldest are dropped first
+    void set_max_fork_bytes(uint64_t s);
+
+    bool is_on_main_branch(const item_ptr& item) const;
+    uint64_t size_in_bytes() const
+    {
+        return _size_in_bytes;
+    }
 
 private:
     /** @return a pointer to the newly pushed item */
     void _push_block(const item_ptr& b);
     void _push_next(const item_ptr& newly_inserted);
+    void _set_head(const item_ptr& h);
+    bool _fetch_branch_to_main(const item_ptr& fork_head,
+                               const item_ptr& main_head,
+                               pair<branch_type, branch_type>& result) const;
+    void _erase_older_than(fork_multi_index_type& index, uint32_t num);
+    void _enforce_max_fork_bytes();
 
     uint32_t _max_size = 1024;
+    uint64_t _max_fork_bytes = DEFAULT_MAX_FORK_BYTES;
+    uint64_t _size_in_bytes = 0;
+    uint64_t _main_branch_size_in_bytes = 0;
 
     fork_multi_index_type _unlinked_index;
     fork_multi_index_type _index;
     shared_ptr<fork_item> _head;
+
+    /// the branch ending at _head, _main_branch[i] has number _main_branch.front()->num + i
+    std::deque<item_ptr> _main_branch;
 };
 }
 } // deip::chain
@@ -0,0 +1,167 @@
+#pragma once
+#include <deip/protocol/types.hpp>
+
+#include <chainbase/chainbase.hpp>
+
+#include <fc/crypto/sha256.hpp>
+#include <fc/interprocess/container.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/reflect/typename.hpp>
+
+#include <iostream>
+
+namespace deip {
+namespace chain {
+
+using deip::protocol::block_id_type;
+using deip::protocol::chain_id_type;
+
+/**
+ *  Location and content summary of one index in a snapshot file.
+ */
+struct snapshot_index_header
+{
+    std::string type_name; ///< reflected name of the object type, the same for every compiler
+    uint64_t offset = 0;
+    uint64_t object_count = 0;
+    int64_t next_id = 0;
+    fc::sha256 checksum;
+};
+
+/**
+ *  A state snapshot holds every object of every snapshot index as fc-packed bytes.
+ *
+ *  +---------+---------+-----+--------+-------------------+
+ *  | Index 1 | Index 2 | ... | Header | Pos of the Header |
+ *  +---------+---------+-----+--------+-------------------+
+ *
+ *  The header is written after the indexes, as their checksums are only known once they are
+ *  written, and is found through the position in the last 8 bytes of the file.
+ */
+struct snapshot_header
+{
+    static const uint32_t current_version = 2;
+
+    uint32_t version = current_version;
+    chain_id_type chain_id;
+    block_id_type head_block_id;
+    std::vector<snapshot_index_header> indexes;
+
+    static snapshot_header read(std::istream& in);
+    void write(std::ostream& out) const;
+};
+
+/**
+ *  Stream adapters that checksum the bytes of an index section while it is written or read.
+ */
+class snapshot_writer
+{
+public:
+    explicit snapshot_writer(std::ostream& out);
+
+    void write(const char* data, size_t size);
+    fc::sha256 checksum();
+
+private:
+    std::ostream& _out;
+    fc::sha256::encoder _encoder;
+};
+
+class snapshot_reader
+{
+public:
+    explicit snapshot_reader(std::istream& in);
+
+    void read(char* data, size_t size);
+    void get(char& c);
+    fc::sha256 checksum();
+
+private:
+    std::istream& _in;
+    fc::sha256::encoder _encoder;
+};
+
+/**
+ *  Index extension that moves the objects of one index to and from a snapshot.
+ */
+class abstract_snapshot_index : public chainbase::index_extension
+{
+public:
+    /// indexes that are not required may be missing in a snapshot, e.g. plugin indexes
+    explicit abstract_snapshot_index(bool required)
+        : _required(required)
+    {
+    }
+
+    bool required() const
+    {
+        return _required;
+    }
+
+    virtual std::string type_name() const = 0;
+    virtual void export_objects(snapshot_writer& out, snapshot_index_header& header) const = 0;
+    virtual void import_objects(snapshot_reader& in, const snapshot_index_header& header) = 0;
+    virtual void clear() = 0;
+
+private:
+    bool _required;
+};
+
+template <typename MultiIndexType> class snapshot_index : public abstract_snapshot_index
+{
+public:
+    typedef typename chainbase::generic_index<MultiIndexType>::value_type value_type;
+
+    snapshot_index(chainbase::database& db, bool required)
+        : abstract_snapshot_index(required)
+        , _db(db)
+    {
+    }
+
+    virtual std::string type_name() const override
+    {
+        return fc::get_typename<value_type>::name();
+    }
+
+    virtual void export_objects(snapshot_writer& out, snapshot_index_header& header) const override
+    {
+        const auto& idx = _db.get_index<MultiIndexType>();
+
+        header.object_count = idx.indices().size();
+        header.next_id = idx.next_id()._id;
+
+        std::vector<char> packed;
+        for (const value_type& o : idx.indices())
+        {
+            packed = fc::raw::pack(o);
+            out.write(packed.data(), packed.size());
+        }
+    }
+
+    virtual void import_objects(snapshot_reader& in, const snapshot_index_header& header) override
+    {
+        auto& idx = _db.get_mutable_index<MultiIndexType>();
+        FC_ASSERT(idx.indices().empty(), "Index ${i} must be empty before import", ("i", header.type_name));
+
+        // objects keep the ids they had in the snapshot
+        for (uint64_t i = 0; i < header.object_count; ++i)
+            idx.emplace([&](value_type& o) { fc::raw::unpack(in, o); });
+
+        idx.set_next_id(typename value_type::id_type(header.next_id));
+    }
+
+    virtual void clear() override
+    {
+        auto& idx = _db.get_mutable_index<MultiIndexType>();
+        while (!idx.indices().empty())
+            idx.remove(*idx.indices().begin());
+    }
+
+private:
+    chainbase::database& _db;
+};
+}
+} // deip::chain
+
+FC_REFLECT(deip::chain::snapshot_index_header, (type_name)(offset)(object_count)(next_id)(checksum))
+FC_REFLECT(deip::chain::snapshot_header, (version)(chain_id)(head_block_id)(indexes))
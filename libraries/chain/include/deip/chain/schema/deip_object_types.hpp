@@ -86,7 +86,8 @@ enum object_type
     assessment_object_type,
     assessment_stage_object_type,
     assessment_stage_phase_object_type,
-    research_license_object_type
+    research_license_object_type,
+    research_member_object_type
 };
 
 class dynamic_global_property_object;
@@ -140,6 +141,7 @@ class assessment_object;
 class assessment_stage_object;
 class assessment_stage_phase_object;
 class research_license_object;
+class research_member_object;
 
 typedef oid<dynamic_global_property_object> dynamic_global_property_id_type;
 typedef oid<chain_property_object> chain_property_id_type;
@@ -192,6 +194,7 @@ typedef oid<assessment_object> assessment_id_type;
 typedef oid<assessment_stage_object> assessment_stage_id_type;
 typedef oid<assessment_stage_phase_object> assessment_stage_phase_id_type;
 typedef oid<research_license_object> research_license_id_type;
+typedef oid<research_member_object> research_member_id_type;
 
 typedef bip::allocator<fc::shared_string, bip::managed_mapped_file::segment_manager> basic_string_allocator;
 
@@ -268,6 +271,7 @@ FC_REFLECT_ENUM( deip::chain::object_type,
                  (assessment_stage_object_type)
                  (assessment_stage_phase_object_type)
                  (research_license_object_type)
+                 (research_member_object_type)
 )
 
 
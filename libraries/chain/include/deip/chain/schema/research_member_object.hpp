@@ -0,0 +1,64 @@
+#pragma once
+
+#include <deip/protocol/authority.hpp>
+
+#include "deip_object_types.hpp"
+#include <boost/multi_index/composite_key.hpp>
+
+namespace deip{
+namespace chain{
+
+/**
+ *  An account in the members of a research, the research_object::members looked up by account.
+ */
+class research_member_object
+        : public object<research_member_object_type, research_member_object>
+{
+
+    research_member_object() = delete;
+
+public:
+
+    template <typename Constructor, typename Allocator>
+    research_member_object(Constructor &&c, allocator<Allocator> a)
+    {
+        c(*this);
+    }
+
+    research_member_id_type id;
+    research_id_type research_id;
+    account_name_type member;
+};
+
+struct by_member_and_research;
+struct by_research_and_member;
+
+typedef multi_index_container<research_member_object,
+        indexed_by<ordered_unique<tag<by_id>,
+                member<research_member_object,
+                        research_member_id_type,
+                        &research_member_object::id>>,
+                ordered_unique<tag<by_member_and_research>,
+                        composite_key<research_member_object,
+                                member<research_member_object,
+                                        account_name_type,
+                                        &research_member_object::member>,
+                                member<research_member_object,
+                                        research_id_type,
+                                        &research_member_object::research_id>>>,
+                ordered_unique<tag<by_research_and_member>,
+                        composite_key<research_member_object,
+                                member<research_member_object,
+                                        research_id_type,
+                                        &research_member_object::research_id>,
+                                member<research_member_object,
+                                        account_name_type,
+                                        &research_member_object::member>>>>,
+        allocator<research_member_object>>
+        research_member_index;
+}
+}
+
+FC_REFLECT(deip::chain::research_member_object, (id)(research_id)(member))
+
+CHAINBASE_SET_INDEX_TYPE(deip::chain::research_member_object, deip::chain::research_member_index)
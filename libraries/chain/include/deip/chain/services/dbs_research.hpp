@@ -2,6 +2,7 @@
 
 #include "dbs_base_impl.hpp"
 #include <deip/chain/schema/research_object.hpp>
+#include <deip/chain/schema/research_member_object.hpp>
 
 #include <vector>
 
@@ -66,6 +67,10 @@ public:
     const research_refs_type lookup_researches(const research_id_type& lower_bound, uint32_t limit) const;
 
     const research_refs_type get_researches_by_member(const account_name_type& member) const;
+
+private:
+
+    void update_research_members(const research_object& research, const flat_set<account_name_type>& members);
 };
 }
 }
\ No newline at end of file
@@ -0,0 +1,137 @@
+#pragma once
+#include <deip/protocol/transaction.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include <map>
+
+namespace deip {
+namespace chain {
+using boost::multi_index_container;
+using namespace boost::multi_index;
+
+using deip::protocol::account_name_type;
+using deip::protocol::signed_transaction;
+using deip::protocol::transaction_id_type;
+
+/**
+ *  A transaction waiting to be included in a block.
+ */
+struct pending_transaction
+{
+    signed_transaction trx;
+    transaction_id_type id;
+    fc::time_point_sec expiration;
+    uint32_t packed_size = 0;
+    uint64_t sequence = 0; ///< arrival order
+    uint64_t applied_sequence = 0; ///< order it was applied to the pending state in, 0 if it isn't applied
+    bool verified = false; ///< its signatures and authorities were checked when it was applied
+    flat_set<account_name_type> accounts; ///< accounts whose authority the transaction requires
+};
+
+/**
+ *  Transactions the node has accepted but not yet seen in a block.
+ *
+ *  The database applies only about one block's worth of them on top of the head block, in
+ *  arrival order; that applied prefix is the candidate for the next block, so producing a
+ *  block doesn't have to replay the whole pool. The rest wait, unapplied, until a block makes
+ *  room. Entries included in a block are removed by id and expired entries by expiration,
+ *  so neither requires a scan.
+ *
+ *  The pool is bounded by count, bytes and transactions per account. When it is full, an
+ *  unapplied transaction from the account with the most pending transactions is evicted
+ *  to make room for an account with fewer, so one busy account can't crowd out the rest.
+ *  All access happens under the database write lock.
+ */
+class transaction_mempool
+{
+public:
+    static const size_t default_max_transactions = 100000;
+    static const uint64_t default_max_bytes = 64 * 1024 * 1024;
+    static const uint32_t default_max_transactions_per_account = 1000;
+
+    transaction_mempool();
+
+    /**
+     *  @throw fc::exception if the transaction is already pending, its account is at its
+     *  limit, or the pool is full of transactions from accounts with fewer pending
+     */
+    const pending_transaction& insert(const signed_transaction& trx, uint32_t packed_size);
+
+    bool contains(const transaction_id_type& id) const;
+    void remove(const transaction_id_type& id);
+    size_t remove_expired(const fc::time_point_sec& now);
+    void clear();
+
+    /// records that the transaction is now part of the pending state
+    void mark_applied(const pending_transaction& entry, bool verified);
+    /// the pending state was discarded, so nothing in the pool is applied any more
+    void reset_applied();
+
+    /// pending transactions in the order they were applied, the next block candidate
+    std::vector<const pending_transaction*> get_applied() const;
+    /// pending transactions that are not applied, in arrival order
+    std::vector<const pending_transaction*> get_unapplied() const;
+    /// the oldest pending transaction that is not applied, or nullptr if all of them are
+    const pending_transaction* next_unapplied() const;
+    /// every pending transaction in arrival order
+    std::vector<const pending_transaction*> get_all() const;
+
+    size_t size() const;
+    uint64_t size_in_bytes() const;
+    uint64_t applied_size_in_bytes() const;
+
+    void set_limits(size_t max_transactions, uint64_t max_bytes, uint32_t max_transactions_per_account);
+
+private:
+    struct by_id;
+    struct by_sequence;
+    struct by_applied_sequence;
+    struct by_expiration;
+    typedef multi_index_container<pending_transaction,
+                                  indexed_by<hashed_unique<tag<by_id>,
+                                                           member<pending_transaction,
+                                                                  transaction_id_type,
+                                                                  &pending_transaction::id>,
+                                                           std::hash<transaction_id_type>>,
+                                             ordered_unique<tag<by_sequence>,
+                                                            member<pending_transaction,
+                                                                   uint64_t,
+                                                                   &pending_transaction::sequence>>,
+                                             // unapplied entries come first, in arrival order
+                                             ordered_unique<tag<by_applied_sequence>,
+                                                            composite_key<pending_transaction,
+                                                                          member<pending_transaction,
+                                                                                 uint64_t,
+                                                                                 &pending_transaction::applied_sequence>,
+                                                                          member<pending_transaction,
+                                                                                 uint64_t,
+                                                                                 &pending_transaction::sequence>>>,
+                                             ordered_non_unique<tag<by_expiration>,
+                                                                member<pending_transaction,
+                                                                       fc::time_point_sec,
+                                                                       &pending_transaction::expiration>>>>
+        pending_transaction_index_type;
+
+    template <typename Iterator> void _erase(Iterator itr);
+    bool _evict_for(const flat_set<account_name_type>& accounts);
+    uint32_t _max_pending_for(const flat_set<account_name_type>& accounts) const;
+
+    pending_transaction_index_type _transactions;
+    std::map<account_name_type, uint32_t> _pending_per_account;
+
+    uint64_t _next_sequence = 1;
+    uint64_t _next_applied_sequence = 1;
+    uint64_t _size_in_bytes = 0;
+    uint64_t _applied_size_in_bytes = 0;
+
+    size_t _max_transactions;
+    uint64_t _max_bytes;
+    uint32_t _max_transactions_per_account;
+};
+}
+} // deip::chain
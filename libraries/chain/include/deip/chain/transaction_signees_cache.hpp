@@ -0,0 +1,124 @@
+#pragma once
+#include <deip/protocol/block_header.hpp>
+#include <deip/protocol/transaction.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace deip {
+namespace chain {
+using boost::multi_index_container;
+using namespace boost::multi_index;
+
+using deip::protocol::block_id_type;
+using deip::protocol::chain_id_type;
+using deip::protocol::digest_type;
+using deip::protocol::public_key_type;
+using deip::protocol::signed_block_header;
+using deip::protocol::signed_transaction;
+
+/**
+ *  Public keys recovered from the signatures of a single transaction.
+ */
+struct transaction_signees
+{
+    flat_set<public_key_type> signature_keys;
+    optional<public_key_type> tenant_signature_key;
+};
+
+/**
+ *  Bounded, thread safe cache of recovered transaction signees.
+ *
+ *  Public key recovery does not depend on the chain state, so it can be done ahead of
+ *  block application on worker threads. Entries are keyed by the digest of the whole
+ *  signed transaction (signatures included), so a modified transaction never hits a
+ *  stale entry. The oldest entries are evicted once the cache is full.
+ */
+class transaction_signees_cache
+{
+public:
+    static const size_t default_max_size = 65536;
+
+    explicit transaction_signees_cache(size_t max_size = default_max_size);
+
+    static digest_type key(const signed_transaction& trx);
+
+    /**
+     *  @return recovered signees or an empty optional if the signatures can not be recovered,
+     *  in which case the transaction must be rejected by the regular validation path
+     */
+    static optional<transaction_signees> recover(const signed_transaction& trx, const chain_id_type& chain_id);
+
+    bool contains(const digest_type& key) const;
+    optional<transaction_signees> find(const digest_type& key) const;
+    void insert(const digest_type& key, const transaction_signees& signees);
+    void clear();
+
+    void set_max_size(size_t s);
+    size_t size() const;
+
+private:
+    struct entry
+    {
+        digest_type key;
+        transaction_signees signees;
+    };
+
+    struct by_key;
+    typedef multi_index_container<entry,
+                                  indexed_by<sequenced<>,
+                                             hashed_unique<tag<by_key>,
+                                                           member<entry, digest_type, &entry::key>,
+                                                           std::hash<digest_type>>>>
+        entry_index_type;
+
+    void _evict();
+
+    mutable std::mutex _mutex;
+    size_t _max_size;
+    entry_index_type _entries;
+};
+
+/**
+ *  Bounded, thread safe cache of witness keys recovered from the signatures of upcoming
+ *  block headers, by block id. Filled on the signature recovery threads and taken when the
+ *  block is applied.
+ *
+ *  The block id commits to the whole signed header, so a key is only ever used for the
+ *  header it was recovered from. The id still has to be hashed once per applied block to
+ *  look the key up; the database reuses that id for the rest of the block application.
+ */
+class block_signee_cache
+{
+public:
+    static const size_t default_max_size = 4096;
+
+    explicit block_signee_cache(size_t max_size = default_max_size);
+
+    void insert(const block_id_type& id, const fc::ecc::public_key& signee);
+    optional<fc::ecc::public_key> take(const block_id_type& id);
+
+    /**
+     *  @return the key recovered ahead for the header with the given id, or the key
+     *  recovered from the header signature if there is none
+     */
+    fc::ecc::public_key take_or_recover(const signed_block_header& header, const block_id_type& id);
+
+    void clear();
+    size_t size() const;
+
+private:
+    mutable std::mutex _mutex;
+    size_t _max_size;
+    std::unordered_map<block_id_type, fc::ecc::public_key, std::hash<fc::ripemd160>> _signees;
+    // insertion order for eviction, may still hold ids that were already taken
+    std::deque<block_id_type> _order;
+};
+}
+} // deip::chain
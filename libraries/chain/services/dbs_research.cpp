@@ -48,6 +48,8 @@ const research_object& dbs_research::create_research(const research_group_object
         research_disciplines_service.create_research_relation(research.id, discipline_id);
     }
 
+    update_research_members(research, members);
+
     dgp_service.create_recent_entity(external_id);
 
     return research;
@@ -77,9 +79,52 @@ const research_object& dbs_research::update_research(const research_object& rese
         r_o.members.insert(updated_members.begin(), updated_members.end());
     });
 
+    update_research_members(research, updated_members);
+
     return research;
 }
 
+void dbs_research::update_research_members(const research_object& research, const flat_set<account_name_type>& members)
+{
+    const auto& idx = db_impl()
+      .get_index<research_member_index>()
+      .indicies()
+      .get<by_research_and_member>();
+
+    // both are ordered by member, so one pass finds the members that left and joined
+    auto it = idx.lower_bound(boost::make_tuple(research.id));
+    auto member_it = members.begin();
+    while (it != idx.end() && it->research_id == research.id)
+    {
+        if (member_it != members.end() && *member_it < it->member)
+        {
+            const account_name_type member = *member_it++;
+            db_impl().create<research_member_object>([&](research_member_object& rm_o) {
+                rm_o.research_id = research.id;
+                rm_o.member = member;
+            });
+        }
+        else if (member_it != members.end() && *member_it == it->member)
+        {
+            ++member_it;
+            ++it;
+        }
+        else
+        {
+            db_impl().remove(*it++);
+        }
+    }
+
+    for (; member_it != members.end(); ++member_it)
+    {
+        const account_name_type member = *member_it;
+        db_impl().create<research_member_object>([&](research_member_object& rm_o) {
+            rm_o.research_id = research.id;
+            rm_o.member = member;
+        });
+    }
+}
+
 const dbs_research::research_refs_type dbs_research::get_researches_by_research_group(const research_group_id_type& research_group_id) const
 {
     research_refs_type ret;
@@ -359,21 +404,21 @@ const dbs_research::research_refs_type dbs_research::lookup_researches(const res
 
 const dbs_research::research_refs_type dbs_research::get_researches_by_member(const account_name_type& member) const
 {
-    const auto& research_groups_service = db_impl().obtain_service<dbs_research_group>();
-
     research_refs_type ret;
 
-    const auto& rgt_list = research_groups_service.get_research_group_tokens_by_member(member);
-    for (const research_group_token_object& rgt : rgt_list)
+    const auto& idx = db_impl()
+      .get_index<research_member_index>()
+      .indicies()
+      .get<by_member_and_research>();
+
+    auto it_pair = idx.equal_range(member);
+
+    auto it = it_pair.first;
+    const auto it_end = it_pair.second;
+    while (it != it_end)
     {
-        const auto& research_list = get_researches_by_research_group(rgt.research_group_id);
-        for (const research_object& research : research_list)
-        {
-            if (research.members.find(member) != research.members.end())
-            {
-                ret.push_back(research);
-            }
-        }
+        ret.push_back(std::cref(db_impl().get<research_object>(it->research_id)));
+        ++it;
     }
 
     return ret;
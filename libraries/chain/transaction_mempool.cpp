@@ -0,0 +1,217 @@
+#include <deip/chain/transaction_mempool.hpp>
+
+#include <fc/exception/exception.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+namespace deip {
+namespace chain {
+
+transaction_mempool::transaction_mempool()
+    : _max_transactions(default_max_transactions)
+    , _max_bytes(default_max_bytes)
+    , _max_transactions_per_account(default_max_transactions_per_account)
+{
+}
+
+const pending_transaction& transaction_mempool::insert(const signed_transaction& trx, uint32_t packed_size)
+{
+    pending_transaction entry;
+    entry.trx = trx;
+    entry.id = trx.id();
+    entry.expiration = trx.expiration;
+    entry.packed_size = packed_size;
+
+    FC_ASSERT(!contains(entry.id), "Transaction is already pending", ("id", entry.id));
+
+    flat_set<account_name_type> owner;
+    vector<deip::protocol::authority> other;
+    trx.get_required_authorities(entry.accounts, owner, other);
+    entry.accounts.insert(owner.begin(), owner.end());
+
+    FC_ASSERT(_max_pending_for(entry.accounts) < _max_transactions_per_account,
+              "Too many pending transactions for account",
+              ("accounts", entry.accounts)("limit", _max_transactions_per_account));
+
+    while (_transactions.size() >= _max_transactions || _size_in_bytes + packed_size > _max_bytes)
+        FC_ASSERT(_evict_for(entry.accounts), "Pending transaction pool is full",
+                  ("size", _transactions.size())("bytes", _size_in_bytes));
+
+    entry.sequence = _next_sequence++;
+    for (const account_name_type& account : entry.accounts)
+        ++_pending_per_account[account];
+    _size_in_bytes += packed_size;
+
+    return *_transactions.insert(std::move(entry)).first;
+}
+
+bool transaction_mempool::contains(const transaction_id_type& id) const
+{
+    const auto& idx = _transactions.get<by_id>();
+    return idx.find(id) != idx.end();
+}
+
+void transaction_mempool::remove(const transaction_id_type& id)
+{
+    auto& idx = _transactions.get<by_id>();
+    auto itr = idx.find(id);
+    if (itr != idx.end())
+        _erase(itr);
+}
+
+size_t transaction_mempool::remove_expired(const fc::time_point_sec& now)
+{
+    auto& idx = _transactions.get<by_expiration>();
+    size_t removed = 0;
+    while (!idx.empty() && idx.begin()->expiration < now)
+    {
+        _erase(idx.begin());
+        ++removed;
+    }
+    return removed;
+}
+
+void transaction_mempool::clear()
+{
+    _transactions.clear();
+    _pending_per_account.clear();
+    _size_in_bytes = 0;
+    _applied_size_in_bytes = 0;
+}
+
+void transaction_mempool::mark_applied(const pending_transaction& entry, bool verified)
+{
+    FC_ASSERT(entry.applied_sequence == 0);
+    auto itr = _transactions.get<by_id>().find(entry.id);
+    FC_ASSERT(itr != _transactions.get<by_id>().end());
+    _transactions.get<by_id>().modify(itr, [&](pending_transaction& e) {
+        e.applied_sequence = _next_applied_sequence++;
+        e.verified = verified;
+    });
+    _applied_size_in_bytes += entry.packed_size;
+}
+
+void transaction_mempool::reset_applied()
+{
+    auto& idx = _transactions.get<by_applied_sequence>();
+    // every modify moves the entry to the front of the index, so keep taking the last one
+    while (!idx.empty() && idx.rbegin()->applied_sequence != 0)
+        idx.modify(std::prev(idx.end()), [](pending_transaction& e) {
+            e.applied_sequence = 0;
+            e.verified = false;
+        });
+    _applied_size_in_bytes = 0;
+}
+
+std::vector<const pending_transaction*> transaction_mempool::get_applied() const
+{
+    std::vector<const pending_transaction*> result;
+    const auto& idx = _transactions.get<by_applied_sequence>();
+    for (auto itr = idx.upper_bound(boost::make_tuple(0)); itr != idx.end(); ++itr)
+        result.push_back(&*itr);
+    return result;
+}
+
+std::vector<const pending_transaction*> transaction_mempool::get_unapplied() const
+{
+    std::vector<const pending_transaction*> result;
+    const auto range = _transactions.get<by_applied_sequence>().equal_range(boost::make_tuple(0));
+    for (auto itr = range.first; itr != range.second; ++itr)
+        result.push_back(&*itr);
+    return result;
+}
+
+const pending_transaction* transaction_mempool::next_unapplied() const
+{
+    const auto& idx = _transactions.get<by_applied_sequence>();
+    if (idx.empty() || idx.begin()->applied_sequence != 0)
+        return nullptr;
+    return &*idx.begin();
+}
+
+std::vector<const pending_transaction*> transaction_mempool::get_all() const
+{
+    std::vector<const pending_transaction*> result;
+    result.reserve(_transactions.size());
+    for (const pending_transaction& entry : _transactions.get<by_sequence>())
+        result.push_back(&entry);
+    return result;
+}
+
+size_t transaction_mempool::size() const
+{
+    return _transactions.size();
+}
+
+uint64_t transaction_mempool::size_in_bytes() const
+{
+    return _size_in_bytes;
+}
+
+uint64_t transaction_mempool::applied_size_in_bytes() const
+{
+    return _applied_size_in_bytes;
+}
+
+void transaction_mempool::set_limits(size_t max_transactions,
+                                     uint64_t max_bytes,
+                                     uint32_t max_transactions_per_account)
+{
+    _max_transactions = max_transactions;
+    _max_bytes = max_bytes;
+    _max_transactions_per_account = max_transactions_per_account;
+}
+
+template <typename Iterator> void transaction_mempool::_erase(Iterator itr)
+{
+    for (const account_name_type& account : itr->accounts)
+    {
+        auto count = _pending_per_account.find(account);
+        if (--count->second == 0)
+            _pending_per_account.erase(count);
+    }
+    _size_in_bytes -= itr->packed_size;
+    if (itr->applied_sequence != 0)
+        _applied_size_in_bytes -= itr->packed_size;
+    _transactions.erase(_transactions.project<0>(itr));
+}
+
+bool transaction_mempool::_evict_for(const flat_set<account_name_type>& accounts)
+{
+    auto heaviest = std::max_element(
+        _pending_per_account.begin(), _pending_per_account.end(),
+        [](const std::pair<const account_name_type, uint32_t>& a,
+           const std::pair<const account_name_type, uint32_t>& b) { return a.second < b.second; });
+    if (heaviest == _pending_per_account.end() || heaviest->second <= _max_pending_for(accounts) + 1)
+        return false;
+
+    // the newest transaction of the busiest account goes first. Applied transactions are part
+    // of the pending state and can't be taken back out of it
+    const account_name_type account = heaviest->first;
+    const auto range = _transactions.get<by_applied_sequence>().equal_range(boost::make_tuple(0));
+    for (auto itr = range.second; itr != range.first;)
+    {
+        --itr;
+        if (itr->accounts.count(account))
+        {
+            _erase(itr);
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t transaction_mempool::_max_pending_for(const flat_set<account_name_type>& accounts) const
+{
+    uint32_t result = 0;
+    for (const account_name_type& account : accounts)
+    {
+        auto count = _pending_per_account.find(account);
+        if (count != _pending_per_account.end())
+            result = std::max(result, count->second);
+    }
+    return result;
+}
+}
+} // deip::chain
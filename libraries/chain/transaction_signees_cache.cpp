@@ -0,0 +1,140 @@
+#include <deip/chain/transaction_signees_cache.hpp>
+
+namespace deip {
+namespace chain {
+
+transaction_signees_cache::transaction_signees_cache(size_t max_size)
+    : _max_size(max_size)
+{
+}
+
+digest_type transaction_signees_cache::key(const signed_transaction& trx)
+{
+    return trx.merkle_digest();
+}
+
+optional<transaction_signees> transaction_signees_cache::recover(const signed_transaction& trx,
+                                                                 const chain_id_type& chain_id)
+{
+    optional<transaction_signees> result;
+    try
+    {
+        transaction_signees signees;
+        signees.signature_keys = trx.get_signature_keys(chain_id);
+        signees.tenant_signature_key = trx.get_tenant_signature_key(chain_id);
+        result = std::move(signees);
+    }
+    catch (const fc::exception&)
+    {
+        // invalid or duplicate signatures are reported by the regular validation path
+    }
+    return result;
+}
+
+bool transaction_signees_cache::contains(const digest_type& key) const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    const auto& idx = _entries.get<by_key>();
+    return idx.find(key) != idx.end();
+}
+
+optional<transaction_signees> transaction_signees_cache::find(const digest_type& key) const
+{
+    optional<transaction_signees> result;
+
+    std::lock_guard<std::mutex> guard(_mutex);
+    const auto& idx = _entries.get<by_key>();
+    auto itr = idx.find(key);
+    if (itr != idx.end())
+        result = itr->signees;
+    return result;
+}
+
+void transaction_signees_cache::insert(const digest_type& key, const transaction_signees& signees)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    if (_max_size == 0)
+        return;
+
+    _entries.push_back(entry{ key, signees });
+    _evict();
+}
+
+void transaction_signees_cache::clear()
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    _entries.clear();
+}
+
+void transaction_signees_cache::set_max_size(size_t s)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    _max_size = s;
+    _evict();
+}
+
+size_t transaction_signees_cache::size() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _entries.size();
+}
+
+void transaction_signees_cache::_evict()
+{
+    while (_entries.size() > _max_size)
+        _entries.pop_front();
+}
+
+block_signee_cache::block_signee_cache(size_t max_size)
+    : _max_size(max_size)
+{
+}
+
+void block_signee_cache::insert(const block_id_type& id, const fc::ecc::public_key& signee)
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    if (!_signees.emplace(id, signee).second)
+        return;
+    _order.push_back(id);
+    while (_order.size() > _max_size)
+    {
+        _signees.erase(_order.front());
+        _order.pop_front();
+    }
+}
+
+optional<fc::ecc::public_key> block_signee_cache::take(const block_id_type& id)
+{
+    optional<fc::ecc::public_key> result;
+    std::lock_guard<std::mutex> guard(_mutex);
+    auto itr = _signees.find(id);
+    if (itr != _signees.end())
+    {
+        result = itr->second;
+        _signees.erase(itr);
+    }
+    return result;
+}
+
+fc::ecc::public_key block_signee_cache::take_or_recover(const signed_block_header& header, const block_id_type& id)
+{
+    auto signee = take(id);
+    if (signee.valid())
+        return *signee;
+    return header.signee();
+}
+
+void block_signee_cache::clear()
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    _signees.clear();
+    _order.clear();
+}
+
+size_t block_signee_cache::size() const
+{
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _signees.size();
+}
+}
+} // deip::chain
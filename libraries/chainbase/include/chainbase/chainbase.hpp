@@ -7,7 +7,8 @@
 #include <boost/interprocess/containers/deque.hpp>
 #include <boost/interprocess/containers/string.hpp>
 #include <boost/interprocess/allocators/allocator.hpp>
-#include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
+#include <boost/interprocess/sync/interprocess_condition.hpp>
+#include <boost/interprocess/sync/interprocess_mutex.hpp>
 #include <boost/interprocess/sync/sharable_lock.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
 
@@ -22,6 +23,7 @@
 
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
@@ -34,6 +36,10 @@
 #define CHAINBASE_NUM_RW_LOCKS 10
 #endif
 
+#ifndef CHAINBASE_MAX_READER_SLOTS
+#define CHAINBASE_MAX_READER_SLOTS 64
+#endif
+
 #define CHAINBASE_REQUIRE_READ_LOCK(m, t) require_read_lock(m, typeid(t).name())
 #define CHAINBASE_REQUIRE_WRITE_LOCK(m, t) require_write_lock(m, typeid(t).name())
 
@@ -44,7 +50,46 @@ namespace bfs = boost::filesystem;
 
 template <typename T> using allocator = bip::allocator<T, bip::managed_mapped_file::segment_manager>;
 
-typedef boost::interprocess::interprocess_sharable_mutex read_write_mutex;
+/**
+ *  Phase-fair reader-writer lock shared between the processes of a database. A waiting writer stops new
+ *  readers from entering, and the readers it stopped are admitted as a group when the writer leaves,
+ *  before any other writer. Neither block application nor API reads can starve the other side: a writer
+ *  waits for at most one reader phase, a reader for at most one writer.
+ */
+class read_write_mutex
+{
+public:
+    read_write_mutex()
+    {
+    }
+
+    read_write_mutex(const read_write_mutex&) = delete;
+    read_write_mutex& operator=(const read_write_mutex&) = delete;
+
+    void lock_sharable();
+    bool try_lock_sharable();
+    bool timed_lock_sharable(const boost::posix_time::ptime& abs_time);
+    void unlock_sharable();
+
+    void lock();
+    bool try_lock();
+    bool timed_lock(const boost::posix_time::ptime& abs_time);
+    void unlock();
+
+private:
+    void grant_blocked_readers();
+
+    bip::interprocess_mutex _mutex;
+    bip::interprocess_condition _readers_cond;
+    bip::interprocess_condition _writers_cond;
+
+    uint32_t _readers = 0; ///< readers holding the lock, including granted ones not woken up yet
+    uint32_t _blocked_readers = 0; ///< readers waiting for the current writer phase to end
+    uint32_t _waiting_writers = 0;
+    bool _writer = false;
+    uint64_t _write_phase = 0; ///< incremented whenever blocked readers are granted the lock
+};
+
 typedef boost::interprocess::sharable_lock<read_write_mutex> read_lock;
 typedef boost::unique_lock<read_write_mutex> write_lock;
 
@@ -73,30 +118,45 @@ template <typename T> struct get_index_type
         c(*this);                                                                                                      \
     }
 
-template <typename value_type> class undo_state
+/**
+ *  Undo revisions of a database, shared by all of its indexes. Every undo session increments head,
+ *  revisions in (floor, head] can still be undone.
+ */
+struct undo_revisions
 {
-public:
-    typedef typename value_type::id_type id_type;
-    typedef allocator<std::pair<const id_type, value_type>> id_value_allocator_type;
-    typedef allocator<id_type> id_allocator_type;
+    int64_t head = 0;
+    int64_t floor = 0;
 
-    template <typename T>
-    undo_state(allocator<T> al)
-        : old_values(id_value_allocator_type(al.get_segment_manager()))
-        , removed_values(id_value_allocator_type(al.get_segment_manager()))
-        , new_ids(id_allocator_type(al.get_segment_manager()))
+    bool enabled() const
     {
+        return head > floor;
     }
+};
 
-    typedef boost::interprocess::map<id_type, value_type, std::less<id_type>, id_value_allocator_type>
-        id_value_type_map;
-    typedef boost::interprocess::set<id_type, std::less<id_type>, id_allocator_type> id_type_set;
-
-    id_value_type_map old_values;
-    id_value_type_map removed_values;
-    id_type_set new_ids;
-    id_type old_next_id = 0;
+/**
+ *  Changes one index made within one revision. An index gets a frame only once it is written in
+ *  the revision; the frame owns the undo log entries from first_entry up to the next frame.
+ */
+template <typename id_type> struct undo_frame
+{
     int64_t revision = 0;
+    uint64_t first_entry = 0;
+    id_type old_next_id = 0;
+};
+
+/**
+ *  Value an object had before it was modified or removed.
+ */
+template <typename value_type> struct undo_entry
+{
+    undo_entry(bool r, const value_type& v)
+        : removed(r)
+        , value(v)
+    {
+    }
+
+    bool removed;
+    value_type value;
 };
 
 /**
@@ -142,10 +202,12 @@ public:
     typedef MultiIndexType index_type;
     typedef typename index_type::value_type value_type;
     typedef bip::allocator<generic_index, segment_manager_type> allocator_type;
-    typedef undo_state<value_type> undo_state_type;
+    typedef undo_entry<value_type> undo_entry_type;
+    typedef undo_frame<typename value_type::id_type> undo_frame_type;
 
     generic_index(allocator<value_type> a)
-        : _stack(a)
+        : _undo_log(a)
+        , _undo_frames(a)
         , _indices(a)
         , _size_of_value_type(sizeof(typename MultiIndexType::node_type))
         , _size_of_this(sizeof(*this))
@@ -160,7 +222,7 @@ public:
 
     /**
      * Construct a new element in the multi_index_container.
-     * Set the ID to the next available ID, then increment _next_id and fire off on_create().
+     * Fire off on_create(), set the ID to the next available ID, then increment _next_id.
      */
     template <typename Constructor> const value_type& emplace(Constructor&& c)
     {
@@ -171,17 +233,20 @@ public:
             c(v);
         };
 
-        auto insert_result = _indices.emplace(constructor, _indices.get_allocator());
+        on_create();
 
-        if (!insert_result.second)
+        // ids only grow, so the new object is linked at the end of the primary index without a search
+        const auto size = _indices.size();
+        auto itr = _indices.emplace_hint(_indices.end(), constructor, _indices.get_allocator());
+
+        if (_indices.size() == size)
         {
             BOOST_THROW_EXCEPTION(
                 std::logic_error("could not insert object, most likely a uniqueness constraint was violated"));
         }
 
         ++_next_id;
-        on_create(*insert_result.first);
-        return *insert_result.first;
+        return *itr;
     }
 
     template <typename Modifier> void modify(const value_type& obj, Modifier&& m)
@@ -220,251 +285,112 @@ public:
         return _indices;
     }
 
-    class session
+    const index_type& indicies() const
     {
-    public:
-        session(session&& mv)
-            : _index(mv._index)
-            , _apply(mv._apply)
-        {
-            mv._apply = false;
-        }
-
-        ~session()
-        {
-            if (_apply)
-            {
-                _index.undo();
-            }
-        }
-
-        /** leaves the UNDO state on the stack when session goes out of scope */
-        void push()
-        {
-            _apply = false;
-        }
-        /** combines this session with the prior session */
-        void squash()
-        {
-            if (_apply)
-                _index.squash();
-            _apply = false;
-        }
-        void undo()
-        {
-            if (_apply)
-                _index.undo();
-            _apply = false;
-        }
-
-        session& operator=(session&& mv)
-        {
-            if (this == &mv)
-                return *this;
-            if (_apply)
-                _index.undo();
-            _apply = mv._apply;
-            mv._apply = false;
-            return *this;
-        }
-
-        int64_t revision() const
-        {
-            return _revision;
-        }
-
-    private:
-        friend class generic_index;
-
-        session(generic_index& idx, int64_t revision)
-            : _index(idx)
-            , _revision(revision)
-        {
-            if (revision == -1)
-                _apply = false;
-        }
-
-        generic_index& _index;
-        bool _apply = true;
-        int64_t _revision = 0;
-    };
+        return _indices;
+    }
 
-    session start_undo_session(bool enabled)
+    /**
+     *  The id the next created object will get. Setting it bypasses the undo state,
+     *  it is meant for restoring an index from a snapshot.
+     */
+    typename value_type::id_type next_id() const
     {
-        if (enabled)
-        {
-            _stack.emplace_back(_indices.get_allocator());
-            _stack.back().old_next_id = _next_id;
-            _stack.back().revision = ++_revision;
-            return session(*this, _revision);
-        }
-        else
-        {
-            return session(*this, -1);
-        }
+        return _next_id;
     }
-
-    const index_type& indicies() const
+    void set_next_id(typename value_type::id_type id)
     {
-        return _indices;
+        _next_id = id;
     }
-    int64_t revision() const
+
+    /**
+     *  Undo sessions are started by the database for all indexes at once, the index only records
+     *  changes while the shared revisions have an undoable head.
+     */
+    void set_undo_revisions(undo_revisions* revisions)
     {
-        return _revision;
+        _revisions = revisions;
     }
 
     /**
-     *  Restores the state to how it was prior to the current session discarding all changes
-     *  made between the last revision and the current revision.
+     *  Restores the state to how it was prior to the given revision discarding all changes
+     *  made within it. Does nothing if the index was not written in that revision.
      */
-    void undo()
+    void undo(int64_t revision)
     {
-        if (!enabled())
+        if (_undo_frames.empty() || _undo_frames.back().revision != revision)
             return;
 
-        const auto& head = _stack.back();
+        const undo_frame_type frame = _undo_frames.back();
 
-        for (auto& item : head.old_values)
+        // ids are assigned in increasing order, so the objects created within the frame are exactly
+        // those with ids from the next id at its start; removing them first keeps the restored
+        // values below from colliding with them
+        for (auto id = frame.old_next_id; id < _next_id; ++id)
         {
-            auto ok
-                = _indices.modify(_indices.find(item.second.id), [&](value_type& v) { v = std::move(item.second); });
-            if (!ok)
-                BOOST_THROW_EXCEPTION(
-                    std::logic_error("Could not modify object, most likely a uniqueness constraint was violated"));
+            auto itr = _indices.find(id);
+            if (itr != _indices.end())
+                _indices.erase(itr);
         }
+        _next_id = frame.old_next_id;
 
-        for (auto id : head.new_ids)
+        const size_t first_entry = frame.first_entry - _undo_log_offset;
+        while (_undo_log.size() > first_entry)
         {
-            _indices.erase(_indices.find(id));
-        }
-        _next_id = head.old_next_id;
+            auto& entry = _undo_log.back();
 
-        for (auto& item : head.removed_values)
-        {
-            bool ok = _indices.emplace(std::move(item.second)).second;
-            if (!ok)
-                BOOST_THROW_EXCEPTION(
-                    std::logic_error("Could not restore object, most likely a uniqueness constraint was violated"));
+            // changes of objects created within the frame get into it when it is merged by squash
+            if (entry.value.id < frame.old_next_id)
+            {
+                if (entry.removed)
+                {
+                    bool ok = _indices.emplace(std::move(entry.value)).second;
+                    if (!ok)
+                        BOOST_THROW_EXCEPTION(std::logic_error(
+                            "Could not restore object, most likely a uniqueness constraint was violated"));
+                }
+                else
+                {
+                    auto ok = _indices.modify(_indices.find(entry.value.id),
+                                              [&](value_type& v) { v = std::move(entry.value); });
+                    if (!ok)
+                        BOOST_THROW_EXCEPTION(std::logic_error(
+                            "Could not modify object, most likely a uniqueness constraint was violated"));
+                }
+            }
+
+            _undo_log.pop_back();
         }
 
-        _stack.pop_back();
-        --_revision;
+        _undo_frames.pop_back();
     }
 
     /**
-     *  This method works similar to git squash, it merges the change set from the two most
-     *  recent revision numbers into one revision number (reducing the head revision number)
+     *  This method works similar to git squash, it merges the changes of the given revision into
+     *  the previous one. The log is replayed in reverse on undo, so merging only relabels the frame.
+     *  If the previous revision can not be undone any more the changes are discarded instead.
      *
      *  This method does not change the state of the index, only the state of the undo buffer.
      */
-    void squash()
+    void squash(int64_t revision, bool discard)
     {
-        if (!enabled())
+        if (_undo_frames.empty() || _undo_frames.back().revision != revision)
             return;
-        if (_stack.size() == 1)
+
+        if (discard)
         {
-            _stack.pop_front();
-            return;
+            const size_t first_entry = _undo_frames.back().first_entry - _undo_log_offset;
+            _undo_log.erase(_undo_log.begin() + first_entry, _undo_log.end());
+            _undo_frames.pop_back();
         }
-
-        auto& state = _stack.back();
-        auto& prev_state = _stack[_stack.size() - 2];
-
-        // An object's relationship to a state can be:
-        // in new_ids            : new
-        // in old_values (was=X) : upd(was=X)
-        // in removed (was=X)    : del(was=X)
-        // not in any of above   : nop
-        //
-        // When merging A=prev_state and B=state we have a 4x4 matrix of all possibilities:
-        //
-        //                   |--------------------- B ----------------------|
-        //
-        //                +------------+------------+------------+------------+
-        //                | new        | upd(was=Y) | del(was=Y) | nop        |
-        //   +------------+------------+------------+------------+------------+
-        // / | new        | N/A        | new       A| nop       C| new       A|
-        // | +------------+------------+------------+------------+------------+
-        // | | upd(was=X) | N/A        | upd(was=X)A| del(was=X)C| upd(was=X)A|
-        // A +------------+------------+------------+------------+------------+
-        // | | del(was=X) | N/A        | N/A        | N/A        | del(was=X)A|
-        // | +------------+------------+------------+------------+------------+
-        // \ | nop        | new       B| upd(was=Y)B| del(was=Y)B| nop      AB|
-        //   +------------+------------+------------+------------+------------+
-        //
-        // Each entry was composed by labelling what should occur in the given case.
-        //
-        // Type A means the composition of states contains the same entry as the first of the two merged states for that
-        // object.
-        // Type B means the composition of states contains the same entry as the second of the two merged states for
-        // that object.
-        // Type C means the composition of states contains an entry different from either of the merged states for that
-        // object.
-        // Type N/A means the composition of states violates causal timing.
-        // Type AB means both type A and type B simultaneously.
-        //
-        // The merge() operation is defined as modifying prev_state in-place to be the state object which represents the
-        // composition of
-        // state A and B.
-        //
-        // Type A (and AB) can be implemented as a no-op; prev_state already contains the correct value for the merged
-        // state.
-        // Type B (and AB) can be implemented by copying from state to prev_state.
-        // Type C needs special case-by-case logic.
-        // Type N/A can be ignored or assert(false) as it can only occur if prev_state and state have illegal values
-        // (a serious logic error which should never happen).
-        //
-
-        // We can only be outside type A/AB (the nop path) if B is not nop, so it suffices to iterate through B's three
-        // containers.
-
-        for (const auto& item : state.old_values)
+        else if (_undo_frames.size() > 1 && _undo_frames[_undo_frames.size() - 2].revision == revision - 1)
         {
-            if (prev_state.new_ids.find(item.second.id) != prev_state.new_ids.end())
-            {
-                // new+upd -> new, type A
-                continue;
-            }
-            if (prev_state.old_values.find(item.second.id) != prev_state.old_values.end())
-            {
-                // upd(was=X) + upd(was=Y) -> upd(was=X), type A
-                continue;
-            }
-            // del+upd -> N/A
-            assert(prev_state.removed_values.find(item.second.id) == prev_state.removed_values.end());
-            // nop+upd(was=Y) -> upd(was=Y), type B
-            prev_state.old_values.emplace(std::move(item));
+            _undo_frames.pop_back();
         }
-
-        // *+new, but we assume the N/A cases don't happen, leaving type B nop+new -> new
-        for (auto id : state.new_ids)
-            prev_state.new_ids.insert(id);
-
-        // *+del
-        for (auto& obj : state.removed_values)
+        else
         {
-            if (prev_state.new_ids.find(obj.second.id) != prev_state.new_ids.end())
-            {
-                // new + del -> nop (type C)
-                prev_state.new_ids.erase(obj.second.id);
-                continue;
-            }
-            auto it = prev_state.old_values.find(obj.second.id);
-            if (it != prev_state.old_values.end())
-            {
-                // upd(was=X) + del(was=Y) -> del(was=X)
-                prev_state.removed_values.emplace(std::move(*it));
-                prev_state.old_values.erase(obj.second.id);
-                continue;
-            }
-            // del + del -> N/A
-            assert(prev_state.removed_values.find(obj.second.id) == prev_state.removed_values.end());
-            // nop + del(was=Y) -> del(was=Y)
-            prev_state.removed_values.emplace(std::move(obj)); //[obj.second->id] = std::move(obj.second);
+            _undo_frames.back().revision = revision - 1;
         }
-
-        _stack.pop_back();
-        --_revision;
     }
 
     /**
@@ -472,26 +398,18 @@ public:
      */
     void commit(int64_t revision)
     {
-        while (_stack.size() && _stack[0].revision <= revision)
+        while (_undo_frames.size() && _undo_frames.front().revision <= revision)
         {
-            _stack.pop_front();
-        }
-    }
-
-    /**
-     * Unwinds all undo states
-     */
-    void undo_all()
-    {
-        while (enabled())
-            undo();
-    }
+            _undo_frames.pop_front();
 
-    void set_revision(int64_t revision)
-    {
-        if (_stack.size() != 0)
-            BOOST_THROW_EXCEPTION(std::logic_error("cannot set revision while there is an existing undo stack"));
-        _revision = revision;
+            const uint64_t last_entry
+                = _undo_frames.empty() ? _undo_log_offset + _undo_log.size() : _undo_frames.front().first_entry;
+            while (_undo_log_offset < last_entry)
+            {
+                _undo_log.pop_front();
+                ++_undo_log_offset;
+            }
+        }
     }
 
     void remove_object(int64_t id)
@@ -503,117 +421,73 @@ public:
     }
 
 private:
-    bool enabled() const
-    {
-        return _stack.size();
-    }
-
-    void on_modify(const value_type& v)
+    /**
+     *  Opens the frame of the head revision on the first write within it.
+     *  @return frame to record the write in, nullptr if undo is disabled
+     */
+    undo_frame_type* head_frame()
     {
-        if (!enabled())
-            return;
-
-        auto& head = _stack.back();
-
-        if (head.new_ids.find(v.id) != head.new_ids.end())
-            return;
+        if (!_revisions || !_revisions->enabled())
+            return nullptr;
 
-        auto itr = head.old_values.find(v.id);
-        if (itr != head.old_values.end())
-            return;
+        if (_undo_frames.empty() || _undo_frames.back().revision != _revisions->head)
+        {
+            undo_frame_type frame;
+            frame.revision = _revisions->head;
+            frame.first_entry = _undo_log_offset + _undo_log.size();
+            frame.old_next_id = _next_id;
+            _undo_frames.push_back(frame);
+        }
 
-        head.old_values.emplace(std::pair<typename value_type::id_type, const value_type&>(v.id, v));
+        return &_undo_frames.back();
     }
 
-    void on_remove(const value_type& v)
+    void on_modify(const value_type& v)
     {
-        if (!enabled())
+        const undo_frame_type* frame = head_frame();
+        if (!frame || v.id >= frame->old_next_id)
             return;
 
-        auto& head = _stack.back();
-        if (head.new_ids.count(v.id))
+        // only the oldest value matters on undo, skip repeated modifications of the same object
+        if (_undo_log.size() > frame->first_entry - _undo_log_offset)
         {
-            head.new_ids.erase(v.id);
-            return;
-        }
-
-        auto itr = head.old_values.find(v.id);
-        if (itr != head.old_values.end())
-        {
-            head.removed_values.emplace(std::move(*itr));
-            head.old_values.erase(v.id);
-            return;
+            const auto& last = _undo_log.back();
+            if (!last.removed && last.value.id == v.id)
+                return;
         }
 
-        if (head.removed_values.count(v.id))
-            return;
-
-        head.removed_values.emplace(std::pair<typename value_type::id_type, const value_type&>(v.id, v));
+        _undo_log.emplace_back(false, v);
     }
 
-    void on_create(const value_type& v)
+    void on_remove(const value_type& v)
     {
-        if (!enabled())
+        const undo_frame_type* frame = head_frame();
+        if (!frame || v.id >= frame->old_next_id)
             return;
-        auto& head = _stack.back();
 
-        head.new_ids.insert(v.id);
+        _undo_log.emplace_back(true, v);
     }
 
-    boost::interprocess::deque<undo_state_type, allocator<undo_state_type>> _stack;
+    void on_create()
+    {
+        head_frame();
+    }
 
     /**
-     *  Each new session increments the revision, a squash will decrement the revision by combining
-     *  the two most recent revisions into one revision.
-     *
-     *  Commit will discard all revisions prior to the committed revision.
+     *  Append-only log of the values to restore, in the order the changes were made. Frames split it by
+     *  revision; _undo_log_offset counts the entries committed from its front.
      */
-    int64_t _revision = 0;
+    boost::interprocess::deque<undo_entry_type, allocator<undo_entry_type>> _undo_log;
+    boost::interprocess::deque<undo_frame_type, allocator<undo_frame_type>> _undo_frames;
+    uint64_t _undo_log_offset = 0;
+    bip::offset_ptr<undo_revisions> _revisions;
+
     typename value_type::id_type _next_id = 0;
     index_type _indices;
     uint32_t _size_of_value_type = 0;
     uint32_t _size_of_this = 0;
 };
 
-class abstract_session
-{
-public:
-    virtual ~abstract_session(){};
-    virtual void push() = 0;
-    virtual void squash() = 0;
-    virtual void undo() = 0;
-    virtual int64_t revision() const = 0;
-};
-
-template <typename SessionType> class session_impl : public abstract_session
-{
-public:
-    session_impl(SessionType&& s)
-        : _session(std::move(s))
-    {
-    }
-
-    virtual void push() override
-    {
-        _session.push();
-    }
-    virtual void squash() override
-    {
-        _session.squash();
-    }
-    virtual void undo() override
-    {
-        _session.undo();
-    }
-    virtual int64_t revision() const override
-    {
-        return _session.revision();
-    }
-
-private:
-    SessionType _session;
-};
-
 class index_extension
 {
 public:
@@ -637,18 +511,16 @@ public:
     virtual ~abstract_index()
     {
     }
-    virtual void set_revision(int64_t revision) = 0;
-    virtual std::unique_ptr<abstract_session> start_undo_session(bool enabled) = 0;
-
-    virtual int64_t revision() const = 0;
-    virtual void undo() const = 0;
-    virtual void squash() const = 0;
+    virtual void undo(int64_t revision) const = 0;
+    virtual void squash(int64_t revision, bool discard) const = 0;
     virtual void commit(int64_t revision) const = 0;
-    virtual void undo_all() const = 0;
     virtual uint32_t type_id() const = 0;
 
     virtual void remove_object(int64_t id) = 0;
 
+    /** Looks the index up again after the segment was mapped at another address. */
+    virtual void attach(bip::managed_mapped_file& segment) = 0;
+
     void add_index_extension(std::shared_ptr<index_extension> ext)
     {
         _extensions.push_back(ext);
@@ -662,6 +534,12 @@ public:
         return _idx_ptr;
     }
 
+protected:
+    void set(void* i)
+    {
+        _idx_ptr = i;
+    }
+
 private:
     void* _idx_ptr;
     index_extensions _extensions;
@@ -672,39 +550,21 @@ template <typename BaseIndex> class index_impl : public abstract_index
 public:
     index_impl(BaseIndex& base)
         : abstract_index(&base)
-        , _base(base)
+        , _base(&base)
     {
     }
 
-    virtual std::unique_ptr<abstract_session> start_undo_session(bool enabled) override
+    virtual void undo(int64_t revision) const override
     {
-        return std::unique_ptr<abstract_session>(
-            new session_impl<typename BaseIndex::session>(_base.start_undo_session(enabled)));
+        _base->undo(revision);
     }
-
-    virtual void set_revision(int64_t revision) override
+    virtual void squash(int64_t revision, bool discard) const override
     {
-        _base.set_revision(revision);
-    }
-    virtual int64_t revision() const override
-    {
-        return _base.revision();
-    }
-    virtual void undo() const override
-    {
-        _base.undo();
-    }
-    virtual void squash() const override
-    {
-        _base.squash();
+        _base->squash(revision, discard);
     }
     virtual void commit(int64_t revision) const override
     {
-        _base.commit(revision);
-    }
-    virtual void undo_all() const override
-    {
-        _base.undo_all();
+        _base->commit(revision);
     }
     virtual uint32_t type_id() const override
     {
@@ -713,11 +573,22 @@ public:
 
     virtual void remove_object(int64_t id) override
     {
-        return _base.remove_object(id);
+        return _base->remove_object(id);
+    }
+
+    virtual void attach(bip::managed_mapped_file& segment) override
+    {
+        std::string type_name = boost::core::demangle(typeid(typename BaseIndex::value_type).name());
+        BaseIndex* base = segment.find<BaseIndex>(type_name.c_str()).first;
+        if (!base)
+            BOOST_THROW_EXCEPTION(std::runtime_error("unable to find index for " + type_name + " in database"));
+
+        _base = base;
+        set(base);
     }
 
 private:
-    BaseIndex& _base;
+    BaseIndex* _base;
 };
 
 template <typename IndexType> class index : public index_impl<IndexType>
@@ -729,6 +600,81 @@ public:
     }
 };
 
+/**
+ *  Acquisitions of one side of the database lock within this process.
+ */
+struct lock_wait_stats
+{
+    uint64_t locks = 0; ///< locks acquired
+    uint64_t waits = 0; ///< locks that were not free and had to be waited for
+    uint64_t wait_micro = 0; ///< total time spent waiting
+    uint64_t max_wait_micro = 0;
+    uint64_t timeouts = 0; ///< waits given up after the timeout
+};
+
+struct lock_stats
+{
+    lock_wait_stats read;
+    lock_wait_stats write;
+    uint32_t lock_num = 0; ///< number of the lock in use, grows whenever a writer moves to the next lock
+    uint64_t torn_reads = 0; ///< reads that found a writer running on another lock and waited for it
+    uint64_t head_sequence = 0;
+};
+
+class lock_wait_counters
+{
+public:
+    void record_lock()
+    {
+        ++_locks;
+    }
+
+    void record_wait(uint64_t wait_micro)
+    {
+        ++_locks;
+        ++_waits;
+        _wait_micro += wait_micro;
+
+        uint64_t max = _max_wait_micro.load();
+        while (wait_micro > max && !_max_wait_micro.compare_exchange_weak(max, wait_micro))
+        {
+        }
+    }
+
+    void record_timeout()
+    {
+        ++_timeouts;
+    }
+
+    lock_wait_stats get() const
+    {
+        lock_wait_stats stats;
+        stats.locks = _locks.load();
+        stats.waits = _waits.load();
+        stats.wait_micro = _wait_micro.load();
+        stats.max_wait_micro = _max_wait_micro.load();
+        stats.timeouts = _timeouts.load();
+        return stats;
+    }
+
+private:
+    std::atomic<uint64_t> _locks{ 0 };
+    std::atomic<uint64_t> _waits{ 0 };
+    std::atomic<uint64_t> _wait_micro{ 0 };
+    std::atomic<uint64_t> _max_wait_micro{ 0 };
+    std::atomic<uint64_t> _timeouts{ 0 };
+};
+
+/**
+ *  Reads in progress of one open database. A writer that moved past a lock waits for the reads of live
+ *  processes before it writes, so no read ever runs together with a write.
+ */
+struct reader_slot
+{
+    std::atomic<int32_t> pid{ 0 }; ///< process of the database, 0 if the slot is free
+    std::atomic<uint32_t> readers{ 0 };
+};
+
 class read_write_mutex_manager
 {
 public:
@@ -757,9 +703,44 @@ public:
         return _current_lock;
     }
 
+    /**
+     *  The writer increments the head sequence when it takes the write lock and when it releases it, so an
+     *  odd sequence means a write is in progress. Sequentially consistent, together with the reader slots it
+     *  makes either the reader see the write or the writer see the reader.
+     */
+    uint64_t head_sequence() const
+    {
+        return _head_sequence.load();
+    }
+
+    void next_sequence()
+    {
+        _head_sequence.fetch_add(1);
+    }
+
+    /** Size of the segment file as last mapped by the writer, read only processes map it again on change. */
+    uint64_t segment_size() const
+    {
+        return _segment_size.load(std::memory_order_acquire);
+    }
+
+    void set_segment_size(uint64_t size)
+    {
+        _segment_size.store(size, std::memory_order_release);
+    }
+
+    /** Takes a free slot or one of a dead process, throws if there is none. */
+    reader_slot& acquire_reader_slot(int32_t pid);
+
+    /** @return reads in progress in processes that are alive, slots of dead processes are freed */
+    uint32_t active_readers();
+
 private:
     std::array<read_write_mutex, CHAINBASE_NUM_RW_LOCKS> _locks;
+    std::array<reader_slot, CHAINBASE_MAX_READER_SLOTS> _reader_slots;
     std::atomic<uint32_t> _current_lock;
+    std::atomic<uint64_t> _head_sequence{ 0 };
+    std::atomic<uint64_t> _segment_size{ 0 };
 };
 
 /**
@@ -787,6 +768,37 @@ public:
     void wipe(const bfs::path& dir);
     void set_require_locking(bool enable_require_locking);
 
+    /**
+     *  Defers flushes of the segment to the end of the outermost deferral, for genesis and snapshot import
+     *  where the state is built in one go and an interrupted load is restarted anyway. Deferrals nest. Indexes
+     *  are maintained as usual, and block replays don't defer so they keep their periodic flushes.
+     */
+    void begin_deferred_flush();
+    void end_deferred_flush();
+    bool is_flush_deferred() const
+    {
+        return _deferred_flush_depth > 0;
+    }
+
+    template <typename Lambda> auto with_deferred_flush(Lambda&& callback) -> decltype((*(Lambda*)nullptr)())
+    {
+        struct deferred_flush_guard
+        {
+            deferred_flush_guard(database& db)
+                : _db(db)
+            {
+                _db.begin_deferred_flush();
+            }
+            ~deferred_flush_guard()
+            {
+                _db.end_deferred_flush();
+            }
+            database& _db;
+        } guard(*this);
+
+        return callback();
+    }
+
     void require_lock_fail(const char* method, const char* lock_type, const char* tname) const;
 
     void require_read_lock(const char* method, const char* tname) const
@@ -801,19 +813,18 @@ public:
             require_lock_fail(method, "write", tname);
     }
 
+    /**
+     *  Undo session of all indexes. Starting one is O(1): an index opens its undo frame only when it
+     *  is written within the session.
+     */
     struct session
     {
     public:
         session(session&& s)
-            : _index_sessions(std::move(s._index_sessions))
+            : _db(s._db)
             , _revision(s._revision)
         {
-        }
-        session(std::vector<std::unique_ptr<abstract_session>>&& s)
-            : _index_sessions(std::move(s))
-        {
-            if (_index_sessions.size())
-                _revision = _index_sessions[0]->revision();
+            s._db = nullptr;
         }
 
         ~session()
@@ -821,25 +832,25 @@ public:
             undo();
         }
 
+        /** leaves the UNDO state on the stack when session goes out of scope */
         void push()
         {
-            for (auto& i : _index_sessions)
-                i->push();
-            _index_sessions.clear();
+            _db = nullptr;
         }
 
+        /** combines this session with the prior session */
         void squash()
         {
-            for (auto& i : _index_sessions)
-                i->squash();
-            _index_sessions.clear();
+            if (_db)
+                _db->squash();
+            _db = nullptr;
         }
 
         void undo()
         {
-            for (auto& i : _index_sessions)
-                i->undo();
-            _index_sessions.clear();
+            if (_db)
+                _db->undo();
+            _db = nullptr;
         }
 
         int64_t revision() const
@@ -852,8 +863,13 @@ public:
         session()
         {
         }
+        session(database& db, int64_t revision)
+            : _db(&db)
+            , _revision(revision)
+        {
+        }
 
-        std::vector<std::unique_ptr<abstract_session>> _index_sessions;
+        database* _db = nullptr;
         int64_t _revision = -1;
     };
 
@@ -861,9 +877,9 @@ public:
 
     int64_t revision() const
     {
-        if (_index_list.size() == 0)
+        if (!_undo_revisions)
             return -1;
-        return _index_list[0]->revision();
+        return _undo_revisions->head;
     }
 
     void undo();
@@ -874,8 +890,10 @@ public:
     void set_revision(int64_t revision)
     {
         CHAINBASE_REQUIRE_WRITE_LOCK("set_revision", int64_t);
-        for (auto i : _index_list)
-            i->set_revision(revision);
+        if (_undo_revisions->enabled())
+            BOOST_THROW_EXCEPTION(std::logic_error("cannot set revision while there is an existing undo stack"));
+        _undo_revisions->head = revision;
+        _undo_revisions->floor = revision;
     }
 
     auto get_segment_manager() -> decltype(((bip::managed_mapped_file*)nullptr)->get_segment_manager())
@@ -888,6 +906,23 @@ public:
         return _segment->get_segment_manager()->get_free_memory();
     }
 
+    size_t get_max_memory() const
+    {
+        return _segment->get_segment_manager()->get_size();
+    }
+
+    /**
+     *  Grows the segment by `size` bytes while the database is open. The file is mapped again, possibly at
+     *  another address, so references to objects taken before are invalid afterwards. Must be called with
+     *  the write lock held and no object references alive.
+     */
+    void grow(uint64_t size);
+
+    /**
+     *  Truncates the free memory at the end of the shared memory file in `dir`. The database must be closed.
+     */
+    static void shrink_to_fit(const bfs::path& dir);
+
     template <typename MultiIndexType> void add_index()
     {
         const uint16_t type_id = generic_index<MultiIndexType>::value_type::type_id;
@@ -916,6 +951,8 @@ public:
         }
 
         idx_ptr->validate();
+        if (!_read_only)
+            idx_ptr->set_undo_revisions(_undo_revisions);
 
         if (type_id >= _index_map.size())
             _index_map.resize(type_id + 1);
@@ -1054,24 +1091,24 @@ public:
         return get_mutable_index<index_type>().emplace(std::forward<Constructor>(con));
     }
 
+    /**
+     *  Runs callback once under the read lock. It never runs together with a write: a read that finds a
+     *  writer running on another lock waits for it, and such a writer waits for the reads already running.
+     *  Read only processes serving as replicas of the writer map the segment again first if the writer has
+     *  grown it. A read nested in another read of the same database in the same fc task runs under the
+     *  outer lock.
+     */
     template <typename Lambda>
     auto with_read_lock(Lambda&& callback, uint64_t wait_micro = 1000000) -> decltype((*(Lambda*)nullptr)())
     {
-        read_lock lock(_rw_manager->current_lock(), bip::defer_lock_type());
         BOOST_ATTRIBUTE_UNUSED
         int_incrementer ii(_read_lock_count);
 
-        if (!wait_micro)
-        {
-            lock.lock();
-        }
-        else
-        {
-            if (!lock.timed_lock(boost::posix_time::microsec_clock::universal_time()
-                                 + boost::posix_time::microseconds(wait_micro)))
-                BOOST_THROW_EXCEPTION(std::runtime_error("unable to acquire lock"));
-        }
+        // taking the lock again could wait behind a writer that is itself waiting for the outer read
+        if (current_reader() == this)
+            return callback();
 
+        read_guard read(*this, wait_micro);
         return callback();
     }
 
@@ -1085,24 +1122,69 @@ public:
         BOOST_ATTRIBUTE_UNUSED
         int_incrementer ii(_write_lock_count);
 
-        if (!wait_micro)
+        if (lock.try_lock())
         {
-            lock.lock();
+            _write_lock_stats.record_lock();
         }
         else
         {
-            while (!lock.timed_lock(boost::posix_time::microsec_clock::universal_time()
-                                    + boost::posix_time::microseconds(wait_micro)))
+            const auto start = std::chrono::steady_clock::now();
+            if (!wait_micro)
+            {
+                lock.lock();
+            }
+            else
             {
-                _rw_manager->next_lock();
-                std::cerr << "Lock timeout, moving to lock " << _rw_manager->current_lock_num() << std::endl;
-                lock = write_lock(_rw_manager->current_lock(), boost::defer_lock_t());
+                // readers can only delay a writer by one reader phase, a timeout means a reader process died
+                // holding the lock. The move shows up in get_lock_stats() as a write timeout and a new lock_num
+                while (!lock.timed_lock(boost::posix_time::microsec_clock::universal_time()
+                                        + boost::posix_time::microseconds(wait_micro)))
+                {
+                    _write_lock_stats.record_timeout();
+                    _rw_manager->next_lock();
+                    lock = write_lock(_rw_manager->current_lock(), boost::defer_lock_t());
+                }
             }
+            _write_lock_stats.record_wait(elapsed_micro(start));
         }
 
+        struct sequence_guard
+        {
+            sequence_guard(read_write_mutex_manager& m)
+                : _manager(m)
+            {
+                _manager.next_sequence();
+            }
+            ~sequence_guard()
+            {
+                _manager.next_sequence();
+            }
+            read_write_mutex_manager& _manager;
+        } sequence(*_rw_manager);
+
+        wait_for_readers(wait_micro);
         return callback();
     }
 
+    lock_stats get_lock_stats() const
+    {
+        lock_stats stats;
+        stats.read = _read_lock_stats.get();
+        stats.write = _write_lock_stats.get();
+        stats.torn_reads = _torn_reads.load();
+        if (_rw_manager)
+        {
+            stats.lock_num = _rw_manager->current_lock_num();
+            stats.head_sequence = _rw_manager->head_sequence();
+        }
+        return stats;
+    }
+
+    uint64_t head_sequence() const
+    {
+        return _rw_manager->head_sequence();
+    }
+
     template <typename IndexExtensionType, typename Lambda> void for_each_index_extension(Lambda&& callback) const
     {
         for (const abstract_index* idx : _index_list)
@@ -1118,9 +1200,54 @@ public:
     }
 
 private:
+    /// times a read looks for a writer on another lock to finish before it sleeps between looks
+    static const uint32_t max_read_spins = 64;
+
+    /**
+     *  Holds the read lock, counted in the reader slot of the database, for the duration of a read.
+     */
+    class read_guard
+    {
+    public:
+        read_guard(database& db, uint64_t wait_micro);
+
+        ~read_guard()
+        {
+            current_reader() = _previous_reader;
+            --_db._reader_slot->readers;
+        }
+
+    private:
+        database& _db;
+        boost::shared_lock<boost::shared_mutex> _local;
+        read_lock _lock;
+        const database* _previous_reader = nullptr;
+    };
+
+    /// the database whose read lock the current fc task holds
+    static const database*& current_reader();
+
+    /**
+     *  Called by a writer after it took the lock. Waits for reads that still run under a lock the writer
+     *  moved past, except for one of the current fc task, and throws if they don't finish in wait_micro.
+     */
+    void wait_for_readers(uint64_t wait_micro);
+
+    void acquire_read_lock(read_lock& lock, uint64_t wait_micro);
+    void release_reader_slot();
+    void remap_read_only(uint64_t wait_micro);
+    void attach_segment();
+
+    static uint64_t elapsed_micro(const std::chrono::steady_clock::time_point& start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+            .count();
+    }
+
     std::unique_ptr<bip::managed_mapped_file> _segment;
     std::unique_ptr<bip::managed_mapped_file> _meta;
     read_write_mutex_manager* _rw_manager = nullptr;
+    reader_slot* _reader_slot = nullptr;
     bool _read_only = false;
     bip::file_lock _flock;
 
@@ -1129,6 +1256,8 @@ private:
      */
     std::vector<abstract_index*> _index_list;
 
+    undo_revisions* _undo_revisions = nullptr;
+
     /**
      * This is a full map (size 2^16) of all possible index designed for constant time lookup
      */
@@ -1139,6 +1268,16 @@ private:
     int32_t _read_lock_count = 0;
     int32_t _write_lock_count = 0;
     bool _enable_require_locking = false;
+
+    lock_wait_counters _read_lock_stats;
+    lock_wait_counters _write_lock_stats;
+    std::atomic<uint64_t> _torn_reads{ 0 };
+
+    /** keeps the readers of a read only process out while it maps a grown segment */
+    boost::shared_mutex _remap_mutex;
+
+    int32_t _deferred_flush_depth = 0;
+    bool _deferred_flush_pending = false;
 };
 
 template <typename Object, typename... Args>
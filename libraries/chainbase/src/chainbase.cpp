@@ -1,10 +1,181 @@
 #include <chainbase/chainbase.hpp>
 #include <boost/array.hpp>
 
+#include <fc/thread/thread_specific.hpp>
+
+#include <algorithm>
+
+#include <cerrno>
+#include <signal.h>
+#include <unistd.h>
+
 #include <iostream>
 
 namespace chainbase {
 
+void read_write_mutex::lock_sharable()
+{
+    bip::scoped_lock<bip::interprocess_mutex> guard(_mutex);
+    if (!_writer && !_waiting_writers)
+    {
+        ++_readers;
+        return;
+    }
+
+    ++_blocked_readers;
+    const uint64_t phase = _write_phase;
+    while (phase == _write_phase)
+        _readers_cond.wait(guard);
+}
+
+bool read_write_mutex::try_lock_sharable()
+{
+    bip::scoped_lock<bip::interprocess_mutex> guard(_mutex);
+    if (_writer || _waiting_writers)
+        return false;
+
+    ++_readers;
+    return true;
+}
+
+bool read_write_mutex::timed_lock_sharable(const boost::posix_time::ptime& abs_time)
+{
+    bip::scoped_lock<bip::interprocess_mutex> guard(_mutex);
+    if (!_writer && !_waiting_writers)
+    {
+        ++_readers;
+        return true;
+    }
+
+    ++_blocked_readers;
+    const uint64_t phase = _write_phase;
+    while (phase == _write_phase)
+    {
+        if (!_readers_cond.timed_wait(guard, abs_time) && phase == _write_phase)
+        {
+            --_blocked_readers;
+            return false;
+        }
+    }
+    return true;
+}
+
+void read_write_mutex::unlock_sharable()
+{
+    bip::scoped_lock<bip::interprocess_mutex> guard(_mutex);
+    if (--_readers == 0 && _waiting_writers)
+        _writers_cond.notify_all();
+}
+
+void read_write_mutex::lock()
+{
+    bip::scoped_lock<bip::interprocess_mutex> guard(_mutex);
+    ++_waiting_writers;
+    while (_writer || _readers)
+        _writers_cond.wait(guard);
+    --_waiting_writers;
+    _writer = true;
+}
+
+bool read_write_mutex::try_lock()
+{
+    bip::scoped_lock<bip::interprocess_mutex> guard(_mutex);
+    if (_writer || _readers)
+        return false;
+
+    _writer = true;
+    return true;
+}
+
+bool read_write_mutex::timed_lock(const boost::posix_time::ptime& abs_time)
+{
+    bip::scoped_lock<bip::interprocess_mutex> guard(_mutex);
+    ++_waiting_writers;
+    while (_writer || _readers)
+    {
+        if (!_writers_cond.timed_wait(guard, abs_time) && (_writer || _readers))
+        {
+            // readers stopped by this writer must not wait for it any longer
+            if (--_waiting_writers == 0 && !_writer)
+                grant_blocked_readers();
+            return false;
+        }
+    }
+    --_waiting_writers;
+    _writer = true;
+    return true;
+}
+
+void read_write_mutex::unlock()
+{
+    bip::scoped_lock<bip::interprocess_mutex> guard(_mutex);
+    _writer = false;
+    if (_blocked_readers)
+        grant_blocked_readers();
+    else if (_waiting_writers)
+        _writers_cond.notify_all();
+}
+
+void read_write_mutex::grant_blocked_readers()
+{
+    if (!_blocked_readers)
+        return;
+
+    _readers += _blocked_readers;
+    _blocked_readers = 0;
+    ++_write_phase;
+    _readers_cond.notify_all();
+}
+
+namespace {
+bool is_process_alive(int32_t pid)
+{
+    return ::kill(pid, 0) == 0 || errno == EPERM;
+}
+}
+
+reader_slot& read_write_mutex_manager::acquire_reader_slot(int32_t pid)
+{
+    for (reader_slot& slot : _reader_slots)
+    {
+        int32_t owner = slot.pid.load();
+        if (owner && is_process_alive(owner))
+            continue;
+
+        if (slot.pid.compare_exchange_strong(owner, pid))
+        {
+            slot.readers = 0;
+            return slot;
+        }
+    }
+    BOOST_THROW_EXCEPTION(std::runtime_error("too many processes have the database open"));
+}
+
+uint32_t read_write_mutex_manager::active_readers()
+{
+    uint32_t readers = 0;
+    for (reader_slot& slot : _reader_slots)
+    {
+        const uint32_t slot_readers = slot.readers.load();
+        if (!slot_readers)
+            continue;
+
+        int32_t owner = slot.pid.load();
+        if (!owner)
+            continue;
+
+        // the reads of a process that died holding the lock will never finish
+        if (!is_process_alive(owner))
+        {
+            if (slot.pid.compare_exchange_strong(owner, 0))
+                slot.readers = 0;
+            continue;
+        }
+        readers += slot_readers;
+    }
+    return readers;
+}
+
 struct environment_check
 {
     environment_check()
@@ -89,6 +260,17 @@ void database::open(const bfs::path& dir, uint32_t flags, uint64_t shared_file_s
         _segment->find_or_construct<environment_check>("environment")();
     }
 
+    if (_read_only)
+    {
+        _undo_revisions = _segment->find<undo_revisions>("undo_revisions").first;
+        if (!_undo_revisions)
+            BOOST_THROW_EXCEPTION(std::runtime_error("unable to find undo revisions in read only database"));
+    }
+    else
+    {
+        _undo_revisions = _segment->find_or_construct<undo_revisions>("undo_revisions")();
+    }
+
     abs_path = bfs::absolute(dir / "shared_memory.meta");
 
     if (bfs::exists(abs_path))
@@ -112,30 +294,219 @@ void database::open(const bfs::path& dir, uint32_t flags, uint64_t shared_file_s
         _flock = bip::file_lock(abs_path.generic_string().c_str());
         if (!_flock.try_lock())
             BOOST_THROW_EXCEPTION(std::runtime_error("could not gain write access to the shared memory file"));
+
+        _rw_manager->set_segment_size(_segment->get_size());
+
+        // a writer that died while writing left the sequence odd
+        if (_rw_manager->head_sequence() & 1)
+            _rw_manager->next_sequence();
+    }
+
+    _reader_slot = &_rw_manager->acquire_reader_slot(::getpid());
+}
+
+const database*& database::current_reader()
+{
+    // fc runs many tasks on one thread, so this is kept per task: a task holding the read lock must not let
+    // another task of its thread skip the lock. Outside of fc tasks it is per thread
+    static fc::task_specific_ptr<const database*> reader;
+    if (!reader.get())
+        reader.reset(new const database*(nullptr));
+    return *reader.get();
+}
+
+database::read_guard::read_guard(database& db, uint64_t wait_micro)
+    : _db(db)
+{
+    const auto start = std::chrono::steady_clock::now();
+    bool waited = false;
+    for (uint32_t spin = 1;; ++spin)
+    {
+        if (_db._read_only)
+            _local = boost::shared_lock<boost::shared_mutex>(_db._remap_mutex);
+
+        _lock = read_lock(_db._rw_manager->current_lock(), bip::defer_lock_type());
+        _db.acquire_read_lock(_lock, wait_micro);
+
+        if (_db._read_only && _db._rw_manager->segment_size() != _db._segment->get_size())
+        {
+            _lock.unlock();
+            _local.unlock();
+            _db.remap_read_only(wait_micro);
+            continue;
+        }
+
+        // counted before the sequence is looked at: a writer that made the sequence odd after this waits for us
+        ++_db._reader_slot->readers;
+        if (!(_db._rw_manager->head_sequence() & 1))
+        {
+            _previous_reader = current_reader();
+            current_reader() = &_db;
+            return;
+        }
+
+        // a writer that moved to the next lock is still running, it holds the lock now current
+        --_db._reader_slot->readers;
+        _lock.unlock();
+        if (_local.owns_lock())
+            _local.unlock();
+
+        if (!waited)
+        {
+            ++_db._torn_reads;
+            waited = true;
+        }
+        if (wait_micro && elapsed_micro(start) > wait_micro)
+        {
+            _db._read_lock_stats.record_timeout();
+            BOOST_THROW_EXCEPTION(std::runtime_error("unable to acquire lock, a write is in progress"));
+        }
+
+        if (spin < max_read_spins)
+            boost::this_thread::yield();
+        else
+            boost::this_thread::sleep_for(boost::chrono::microseconds(100));
+    }
+}
+
+void database::wait_for_readers(uint64_t wait_micro)
+{
+    // only readers of a lock the writer moved past can still be running, normally there are none
+    const uint32_t own_reads = current_reader() == this ? 1 : 0;
+    if (_rw_manager->active_readers() <= own_reads)
+        return;
+
+    const auto start = std::chrono::steady_clock::now();
+    while (_rw_manager->active_readers() > own_reads)
+    {
+        if (wait_micro && elapsed_micro(start) > wait_micro)
+        {
+            _write_lock_stats.record_timeout();
+            BOOST_THROW_EXCEPTION(std::runtime_error("unable to acquire lock, reads of a live process are running"));
+        }
+        boost::this_thread::sleep_for(boost::chrono::microseconds(100));
+    }
+}
+
+void database::acquire_read_lock(read_lock& lock, uint64_t wait_micro)
+{
+    if (lock.try_lock())
+    {
+        _read_lock_stats.record_lock();
+        return;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    if (!wait_micro)
+    {
+        lock.lock();
+    }
+    else
+    {
+        if (!lock.timed_lock(boost::posix_time::microsec_clock::universal_time()
+                             + boost::posix_time::microseconds(wait_micro)))
+        {
+            _read_lock_stats.record_timeout();
+            BOOST_THROW_EXCEPTION(std::runtime_error("unable to acquire lock"));
+        }
+    }
+    _read_lock_stats.record_wait(elapsed_micro(start));
+}
+
+void database::remap_read_only(uint64_t wait_micro)
+{
+    boost::unique_lock<boost::shared_mutex> local(_remap_mutex);
+
+    read_lock lock(_rw_manager->current_lock(), bip::defer_lock_type());
+    acquire_read_lock(lock, wait_micro);
+
+    if (_rw_manager->segment_size() == _segment->get_size())
+        return;
+
+    const auto abs_path = bfs::absolute(_data_dir / "shared_memory.bin");
+    _segment.reset(new bip::managed_mapped_file(bip::open_read_only, abs_path.generic_string().c_str()));
+    attach_segment();
+}
+
+void database::attach_segment()
+{
+    _undo_revisions = _segment->find<undo_revisions>("undo_revisions").first;
+    for (auto& item : _index_list)
+    {
+        item->attach(*_segment);
     }
 }
 
 void database::flush()
 {
+    if (is_flush_deferred())
+    {
+        _deferred_flush_pending = true;
+        return;
+    }
+
     if (_segment)
         _segment->flush();
     if (_meta)
         _meta->flush();
 }
 
+void database::grow(uint64_t size)
+{
+    CHAINBASE_REQUIRE_WRITE_LOCK("grow", uint64_t);
+    if (_read_only)
+        BOOST_THROW_EXCEPTION(std::logic_error("cannot grow a read only database"));
+
+    const auto abs_path = bfs::absolute(_data_dir / "shared_memory.bin");
+
+    // the file can be grown only while it is not mapped
+    _segment->flush();
+    _segment.reset();
+
+    const bool grown = bip::managed_mapped_file::grow(abs_path.generic_string().c_str(), size);
+
+    _segment.reset(new bip::managed_mapped_file(bip::open_only, abs_path.generic_string().c_str()));
+    attach_segment();
+    _rw_manager->set_segment_size(_segment->get_size());
+
+    if (!grown)
+        BOOST_THROW_EXCEPTION(std::runtime_error("could not grow database file to requested size."));
+}
+
+void database::shrink_to_fit(const bfs::path& dir)
+{
+    const auto abs_path = bfs::absolute(dir / "shared_memory.bin");
+    if (!bip::managed_mapped_file::shrink_to_fit(abs_path.generic_string().c_str()))
+        BOOST_THROW_EXCEPTION(std::runtime_error("could not shrink database file."));
+}
+
+void database::release_reader_slot()
+{
+    if (!_reader_slot)
+        return;
+
+    _reader_slot->readers = 0;
+    _reader_slot->pid = 0;
+    _reader_slot = nullptr;
+}
+
 void database::close()
 {
+    release_reader_slot();
     _segment.reset();
     _meta.reset();
+    _undo_revisions = nullptr;
     _data_dir = bfs::path();
 }
 
 void database::wipe(const bfs::path& dir)
 {
+    release_reader_slot();
     _segment.reset();
     _meta.reset();
     bfs::remove_all(dir / "shared_memory.bin");
     bfs::remove_all(dir / "shared_memory.meta");
+    _undo_revisions = nullptr;
     _data_dir = bfs::path();
     _index_list.clear();
     _index_map.clear();
@@ -154,20 +525,51 @@ void database::require_lock_fail(const char* method, const char* lock_type, cons
     BOOST_THROW_EXCEPTION(std::runtime_error(err_msg));
 }
 
+void database::begin_deferred_flush()
+{
+    ++_deferred_flush_depth;
+}
+
+void database::end_deferred_flush()
+{
+    if (_deferred_flush_depth <= 0)
+        BOOST_THROW_EXCEPTION(std::logic_error("end_deferred_flush() without begin_deferred_flush()"));
+
+    if (--_deferred_flush_depth == 0 && _deferred_flush_pending)
+    {
+        _deferred_flush_pending = false;
+        flush();
+    }
+}
+
 void database::undo()
 {
+    if (!_undo_revisions->enabled())
+        return;
+
     for (auto& item : _index_list)
     {
-        item->undo();
+        item->undo(_undo_revisions->head);
     }
+    --_undo_revisions->head;
 }
 
 void database::squash()
 {
+    if (!_undo_revisions->enabled())
+        return;
+
+    // squashing the only undoable revision has nothing to merge into, its changes become permanent
+    const bool discard = _undo_revisions->head - 1 == _undo_revisions->floor;
     for (auto& item : _index_list)
     {
-        item->squash();
+        item->squash(_undo_revisions->head, discard);
     }
+
+    if (discard)
+        _undo_revisions->floor = _undo_revisions->head;
+    else
+        --_undo_revisions->head;
 }
 
 void database::commit(int64_t revision)
@@ -176,27 +578,20 @@ void database::commit(int64_t revision)
     {
         item->commit(revision);
     }
+    _undo_revisions->floor = std::max(_undo_revisions->floor, std::min(revision, _undo_revisions->head));
 }
 
 void database::undo_all()
 {
-    for (auto& item : _index_list)
-    {
-        item->undo_all();
-    }
+    while (_undo_revisions->enabled())
+        undo();
 }
 
 database::session database::start_undo_session(bool enabled)
 {
     if (enabled)
     {
-        std::vector<std::unique_ptr<abstract_session>> _sub_sessions;
-        _sub_sessions.reserve(_index_list.size());
-        for (auto& item : _index_list)
-        {
-            _sub_sessions.push_back(item->start_undo_session(enabled));
-        }
-        return session(std::move(_sub_sessions));
+        return session(*this, ++_undo_revisions->head);
     }
     else
     {
@@ -7,7 +7,12 @@
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/member.hpp>
 
+#include <atomic>
 #include <iostream>
+#include <thread>
+
+#include <sys/wait.h>
+#include <unistd.h>
 
 using namespace boost::multi_index;
 
@@ -54,7 +59,7 @@ public:
 
 BOOST_AUTO_TEST_CASE(open_and_create)
 {
-    boost::filesystem::path temp = boost::filesystem::unique_path();
+    boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
     try
     {
         std::cerr << temp.native() << " \n";
@@ -149,6 +154,374 @@ BOOST_AUTO_TEST_CASE(open_and_create)
         chainbase::bfs::remove_all(temp);
         throw;
     }
+    chainbase::bfs::remove_all(temp);
 }
 
 // BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_CASE(undo_squash_commit)
+{
+    boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    try
+    {
+        moc_database db;
+        db.open(temp, chainbase::database::read_write, 1024 * 1024 * 8);
+        db.add_index<book_index>();
+
+        const auto& book0 = db.create<book>([](book& b) { b.a = 1; });
+        BOOST_REQUIRE_EQUAL(db.revision(), 0);
+
+        {
+            auto outer = db.start_undo_session(true);
+            db.modify(book0, [](book& b) { b.a = 2; });
+            const auto& book1 = db.create<book>([](book& b) { b.a = 10; });
+
+            {
+                auto inner = db.start_undo_session(true);
+                BOOST_REQUIRE_EQUAL(inner.revision(), 2);
+                db.modify(book0, [](book& b) { b.a = 3; });
+                db.modify(book1, [](book& b) { b.a = 11; });
+                db.remove(book1);
+                db.create<book>([](book& b) { b.a = 20; });
+                inner.squash();
+            }
+            BOOST_REQUIRE_EQUAL(db.revision(), 1);
+            BOOST_REQUIRE_EQUAL(book0.a, 3);
+            BOOST_REQUIRE(db.find(book::id_type(1)) == nullptr);
+            BOOST_REQUIRE_EQUAL(db.get(book::id_type(2)).a, 20);
+        }
+        BOOST_REQUIRE_EQUAL(db.revision(), 0);
+        BOOST_REQUIRE_EQUAL(book0.a, 1);
+        BOOST_REQUIRE(db.find(book::id_type(1)) == nullptr);
+        BOOST_REQUIRE(db.find(book::id_type(2)) == nullptr);
+
+        // revisions the index was not written in are skipped, the removed object comes back on undo
+        db.start_undo_session(true).push();
+        auto session = db.start_undo_session(true);
+        db.remove(book0);
+        session.push();
+        db.start_undo_session(true).push();
+        BOOST_REQUIRE_EQUAL(db.revision(), 3);
+        db.undo();
+        db.undo();
+        BOOST_REQUIRE_EQUAL(db.get(book::id_type(0)).a, 1);
+        db.undo();
+        BOOST_REQUIRE_EQUAL(db.revision(), 0);
+
+        // committed revisions can not be undone
+        for (int i = 1; i <= 3; ++i)
+        {
+            auto s = db.start_undo_session(true);
+            db.modify(db.get(book::id_type(0)), [&](book& b) { b.a = 100 + i; });
+            s.push();
+        }
+        db.commit(2);
+        db.undo_all();
+        BOOST_REQUIRE_EQUAL(db.revision(), 2);
+        BOOST_REQUIRE_EQUAL(db.get(book::id_type(0)).a, 102);
+
+        // squashing the only undoable revision keeps its changes
+        {
+            auto s = db.start_undo_session(true);
+            db.modify(db.get(book::id_type(0)), [](book& b) { b.a = 200; });
+            s.squash();
+        }
+        db.undo_all();
+        BOOST_REQUIRE_EQUAL(db.revision(), 3);
+        BOOST_REQUIRE_EQUAL(db.get(book::id_type(0)).a, 200);
+
+        db.start_undo_session(true).push();
+        BOOST_CHECK_THROW(db.set_revision(10), std::logic_error);
+        db.undo();
+        db.set_revision(10);
+        BOOST_REQUIRE_EQUAL(db.revision(), 10);
+    }
+    catch (...)
+    {
+        chainbase::bfs::remove_all(temp);
+        throw;
+    }
+    chainbase::bfs::remove_all(temp);
+}
+
+BOOST_AUTO_TEST_CASE(deferred_flush)
+{
+    boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    try
+    {
+        moc_database db;
+        db.open(temp, chainbase::database::read_write, 1024 * 1024 * 8);
+        db.add_index<book_index>();
+
+        db.with_deferred_flush([&]() {
+            db.with_deferred_flush([&]() {
+                for (int i = 0; i < 100; ++i)
+                    db.create<book>([&](book& b) { b.a = i; });
+                db.flush();
+            });
+            BOOST_REQUIRE(db.is_flush_deferred());
+
+            // lookups keep working while loading
+            BOOST_REQUIRE_EQUAL(db.get(book::id_type(42)).a, 42);
+            BOOST_REQUIRE_EQUAL(db.get_index<book_index>().indices().get<1>().begin()->a, 0);
+        });
+        BOOST_REQUIRE(!db.is_flush_deferred());
+        BOOST_CHECK_THROW(db.end_deferred_flush(), std::logic_error);
+    }
+    catch (...)
+    {
+        chainbase::bfs::remove_all(temp);
+        throw;
+    }
+    chainbase::bfs::remove_all(temp);
+}
+
+BOOST_AUTO_TEST_CASE(grow_and_shrink)
+{
+    boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    try
+    {
+        {
+            moc_database db;
+            db.open(temp, chainbase::database::read_write, 1024 * 1024 * 8);
+            db.add_index<book_index>();
+
+            for (int i = 0; i < 100; ++i)
+                db.create<book>([&](book& b) { b.a = i; });
+
+            auto session = db.start_undo_session(true);
+            db.modify(db.get(book::id_type(7)), [](book& b) { b.a = 700; });
+
+            const size_t max_memory = db.get_max_memory();
+            db.grow(1024 * 1024 * 8);
+            BOOST_REQUIRE_EQUAL(db.get_max_memory(), max_memory + 1024 * 1024 * 8);
+
+            // objects and undo state survive the remapping
+            BOOST_REQUIRE_EQUAL(db.get(book::id_type(7)).a, 700);
+            BOOST_REQUIRE_EQUAL(db.get_index<book_index>().indices().size(), 100u);
+            session.undo();
+            BOOST_REQUIRE_EQUAL(db.get(book::id_type(7)).a, 7);
+
+            db.create<book>([&](book& b) { b.a = 100; });
+            db.close();
+        }
+
+        const auto file_size = boost::filesystem::file_size(temp / "shared_memory.bin");
+        chainbase::database::shrink_to_fit(temp);
+        BOOST_REQUIRE_LT(boost::filesystem::file_size(temp / "shared_memory.bin"), file_size);
+
+        moc_database db;
+        db.open(temp, chainbase::database::read_write);
+        db.add_index<book_index>();
+        BOOST_REQUIRE_EQUAL(db.get(book::id_type(100)).a, 100);
+    }
+    catch (...)
+    {
+        chainbase::bfs::remove_all(temp);
+        throw;
+    }
+    chainbase::bfs::remove_all(temp);
+}
+
+BOOST_AUTO_TEST_CASE(phase_fair_lock)
+{
+    chainbase::read_write_mutex mutex;
+
+    mutex.lock_sharable();
+
+    std::atomic<bool> writer_done(false);
+    std::thread writer([&]() {
+        mutex.lock();
+        writer_done = true;
+        mutex.unlock();
+    });
+
+    // a waiting writer stops new readers from entering
+    while (mutex.try_lock_sharable())
+    {
+        mutex.unlock_sharable();
+        std::this_thread::yield();
+    }
+
+    std::atomic<bool> reader_done(false);
+    std::thread reader([&]() {
+        mutex.lock_sharable();
+        reader_done = true;
+        mutex.unlock_sharable();
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_REQUIRE(!writer_done && !reader_done);
+
+    mutex.unlock_sharable();
+    writer.join();
+    reader.join();
+    BOOST_REQUIRE(writer_done && reader_done);
+
+    // a writer giving up lets the readers it stopped in
+    mutex.lock_sharable();
+    std::thread timed_writer([&]() {
+        BOOST_CHECK(!mutex.timed_lock(boost::posix_time::microsec_clock::universal_time()
+                                      + boost::posix_time::milliseconds(100)));
+    });
+    while (mutex.try_lock_sharable())
+    {
+        mutex.unlock_sharable();
+        std::this_thread::yield();
+    }
+    mutex.lock_sharable();
+    timed_writer.join();
+    mutex.unlock_sharable();
+    mutex.unlock_sharable();
+
+    BOOST_REQUIRE(mutex.try_lock());
+    mutex.unlock();
+}
+
+BOOST_AUTO_TEST_CASE(lock_stats)
+{
+    boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    try
+    {
+        moc_database db;
+        db.open(temp, chainbase::database::read_write, 1024 * 1024 * 8);
+
+        db.with_write_lock([&]() {});
+        db.with_read_lock([&]() {});
+
+        std::thread reader([&]() {
+            db.with_read_lock([&]() { std::this_thread::sleep_for(std::chrono::milliseconds(100)); });
+        });
+        while (db.get_lock_stats().read.locks < 2)
+            std::this_thread::yield();
+        db.with_write_lock([&]() {});
+        reader.join();
+
+        const auto stats = db.get_lock_stats();
+        BOOST_REQUIRE_EQUAL(stats.read.locks, 2u);
+        BOOST_REQUIRE_EQUAL(stats.write.locks, 2u);
+        BOOST_REQUIRE_EQUAL(stats.write.waits, 1u);
+        BOOST_REQUIRE_GT(stats.write.max_wait_micro, 0u);
+        BOOST_REQUIRE_EQUAL(stats.write.timeouts, 0u);
+    }
+    catch (...)
+    {
+        chainbase::bfs::remove_all(temp);
+        throw;
+    }
+    chainbase::bfs::remove_all(temp);
+}
+
+BOOST_AUTO_TEST_CASE(read_only_replica)
+{
+    boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    try
+    {
+        moc_database db;
+        db.open(temp, chainbase::database::read_write, 1024 * 1024 * 8);
+        db.add_index<book_index>();
+
+        moc_database replica;
+        replica.open(temp);
+        replica.add_index<book_index>();
+
+        const auto sequence = replica.head_sequence();
+        db.with_write_lock([&]() { db.create<book>([](book& b) { b.a = 1; }); });
+        BOOST_REQUIRE_EQUAL(replica.head_sequence(), sequence + 2);
+        BOOST_REQUIRE_EQUAL(replica.with_read_lock([&]() { return replica.get(book::id_type(0)).a; }), 1);
+
+        // the replica maps the segment again once the writer has grown it
+        db.with_write_lock([&]() {
+            db.grow(1024 * 1024 * 8);
+            for (int i = 1; i < 100; ++i)
+                db.create<book>([&](book& b) { b.a = i; });
+        });
+        replica.with_read_lock([&]() {
+            BOOST_REQUIRE_EQUAL(replica.get_max_memory(), db.get_max_memory());
+            BOOST_REQUIRE_EQUAL(replica.get_index<book_index>().indices().size(), 100u);
+            BOOST_REQUIRE_EQUAL(replica.get(book::id_type(99)).a, 99);
+        });
+
+        // a writer that moved to the next lock waits for the read still running and gives up, the read runs
+        // once and never sees the write
+        int attempts = 0;
+        const int a = replica.with_read_lock([&]() {
+            ++attempts;
+            BOOST_CHECK_THROW(
+                db.with_write_lock([&]() { db.modify(db.get(book::id_type(5)), [](book& b) { b.a = 500; }); }, 1000),
+                std::runtime_error);
+            return replica.get(book::id_type(5)).a;
+        });
+        BOOST_REQUIRE_EQUAL(attempts, 1);
+        BOOST_REQUIRE_EQUAL(a, 5);
+        BOOST_REQUIRE_EQUAL(replica.head_sequence() % 2, 0u);
+
+        db.with_write_lock([&]() { db.modify(db.get(book::id_type(5)), [](book& b) { b.a = 500; }); });
+        BOOST_REQUIRE_EQUAL(replica.with_read_lock([&]() { return replica.get(book::id_type(5)).a; }), 500);
+    }
+    catch (...)
+    {
+        chainbase::bfs::remove_all(temp);
+        throw;
+    }
+    chainbase::bfs::remove_all(temp);
+}
+
+BOOST_AUTO_TEST_CASE(read_only_replica_process)
+{
+    boost::filesystem::path temp = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    try
+    {
+        moc_database db;
+        db.open(temp, chainbase::database::read_write, 1024 * 1024 * 8);
+        db.add_index<book_index>();
+        db.with_write_lock([&]() {
+            for (int i = 0; i < 100; ++i)
+                db.create<book>([](book& b) { b.a = 0; });
+        });
+
+        const pid_t child = fork();
+        BOOST_REQUIRE(child >= 0);
+        if (child == 0)
+        {
+            // the replica process checks that no read sees the books of a half applied write
+            int status = 0;
+            try
+            {
+                moc_database replica;
+                replica.open(temp);
+                replica.add_index<book_index>();
+                for (int i = 0; i < 2000 && !status; ++i)
+                    replica.with_read_lock([&]() {
+                        const auto& books = replica.get_index<book_index>().indices();
+                        if (books.size() != 100)
+                            status = 1;
+                        for (const book& b : books)
+                            if (b.a != books.begin()->a)
+                                status = 1;
+                    });
+            }
+            catch (...)
+            {
+                status = 2;
+            }
+            _exit(status);
+        }
+
+        int status = 0;
+        for (int i = 1; waitpid(child, &status, WNOHANG) == 0; ++i)
+            db.with_write_lock([&]() {
+                for (const book& b : db.get_index<book_index>().indices())
+                    db.modify(b, [&](book& m) { m.a = i; });
+            });
+
+        BOOST_REQUIRE(WIFEXITED(status));
+        BOOST_REQUIRE_EQUAL(WEXITSTATUS(status), 0);
+    }
+    catch (...)
+    {
+        chainbase::bfs::remove_all(temp);
+        throw;
+    }
+    chainbase::bfs::remove_all(temp);
+}
@@ -28,6 +28,7 @@ namespace net {
 
 const core_message_type_enum trx_message::type = core_message_type_enum::trx_message_type;
 const core_message_type_enum block_message::type = core_message_type_enum::block_message_type;
+const core_message_type_enum compact_block_message::type = core_message_type_enum::compact_block_message_type;
 const core_message_type_enum item_ids_inventory_message::type = core_message_type_enum::item_ids_inventory_message_type;
 const core_message_type_enum blockchain_item_ids_inventory_message::type
     = core_message_type_enum::blockchain_item_ids_inventory_message_type;
@@ -53,5 +54,10 @@ const core_message_type_enum get_current_connections_request_message::type
     = core_message_type_enum::get_current_connections_request_message_type;
 const core_message_type_enum get_current_connections_reply_message::type
     = core_message_type_enum::get_current_connections_reply_message_type;
+const core_message_type_enum get_compact_block_transactions_message::type
+    = core_message_type_enum::get_compact_block_transactions_message_type;
+const core_message_type_enum compact_block_transactions_message::type
+    = core_message_type_enum::compact_block_transactions_message_type;
+const core_message_type_enum compressed_message::type = core_message_type_enum::compressed_message_type;
 }
 } // graphene::net
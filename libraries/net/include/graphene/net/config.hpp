@@ -23,7 +23,7 @@
  */
 #pragma once
 
-#define GRAPHENE_NET_PROTOCOL_VERSION 106
+#define GRAPHENE_NET_PROTOCOL_VERSION 107
 
 /**
  * Define this to enable debugging code in the p2p network interface.
@@ -57,6 +57,20 @@
 
 #define GRAPHENE_NET_MAXIMUM_QUEUED_MESSAGES_IN_BYTES (1024 * 1024)
 
+/**
+ * Outgoing messages are padded and encrypted in buffers borrowed from a pool
+ * shared by all connections.  Released buffers are kept for reuse until the
+ * pool holds this many bytes, after which they are freed.
+ */
+#define GRAPHENE_NET_SEND_BUFFER_POOL_MAX_BYTES (16 * 1024 * 1024)
+
+/**
+ * Messages to peers that negotiated compression are deflated when their
+ * data is at least this many bytes.  Smaller messages rarely shrink enough
+ * to pay for the envelope and the CPU time.
+ */
+#define GRAPHENE_NET_MESSAGE_COMPRESSION_THRESHOLD 512
+
 /**
  * When we receive a message from the network, we advertise it to
  * our peers and save a copy in a cache were we will find it if
@@ -68,6 +82,13 @@
  */
 #define GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS 20
 
+/**
+ * Upper bound on the memory the message cache may hold.  When a burst of
+ * transactions pushes it past this, the oldest messages are dropped before
+ * their GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS are up.
+ */
+#define GRAPHENE_NET_MESSAGE_CACHE_MAX_BYTES (64 * 1024 * 1024)
+
 /**
  * We prevent a peer from offering us a list of blocks which, if we fetched them
  * all, would result in a blockchain that extended into the future.
@@ -81,6 +102,21 @@
 
 #define GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING 200
 
+/**
+ * How many sync blocks a peer may have outstanding when we start syncing from it.
+ * Each block it delivers raises this by one, up to GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING,
+ * and it is halved whenever the peer holds up the block we need next.
+ */
+#define GRAPHENE_NET_INITIAL_SYNC_BLOCKS_PER_PEER 20
+
+/**
+ * A sync block we need next is requested again from another peer once it has been outstanding
+ * for this long (or four times the other peer's average delivery time, whichever is longer).
+ * A peer that holds up sync this many times is no longer asked for sync blocks.
+ */
+#define GRAPHENE_NET_SYNC_BLOCK_STALL_TIMEOUT_MS 2000
+#define GRAPHENE_NET_MAX_SYNC_STALLS_PER_PEER 3
+
 /**
  * During normal operation, how many items will be fetched from each
  * peer at a time.  This will only come into play when the network
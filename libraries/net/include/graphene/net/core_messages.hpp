@@ -44,6 +44,7 @@ using deip::protocol::signed_transaction;
 using deip::protocol::block_id_type;
 using deip::protocol::transaction_id_type;
 using deip::protocol::signed_block;
+using deip::protocol::signed_block_header;
 
 typedef fc::ecc::public_key_data node_id_t;
 typedef fc::ripemd160 item_hash_t;
@@ -65,6 +66,7 @@ enum core_message_type_enum
 {
     trx_message_type = 1000,
     block_message_type = 1001,
+    compact_block_message_type = 1002,
     core_message_type_first = 5000,
     item_ids_inventory_message_type = 5001,
     blockchain_item_ids_inventory_message_type = 5002,
@@ -83,6 +85,9 @@ enum core_message_type_enum
     check_firewall_reply_message_type = 5015,
     get_current_connections_request_message_type = 5016,
     get_current_connections_reply_message_type = 5017,
+    get_compact_block_transactions_message_type = 5018,
+    compact_block_transactions_message_type = 5019,
+    compressed_message_type = 5020,
     core_message_type_last = 5099
 };
 
@@ -115,6 +120,72 @@ struct block_message
     block_id_type block_id;
 };
 
+/**
+ * A block as a header and the ids of the trx_messages carrying its transactions.
+ * Sent instead of a block_message to peers that request item type compact_block_message_type,
+ * the receiver rebuilds the block from the transactions it already has and asks for the rest
+ * with a get_compact_block_transactions_message.
+ */
+struct compact_block_message
+{
+    static const core_message_type_enum type;
+
+    item_hash_t block_message_id; ///< id of the block_message this block is rebuilt into
+    signed_block_header header;
+    std::vector<item_hash_t> transaction_message_ids;
+
+    compact_block_message() {}
+    compact_block_message(const item_hash_t& block_message_id, const signed_block& blk)
+        : block_message_id(block_message_id)
+        , header(blk)
+    {
+    }
+};
+
+struct get_compact_block_transactions_message
+{
+    static const core_message_type_enum type;
+
+    item_hash_t block_message_id;
+    std::vector<uint32_t> transaction_indices;
+
+    get_compact_block_transactions_message() {}
+    get_compact_block_transactions_message(const item_hash_t& block_message_id,
+                                           const std::vector<uint32_t>& transaction_indices)
+        : block_message_id(block_message_id)
+        , transaction_indices(transaction_indices)
+    {
+    }
+};
+
+struct compact_block_transactions_message
+{
+    static const core_message_type_enum type;
+
+    item_hash_t block_message_id;
+    std::vector<signed_transaction> transactions; ///< in the order of the requested transaction_indices
+
+    compact_block_transactions_message() {}
+    compact_block_transactions_message(const item_hash_t& block_message_id)
+        : block_message_id(block_message_id)
+    {
+    }
+};
+
+/**
+ * Wraps another message whose data has been deflated.  Only sent to peers that advertised
+ * "message_compression" in the user_data of their hello_message, and unwrapped by the
+ * receiving peer_connection before the node sees it.
+ */
+struct compressed_message
+{
+    static const core_message_type_enum type;
+
+    uint32_t msg_type; ///< type of the wrapped message
+    uint32_t uncompressed_size; ///< size of the wrapped message's data
+    std::vector<char> compressed_data;
+};
+
 struct item_ids_inventory_message
 {
     static const core_message_type_enum type;
@@ -425,6 +496,7 @@ FC_REFLECT_ENUM(
         graphene::net::core_message_type_enum,
         (trx_message_type)
         (block_message_type)
+        (compact_block_message_type)
         (core_message_type_first)
         (item_ids_inventory_message_type)
         (blockchain_item_ids_inventory_message_type)
@@ -443,10 +515,17 @@ FC_REFLECT_ENUM(
         (check_firewall_reply_message_type)
         (get_current_connections_request_message_type)
         (get_current_connections_reply_message_type)
+        (get_compact_block_transactions_message_type)
+        (compact_block_transactions_message_type)
+        (compressed_message_type)
         (core_message_type_last))
 
 FC_REFLECT(graphene::net::trx_message, (trx))
 FC_REFLECT(graphene::net::block_message, (block)(block_id))
+FC_REFLECT(graphene::net::compact_block_message, (block_message_id)(header)(transaction_message_ids))
+FC_REFLECT(graphene::net::get_compact_block_transactions_message, (block_message_id)(transaction_indices))
+FC_REFLECT(graphene::net::compact_block_transactions_message, (block_message_id)(transactions))
+FC_REFLECT(graphene::net::compressed_message, (msg_type)(uncompressed_size)(compressed_data))
 
 FC_REFLECT(graphene::net::item_id, (item_type)(item_hash))
 FC_REFLECT(graphene::net::item_ids_inventory_message, (item_type)(item_hashes_available))
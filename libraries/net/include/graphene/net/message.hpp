@@ -29,6 +29,8 @@
 #include <fc/crypto/ripemd160.hpp>
 #include <fc/reflect/variant.hpp>
 
+#include <memory>
+
 namespace graphene {
 namespace net {
 
@@ -54,6 +56,14 @@ struct message : public message_header
 {
     std::vector<char> data;
 
+    /**
+     *  What get_compressed_message() made of this message: its compressed form, or null if it
+     *  didn't pay off or the message is always sent plain.  Not serialized, and left out by the
+     *  copy and move constructors.
+     */
+    mutable std::shared_ptr<const message> compressed;
+    mutable bool compression_tried = false;
+
     message() {}
 
     message(message&& m)
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#pragma once
+#include <graphene/net/message.hpp>
+
+#include <fc/optional.hpp>
+
+namespace graphene {
+namespace net {
+
+/** running totals for the messages this process has compressed and decompressed */
+struct message_compression_statistics
+{
+    uint64_t messages_compressed = 0;
+    uint64_t bytes_before_compression = 0;
+    uint64_t bytes_after_compression = 0;
+    uint64_t compression_time_us = 0; ///< includes attempts that didn't shrink the message
+    uint64_t messages_decompressed = 0;
+    uint64_t decompression_time_us = 0;
+};
+
+/** name advertised in the hello_message user_data for the compression implemented here */
+extern const char* const message_compression_algorithm;
+
+/**
+ *  Deflates the data of message_to_compress into a compressed_message.  Returns an empty
+ *  optional if the message is below GRAPHENE_NET_MESSAGE_COMPRESSION_THRESHOLD or didn't
+ *  get smaller, in which case the caller should send the original.
+ */
+fc::optional<message> compress_message(const message& message_to_compress);
+
+/**
+ *  Returns what to send to a peer that accepts compressed messages: the compressed form of
+ *  message_to_send, or message_to_send itself if compress_message() gave nothing.  The result
+ *  is kept on the message, so a message queued for several peers is only compressed once.
+ *  Must only be called from the p2p thread.
+ */
+std::shared_ptr<const message> get_compressed_message(const std::shared_ptr<const message>& message_to_send);
+
+/**
+ *  Unwraps a compressed_message back into the message it was made from.  Throws if the
+ *  envelope is malformed or would inflate past MAX_MESSAGE_SIZE.
+ */
+message decompress_message(const message& compressed);
+
+message_compression_statistics get_message_compression_statistics();
+}
+} // graphene::net
+
+FC_REFLECT(graphene::net::message_compression_statistics,
+           (messages_compressed)(bytes_before_compression)(bytes_after_compression)(compression_time_us)(
+               messages_decompressed)(decompression_time_us))
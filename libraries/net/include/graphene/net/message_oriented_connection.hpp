@@ -23,6 +23,7 @@
  */
 #pragma once
 #include <fc/network/tcp_socket.hpp>
+#include <fc/variant_object.hpp>
 #include <graphene/net/message.hpp>
 
 namespace graphene {
@@ -65,6 +66,9 @@ public:
     fc::time_point get_connection_time() const;
     fc::sha512 get_shared_secret() const;
 
+    /** allocation counters for the buffer pool that all connections send through */
+    static fc::variant_object get_send_buffer_pool_statistics();
+
 private:
     std::unique_ptr<detail::message_oriented_connection_impl> my;
 };
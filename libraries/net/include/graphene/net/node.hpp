@@ -81,6 +81,14 @@ public:
         std::vector<fc::uint160_t>& contained_transaction_message_ids)
         = 0;
 
+    /**
+     *  @brief Called for every sync block queued for processing, before handle_block() is called
+     *         for it, so the client can start its state independent validation in the background.
+     *
+     *  Called from the p2p thread and must not block or yield.
+     */
+    virtual void prevalidate_sync_block(const graphene::net::block_message& blk_msg) = 0;
+
     /**
      *  @brief Called when a new transaction comes in from the network
      *
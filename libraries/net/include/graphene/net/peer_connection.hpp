@@ -67,7 +67,7 @@ class peer_connection_delegate
 public:
     virtual void on_message(peer_connection* originating_peer, const message& received_message) = 0;
     virtual void on_connection_closed(peer_connection* originating_peer) = 0;
-    virtual message get_message_for_item(const item_id& item) = 0;
+    virtual std::shared_ptr<const message> get_message_for_item(const item_id& item) = 0;
 };
 
 class peer_connection;
@@ -125,7 +125,7 @@ private:
         {
         }
 
-        virtual message get_message(peer_connection_delegate* node) = 0;
+        virtual std::shared_ptr<const message> get_message(peer_connection_delegate* node) = 0;
         /** returns roughly the number of bytes of memory the message is consuming while
          * it is sitting on the queue
          */
@@ -133,21 +133,23 @@ private:
         virtual ~queued_message() {}
     };
 
-    /* when you queue up a 'real_queued_message', a full copy of the message is
-     * stored on the heap until it is sent
+    /* when you queue up a 'real_queued_message', the message is held on the heap until
+     * it is sent.  The message may be shared, so a message sent to many peers is only
+     * stored once
      */
     struct real_queued_message : queued_message
     {
-        message message_to_send;
+        std::shared_ptr<const message> message_to_send;
         size_t message_send_time_field_offset;
 
-        real_queued_message(message message_to_send, size_t message_send_time_field_offset = (size_t)-1)
+        real_queued_message(std::shared_ptr<const message> message_to_send,
+                            size_t message_send_time_field_offset = (size_t)-1)
             : message_to_send(std::move(message_to_send))
             , message_send_time_field_offset(message_send_time_field_offset)
         {
         }
 
-        message get_message(peer_connection_delegate* node) override;
+        std::shared_ptr<const message> get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
     };
 
@@ -164,7 +166,7 @@ private:
         {
         }
 
-        message get_message(peer_connection_delegate* node) override;
+        std::shared_ptr<const message> get_message(peer_connection_delegate* node) override;
         size_t get_size_in_queue() override;
     };
 
@@ -211,6 +213,8 @@ public:
     fc::optional<std::string> platform;
     fc::optional<uint32_t> bitness;
     fc::optional<deip::protocol::chain_id_type> chain_id;
+    /// true once both sides have agreed in their hello messages to compress large messages
+    bool message_compression_enabled;
 
     // for inbound connections, these fields record what the peer sent us in
     // its hello message.  For outbound, they record what we sent the peer
@@ -243,6 +247,9 @@ public:
         last_block_delegate_has_seen; /// the hash of the last block  this peer has told us about that the peer knows
     fc::time_point_sec last_block_time_delegate_has_seen;
     bool inhibit_fetching_sync_blocks;
+    uint32_t sync_request_window; /// how many sync blocks this peer may have outstanding, grows as it delivers
+    fc::microseconds average_sync_block_latency; /// moving average of the time this peer takes to deliver a sync block
+    uint32_t sync_stall_count; /// how many times this peer held up the block we needed next
     /// @}
 
     /// non-synchronization state data
@@ -274,6 +281,16 @@ public:
 
     item_to_time_map_type items_requested_from_peer; /// items we've requested from this peer during normal operation.
     /// fetch from another peer if this peer disconnects
+
+    /// a block this peer sent us as a compact_block_message, waiting for the transactions we didn't have
+    struct compact_block_reconstruction
+    {
+        signed_block block;
+        std::vector<uint32_t> missing_transaction_indices;
+        fc::time_point received_time;
+    };
+    std::map<item_hash_t, compact_block_reconstruction> compact_blocks_being_reconstructed; /// keyed by the id of the
+    /// block_message, entries live only as long as the matching entry in items_requested_from_peer
     /// @}
 
     // if they're flooding us with transactions, we set this to avoid fetching for a few seconds to let the
@@ -309,6 +326,8 @@ public:
 
     void send_queueable_message(std::unique_ptr<queued_message>&& message_to_send);
     void send_message(const message& message_to_send, size_t message_send_time_field_offset = (size_t)-1);
+    /** queues a message without copying it, for messages that go out to several peers */
+    void send_message(std::shared_ptr<const message> message_to_send);
     void send_item(const item_id& item_to_send);
     void close_connection();
     void destroy_connection();
@@ -333,6 +352,7 @@ public:
     bool is_inventory_advertised_to_us_list_full_for_transactions() const;
     bool is_inventory_advertised_to_us_list_full() const;
     bool performing_firewall_check() const;
+    bool supports_compact_blocks() const;
     fc::optional<fc::ip::endpoint> get_endpoint_for_connecting() const;
 
 private:
@@ -51,6 +51,13 @@ public:
     virtual size_t writesome(const char* buffer, size_t len);
     virtual size_t writesome(const std::shared_ptr<const char>& buf, size_t len, size_t offset);
 
+    /**
+     *  Encrypts len bytes of buffer in place and writes all of them to the socket.
+     *  Unlike writesome(), this skips the intermediate encryption buffer, so the caller must
+     *  own buffer and not expect its plaintext to survive the call.
+     */
+    void write_in_place(char* buffer, size_t len);
+
     virtual void flush();
     virtual void close();
 
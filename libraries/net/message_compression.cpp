@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <graphene/net/message_compression.hpp>
+#include <graphene/net/core_messages.hpp>
+#include <graphene/net/config.hpp>
+
+#include <fc/exception/exception.hpp>
+#include <fc/time.hpp>
+
+#include <atomic>
+
+#include <zlib.h>
+
+namespace graphene {
+namespace net {
+
+const char* const message_compression_algorithm = "zlib";
+
+namespace {
+
+// connections may live on several threads, so the totals are kept in atomics
+struct atomic_compression_statistics
+{
+    std::atomic<uint64_t> messages_compressed{ 0 };
+    std::atomic<uint64_t> bytes_before_compression{ 0 };
+    std::atomic<uint64_t> bytes_after_compression{ 0 };
+    std::atomic<uint64_t> compression_time_us{ 0 };
+    std::atomic<uint64_t> messages_decompressed{ 0 };
+    std::atomic<uint64_t> decompression_time_us{ 0 };
+};
+
+atomic_compression_statistics& statistics()
+{
+    static atomic_compression_statistics totals;
+    return totals;
+}
+}
+
+fc::optional<message> compress_message(const message& message_to_compress)
+{
+    if (message_to_compress.data.size() < GRAPHENE_NET_MESSAGE_COMPRESSION_THRESHOLD
+        || message_to_compress.msg_type == compressed_message_type)
+        return fc::optional<message>();
+
+    fc::time_point start_time = fc::time_point::now();
+    compressed_message envelope;
+    envelope.msg_type = message_to_compress.msg_type;
+    envelope.uncompressed_size = (uint32_t)message_to_compress.data.size();
+
+    // anything that doesn't come out at least this much smaller isn't worth the receiver's time
+    uLongf compressed_size = envelope.uncompressed_size - envelope.uncompressed_size / 8;
+    envelope.compressed_data.resize(compressed_size);
+    int result = compress2((Bytef*)envelope.compressed_data.data(), &compressed_size,
+                           (const Bytef*)message_to_compress.data.data(), envelope.uncompressed_size, Z_BEST_SPEED);
+    statistics().compression_time_us += (fc::time_point::now() - start_time).count();
+    if (result != Z_OK)
+        return fc::optional<message>(); // Z_BUF_ERROR, the data didn't compress well enough
+    envelope.compressed_data.resize(compressed_size);
+
+    message compressed(envelope);
+    ++statistics().messages_compressed;
+    statistics().bytes_before_compression += message_to_compress.data.size();
+    statistics().bytes_after_compression += compressed.data.size();
+    return compressed;
+}
+
+std::shared_ptr<const message> get_compressed_message(const std::shared_ptr<const message>& message_to_send)
+{
+    if (!message_to_send->compression_tried)
+    {
+        fc::optional<message> compressed = compress_message(*message_to_send);
+        if (compressed)
+            message_to_send->compressed = std::make_shared<const message>(std::move(*compressed));
+        message_to_send->compression_tried = true;
+    }
+    return message_to_send->compressed ? message_to_send->compressed : message_to_send;
+}
+
+message decompress_message(const message& compressed)
+{
+    fc::time_point start_time = fc::time_point::now();
+    compressed_message envelope = compressed.as<compressed_message>();
+    FC_ASSERT(envelope.msg_type != compressed_message_type, "compressed messages may not be nested");
+    FC_ASSERT(envelope.uncompressed_size <= MAX_MESSAGE_SIZE, "compressed message would inflate past the limit",
+              ("uncompressed_size", envelope.uncompressed_size)("MAX_MESSAGE_SIZE", MAX_MESSAGE_SIZE));
+
+    message result;
+    result.msg_type = envelope.msg_type;
+    result.data.resize(envelope.uncompressed_size);
+    uLongf uncompressed_size = envelope.uncompressed_size;
+    int status = uncompress((Bytef*)result.data.data(), &uncompressed_size,
+                            (const Bytef*)envelope.compressed_data.data(), (uLong)envelope.compressed_data.size());
+    FC_ASSERT(status == Z_OK && uncompressed_size == envelope.uncompressed_size, "unable to inflate compressed message",
+              ("status", status)("uncompressed_size", uncompressed_size)("expected", envelope.uncompressed_size));
+    result.size = (uint32_t)result.data.size();
+
+    ++statistics().messages_decompressed;
+    statistics().decompression_time_us += (fc::time_point::now() - start_time).count();
+    return result;
+}
+
+message_compression_statistics get_message_compression_statistics()
+{
+    message_compression_statistics result;
+    result.messages_compressed = statistics().messages_compressed;
+    result.bytes_before_compression = statistics().bytes_before_compression;
+    result.bytes_after_compression = statistics().bytes_after_compression;
+    result.compression_time_us = statistics().compression_time_us;
+    result.messages_decompressed = statistics().messages_decompressed;
+    result.decompression_time_us = statistics().decompression_time_us;
+    return result;
+}
+}
+} // graphene::net
@@ -28,6 +28,8 @@
 #include <fc/log/logger.hpp>
 #include <fc/io/enum_type.hpp>
 
+#include <mutex>
+
 #include <graphene/net/message_oriented_connection.hpp>
 #include <graphene/net/stcp_socket.hpp>
 #include <graphene/net/config.hpp>
@@ -49,6 +51,118 @@
 namespace graphene {
 namespace net {
 namespace detail {
+
+/**
+ *  Hands out the buffers that outgoing messages are padded and encrypted in.  Buffers come in
+ *  power-of-two size classes and go back on a free list when the send finishes, so once the
+ *  lists are warm a node relaying a steady stream of messages stops allocating.  Connections may
+ *  live on different threads, so the free lists are guarded by a mutex; it is never held across
+ *  a socket operation.
+ */
+class send_buffer_pool
+{
+public:
+    static send_buffer_pool& instance()
+    {
+        static send_buffer_pool pool;
+        return pool;
+    }
+
+    std::unique_ptr<char[]> acquire(size_t size, size_t& capacity)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        ++_buffers_in_use;
+        size_t size_class = get_size_class(size);
+        if (size_class < size_class_count)
+        {
+            capacity = min_buffer_size << size_class;
+            std::vector<std::unique_ptr<char[]>>& free_buffers = _free_buffers[size_class];
+            if (!free_buffers.empty())
+            {
+                std::unique_ptr<char[]> buffer = std::move(free_buffers.back());
+                free_buffers.pop_back();
+                _pooled_bytes -= capacity;
+                ++_reuse_count;
+                return buffer;
+            }
+        }
+        else
+            capacity = size; // too big to be worth keeping, this one is freed when it comes back
+        ++_allocation_count;
+        return std::unique_ptr<char[]>(new char[capacity]);
+    }
+
+    void release(std::unique_ptr<char[]> buffer, size_t capacity)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        --_buffers_in_use;
+        size_t size_class = get_size_class(capacity);
+        if (size_class < size_class_count && _pooled_bytes + capacity <= GRAPHENE_NET_SEND_BUFFER_POOL_MAX_BYTES)
+        {
+            _free_buffers[size_class].push_back(std::move(buffer));
+            _pooled_bytes += capacity;
+        }
+    }
+
+    fc::variant_object get_statistics() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        fc::mutable_variant_object statistics;
+        statistics["allocations"] = _allocation_count;
+        statistics["reuses"] = _reuse_count;
+        statistics["buffers_in_use"] = _buffers_in_use;
+        statistics["pooled_bytes"] = _pooled_bytes;
+        return statistics;
+    }
+
+private:
+    static const size_t min_buffer_size = 4096;
+    // 4 KiB through MAX_MESSAGE_SIZE (2 MiB)
+    static const size_t size_class_count = 10;
+    static_assert((min_buffer_size << (size_class_count - 1)) == MAX_MESSAGE_SIZE,
+                  "the largest size class should hold a maximum sized message");
+
+    static size_t get_size_class(size_t size)
+    {
+        size_t size_class = 0;
+        while (size_class < size_class_count && (min_buffer_size << size_class) < size)
+            ++size_class;
+        return size_class;
+    }
+
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<char[]>> _free_buffers[size_class_count];
+    uint64_t _allocation_count = 0;
+    uint64_t _reuse_count = 0;
+    uint64_t _buffers_in_use = 0;
+    uint64_t _pooled_bytes = 0;
+};
+
+/** borrows a buffer from the send_buffer_pool for as long as it is in scope */
+class pooled_send_buffer
+{
+public:
+    explicit pooled_send_buffer(size_t size)
+        : _buffer(send_buffer_pool::instance().acquire(size, _capacity))
+    {
+    }
+    ~pooled_send_buffer()
+    {
+        send_buffer_pool::instance().release(std::move(_buffer), _capacity);
+    }
+    pooled_send_buffer(const pooled_send_buffer&) = delete;
+    pooled_send_buffer& operator=(const pooled_send_buffer&) = delete;
+
+    char* get() const
+    {
+        return _buffer.get();
+    }
+
+private:
+    size_t _capacity;
+    std::unique_ptr<char[]> _buffer;
+};
+
 class message_oriented_connection_impl
 {
 private:
@@ -282,10 +396,13 @@ void message_oriented_connection_impl::send_message(const message& message_to_se
             elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
         // pad the message we send to a multiple of 16 bytes
         size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
-        std::unique_ptr<char[]> padded_message(new char[size_with_padding]);
+        // the header, body and padding are laid out in one pooled buffer and encrypted where they
+        // sit, so sending a message costs no allocations once the pool is warm
+        pooled_send_buffer padded_message(size_with_padding);
         memcpy(padded_message.get(), (char*)&message_to_send, sizeof(message_header));
         memcpy(padded_message.get() + sizeof(message_header), message_to_send.data.data(), message_to_send.size);
-        _sock.write(padded_message.get(), size_with_padding);
+        memset(padded_message.get() + size_of_message_and_header, 0, size_with_padding - size_of_message_and_header);
+        _sock.write_in_place(padded_message.get(), size_with_padding);
         _sock.flush();
         _bytes_sent += size_with_padding;
         _last_message_sent_time = fc::time_point::now();
@@ -426,6 +543,10 @@ fc::time_point message_oriented_connection::get_connection_time() const
 {
     return my->get_connection_time();
 }
+fc::variant_object message_oriented_connection::get_send_buffer_pool_statistics()
+{
+    return detail::send_buffer_pool::instance().get_statistics();
+}
 fc::sha512 message_oriented_connection::get_shared_secret() const
 {
     return my->get_shared_secret();
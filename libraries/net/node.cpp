@@ -74,6 +74,7 @@
 #include <graphene/net/node.hpp>
 #include <graphene/net/peer_database.hpp>
 #include <graphene/net/peer_connection.hpp>
+#include <graphene/net/message_compression.hpp>
 #include <graphene/net/stcp_socket.hpp>
 #include <graphene/net/config.hpp>
 #include <graphene/net/exceptions.hpp>
@@ -134,6 +135,7 @@ class blockchain_tied_message_cache
 {
 private:
     static const uint32_t cache_duration_in_blocks = GRAPHENE_NET_MESSAGE_CACHE_DURATION_IN_BLOCKS;
+    static const uint64_t cache_size_limit_in_bytes = GRAPHENE_NET_MESSAGE_CACHE_MAX_BYTES;
 
     struct message_hash_index
     {
@@ -141,13 +143,13 @@ private:
     struct message_contents_hash_index
     {
     };
-    struct block_clock_index
+    struct insertion_order_index
     {
     };
     struct message_info
     {
         message_hash_type message_hash;
-        message message_body;
+        std::shared_ptr<const message> message_body; // shared with the send queues of the peers it goes to
         uint32_t block_clock_when_received;
 
         // for network performance stats
@@ -161,81 +163,154 @@ private:
                      const message_propagation_data& propagation_data,
                      fc::uint160_t message_contents_hash)
             : message_hash(message_hash)
-            , message_body(message_body)
+            , message_body(std::make_shared<const message>(message_body))
             , block_clock_when_received(block_clock_when_received)
             , propagation_data(propagation_data)
             , message_contents_hash(message_contents_hash)
         {
         }
+
+        /// roughly what this entry costs us, for the byte budget, including the compressed copy peers are sent
+        uint64_t get_size_in_cache() const
+        {
+            return sizeof(message_info) + message_body->data.size()
+                + (message_body->compressed ? message_body->compressed->data.size() : 0);
+        }
     };
+    // the block clock never goes backwards, so insertion order is also the order entries expire in
     typedef boost::
         multi_index_container<message_info,
                               bmi::
-                                  indexed_by<bmi::ordered_unique<bmi::tag<message_hash_index>,
-                                                                 bmi::member<message_info,
-                                                                             message_hash_type,
-                                                                             &message_info::message_hash>>,
-                                             bmi::ordered_non_unique<bmi::tag<message_contents_hash_index>,
-                                                                     bmi::member<message_info,
-                                                                                 fc::uint160_t,
-                                                                                 &message_info::message_contents_hash>>,
-                                             bmi::ordered_non_unique<bmi::tag<block_clock_index>,
-                                                                     bmi::member<message_info,
-                                                                                 uint32_t,
-                                                                                 &message_info::
-                                                                                     block_clock_when_received>>>>
+                                  indexed_by<bmi::hashed_unique<bmi::tag<message_hash_index>,
+                                                                bmi::member<message_info,
+                                                                            message_hash_type,
+                                                                            &message_info::message_hash>,
+                                                                std::hash<message_hash_type>>,
+                                             bmi::hashed_non_unique<bmi::tag<message_contents_hash_index>,
+                                                                    bmi::member<message_info,
+                                                                                fc::uint160_t,
+                                                                                &message_info::message_contents_hash>,
+                                                                    std::hash<fc::uint160_t>>,
+                                             bmi::sequenced<bmi::tag<insertion_order_index>>>>
             message_cache_container;
 
     message_cache_container _message_cache;
 
     uint32_t block_clock;
+    uint64_t _size_in_bytes;
+
+    mutable uint64_t _hit_count;
+    mutable uint64_t _miss_count;
+    uint64_t _eviction_count; // dropped early to stay under the byte budget
+    uint64_t _expiration_count; // dropped after cache_duration_in_blocks
+
+    void erase_oldest();
 
 public:
     blockchain_tied_message_cache()
         : block_clock(0)
+        , _size_in_bytes(0)
+        , _hit_count(0)
+        , _miss_count(0)
+        , _eviction_count(0)
+        , _expiration_count(0)
     {
     }
     void block_accepted();
+    /**
+     *  Peers are sent the cached message itself, so its compressed copy is made here, when compress is set,
+     *  and counted against the byte budget. The entry never gets a copy later, so its size doesn't change
+     */
     void cache_message(const message& message_to_cache,
                        const message_hash_type& hash_of_message_to_cache,
                        const message_propagation_data& propagation_data,
-                       const fc::uint160_t& message_content_hash);
-    message get_message(const message_hash_type& hash_of_message_to_lookup);
+                       const fc::uint160_t& message_content_hash,
+                       bool compress);
+    std::shared_ptr<const message> get_shared_message(const message_hash_type& hash_of_message_to_lookup) const;
+    const message* find_message(const message_hash_type& hash_of_message_to_lookup) const;
     message_propagation_data
     get_message_propagation_data(const fc::uint160_t& hash_of_message_contents_to_lookup) const;
     size_t size() const
     {
         return _message_cache.size();
     }
+    fc::variant_object get_statistics() const;
 };
 
+void blockchain_tied_message_cache::erase_oldest()
+{
+    auto& insertion_order = _message_cache.get<insertion_order_index>();
+    _size_in_bytes -= insertion_order.front().get_size_in_cache();
+    insertion_order.pop_front();
+}
+
 void blockchain_tied_message_cache::block_accepted()
 {
     ++block_clock;
     if (block_clock > cache_duration_in_blocks)
-        _message_cache.get<block_clock_index>().erase(
-            _message_cache.get<block_clock_index>().begin(),
-            _message_cache.get<block_clock_index>().lower_bound(block_clock - cache_duration_in_blocks));
+    {
+        const auto& insertion_order = _message_cache.get<insertion_order_index>();
+        while (!insertion_order.empty()
+               && insertion_order.front().block_clock_when_received < block_clock - cache_duration_in_blocks)
+        {
+            erase_oldest();
+            ++_expiration_count;
+        }
+    }
 }
 
 void blockchain_tied_message_cache::cache_message(const message& message_to_cache,
                                                   const message_hash_type& hash_of_message_to_cache,
                                                   const message_propagation_data& propagation_data,
-                                                  const fc::uint160_t& message_content_hash)
+                                                  const fc::uint160_t& message_content_hash,
+                                                  bool compress)
 {
-    _message_cache.insert(
+    auto insert_result = _message_cache.insert(
         message_info(hash_of_message_to_cache, message_to_cache, block_clock, propagation_data, message_content_hash));
+    if (!insert_result.second)
+        return;
+    if (compress)
+        get_compressed_message(insert_result.first->message_body);
+    else
+        insert_result.first->message_body->compression_tried = true; // peers get the plain message
+    _size_in_bytes += insert_result.first->get_size_in_cache();
+
+    // during a transaction flood, drop the oldest messages rather than wait for blocks to expire them.
+    // Peers that ask for an evicted block still get it from the delegate
+    while (_size_in_bytes > cache_size_limit_in_bytes && _message_cache.size() > 1)
+    {
+        erase_oldest();
+        ++_eviction_count;
+    }
 }
 
-message blockchain_tied_message_cache::get_message(const message_hash_type& hash_of_message_to_lookup)
+std::shared_ptr<const message>
+blockchain_tied_message_cache::get_shared_message(const message_hash_type& hash_of_message_to_lookup) const
 {
     message_cache_container::index<message_hash_index>::type::const_iterator iter
         = _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup);
     if (iter != _message_cache.get<message_hash_index>().end())
+    {
+        ++_hit_count;
         return iter->message_body;
+    }
+    ++_miss_count;
     FC_THROW_EXCEPTION(fc::key_not_found_exception, "Requested message not in cache");
 }
 
+const message* blockchain_tied_message_cache::find_message(const message_hash_type& hash_of_message_to_lookup) const
+{
+    message_cache_container::index<message_hash_index>::type::const_iterator iter
+        = _message_cache.get<message_hash_index>().find(hash_of_message_to_lookup);
+    if (iter != _message_cache.get<message_hash_index>().end())
+    {
+        ++_hit_count;
+        return iter->message_body.get();
+    }
+    ++_miss_count;
+    return nullptr;
+}
+
 message_propagation_data blockchain_tied_message_cache::get_message_propagation_data(
     const fc::uint160_t& hash_of_message_contents_to_lookup) const
 {
@@ -249,6 +324,19 @@ message_propagation_data blockchain_tied_message_cache::get_message_propagation_
     FC_THROW_EXCEPTION(fc::key_not_found_exception, "Requested message not in cache");
 }
 
+fc::variant_object blockchain_tied_message_cache::get_statistics() const
+{
+    fc::mutable_variant_object statistics;
+    statistics["messages"] = _message_cache.size();
+    statistics["size_in_bytes"] = _size_in_bytes;
+    statistics["size_limit_in_bytes"] = uint64_t(GRAPHENE_NET_MESSAGE_CACHE_MAX_BYTES);
+    statistics["hits"] = _hit_count;
+    statistics["misses"] = _miss_count;
+    statistics["evictions"] = _eviction_count;
+    statistics["expirations"] = _expiration_count;
+    return statistics;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 // This specifies configuration info for the local node.  It's stored as JSON
@@ -326,6 +414,7 @@ private:
 #define NODE_DELEGATE_METHOD_NAMES (has_item) \
                                    (handle_message) \
                                    (handle_block) \
+                                   (prevalidate_sync_block) \
                                    (handle_transaction) \
                                    (get_block_ids) \
                                    (get_item) \
@@ -347,6 +436,16 @@ private:
     BOOST_PP_SEQ_FOR_EACH(DECLARE_ACCUMULATOR, unused, NODE_DELEGATE_METHOD_NAMES)
 #undef DECLARE_ACCUMULATOR
 
+    // block propagation during normal operation, split by whether the block came in full or as a compact block.
+    // delay is measured from the block timestamp, fetch time from our request for the block
+    call_stats_accumulator _full_block_propagation_delay_accumulator;
+    call_stats_accumulator _full_block_fetch_time_accumulator;
+    call_stats_accumulator _compact_block_propagation_delay_accumulator;
+    call_stats_accumulator _compact_block_fetch_time_accumulator;
+    call_stats_accumulator _compact_block_transaction_count_accumulator;
+    call_stats_accumulator _compact_block_missing_transaction_count_accumulator;
+    uint64_t _compact_block_fallback_count;
+
     class call_statistics_collector
     {
     private:
@@ -423,11 +522,16 @@ public:
 
     fc::variant_object get_call_statistics();
 
+    void record_block_propagation(fc::time_point_sec block_timestamp, fc::time_point request_time, bool compact);
+    void record_compact_block_received(size_t transaction_count, size_t missing_transaction_count);
+    void record_compact_block_fallback();
+
     bool has_item(const net::item_id& id) override;
     void handle_message(const message&) override;
     bool handle_block(const graphene::net::block_message& block_message,
                       bool sync_mode,
                       std::vector<fc::uint160_t>& contained_transaction_message_ids) override;
+    void prevalidate_sync_block(const graphene::net::block_message& block_message) override;
     void handle_transaction(const graphene::net::trx_message& transaction_message) override;
     std::vector<item_hash_t> get_block_ids(const std::vector<item_hash_t>& blockchain_synopsis,
                                            uint32_t& remaining_item_count,
@@ -490,15 +594,21 @@ public:
     bool _sync_items_to_fetch_updated;
     fc::future<void> _fetch_sync_items_loop_done;
 
-    typedef std::unordered_map<graphene::net::block_id_type, fc::time_point> active_sync_requests_map;
+    struct active_sync_request
+    {
+        peer_connection_ptr peer; /// the peer the block was requested from, the last one if it was requested again
+        fc::time_point request_time;
+    };
+    typedef std::unordered_map<graphene::net::block_id_type, active_sync_request> active_sync_requests_map;
 
     active_sync_requests_map
         _active_sync_requests; /// list of sync blocks we've asked for from peers but have not yet received
     std::list<graphene::net::block_message>
         _new_received_sync_items; /// list of sync blocks we've just received but haven't yet tried to process
-    std::list<graphene::net::block_message> _received_sync_items; /// list of sync blocks we've received, but can't yet
-    /// process because we are still missing blocks that
-    /// come earlier in the chain
+    std::unordered_map<graphene::net::block_id_type, graphene::net::block_message>
+        _received_sync_items; /// sync blocks we've received, but can't yet process because we are still missing
+    /// blocks that come earlier in the chain. Keyed by id, because the block to push next is named by the
+    /// front of a peer's ids_of_items_to_get and competing forks can share block numbers
     // @}
 
     fc::future<void> _process_backlog_of_sync_blocks_done;
@@ -612,6 +722,8 @@ public:
     boost::circular_buffer<uint32_t> _average_network_write_speed_hours;
     unsigned _average_network_usage_second_counter;
     unsigned _average_network_usage_minute_counter;
+    boost::circular_buffer<uint32_t> _compression_bytes_saved_seconds;
+    message_compression_statistics _last_compression_statistics; /// totals as of the last bandwidth_monitor_loop
 
     fc::time_point_sec _bandwidth_monitor_last_update_time;
     fc::future<void> _bandwidth_monitor_loop_done;
@@ -643,6 +755,8 @@ public:
     unsigned _maximum_number_of_blocks_to_handle_at_one_time;
     unsigned _maximum_number_of_sync_blocks_to_prefetch;
     unsigned _maximum_blocks_per_peer_during_syncing;
+    bool _compact_block_relay_enabled; /// request blocks as compact_block_messages from peers that support them
+    bool _message_compression_enabled; /// offer to exchange compressed messages in our hello
 
     std::list<fc::future<void>> _handle_message_calls_in_progress;
     std::set<message_hash_type> _message_ids_currently_being_processed;
@@ -660,6 +774,8 @@ public:
     void request_sync_items_from_peer(const peer_connection_ptr& peer,
                                       const std::vector<item_hash_t>& items_to_request);
     void fetch_sync_items_loop();
+    void reassign_stalled_sync_items();
+    void forget_sync_request(peer_connection* peer, const item_hash_t& item_hash);
     void trigger_fetch_sync_items_loop();
 
     bool is_item_in_any_peers_inventory(const item_id& item) const;
@@ -752,6 +868,7 @@ public:
 
     void send_sync_block_to_node_delegate(const graphene::net::block_message& block_message_to_send);
     void process_backlog_of_sync_blocks();
+    void prune_received_sync_items();
     void trigger_process_backlog_of_sync_blocks();
     void process_block_during_sync(peer_connection* originating_peer,
                                    const graphene::net::block_message& block_message,
@@ -763,6 +880,18 @@ public:
                                const message& message_to_process,
                                const message_hash_type& message_hash);
 
+    void on_compact_block_message(peer_connection* originating_peer,
+                                  const compact_block_message& compact_block_message_received);
+    void on_get_compact_block_transactions_message(
+        peer_connection* originating_peer,
+        const get_compact_block_transactions_message& get_compact_block_transactions_message_received);
+    void on_compact_block_transactions_message(
+        peer_connection* originating_peer,
+        const compact_block_transactions_message& compact_block_transactions_message_received);
+    void process_reconstructed_compact_block(peer_connection* originating_peer,
+                                             const item_hash_t& block_message_id,
+                                             const peer_connection::compact_block_reconstruction& reconstruction);
+
     void process_ordinary_message(peer_connection* originating_peer,
                                   const message& message_to_process,
                                   const message_hash_type& message_hash);
@@ -830,7 +959,7 @@ public:
     void set_total_bandwidth_limit(uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second);
     void disable_peer_advertising();
     fc::variant_object get_call_statistics() const;
-    message get_message_for_item(const item_id& item) override;
+    std::shared_ptr<const message> get_message_for_item(const item_id& item) override;
 
     fc::variant_object network_get_info() const;
     fc::variant_object network_get_usage_stats() const;
@@ -906,10 +1035,13 @@ node_impl::node_impl(const std::string& user_agent)
     , _average_network_write_speed_hours(72)
     , _average_network_usage_second_counter(0)
     , _average_network_usage_minute_counter(0)
+    , _compression_bytes_saved_seconds(60)
     , _node_is_shutting_down(false)
     , _maximum_number_of_blocks_to_handle_at_one_time(MAXIMUM_NUMBER_OF_BLOCKS_TO_HANDLE_AT_ONE_TIME)
     , _maximum_number_of_sync_blocks_to_prefetch(MAXIMUM_NUMBER_OF_BLOCKS_TO_PREFETCH)
     , _maximum_blocks_per_peer_during_syncing(GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING)
+    , _compact_block_relay_enabled(true)
+    , _message_compression_enabled(true)
 {
     _rate_limiter.set_actual_rate_time_constant(fc::seconds(2));
     fc::rand_pseudo_bytes(&_node_id.data[0], (int)_node_id.size());
@@ -1081,10 +1213,7 @@ void node_impl::trigger_p2p_network_connect_loop()
 bool node_impl::have_already_received_sync_item(const item_hash_t& item_hash)
 {
     VERIFY_CORRECT_THREAD();
-    return std::find_if(
-               _received_sync_items.begin(), _received_sync_items.end(),
-               [&item_hash](const graphene::net::block_message& message) { return message.block_id == item_hash; })
-        != _received_sync_items.end()
+    return _received_sync_items.find(item_hash) != _received_sync_items.end()
         || std::find_if(
                _new_received_sync_items.begin(), _new_received_sync_items.end(),
                [&item_hash](const graphene::net::block_message& message) { return message.block_id == item_hash; })
@@ -1098,7 +1227,8 @@ void node_impl::request_sync_item_from_peer(const peer_connection_ptr& peer, con
     dlog("requesting item ${item_hash} from peer ${endpoint}",
          ("item_hash", item_to_request)("endpoint", peer->get_remote_endpoint()));
     item_id item_id_to_request(graphene::net::block_message_type, item_to_request);
-    _active_sync_requests.insert(active_sync_requests_map::value_type(item_to_request, fc::time_point::now()));
+    _active_sync_requests.insert(
+        active_sync_requests_map::value_type(item_to_request, active_sync_request{ peer, fc::time_point::now() }));
     peer->last_sync_item_received_time = fc::time_point::now();
     peer->sync_items_requested_from_peer.insert(item_to_request);
     peer->send_message(
@@ -1114,7 +1244,8 @@ void node_impl::request_sync_items_from_peer(const peer_connection_ptr& peer,
                                                                                        peer->get_remote_endpoint()));
     for (const item_hash_t& item_to_request : items_to_request)
     {
-        _active_sync_requests.insert(active_sync_requests_map::value_type(item_to_request, fc::time_point::now()));
+        _active_sync_requests.insert(
+            active_sync_requests_map::value_type(item_to_request, active_sync_request{ peer, fc::time_point::now() }));
         peer->last_sync_item_received_time = fc::time_point::now();
         peer->sync_items_requested_from_peer.insert(item_to_request);
     }
@@ -1129,55 +1260,59 @@ void node_impl::fetch_sync_items_loop()
         _sync_items_to_fetch_updated = false;
         dlog("beginning another iteration of the sync items loop");
 
+        bool sync_requests_outstanding = !_active_sync_requests.empty();
         if (!_suspend_fetching_sync_blocks)
         {
             std::map<peer_connection_ptr, std::vector<item_hash_t>> sync_item_requests_to_send;
 
             {
                 ASSERT_TASK_NOT_PREEMPTED();
-                std::set<item_hash_t> sync_items_to_request;
+                reassign_stalled_sync_items();
 
-                // for each idle peer that we're syncing with
+                // the peers we can ask for sync blocks, fastest first, so when several of them have
+                // the same blocks the ones we need soonest go to the peer that will deliver them soonest
+                std::vector<peer_connection_ptr> sync_peers;
                 for (const peer_connection_ptr& peer : _active_connections)
+                    if (peer->we_need_sync_items_from_peer && !peer->inhibit_fetching_sync_blocks
+                        && peer->sync_items_requested_from_peer.size() < peer->sync_request_window)
+                        sync_peers.push_back(peer);
+                std::stable_sort(sync_peers.begin(), sync_peers.end(),
+                                 [](const peer_connection_ptr& lhs, const peer_connection_ptr& rhs) {
+                                     return lhs->average_sync_block_latency < rhs->average_sync_block_latency;
+                                 });
+
+                std::set<item_hash_t> sync_items_to_request;
+                for (const peer_connection_ptr& peer : sync_peers)
                 {
-                    if (peer->we_need_sync_items_from_peer
-                        && sync_item_requests_to_send.find(peer) == sync_item_requests_to_send.end()
-                        && // if we've already scheduled a request for this peer, don't consider scheduling another
-                        peer->idle())
+                    // each peer takes the earliest blocks nobody has been asked for yet, up to the room left
+                    // in its own window, so the download window gets striped across all sync peers.
+                    // Blocks past the download window wait until the blocks in front of them are pushed
+                    size_t requests_available = peer->sync_request_window - peer->sync_items_requested_from_peer.size();
+                    size_t download_window
+                        = std::min<size_t>(peer->ids_of_items_to_get.size(), _maximum_number_of_sync_blocks_to_prefetch);
+                    std::vector<item_hash_t>& requests_for_peer = sync_item_requests_to_send[peer];
+                    for (size_t i = 0; i < download_window && requests_for_peer.size() < requests_available; ++i)
                     {
-                        if (!peer->inhibit_fetching_sync_blocks)
+                        const item_hash_t& item_to_potentially_request = peer->ids_of_items_to_get[i];
+                        if (!have_already_received_sync_item(item_to_potentially_request)
+                            && sync_items_to_request.find(item_to_potentially_request) == sync_items_to_request.end()
+                            && _active_sync_requests.find(item_to_potentially_request) == _active_sync_requests.end()
+                            && peer->sync_items_requested_from_peer.find(item_to_potentially_request)
+                                == peer->sync_items_requested_from_peer.end())
                         {
-                            // loop through the items it has that we don't yet have on our blockchain
-                            for (unsigned i = 0; i < peer->ids_of_items_to_get.size(); ++i)
-                            {
-                                item_hash_t item_to_potentially_request = peer->ids_of_items_to_get[i];
-                                // if we don't already have this item in our temporary storage and we haven't requested
-                                // from another syncing peer
-                                if (!have_already_received_sync_item(item_to_potentially_request)
-                                    && // already got it, but for some reson it's still in our list of items to fetch
-                                    sync_items_to_request.find(item_to_potentially_request)
-                                        == sync_items_to_request.end()
-                                    && // we have already decided to request it from another peer during this iteration
-                                    _active_sync_requests.find(item_to_potentially_request)
-                                        == _active_sync_requests.end()) // we've requested it in a previous iteration
-                                // and we're still waiting for it to arrive
-                                {
-                                    // then schedule a request from this peer
-                                    sync_item_requests_to_send[peer].push_back(item_to_potentially_request);
-                                    sync_items_to_request.insert(item_to_potentially_request);
-                                    if (sync_item_requests_to_send[peer].size()
-                                        >= _maximum_blocks_per_peer_during_syncing)
-                                        break;
-                                }
-                            }
+                            requests_for_peer.push_back(item_to_potentially_request);
+                            sync_items_to_request.insert(item_to_potentially_request);
                         }
                     }
+                    if (requests_for_peer.empty())
+                        sync_item_requests_to_send.erase(peer);
                 }
             } // end non-preemptable section
 
             // make all the requests we scheduled in the loop above
             for (auto sync_item_request : sync_item_requests_to_send)
                 request_sync_items_from_peer(sync_item_request.first, sync_item_request.second);
+            sync_requests_outstanding = sync_requests_outstanding || !sync_item_requests_to_send.empty();
             sync_item_requests_to_send.clear();
         }
         else
@@ -1188,12 +1323,95 @@ void node_impl::fetch_sync_items_loop()
             dlog("no sync items to fetch right now, going to sleep");
             _retrigger_fetch_sync_items_loop_promise
                 = fc::promise<void>::ptr(new fc::promise<void>("graphene::net::retrigger_fetch_sync_items_loop"));
-            _retrigger_fetch_sync_items_loop_promise->wait();
+            try
+            {
+                // while blocks are on their way, wake up periodically to look for peers holding up the sync
+                if (sync_requests_outstanding)
+                    _retrigger_fetch_sync_items_loop_promise->wait(
+                        fc::milliseconds(GRAPHENE_NET_SYNC_BLOCK_STALL_TIMEOUT_MS / 2));
+                else
+                    _retrigger_fetch_sync_items_loop_promise->wait();
+            }
+            catch (const fc::timeout_exception&)
+            {
+            }
             _retrigger_fetch_sync_items_loop_promise.reset();
         }
     } // while( !canceled )
 }
 
+void node_impl::reassign_stalled_sync_items()
+{
+    VERIFY_CORRECT_THREAD();
+    ASSERT_TASK_NOT_PREEMPTED();
+    fc::time_point now = fc::time_point::now();
+
+    // the blocks we can push next are at the front of our sync peers' lists, those are the only
+    // ones worth re-requesting, a late block anywhere else in the window doesn't hold anything up
+    std::set<item_hash_t> next_sync_items;
+    for (const peer_connection_ptr& peer : _active_connections)
+        if (peer->we_need_sync_items_from_peer && !peer->ids_of_items_to_get.empty())
+            next_sync_items.insert(peer->ids_of_items_to_get.front());
+
+    for (const item_hash_t& next_sync_item : next_sync_items)
+    {
+        auto request_iter = _active_sync_requests.find(next_sync_item);
+        if (request_iter == _active_sync_requests.end())
+            continue;
+
+        // a peer that held the block up before still has it among its requested items, so the request
+        // names the peer we are waiting for, and only peers that were never asked for it can take over
+        const peer_connection_ptr stalled_peer = request_iter->second.peer;
+        peer_connection_ptr fastest_other_peer;
+        for (const peer_connection_ptr& peer : _active_connections)
+        {
+            if (peer->we_need_sync_items_from_peer && !peer->inhibit_fetching_sync_blocks
+                && !peer->ids_of_items_to_get.empty() && peer->ids_of_items_to_get.front() == next_sync_item
+                && peer->sync_items_requested_from_peer.find(next_sync_item)
+                    == peer->sync_items_requested_from_peer.end()
+                && (!fastest_other_peer
+                    || peer->average_sync_block_latency < fastest_other_peer->average_sync_block_latency))
+                fastest_other_peer = peer;
+        }
+        if (!fastest_other_peer)
+            continue;
+
+        fc::microseconds stall_timeout = std::max<fc::microseconds>(
+            fc::milliseconds(GRAPHENE_NET_SYNC_BLOCK_STALL_TIMEOUT_MS),
+            fc::microseconds(fastest_other_peer->average_sync_block_latency.count() * 4));
+        fc::microseconds time_outstanding = now - request_iter->second.request_time;
+        if (time_outstanding < stall_timeout)
+            continue;
+
+        // forget the request so the block can be asked for again, the stalled peer keeps it in its
+        // list of requested sync items so its copy is still accepted if it arrives first
+        _active_sync_requests.erase(request_iter);
+        stalled_peer->sync_request_window = std::max<uint32_t>(1, stalled_peer->sync_request_window / 2);
+        ++stalled_peer->sync_stall_count;
+        fc_wlog(fc::logger::get("sync"),
+                "peer ${peer} has held up sync block ${id} for ${time}us, requesting it from ${other} instead "
+                "(stalled ${count} times, window is now ${window})",
+                ("peer", stalled_peer->get_remote_endpoint())("id", next_sync_item)(
+                    "time", time_outstanding.count())("other", fastest_other_peer->get_remote_endpoint())(
+                    "count", stalled_peer->sync_stall_count)("window", stalled_peer->sync_request_window));
+        if (stalled_peer->sync_stall_count >= GRAPHENE_NET_MAX_SYNC_STALLS_PER_PEER)
+        {
+            wlog("no longer fetching sync blocks from peer ${peer}, it is too slow",
+                 ("peer", stalled_peer->get_remote_endpoint()));
+            stalled_peer->inhibit_fetching_sync_blocks = true;
+        }
+    }
+}
+
+void node_impl::forget_sync_request(peer_connection* peer, const item_hash_t& item_hash)
+{
+    VERIFY_CORRECT_THREAD();
+    // once a block was requested again, the request belongs to the other peer
+    auto request_iter = _active_sync_requests.find(item_hash);
+    if (request_iter != _active_sync_requests.end() && request_iter->second.peer.get() == peer)
+        _active_sync_requests.erase(request_iter);
+}
+
 void node_impl::trigger_fetch_sync_items_loop()
 {
     VERIFY_CORRECT_THREAD();
@@ -1337,15 +1555,22 @@ void node_impl::fetch_items_loop()
                 dlog("requesting ${count} items of type ${type} from peer ${endpoint}: ${hashes}",
                      ("count", items_by_type.second.size())("type", (uint32_t)items_by_type.first)(
                          "endpoint", peer_and_items.peer->get_remote_endpoint())("hashes", items_by_type.second));
+                uint32_t item_type_to_request = items_by_type.first;
                 if (items_by_type.first == core_message_type_enum::block_message_type)
+                {
                     for (const item_hash_t& id : items_by_type.second)
                     {
                         fc_dlog(fc::logger::get("sync"),
                                 "requesting a block from peer ${endpoint} (message_id is ${id})",
                                 ("endpoint", peer_and_items.peer->get_remote_endpoint())("id", id));
                     }
+                    // the request stays recorded as a block_message in items_requested_from_peer,
+                    // only the form the peer sends it in changes
+                    if (_compact_block_relay_enabled && peer_and_items.peer->supports_compact_blocks())
+                        item_type_to_request = core_message_type_enum::compact_block_message_type;
+                }
 
-                peer_and_items.peer->send_message(fetch_items_message(items_by_type.first, items_by_type.second));
+                peer_and_items.peer->send_message(fetch_items_message(item_type_to_request, items_by_type.second));
             }
         }
         items_by_peer.clear();
@@ -1773,6 +1998,15 @@ void node_impl::bandwidth_monitor_loop()
     update_bandwidth_data(bytes_read_this_second, bytes_written_this_second);
     _bandwidth_monitor_last_update_time = current_time;
 
+    message_compression_statistics compression_statistics = get_message_compression_statistics();
+    uint64_t bytes_saved = (compression_statistics.bytes_before_compression
+                            - _last_compression_statistics.bytes_before_compression)
+        - (compression_statistics.bytes_after_compression - _last_compression_statistics.bytes_after_compression);
+    for (uint32_t i = 0; i < seconds_since_last_update - 1; ++i)
+        _compression_bytes_saved_seconds.push_back(0);
+    _compression_bytes_saved_seconds.push_back((uint32_t)(bytes_saved / seconds_since_last_update));
+    _last_compression_statistics = compression_statistics;
+
     if (!_node_is_shutting_down && !_bandwidth_monitor_loop_done.canceled())
         _bandwidth_monitor_loop_done = fc::schedule([=]() { bandwidth_monitor_loop(); },
                                                     fc::time_point::now() + fc::seconds(1), "bandwidth_monitor_loop");
@@ -1997,6 +2231,17 @@ void node_impl::on_message(peer_connection* originating_peer, const message& rec
     case core_message_type_enum::block_message_type:
         process_block_message(originating_peer, received_message, message_hash);
         break;
+    case core_message_type_enum::compact_block_message_type:
+        on_compact_block_message(originating_peer, received_message.as<compact_block_message>());
+        break;
+    case core_message_type_enum::get_compact_block_transactions_message_type:
+        on_get_compact_block_transactions_message(originating_peer,
+                                                  received_message.as<get_compact_block_transactions_message>());
+        break;
+    case core_message_type_enum::compact_block_transactions_message_type:
+        on_compact_block_transactions_message(originating_peer,
+                                              received_message.as<compact_block_transactions_message>());
+        break;
     case core_message_type_enum::current_time_request_message_type:
         on_current_time_request_message(originating_peer, received_message.as<current_time_request_message>());
         break;
@@ -2061,6 +2306,9 @@ fc::variant_object node_impl::generate_hello_user_data()
 
     user_data["chain_id"] = _chain_id;
 
+    if (_message_compression_enabled)
+        user_data["message_compression"] = message_compression_algorithm;
+
     return user_data;
 }
 
@@ -2088,6 +2336,10 @@ void node_impl::parse_hello_user_data_for_peer(peer_connection* originating_peer
         originating_peer->last_known_fork_block_number = user_data["last_known_fork_block_number"].as<uint32_t>();
     if (user_data.contains("chain_id"))
         originating_peer->chain_id = user_data["chain_id"].as<deip::protocol::chain_id_type>();
+    // peers that predate compression don't send this field, so they keep getting plain messages
+    originating_peer->message_compression_enabled = _message_compression_enabled
+        && user_data.contains("message_compression")
+        && user_data["message_compression"].as_string() == message_compression_algorithm;
 }
 
 void node_impl::on_hello_message(peer_connection* originating_peer, const hello_message& hello_message_received)
@@ -2980,23 +3232,31 @@ void node_impl::on_blockchain_item_ids_inventory_message(
     }
 }
 
-message node_impl::get_message_for_item(const item_id& item)
+// trx_message packs nothing but the transaction, so this is the id the transaction
+// was advertised and cached under when it was relayed on its own
+static item_hash_t get_transaction_message_id(const signed_transaction& transaction)
+{
+    const std::vector<char> packed_transaction = fc::raw::pack(transaction);
+    return fc::ripemd160::hash(packed_transaction.data(), (uint32_t)packed_transaction.size());
+}
+
+std::shared_ptr<const message> node_impl::get_message_for_item(const item_id& item)
 {
     try
     {
-        return _message_cache.get_message(item.item_hash);
+        return _message_cache.get_shared_message(item.item_hash);
     }
     catch (fc::key_not_found_exception&)
     {
     }
     try
     {
-        return _delegate->get_item(item);
+        return std::make_shared<const message>(_delegate->get_item(item));
     }
     catch (fc::key_not_found_exception&)
     {
     }
-    return item_not_available_message(item);
+    return std::make_shared<const message>(item_not_available_message(item));
 }
 
 void node_impl::on_fetch_items_message(peer_connection* originating_peer,
@@ -3007,19 +3267,54 @@ void node_impl::on_fetch_items_message(peer_connection* originating_peer,
          ("ids", fetch_items_message_received.items_to_fetch)("type", fetch_items_message_received.item_type)(
              "endpoint", originating_peer->get_remote_endpoint()));
 
-    fc::optional<message> last_block_message_sent;
+    fc::optional<item_hash_t> last_block_sent;
+
+    if (fetch_items_message_received.item_type == compact_block_message_type)
+    {
+        // the peer wants blocks without the transactions it already has, which means we have
+        // to unpack them here to replace each transaction with the id of its trx_message
+        for (const item_hash_t& item_hash : fetch_items_message_received.items_to_fetch)
+        {
+            std::shared_ptr<const message> requested_message
+                = get_message_for_item(item_id(block_message_type, item_hash));
+            if (requested_message->msg_type != block_message_type)
+            {
+                originating_peer->send_message(std::move(requested_message));
+                continue;
+            }
+            block_message requested_block = requested_message->as<block_message>();
+            compact_block_message compact_block(item_hash, requested_block.block);
+            compact_block.transaction_message_ids.reserve(requested_block.block.transactions.size());
+            for (const signed_transaction& transaction : requested_block.block.transactions)
+                compact_block.transaction_message_ids.push_back(get_transaction_message_id(transaction));
+            dlog("returning block ${id} to peer ${endpoint} as a compact block of ${count} transaction ids",
+                 ("id", requested_block.block_id)("endpoint", originating_peer->get_remote_endpoint())(
+                     "count", compact_block.transaction_message_ids.size()));
+            originating_peer->send_message(compact_block);
+            last_block_sent = item_hash;
+        }
+        if (last_block_sent)
+        {
+            originating_peer->last_block_delegate_has_seen = *last_block_sent;
+            originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(*last_block_sent);
+        }
+        return;
+    }
 
-    std::list<message> reply_messages;
+    // blocks are queued by id, so their messages never have to be unpacked here
+    // messages from the cache are queued by reference, so a transaction every peer asks
+    // for is serialized once no matter how many send queues it sits in
+    std::list<std::pair<item_id, std::shared_ptr<const message>>> reply_messages;
     for (const item_hash_t& item_hash : fetch_items_message_received.items_to_fetch)
     {
         try
         {
-            message requested_message = _message_cache.get_message(item_hash);
+            std::shared_ptr<const message> requested_message = _message_cache.get_shared_message(item_hash);
             dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
-                 ("endpoint", originating_peer->get_remote_endpoint())("id", requested_message.id()));
-            reply_messages.push_back(requested_message);
+                 ("endpoint", originating_peer->get_remote_endpoint())("id", item_hash));
+            reply_messages.emplace_back(item_id(fetch_items_message_received.item_type, item_hash), requested_message);
             if (fetch_items_message_received.item_type == block_message_type)
-                last_block_message_sent = requested_message;
+                last_block_sent = item_hash;
             continue;
         }
         catch (fc::key_not_found_exception&)
@@ -3030,38 +3325,39 @@ void node_impl::on_fetch_items_message(peer_connection* originating_peer,
         item_id item_to_fetch(fetch_items_message_received.item_type, item_hash);
         try
         {
-            message requested_message = _delegate->get_item(item_to_fetch);
+            std::shared_ptr<const message> requested_message
+                = std::make_shared<const message>(_delegate->get_item(item_to_fetch));
             dlog("received item request from peer ${endpoint}, returning the item from delegate with id ${id} size "
                  "${size}",
-                 ("id", requested_message.id())("size", requested_message.size)(
+                 ("id", requested_message->id())("size", requested_message->size)(
                      "endpoint", originating_peer->get_remote_endpoint()));
-            reply_messages.push_back(requested_message);
+            reply_messages.emplace_back(item_to_fetch, requested_message);
             if (fetch_items_message_received.item_type == block_message_type)
-                last_block_message_sent = requested_message;
+                last_block_sent = item_hash;
             continue;
         }
         catch (fc::key_not_found_exception&)
         {
-            reply_messages.push_back(item_not_available_message(item_to_fetch));
+            reply_messages.emplace_back(item_to_fetch,
+                                        std::make_shared<const message>(item_not_available_message(item_to_fetch)));
             dlog("received item request from peer ${endpoint} but we don't have it",
                  ("endpoint", originating_peer->get_remote_endpoint()));
         }
     }
 
     // if we sent them a block, update our record of the last block they've seen accordingly
-    if (last_block_message_sent)
+    if (last_block_sent)
     {
-        graphene::net::block_message block = last_block_message_sent->as<graphene::net::block_message>();
-        originating_peer->last_block_delegate_has_seen = block.block_id;
-        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(block.block_id);
+        originating_peer->last_block_delegate_has_seen = *last_block_sent;
+        originating_peer->last_block_time_delegate_has_seen = _delegate->get_block_time(*last_block_sent);
     }
 
-    for (const message& reply : reply_messages)
+    for (const auto& reply : reply_messages)
     {
-        if (reply.msg_type == block_message_type)
-            originating_peer->send_item(item_id(block_message_type, reply.as<graphene::net::block_message>().block_id));
+        if (reply.second->msg_type == block_message_type)
+            originating_peer->send_item(reply.first);
         else
-            originating_peer->send_message(reply);
+            originating_peer->send_message(reply.second);
     }
 }
 
@@ -3074,6 +3370,7 @@ void node_impl::on_item_not_available_message(peer_connection* originating_peer,
     if (regular_item_iter != originating_peer->items_requested_from_peer.end())
     {
         originating_peer->items_requested_from_peer.erase(regular_item_iter);
+        originating_peer->compact_blocks_being_reconstructed.erase(requested_item.item_hash);
         originating_peer->inventory_peer_advertised_to_us.erase(requested_item);
         if (is_item_in_any_peers_inventory(requested_item))
             _items_to_fetch.insert(prioritized_item_id(requested_item, _items_to_fetch_sequence_counter++));
@@ -3086,6 +3383,7 @@ void node_impl::on_item_not_available_message(peer_connection* originating_peer,
     if (sync_item_iter != originating_peer->sync_items_requested_from_peer.end())
     {
         originating_peer->sync_items_requested_from_peer.erase(sync_item_iter);
+        forget_sync_request(originating_peer, requested_item.item_hash);
 
         if (originating_peer->peer_needs_sync_items_from_us)
             originating_peer->inhibit_fetching_sync_blocks = true;
@@ -3293,7 +3591,7 @@ void node_impl::on_connection_closed(peer_connection* originating_peer)
     if (!originating_peer->sync_items_requested_from_peer.empty())
     {
         for (auto sync_item : originating_peer->sync_items_requested_from_peer)
-            _active_sync_requests.erase(sync_item);
+            forget_sync_request(originating_peer, sync_item);
         trigger_fetch_sync_items_loop();
     }
 
@@ -3544,88 +3842,110 @@ void node_impl::process_backlog_of_sync_blocks()
     std::set<peer_connection_ptr> peers_we_need_to_sync_to;
     std::map<peer_connection_ptr, fc::oexception> peers_with_rejected_block;
 
+    prune_received_sync_items();
+
     do
     {
-        std::copy(std::make_move_iterator(_new_received_sync_items.begin()),
-                  std::make_move_iterator(_new_received_sync_items.end()), std::front_inserter(_received_sync_items));
+        // let the client start validating newly queued blocks in the background while
+        // they are waiting for their predecessors to be pushed
+        for (const graphene::net::block_message& new_sync_item : _new_received_sync_items)
+        {
+            try
+            {
+                _delegate->prevalidate_sync_block(new_sync_item);
+            }
+            catch (const fc::exception& e)
+            {
+                wlog("Failed to prevalidate sync block ${id}: ${e}", ("id", new_sync_item.block_id)("e", e));
+            }
+        }
+
+        for (graphene::net::block_message& new_sync_item : _new_received_sync_items)
+        {
+            graphene::net::block_id_type block_id = new_sync_item.block_id;
+            _received_sync_items.emplace(block_id, std::move(new_sync_item));
+        }
         _new_received_sync_items.clear();
         dlog("currently ${count} sync items to consider", ("count", _received_sync_items.size()));
 
         block_processed_this_iteration = false;
-        for (auto received_block_iter = _received_sync_items.begin(); received_block_iter != _received_sync_items.end();
-             ++received_block_iter)
+
+        // the next block on the active chain or one of the forks is at the front of some peer's list,
+        // so checking each peer's front is enough to find it, however many blocks we're holding
+        auto received_block_iter = _received_sync_items.end();
+        for (const peer_connection_ptr& peer : _active_connections)
         {
+            ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
+            if (!peer->ids_of_items_to_get.empty())
+            {
+                received_block_iter = _received_sync_items.find(peer->ids_of_items_to_get.front());
+                if (received_block_iter != _received_sync_items.end())
+                    break;
+            }
+        }
 
-            // find out if this block is the next block on the active chain or one of the forks
-            bool potential_first_block = false;
+        // if there is one, process it, remove it from all sync peers lists
+        if (received_block_iter != _received_sync_items.end())
+        {
             for (const peer_connection_ptr& peer : _active_connections)
             {
                 ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
                 if (!peer->ids_of_items_to_get.empty()
-                    && peer->ids_of_items_to_get.front() == received_block_iter->block_id)
+                    && peer->ids_of_items_to_get.front() == received_block_iter->first)
                 {
-                    potential_first_block = true;
                     peer->ids_of_items_to_get.pop_front();
-                    peer->ids_of_items_being_processed.insert(received_block_iter->block_id);
+                    peer->ids_of_items_being_processed.insert(received_block_iter->first);
                 }
             }
 
-            // if it is, process it, remove it from all sync peers lists
-            if (potential_first_block)
+            // we can get into an interesting situation near the end of synchronization.  We can be in
+            // sync with one peer who is sending us the last block on the chain via a regular inventory
+            // message, while at the same time still be synchronizing with a peer who is sending us the
+            // block through the sync mechanism.  Further, we must request both blocks because
+            // we don't know they're the same (for the peer in normal operation, it has only told us the
+            // message id, for the peer in the sync case we only known the block_id).
+            if (std::find(_most_recent_blocks_accepted.begin(), _most_recent_blocks_accepted.end(),
+                          received_block_iter->first)
+                == _most_recent_blocks_accepted.end())
             {
-                // we can get into an interesting situation near the end of synchronization.  We can be in
-                // sync with one peer who is sending us the last block on the chain via a regular inventory
-                // message, while at the same time still be synchronizing with a peer who is sending us the
-                // block through the sync mechanism.  Further, we must request both blocks because
-                // we don't know they're the same (for the peer in normal operation, it has only told us the
-                // message id, for the peer in the sync case we only known the block_id).
-                if (std::find(_most_recent_blocks_accepted.begin(), _most_recent_blocks_accepted.end(),
-                              received_block_iter->block_id)
-                    == _most_recent_blocks_accepted.end())
-                {
-                    graphene::net::block_message block_message_to_process = *received_block_iter;
-                    _received_sync_items.erase(received_block_iter);
-                    _handle_message_calls_in_progress.emplace_back(fc::async(
-                        [this, block_message_to_process]() {
-                            send_sync_block_to_node_delegate(block_message_to_process);
-                        },
-                        "send_sync_block_to_node_delegate"));
-                    ++blocks_processed;
-                    block_processed_this_iteration = true;
-                }
-                else
+                graphene::net::block_message block_message_to_process = std::move(received_block_iter->second);
+                _received_sync_items.erase(received_block_iter);
+                _handle_message_calls_in_progress.emplace_back(fc::async(
+                    [this, block_message_to_process]() { send_sync_block_to_node_delegate(block_message_to_process); },
+                    "send_sync_block_to_node_delegate"));
+                ++blocks_processed;
+                block_processed_this_iteration = true;
+            }
+            else
+            {
+                dlog("Already received and accepted this block (presumably through normal inventory mechanism), "
+                     "treating it as accepted");
+                graphene::net::block_id_type block_id = received_block_iter->first;
+                _received_sync_items.erase(received_block_iter);
+                for (const peer_connection_ptr& peer : _active_connections)
                 {
-                    dlog("Already received and accepted this block (presumably through normal inventory mechanism), "
-                         "treating it as accepted");
-                    for (const peer_connection_ptr& peer : _active_connections)
+                    auto items_being_processed_iter = peer->ids_of_items_being_processed.find(block_id);
+                    if (items_being_processed_iter != peer->ids_of_items_being_processed.end())
                     {
-                        auto items_being_processed_iter
-                            = peer->ids_of_items_being_processed.find(received_block_iter->block_id);
-                        if (items_being_processed_iter != peer->ids_of_items_being_processed.end())
+                        peer->ids_of_items_being_processed.erase(items_being_processed_iter);
+                        dlog("Removed item from ${endpoint}'s list of items being processed, still processing "
+                             "${len} blocks",
+                             ("endpoint", peer->get_remote_endpoint())("len", peer->ids_of_items_being_processed.size()));
+
+                        // if we just processed the last item in our list from this peer, we will want to
+                        // send another request to find out if we are now in sync (this is normally handled in
+                        // send_sync_block_to_node_delegate)
+                        if (peer->ids_of_items_to_get.empty() && peer->number_of_unfetched_item_ids == 0
+                            && peer->ids_of_items_being_processed.empty())
                         {
-                            peer->ids_of_items_being_processed.erase(items_being_processed_iter);
-                            dlog("Removed item from ${endpoint}'s list of items being processed, still processing "
-                                 "${len} blocks",
-                                 ("endpoint", peer->get_remote_endpoint())("len",
-                                                                           peer->ids_of_items_being_processed.size()));
-
-                            // if we just processed the last item in our list from this peer, we will want to
-                            // send another request to find out if we are now in sync (this is normally handled in
-                            // send_sync_block_to_node_delegate)
-                            if (peer->ids_of_items_to_get.empty() && peer->number_of_unfetched_item_ids == 0
-                                && peer->ids_of_items_being_processed.empty())
-                            {
-                                dlog("We received last item in our list for peer ${endpoint}, setup to do a sync check",
-                                     ("endpoint", peer->get_remote_endpoint()));
-                                fetch_next_batch_of_item_ids_from_peer(peer.get());
-                            }
+                            dlog("We received last item in our list for peer ${endpoint}, setup to do a sync check",
+                                 ("endpoint", peer->get_remote_endpoint()));
+                            fetch_next_batch_of_item_ids_from_peer(peer.get());
                         }
                     }
                 }
-
-                break; // start iterating _received_sync_items from the beginning
-            } // end if potential_first_block
-        } // end for each block in _received_sync_items
+            }
+        }
 
         if (_handle_message_calls_in_progress.size() >= _maximum_number_of_blocks_to_handle_at_one_time)
         {
@@ -3646,6 +3966,39 @@ void node_impl::process_backlog_of_sync_blocks()
         trigger_fetch_sync_items_loop();
 }
 
+void node_impl::prune_received_sync_items()
+{
+    VERIFY_CORRECT_THREAD();
+    // a second copy of a block that was requested again, or one that also came in through the normal
+    // inventory mechanism, can arrive after the block was pushed. No peer names it as its next block any
+    // more, so without this it would sit in _received_sync_items for the rest of the sync. Blocks at or
+    // below the head are only kept while a peer still lists them, as they may be on a fork we switch to
+    uint32_t head_block_num = _delegate->get_block_number(_delegate->get_head_block_id());
+
+    ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
+    size_t pruned_count = 0;
+    for (auto received_block_iter = _received_sync_items.begin(); received_block_iter != _received_sync_items.end();)
+    {
+        const graphene::net::block_id_type& block_id = received_block_iter->first;
+        if (received_block_iter->second.block.block_num() <= head_block_num
+            && std::none_of(_active_connections.begin(), _active_connections.end(),
+                            [&block_id](const peer_connection_ptr& peer) {
+                                return std::find(peer->ids_of_items_to_get.begin(), peer->ids_of_items_to_get.end(),
+                                                 block_id)
+                                    != peer->ids_of_items_to_get.end();
+                            }))
+        {
+            received_block_iter = _received_sync_items.erase(received_block_iter);
+            ++pruned_count;
+        }
+        else
+            ++received_block_iter;
+    }
+    if (pruned_count)
+        dlog("dropped ${count} sync blocks at or below head block #${head}",
+             ("count", pruned_count)("head", head_block_num));
+}
+
 void node_impl::trigger_process_backlog_of_sync_blocks()
 {
     if (!_node_is_shutting_down
@@ -3661,6 +4014,22 @@ void node_impl::process_block_during_sync(peer_connection* originating_peer,
     VERIFY_CORRECT_THREAD();
     dlog("received a sync block from peer ${endpoint}", ("endpoint", originating_peer->get_remote_endpoint()));
 
+    // a block we asked a second peer for because the first one was holding up the sync can arrive twice
+    if (have_already_received_sync_item(block_message_to_process.block_id)
+        || std::find(_most_recent_blocks_accepted.begin(), _most_recent_blocks_accepted.end(),
+                     block_message_to_process.block_id)
+            != _most_recent_blocks_accepted.end()
+        || std::any_of(_active_connections.begin(), _active_connections.end(),
+                       [&block_message_to_process](const peer_connection_ptr& peer) {
+                           return peer->ids_of_items_being_processed.find(block_message_to_process.block_id)
+                               != peer->ids_of_items_being_processed.end();
+                       }))
+    {
+        dlog("already have sync block ${id}, ignoring the copy from peer ${endpoint}",
+             ("id", block_message_to_process.block_id)("endpoint", originating_peer->get_remote_endpoint()));
+        return;
+    }
+
     // add it to the front of _received_sync_items, then process _received_sync_items to try to
     // pass as many messages as possible to the client.
     _new_received_sync_items.push_front(block_message_to_process);
@@ -3848,7 +4217,9 @@ void node_impl::process_block_message(peer_connection* originating_peer,
         = originating_peer->items_requested_from_peer.find(item_id(graphene::net::block_message_type, message_hash));
     if (item_iter != originating_peer->items_requested_from_peer.end())
     {
+        _delegate->record_block_propagation(block_message_to_process.block.timestamp, item_iter->second, false);
         originating_peer->items_requested_from_peer.erase(item_iter);
+        originating_peer->compact_blocks_being_reconstructed.erase(message_hash);
         process_block_during_normal_operation(originating_peer, block_message_to_process, message_hash);
         if (originating_peer->idle())
             trigger_fetch_items_loop();
@@ -3867,7 +4238,25 @@ void node_impl::process_block_message(peer_connection* originating_peer,
             try
             {
                 originating_peer->last_sync_item_received_time = fc::time_point::now();
-                _active_sync_requests.erase(block_message_to_process.block_id);
+                auto active_request_iter = _active_sync_requests.find(block_message_to_process.block_id);
+                if (active_request_iter != _active_sync_requests.end())
+                {
+                    // additive increase of the peer's window, a stall halves it again. A stalled peer
+                    // delivering after the block was requested again doesn't get credit for it
+                    if (active_request_iter->second.peer.get() == originating_peer)
+                    {
+                        fc::microseconds latency = originating_peer->last_sync_item_received_time
+                            - active_request_iter->second.request_time;
+                        originating_peer->average_sync_block_latency
+                            = originating_peer->average_sync_block_latency.count() == 0
+                            ? latency
+                            : fc::microseconds(
+                                  (originating_peer->average_sync_block_latency.count() * 7 + latency.count()) / 8);
+                        if (originating_peer->sync_request_window < _maximum_blocks_per_peer_during_syncing)
+                            ++originating_peer->sync_request_window;
+                    }
+                    _active_sync_requests.erase(active_request_iter);
+                }
                 process_block_during_sync(originating_peer, block_message_to_process, message_hash);
                 if (originating_peer->idle())
                 {
@@ -3879,6 +4268,11 @@ void node_impl::process_block_message(peer_connection* originating_peer,
                     else
                         trigger_fetch_sync_items_loop();
                 }
+                else
+                {
+                    // the peer has room in its window again, keep the download window sliding
+                    trigger_fetch_sync_items_loop();
+                }
                 return;
             }
             catch (const fc::canceled_exception& e)
@@ -4190,6 +4584,158 @@ void node_impl::on_get_current_connections_reply_message(
     VERIFY_CORRECT_THREAD();
 }
 
+void node_impl::on_compact_block_message(peer_connection* originating_peer,
+                                         const compact_block_message& compact_block_message_received)
+{
+    VERIFY_CORRECT_THREAD();
+    const item_hash_t& block_message_id = compact_block_message_received.block_message_id;
+    if (originating_peer->items_requested_from_peer.find(item_id(block_message_type, block_message_id))
+        == originating_peer->items_requested_from_peer.end())
+    {
+        wlog("received a compact block I didn't ask for from peer ${endpoint}, disconnecting from peer",
+             ("endpoint", originating_peer->get_remote_endpoint()));
+        fc::exception detailed_error(
+            FC_LOG_MESSAGE(error, "You sent me a compact block that I didn't ask for, message_hash: ${message_hash}",
+                           ("message_hash", block_message_id)));
+        disconnect_from_peer(originating_peer, "You sent me a message that I didn't request", true, detailed_error);
+        return;
+    }
+
+    // every transaction we received on its own is still in the message cache under the id of
+    // its trx_message, so only the ones that reached the witness without passing through us are missing
+    peer_connection::compact_block_reconstruction reconstruction;
+    reconstruction.received_time = fc::time_point::now();
+    static_cast<signed_block_header&>(reconstruction.block) = compact_block_message_received.header;
+    const std::vector<item_hash_t>& transaction_message_ids = compact_block_message_received.transaction_message_ids;
+    reconstruction.block.transactions.resize(transaction_message_ids.size());
+    for (uint32_t i = 0; i < transaction_message_ids.size(); ++i)
+    {
+        const message* transaction_message = _message_cache.find_message(transaction_message_ids[i]);
+        if (transaction_message && transaction_message->msg_type == trx_message_type)
+            reconstruction.block.transactions[i] = transaction_message->as<trx_message>().trx;
+        else
+            reconstruction.missing_transaction_indices.push_back(i);
+    }
+    _delegate->record_compact_block_received(transaction_message_ids.size(),
+                                             reconstruction.missing_transaction_indices.size());
+
+    if (reconstruction.missing_transaction_indices.empty())
+    {
+        process_reconstructed_compact_block(originating_peer, block_message_id, reconstruction);
+        return;
+    }
+
+    dlog("missing ${missing} of ${count} transactions of compact block ${id} from peer ${endpoint}, requesting them",
+         ("missing", reconstruction.missing_transaction_indices.size())("count", transaction_message_ids.size())(
+             "id", block_message_id)("endpoint", originating_peer->get_remote_endpoint()));
+    get_compact_block_transactions_message transactions_request(block_message_id,
+                                                                reconstruction.missing_transaction_indices);
+    originating_peer->compact_blocks_being_reconstructed[block_message_id] = std::move(reconstruction);
+    originating_peer->send_message(transactions_request);
+}
+
+void node_impl::on_get_compact_block_transactions_message(
+    peer_connection* originating_peer,
+    const get_compact_block_transactions_message& get_compact_block_transactions_message_received)
+{
+    VERIFY_CORRECT_THREAD();
+    const item_hash_t& block_message_id = get_compact_block_transactions_message_received.block_message_id;
+    std::shared_ptr<const message> requested_message
+        = get_message_for_item(item_id(block_message_type, block_message_id));
+    if (requested_message->msg_type != block_message_type)
+    {
+        // item_not_available_message, the peer will fetch the block from someone else
+        originating_peer->send_message(std::move(requested_message));
+        return;
+    }
+
+    block_message requested_block = requested_message->as<block_message>();
+    compact_block_transactions_message reply(block_message_id);
+    reply.transactions.reserve(get_compact_block_transactions_message_received.transaction_indices.size());
+    for (uint32_t transaction_index : get_compact_block_transactions_message_received.transaction_indices)
+    {
+        if (transaction_index >= requested_block.block.transactions.size())
+        {
+            wlog("peer ${endpoint} requested transaction ${index} of a block with ${count} transactions, disconnecting",
+                 ("endpoint", originating_peer->get_remote_endpoint())("index", transaction_index)(
+                     "count", requested_block.block.transactions.size()));
+            fc::exception detailed_error(FC_LOG_MESSAGE(
+                error, "You requested transaction ${index} of block ${id} which only has ${count} transactions",
+                ("index", transaction_index)("id", requested_block.block_id)(
+                    "count", requested_block.block.transactions.size())));
+            disconnect_from_peer(originating_peer, "You requested a transaction that is not in the block", true,
+                                 detailed_error);
+            return;
+        }
+        reply.transactions.push_back(requested_block.block.transactions[transaction_index]);
+    }
+    originating_peer->send_message(reply);
+}
+
+void node_impl::on_compact_block_transactions_message(
+    peer_connection* originating_peer,
+    const compact_block_transactions_message& compact_block_transactions_message_received)
+{
+    VERIFY_CORRECT_THREAD();
+    const item_hash_t& block_message_id = compact_block_transactions_message_received.block_message_id;
+    auto reconstruction_iter = originating_peer->compact_blocks_being_reconstructed.find(block_message_id);
+    if (reconstruction_iter == originating_peer->compact_blocks_being_reconstructed.end())
+    {
+        dlog("received transactions for compact block ${id} from peer ${endpoint}, but I'm no longer waiting for them",
+             ("id", block_message_id)("endpoint", originating_peer->get_remote_endpoint()));
+        return;
+    }
+    peer_connection::compact_block_reconstruction reconstruction = std::move(reconstruction_iter->second);
+    originating_peer->compact_blocks_being_reconstructed.erase(reconstruction_iter);
+
+    const std::vector<signed_transaction>& transactions = compact_block_transactions_message_received.transactions;
+    if (transactions.size() != reconstruction.missing_transaction_indices.size())
+    {
+        wlog("peer ${endpoint} sent ${count} transactions for compact block ${id} when I asked for ${missing}, "
+             "fetching the full block",
+             ("endpoint", originating_peer->get_remote_endpoint())("count", transactions.size())(
+                 "id", block_message_id)("missing", reconstruction.missing_transaction_indices.size()));
+        _delegate->record_compact_block_fallback();
+        originating_peer->send_message(
+            fetch_items_message(block_message_type, std::vector<item_hash_t>{ block_message_id }));
+        return;
+    }
+    for (size_t i = 0; i < transactions.size(); ++i)
+        reconstruction.block.transactions[reconstruction.missing_transaction_indices[i]] = transactions[i];
+
+    process_reconstructed_compact_block(originating_peer, block_message_id, reconstruction);
+}
+
+void node_impl::process_reconstructed_compact_block(
+    peer_connection* originating_peer,
+    const item_hash_t& block_message_id,
+    const peer_connection::compact_block_reconstruction& reconstruction)
+{
+    VERIFY_CORRECT_THREAD();
+    // the id of the block_message covers the header, the witness signature and every transaction
+    // with its signatures, so a match means we rebuilt exactly the block the peer announced
+    graphene::net::block_message block_message_to_process(reconstruction.block);
+    if (message(block_message_to_process).id() != block_message_id)
+    {
+        wlog("compact block ${id} from peer ${endpoint} did not rebuild into the block it was requested as, "
+             "fetching the full block",
+             ("id", block_message_id)("endpoint", originating_peer->get_remote_endpoint()));
+        _delegate->record_compact_block_fallback();
+        originating_peer->send_message(
+            fetch_items_message(block_message_type, std::vector<item_hash_t>{ block_message_id }));
+        return;
+    }
+
+    auto item_iter = originating_peer->items_requested_from_peer.find(item_id(block_message_type, block_message_id));
+    if (item_iter == originating_peer->items_requested_from_peer.end())
+        return;
+    _delegate->record_block_propagation(reconstruction.block.timestamp, item_iter->second, true);
+    originating_peer->items_requested_from_peer.erase(item_iter);
+    process_block_during_normal_operation(originating_peer, block_message_to_process, block_message_id);
+    if (originating_peer->idle())
+        trigger_fetch_items_loop();
+}
+
 // this handles any message we get that doesn't require any special processing.
 // currently, this is any message other than block messages and p2p-specific
 // messages.  (transaction messages would be handled here, for example)
@@ -4265,6 +4811,7 @@ void node_impl::start_synchronizing_with_peer(const peer_connection_ptr& peer)
     peer->last_block_delegate_has_seen = item_hash_t();
     peer->last_block_time_delegate_has_seen = _delegate->get_block_time(item_hash_t());
     peer->inhibit_fetching_sync_blocks = false;
+    peer->sync_stall_count = 0;
     fetch_next_batch_of_item_ids_from_peer(peer.get());
 }
 
@@ -5118,7 +5665,7 @@ void node_impl::dump_node_status()
     ilog("node._new_received_sync_items size: ${size}", ("size", _new_received_sync_items.size()));
     ilog("node._items_to_fetch size: ${size}", ("size", _items_to_fetch.size()));
     ilog("node._new_inventory size: ${size}", ("size", _new_inventory.size()));
-    ilog("node._message_cache size: ${size}", ("size", _message_cache.size()));
+    ilog("node._message_cache: ${statistics}", ("statistics", _message_cache.get_statistics()));
     for (const peer_connection_ptr& peer : _active_connections)
     {
         ilog("  peer ${endpoint}", ("endpoint", peer->get_remote_endpoint()));
@@ -5316,7 +5863,7 @@ void node_impl::broadcast(const message& item_to_broadcast, const message_propag
     message_hash_type hash_of_item_to_broadcast = item_to_broadcast.id();
 
     _message_cache.cache_message(item_to_broadcast, hash_of_item_to_broadcast, propagation_data,
-                                 hash_of_message_contents);
+                                 hash_of_message_contents, _message_compression_enabled);
     _new_inventory.insert(item_id(item_to_broadcast.msg_type, hash_of_item_to_broadcast));
     trigger_advertise_inventory_loop();
 }
@@ -5370,6 +5917,10 @@ void node_impl::set_advanced_node_parameters(const fc::variant_object& params)
         _maximum_number_of_sync_blocks_to_prefetch = params["maximum_number_of_sync_blocks_to_prefetch"].as<uint32_t>();
     if (params.contains("maximum_blocks_per_peer_during_syncing"))
         _maximum_blocks_per_peer_during_syncing = params["maximum_blocks_per_peer_during_syncing"].as<uint32_t>();
+    if (params.contains("enable_compact_block_relay"))
+        _compact_block_relay_enabled = params["enable_compact_block_relay"].as<bool>();
+    if (params.contains("enable_message_compression"))
+        _message_compression_enabled = params["enable_message_compression"].as<bool>();
 
     _desired_number_of_connections = std::min(_desired_number_of_connections, _maximum_number_of_connections);
 
@@ -5388,6 +5939,8 @@ fc::variant_object node_impl::get_advanced_node_parameters()
     result["maximum_number_of_blocks_to_handle_at_one_time"] = _maximum_number_of_blocks_to_handle_at_one_time;
     result["maximum_number_of_sync_blocks_to_prefetch"] = _maximum_number_of_sync_blocks_to_prefetch;
     result["maximum_blocks_per_peer_during_syncing"] = _maximum_blocks_per_peer_during_syncing;
+    result["enable_compact_block_relay"] = _compact_block_relay_enabled;
+    result["enable_message_compression"] = _message_compression_enabled;
     return result;
 }
 
@@ -5457,6 +6010,8 @@ fc::variant_object node_impl::network_get_info() const
     info["node_public_key"] = _node_public_key;
     info["node_id"] = _node_id;
     info["firewalled"] = _is_firewalled;
+    info["send_buffer_pool"] = message_oriented_connection::get_send_buffer_pool_statistics();
+    info["message_cache"] = _message_cache.get_statistics();
     return info;
 }
 fc::variant_object node_impl::network_get_usage_stats() const
@@ -5484,6 +6039,15 @@ fc::variant_object node_impl::network_get_usage_stats() const
     result["usage_by_second"] = network_usage_by_second;
     result["usage_by_minute"] = network_usage_by_minute;
     result["usage_by_hour"] = network_usage_by_hour;
+
+    message_compression_statistics compression_statistics = get_message_compression_statistics();
+    fc::mutable_variant_object compression;
+    compression["totals"] = compression_statistics;
+    compression["bytes_saved"]
+        = compression_statistics.bytes_before_compression - compression_statistics.bytes_after_compression;
+    compression["bytes_saved_by_second"]
+        = std::vector<uint32_t>(_compression_bytes_saved_seconds.begin(), _compression_bytes_saved_seconds.end());
+    result["message_compression"] = compression;
     return result;
 }
 
@@ -5741,10 +6305,53 @@ statistics_gathering_node_delegate_wrapper::statistics_gathering_node_delegate_w
     : _node_delegate(delegate)
     , _thread(thread_for_delegate_calls)
           BOOST_PP_SEQ_FOR_EACH(INITIALIZE_ACCUMULATOR, unused, NODE_DELEGATE_METHOD_NAMES)
+    , _full_block_propagation_delay_accumulator(boost::accumulators::tag::rolling_window::window_size
+                                                = ROLLING_WINDOW_SIZE)
+    , _full_block_fetch_time_accumulator(boost::accumulators::tag::rolling_window::window_size = ROLLING_WINDOW_SIZE)
+    , _compact_block_propagation_delay_accumulator(boost::accumulators::tag::rolling_window::window_size
+                                                   = ROLLING_WINDOW_SIZE)
+    , _compact_block_fetch_time_accumulator(boost::accumulators::tag::rolling_window::window_size
+                                            = ROLLING_WINDOW_SIZE)
+    , _compact_block_transaction_count_accumulator(boost::accumulators::tag::rolling_window::window_size
+                                                   = ROLLING_WINDOW_SIZE)
+    , _compact_block_missing_transaction_count_accumulator(boost::accumulators::tag::rolling_window::window_size
+                                                           = ROLLING_WINDOW_SIZE)
+    , _compact_block_fallback_count(0)
 {
 }
 #undef INITIALIZE_ACCUMULATOR
 
+void statistics_gathering_node_delegate_wrapper::record_block_propagation(fc::time_point_sec block_timestamp,
+                                                                          fc::time_point request_time,
+                                                                          bool compact)
+{
+    fc::time_point now = fc::time_point::now();
+    int64_t propagation_delay = (now - fc::time_point(block_timestamp)).count();
+    int64_t fetch_time = (now - request_time).count();
+    if (compact)
+    {
+        _compact_block_propagation_delay_accumulator(propagation_delay);
+        _compact_block_fetch_time_accumulator(fetch_time);
+    }
+    else
+    {
+        _full_block_propagation_delay_accumulator(propagation_delay);
+        _full_block_fetch_time_accumulator(fetch_time);
+    }
+}
+
+void statistics_gathering_node_delegate_wrapper::record_compact_block_received(size_t transaction_count,
+                                                                               size_t missing_transaction_count)
+{
+    _compact_block_transaction_count_accumulator((int64_t)transaction_count);
+    _compact_block_missing_transaction_count_accumulator((int64_t)missing_transaction_count);
+}
+
+void statistics_gathering_node_delegate_wrapper::record_compact_block_fallback()
+{
+    ++_compact_block_fallback_count;
+}
+
 fc::variant_object statistics_gathering_node_delegate_wrapper::get_call_statistics()
 {
     fc::mutable_variant_object statistics;
@@ -5793,6 +6400,28 @@ fc::variant_object statistics_gathering_node_delegate_wrapper::get_call_statisti
     BOOST_PP_SEQ_FOR_EACH(ADD_STATISTICS_FOR_METHOD, unused, NODE_DELEGATE_METHOD_NAMES)
 #undef ADD_STATISTICS_FOR_METHOD
 
+    auto accumulator_statistics = [](const call_stats_accumulator& accumulator) {
+        fc::mutable_variant_object result;
+        result["min"] = boost::accumulators::min(accumulator);
+        result["mean"] = boost::accumulators::rolling_mean(accumulator);
+        result["max"] = boost::accumulators::max(accumulator);
+        result["count"] = boost::accumulators::count(accumulator);
+        return result;
+    };
+    fc::mutable_variant_object block_propagation;
+    block_propagation["full_block_propagation_delay"]
+        = accumulator_statistics(_full_block_propagation_delay_accumulator);
+    block_propagation["full_block_fetch_time"] = accumulator_statistics(_full_block_fetch_time_accumulator);
+    block_propagation["compact_block_propagation_delay"]
+        = accumulator_statistics(_compact_block_propagation_delay_accumulator);
+    block_propagation["compact_block_fetch_time"] = accumulator_statistics(_compact_block_fetch_time_accumulator);
+    block_propagation["compact_block_transaction_count"]
+        = accumulator_statistics(_compact_block_transaction_count_accumulator);
+    block_propagation["compact_block_missing_transaction_count"]
+        = accumulator_statistics(_compact_block_missing_transaction_count_accumulator);
+    block_propagation["compact_block_fallback_count"] = _compact_block_fallback_count;
+    statistics["block_propagation"] = block_propagation;
+
     return statistics;
 }
 
@@ -5874,6 +6503,18 @@ bool statistics_gathering_node_delegate_wrapper::handle_block(
     INVOKE_AND_COLLECT_STATISTICS(handle_block, block_message, sync_mode, contained_transaction_message_ids);
 }
 
+void statistics_gathering_node_delegate_wrapper::prevalidate_sync_block(
+    const graphene::net::block_message& block_message)
+{
+    // this function doesn't need to block, it only schedules background work
+    ASSERT_TASK_NOT_PREEMPTED();
+    call_statistics_collector statistics_collector("prevalidate_sync_block", &_prevalidate_sync_block_execution_accumulator,
+                                                   &_prevalidate_sync_block_delay_before_accumulator,
+                                                   &_prevalidate_sync_block_delay_after_accumulator);
+    call_statistics_collector::actual_execution_measurement_helper helper(statistics_collector);
+    _node_delegate->prevalidate_sync_block(block_message);
+}
+
 void statistics_gathering_node_delegate_wrapper::handle_transaction(
     const graphene::net::trx_message& transaction_message)
 {
@@ -22,6 +22,7 @@
  * THE SOFTWARE.
  */
 #include <graphene/net/peer_connection.hpp>
+#include <graphene/net/message_compression.hpp>
 #include <graphene/net/exceptions.hpp>
 #include <graphene/net/config.hpp>
 #include <deip/protocol/config.hpp>
@@ -46,24 +47,27 @@
 
 namespace graphene {
 namespace net {
-message peer_connection::real_queued_message::get_message(peer_connection_delegate*)
+std::shared_ptr<const message> peer_connection::real_queued_message::get_message(peer_connection_delegate*)
 {
     if (message_send_time_field_offset != (size_t)-1)
     {
         // patch the current time into the message.  Since this operates on the packed version of the structure,
-        // it won't work for anything after a variable-length field
+        // it won't work for anything after a variable-length field.  Only the small time request/reply
+        // messages do this, and they are never shared, so patching a private copy costs little
+        std::shared_ptr<message> patched_message = std::make_shared<message>(*message_to_send);
         std::vector<char> packed_current_time = fc::raw::pack(fc::time_point::now());
-        assert(message_send_time_field_offset + packed_current_time.size() <= message_to_send.data.size());
-        memcpy(message_to_send.data.data() + message_send_time_field_offset, packed_current_time.data(),
+        assert(message_send_time_field_offset + packed_current_time.size() <= patched_message->data.size());
+        memcpy(patched_message->data.data() + message_send_time_field_offset, packed_current_time.data(),
                packed_current_time.size());
+        return patched_message;
     }
     return message_to_send;
 }
 size_t peer_connection::real_queued_message::get_size_in_queue()
 {
-    return message_to_send.data.size();
+    return message_to_send->data.size();
 }
-message peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
+std::shared_ptr<const message> peer_connection::virtual_queued_message::get_message(peer_connection_delegate* node)
 {
     return node->get_message_for_item(item_to_send);
 }
@@ -84,10 +88,13 @@ peer_connection::peer_connection(peer_connection_delegate* delegate)
     , their_state(their_connection_state::disconnected)
     , we_have_requested_close(false)
     , negotiation_status(connection_negotiation_status::disconnected)
+    , message_compression_enabled(false)
     , number_of_unfetched_item_ids(0)
     , peer_needs_sync_items_from_us(true)
     , we_need_sync_items_from_peer(true)
     , inhibit_fetching_sync_blocks(false)
+    , sync_request_window(GRAPHENE_NET_INITIAL_SYNC_BLOCKS_PER_PEER)
+    , sync_stall_count(0)
     , transaction_fetching_inhibited_until(fc::time_point::min())
     , last_known_fork_block_number(0)
     , firewall_check_state(nullptr)
@@ -288,7 +295,12 @@ void peer_connection::on_message(message_oriented_connection* originating_connec
         this_->_currently_handling_message = false;
     }
     BOOST_SCOPE_EXIT_END
-    _node->on_message(this, received_message);
+    // a peer only compresses after we've offered to accept it, but there's no harm in
+    // unwrapping whatever arrives
+    if (received_message.msg_type == compressed_message_type)
+        _node->on_message(this, decompress_message(received_message));
+    else
+        _node->on_message(this, received_message);
 }
 
 void peer_connection::on_connection_closed(message_oriented_connection* originating_connection)
@@ -321,13 +333,15 @@ void peer_connection::send_queued_messages_task()
     while (!_queued_messages.empty())
     {
         _queued_messages.front()->transmission_start_time = fc::time_point::now();
-        message message_to_send = _queued_messages.front()->get_message(_node);
+        std::shared_ptr<const message> message_to_send = _queued_messages.front()->get_message(_node);
+        if (message_compression_enabled)
+            message_to_send = get_compressed_message(message_to_send);
         try
         {
             // dlog("peer_connection::send_queued_messages_task() calling message_oriented_connection::send_message() "
             //     "to send message of type ${type} for peer ${endpoint}",
             //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
-            _message_connection.send_message(message_to_send);
+            _message_connection.send_message(*message_to_send);
             // dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_message()
             // completed normally for peer ${endpoint}",
             //     ("endpoint", get_remote_endpoint()));
@@ -403,7 +417,14 @@ void peer_connection::send_message(const message& message_to_send, size_t messag
     // dlog("peer_connection::send_message() enqueueing message of type ${type} for peer ${endpoint}",
     //     ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
     std::unique_ptr<queued_message> message_to_enqueue(
-        new real_queued_message(message_to_send, message_send_time_field_offset));
+        new real_queued_message(std::make_shared<const message>(message_to_send), message_send_time_field_offset));
+    send_queueable_message(std::move(message_to_enqueue));
+}
+
+void peer_connection::send_message(std::shared_ptr<const message> message_to_send)
+{
+    VERIFY_CORRECT_THREAD();
+    std::unique_ptr<queued_message> message_to_enqueue(new real_queued_message(std::move(message_to_send)));
     send_queueable_message(std::move(message_to_enqueue));
 }
 
@@ -558,6 +579,12 @@ bool peer_connection::performing_firewall_check() const
     return firewall_check_state && firewall_check_state->requesting_peer != node_id_t();
 }
 
+bool peer_connection::supports_compact_blocks() const
+{
+    // compact_block_message and its transaction request/reply were added in protocol version 107
+    return core_protocol_version >= 107;
+}
+
 fc::optional<fc::ip::endpoint> peer_connection::get_endpoint_for_connecting() const
 {
     if (inbound_port)
@@ -192,6 +192,18 @@ size_t stcp_socket::writesome(const std::shared_ptr<const char>& buf, size_t len
     return writesome(buf.get() + offset, len);
 }
 
+void stcp_socket::write_in_place(char* buffer, size_t len)
+{
+    try
+    {
+        assert(len > 0 && (len % 16) == 0);
+        uint32_t ciphertext_len = _send_aes.encode(buffer, (uint32_t)len, buffer);
+        assert(ciphertext_len == len);
+        _sock.write(buffer, ciphertext_len);
+    }
+    FC_RETHROW_EXCEPTIONS(warn, "", ("len", len))
+}
+
 void stcp_socket::flush()
 {
     _sock.flush();
@@ -15,13 +15,17 @@
 #include <deip/eci_history/research_content_eci_history_object.hpp>
 #include <deip/eci_history/account_eci_history_object.hpp>
 #include <deip/eci_history/discipline_eci_history_object.hpp>
-#include <boost/date_time/gregorian/gregorian.hpp>
+#include <deip/eci_history/research_content_eci_stats_object.hpp>
+#include <deip/eci_history/research_eci_stats_object.hpp>
+#include <deip/eci_history/account_eci_stats_object.hpp>
+#include <deip/eci_history/discipline_eci_history_bucket_object.hpp>
+#include <deip/eci_history/research_eci_history_bucket_object.hpp>
+#include <deip/eci_history/account_eci_history_bucket_object.hpp>
 
 namespace deip {
 namespace eci_history {
 
 using deip::chain::expertise_contribution_type;
-using namespace boost::gregorian;
 
 namespace detail {
   
@@ -116,6 +120,18 @@ public:
             return result;
         }
 
+        if (is_aggregated(filter))
+        {
+            const research_content_object& research_content = *research_content_opt;
+            const auto* stats = db->find<research_content_eci_stats_object, by_research_content_and_discipline>(std::make_tuple(research_content.id, get_discipline_scope(filter)));
+            if (stats != nullptr)
+            {
+                result = make_eci_stats_api_obj<research_content_eci_stats_api_obj>(*stats, get_percentile_rank(*stats));
+            }
+
+            return result;
+        }
+
         const auto& stats = get_research_contents_eci_stats(filter);
         if (stats.find(research_content_external_id) != stats.end())
         {
@@ -134,6 +150,16 @@ public:
 
         std::map<external_id_type, research_content_eci_stats_api_obj> result;
 
+        if (is_aggregated(filter))
+        {
+            visit_eci_stats<research_content_eci_stats_object>(get_discipline_scope(filter),
+              [&](const research_content_eci_stats_object& stats, const percent& percentile_rank) {
+                  result.insert(std::make_pair(stats.research_content_external_id, make_eci_stats_api_obj<research_content_eci_stats_api_obj>(stats, percentile_rank)));
+              });
+
+            return result;
+        }
+
         const auto& research_contents = research_content_service.lookup_research_contents(research_content_id_type(0), DEIP_API_BULK_FETCH_LIMIT);
         std::vector<share_type> eci_scores;
 
@@ -144,6 +170,8 @@ public:
             const auto& itr_end = itr_pair.second;
 
             vector<research_content_eci_stats_api_obj> history;
+            // the same latest contributions the stats objects keep
+            std::vector<std::pair<int64_t, uint16_t>> contributions;
 
             while (itr != itr_end)
             {
@@ -164,7 +192,7 @@ public:
                     const auto& delta = get_modified_eci_delta(hist.delta, hist.assessment_criterias, filter.assessment_criteria_type);
                     stats.eci += delta;
                     stats.timestamp = hist.timestamp;
-                    stats.contributions.insert(std::make_pair(hist.contribution_id, hist.contribution_type));
+                    add_eci_stats_contribution(contributions, std::make_pair(hist.contribution_id, hist.contribution_type));
 
                     history.push_back(stats);
                 }
@@ -176,6 +204,7 @@ public:
             {
                 auto& stats = result[research_content.external_id];
                 eci_scores.push_back(stats.eci);
+                stats.contributions.insert(contributions.begin(), contributions.end());
 
                 const auto& last_growth = calculate_growth_rate(stats.previous_eci, stats.eci);
                 if (last_growth.valid())
@@ -285,6 +314,18 @@ public:
             return result;
         }
 
+        if (is_aggregated(filter))
+        {
+            const research_object& research = *research_opt;
+            const auto* stats = db->find<research_eci_stats_object, by_research_and_discipline>(std::make_tuple(research.id, get_discipline_scope(filter)));
+            if (stats != nullptr)
+            {
+                result = make_eci_stats_api_obj<research_eci_stats_api_obj>(*stats, get_percentile_rank(*stats));
+            }
+
+            return result;
+        }
+
         const auto& stats = get_researches_eci_stats(filter);
         if (stats.find(research_external_id) != stats.end())
         {
@@ -304,6 +345,16 @@ public:
 
         std::map<external_id_type, research_eci_stats_api_obj> result;
 
+        if (is_aggregated(filter))
+        {
+            visit_eci_stats<research_eci_stats_object>(get_discipline_scope(filter),
+              [&](const research_eci_stats_object& stats, const percent& percentile_rank) {
+                  result.insert(std::make_pair(stats.research_external_id, make_eci_stats_api_obj<research_eci_stats_api_obj>(stats, percentile_rank)));
+              });
+
+            return result;
+        }
+
         const auto& researches = research_service.lookup_researches(research_id_type(0), DEIP_API_BULK_FETCH_LIMIT);
         std::vector<share_type> eci_scores;
 
@@ -314,6 +365,8 @@ public:
             const auto& itr_end = itr_pair.second;
 
             vector<research_eci_stats_api_obj> history;
+            // the same latest contributions the stats objects keep
+            std::vector<std::pair<int64_t, uint16_t>> contributions;
 
             while (itr != itr_end)
             {
@@ -334,7 +387,7 @@ public:
                     const auto& delta = get_modified_eci_delta(hist.delta, hist.assessment_criterias, filter.assessment_criteria_type);
                     stats.eci += delta;
                     stats.timestamp = hist.timestamp;
-                    stats.contributions.insert(std::make_pair(hist.contribution_id, hist.contribution_type));
+                    add_eci_stats_contribution(contributions, std::make_pair(hist.contribution_id, hist.contribution_type));
 
                     history.push_back(stats);
                 }
@@ -346,6 +399,7 @@ public:
             {
                 auto& stats = result[research.external_id];
                 eci_scores.push_back(stats.eci);
+                stats.contributions.insert(contributions.begin(), contributions.end());
 
                 const auto& last_growth = calculate_growth_rate(stats.previous_eci, stats.eci);
                 if (last_growth.valid())
@@ -447,6 +501,17 @@ public:
             return result;
         }
 
+        if (is_aggregated(filter))
+        {
+            const auto* stats = db->find<account_eci_stats_object, by_account_and_discipline>(std::make_tuple(account, get_discipline_scope(filter)));
+            if (stats != nullptr)
+            {
+                result = make_eci_stats_api_obj<account_eci_stats_api_obj>(*stats, get_percentile_rank(*stats));
+            }
+
+            return result;
+        }
+
         const auto& stats = get_accounts_eci_stats(filter);
         if (stats.find(account) != stats.end())
         {
@@ -465,6 +530,16 @@ public:
 
         std::map<account_name_type, account_eci_stats_api_obj> result;
 
+        if (is_aggregated(filter))
+        {
+            visit_eci_stats<account_eci_stats_object>(get_discipline_scope(filter),
+              [&](const account_eci_stats_object& stats, const percent& percentile_rank) {
+                  result.insert(std::make_pair(stats.account, make_eci_stats_api_obj<account_eci_stats_api_obj>(stats, percentile_rank)));
+              });
+
+            return result;
+        }
+
         const auto& accounts = accounts_service.lookup_user_accounts(account_name_type("a"), DEIP_API_BULK_FETCH_LIMIT);
         std::vector<share_type> eci_scores;
 
@@ -475,6 +550,8 @@ public:
             const auto& itr_end = itr_pair.second;
 
             vector<account_eci_stats_api_obj> history;
+            // the same latest contributions the stats objects keep
+            std::vector<std::pair<int64_t, uint16_t>> contributions;
 
             while (itr != itr_end)
             {
@@ -497,7 +574,7 @@ public:
                     stats.eci += delta;
                     stats.timestamp = hist.timestamp;
                     stats.researches.insert(hist.researches.begin(), hist.researches.end());
-                    stats.contributions.insert(std::make_pair(hist.contribution_id, hist.contribution_type));
+                    add_eci_stats_contribution(contributions, std::make_pair(hist.contribution_id, hist.contribution_type));
 
                     history.push_back(stats);
                 }
@@ -509,6 +586,7 @@ public:
             {
                 auto& stats = result[acc.name];
                 eci_scores.push_back(stats.eci);
+                stats.contributions.insert(contributions.begin(), contributions.end());
 
                 const auto& last_growth = calculate_growth_rate(stats.previous_eci, stats.eci);
                 if (last_growth.valid())
@@ -596,100 +674,71 @@ public:
                                                                                                             const fc::optional<uint16_t> step_filter) const
     {
         const auto& db = _app.chain_database();
-        const auto& discipline_hist_idx = db->get_index<discipline_eci_history_index>().indices().get<by_discipline>();
+        const auto& discipline_hist_idx = db->get_index<discipline_eci_history_index>().indices().get<by_discipline_and_timestamp>();
+        const auto& discipline_bucket_idx = db->get_index<discipline_eci_history_bucket_index>().indices().get<by_discipline_and_period>();
         const auto& disciplines_service = db->obtain_service<chain::dbs_discipline>();
 
         std::map<external_id_type, std::vector<discipline_eci_stats_api_obj>> result;
 
-        std::multimap<discipline_id_type, date> selection;
-        eci_stat_period_step step = step_filter.valid() ? static_cast<eci_stat_period_step>(*step_filter) : eci_stat_period_step::unknown;
+        const eci_stat_period_step step = step_filter.valid() ? static_cast<eci_stat_period_step>(*step_filter) : eci_stat_period_step::unknown;
+        const fc::time_point_sec from = from_filter.valid() ? *from_filter : fc::time_point_sec::min();
+        const fc::time_point_sec to = to_filter.valid() ? *to_filter : fc::time_point_sec::maximum();
 
-        auto filter = [&](const discipline_eci_history_object& hist) -> bool {
-            if (from_filter.valid())
-            {
-                const fc::time_point_sec& from = *from_filter;
-                if (hist.timestamp < from)
-                {
-                    return false;
-                }
-            }
+        const auto& disciplines = disciplines_service.lookup_disciplines(discipline_id_type(1), DEIP_API_BULK_FETCH_LIMIT);
 
-            if (to_filter.valid())
+        for (const discipline_object& discipline : disciplines)
+        {
+            std::vector<discipline_eci_stats_api_obj> records;
+
+            auto push_record = [&](const discipline_eci_history_object& hist) {
+                std::map<uint16_t, assessment_criteria_value> assessment_criterias = extract_assessment_criterias(hist.assessment_criterias);
+                records.push_back(discipline_eci_stats_api_obj(
+                    discipline.external_id,
+                    fc::to_string(discipline.name),
+                    hist.eci,
+                    share_type(0),
+                    share_type(0),
+                    hist.total_eci,
+                    hist.percentage,
+                    {},
+                    {},
+                    assessment_criterias,
+                    hist.timestamp
+                ));
+            };
+
+            auto itr = discipline_hist_idx.lower_bound(std::make_tuple(discipline.id, from));
+            const auto itr_end = discipline_hist_idx.upper_bound(std::make_tuple(discipline.id, to));
+
+            if (step == eci_stat_period_step::unknown)
             {
-                const fc::time_point_sec& to = *to_filter;
-                if (hist.timestamp > to)
+                for (; itr != itr_end; ++itr)
                 {
-                    return false;
+                    push_record(*itr);
                 }
             }
-
-            if (step != eci_stat_period_step::unknown)
+            else if (itr != itr_end)
             {
-                const string& hist_timestamp = hist.timestamp.to_non_delimited_iso_string();
-                date hist_date = date_from_iso_string(string(hist_timestamp.substr(0, hist_timestamp.find("T"))));
-
-                auto entries_pair = selection.equal_range(hist.discipline_id);
-                if (entries_pair.first != entries_pair.second)
+                // The period 'from' falls into may have records before it, so its first record in range comes from
+                // the history. Every later period starts after 'from' and its first record is in the rollup
+                // any step other than a month selects days
+                const eci_stat_period_step period = step == eci_stat_period_step::month ? eci_stat_period_step::month : eci_stat_period_step::day;
+                const uint16_t period_step = static_cast<uint16_t>(period);
+                push_record(*itr);
+
+                const fc::time_point_sec first_period = get_eci_stat_period_start(itr->timestamp, period);
+                for (auto bucket_itr = discipline_bucket_idx.upper_bound(std::make_tuple(discipline.id, period_step, first_period));
+                     bucket_itr != discipline_bucket_idx.end() && bucket_itr->discipline_id == discipline.id && bucket_itr->step == period_step && bucket_itr->start <= to;
+                     ++bucket_itr)
                 {
-                    auto& last_entry = *(--entries_pair.second);
-                    date bound = step == eci_stat_period_step::day 
-                      ? last_entry.second
-                      : step == eci_stat_period_step::month
-                        ? last_entry.second.end_of_month()
-                        : last_entry.second;
-
-                    if (hist_date > bound)
+                    const auto& hist = db->get<discipline_eci_history_object>(bucket_itr->first_record);
+                    if (hist.timestamp > to)
                     {
-                        selection.insert(std::make_pair(hist.discipline_id, hist_date));
-                        return true;
-                    } 
-                    else
-                    {
-                       return false;
+                        break;
                     }
-                }
-                else
-                {
-                    selection.insert(std::make_pair(hist.discipline_id, hist_date));
-                    return true;
-                }
-            }
-
-            return true;
-        };
-
-        const auto& disciplines = disciplines_service.lookup_disciplines(discipline_id_type(1), DEIP_API_BULK_FETCH_LIMIT);
-
-        for (const discipline_object& discipline : disciplines)
-        {
-            std::vector<discipline_eci_stats_api_obj> records;
 
-            auto itr_pair = discipline_hist_idx.equal_range(discipline.id);
-            auto itr = itr_pair.first;
-            const auto itr_end = itr_pair.second;
-            while (itr != itr_end)
-            {
-                const discipline_eci_history_object& hist = *itr;
-
-                if (filter(hist))
-                {
-                    std::map<uint16_t, assessment_criteria_value> assessment_criterias = extract_assessment_criterias(hist.assessment_criterias);
-                    records.push_back(discipline_eci_stats_api_obj(
-                        discipline.external_id,
-                        fc::to_string(discipline.name),
-                        hist.eci,
-                        share_type(0),
-                        share_type(0),
-                        hist.total_eci,
-                        hist.percentage,
-                        {}, 
-                        {},
-                        assessment_criterias,
-                        hist.timestamp
-                    ));
+                    push_record(hist);
                 }
-
-                ++itr;
             }
 
             result.insert(std::make_pair(discipline.external_id, records));
@@ -698,6 +747,9 @@ public:
         for (auto& res : result)
         {
             auto& records = res.second;
+            const auto start_point_itr = std::find_if(records.begin(), records.end(),
+                [&](const discipline_eci_stats_api_obj& hist) { return hist.eci != share_type(0); });
+
             for (auto i = 0; i < records.size(); i++)
             {
                 if (i == 0) continue;
@@ -713,9 +765,6 @@ public:
                     current.last_growth_rate = *last_growth_rate;
                 }
 
-                const auto& start_point_itr = std::find_if(records.begin(), records.end(),
-                    [&](const discipline_eci_stats_api_obj& hist) { return hist.eci != share_type(0); });
-
                 if (start_point_itr != records.end() && std::distance(records.begin(), start_point_itr) < i)
                 {
                     const auto& start_point = *start_point_itr;
@@ -734,6 +783,71 @@ public:
     }
 
 
+    std::vector<research_eci_stats_api_obj> get_research_eci_stats_history(const external_id_type& research_external_id,
+                                                                           const fc::optional<fc::time_point_sec> from_filter,
+                                                                           const fc::optional<fc::time_point_sec> to_filter,
+                                                                           const fc::optional<uint16_t> step_filter) const
+    {
+        std::vector<research_eci_stats_api_obj> result;
+
+        const auto& db = _app.chain_database();
+        const auto& research_service = db->obtain_service<chain::dbs_research>();
+
+        const auto& research_opt = research_service.get_research_if_exists(research_external_id);
+        if (!research_opt.valid())
+        {
+            return result;
+        }
+
+        const research_object& research = *research_opt;
+
+        visit_eci_history_buckets<research_eci_history_bucket_object, by_research_and_period, research_eci_history_object, by_research_and_timestamp>(
+          research.id, from_filter, to_filter, step_filter,
+          [&](const research_eci_history_bucket_object& bucket) {
+              research_eci_stats_api_obj stats;
+              stats.research_external_id = research.external_id;
+              stats.eci = bucket.eci;
+              stats.previous_eci = bucket.opening_eci;
+              stats.last_growth_rate = calculate_growth_rate(bucket.opening_eci, bucket.eci);
+              stats.timestamp = bucket.timestamp;
+              result.push_back(stats);
+          });
+
+        set_starting_eci(result);
+        return result;
+    }
+
+    std::vector<account_eci_stats_api_obj> get_account_eci_stats_history(const account_name_type& account,
+                                                                         const fc::optional<fc::time_point_sec> from_filter,
+                                                                         const fc::optional<fc::time_point_sec> to_filter,
+                                                                         const fc::optional<uint16_t> step_filter) const
+    {
+        std::vector<account_eci_stats_api_obj> result;
+
+        const auto& db = _app.chain_database();
+        const auto& accounts_service = db->obtain_service<chain::dbs_account>();
+
+        if (!accounts_service.account_exists(account))
+        {
+            return result;
+        }
+
+        visit_eci_history_buckets<account_eci_history_bucket_object, by_account_and_period, account_eci_history_object, by_account_and_timestamp>(
+          account, from_filter, to_filter, step_filter,
+          [&](const account_eci_history_bucket_object& bucket) {
+              account_eci_stats_api_obj stats;
+              stats.account = account;
+              stats.eci = bucket.eci;
+              stats.previous_eci = bucket.opening_eci;
+              stats.last_growth_rate = calculate_growth_rate(bucket.opening_eci, bucket.eci);
+              stats.timestamp = bucket.timestamp;
+              result.push_back(stats);
+          });
+
+        set_starting_eci(result);
+        return result;
+    }
+
     std::map<external_id_type, discipline_eci_stats_api_obj> get_disciplines_eci_last_stats() const
     {
         const auto& db = _app.chain_database();
@@ -787,6 +901,139 @@ public:
     }
 
 private:
+    const bool is_aggregated(const eci_filter& filter) const
+    {
+        // The stats objects accumulate every record of an object, across all disciplines and per discipline.
+        // Any other filter has to go through the history
+        return !filter.from.valid() && !filter.to.valid() && !filter.contribution_type.valid() && !filter.assessment_criteria_type.valid();
+    }
+
+    const external_id_type get_discipline_scope(const eci_filter& filter) const
+    {
+        return filter.discipline.valid() ? *filter.discipline : external_id_type();
+    }
+
+    template <typename ApiObject, typename StatsObject>
+    const ApiObject make_eci_stats_api_obj(const StatsObject& stats, const percent& percentile_rank) const
+    {
+        return ApiObject(stats,
+                         percentile_rank,
+                         calculate_growth_rate(stats.starting_eci, stats.eci),
+                         calculate_growth_rate(stats.previous_eci, stats.eci));
+    }
+
+    /**
+     * Visits the stats of a discipline scope in eci order, so each run of equal scores gets its
+     * percentile rank from its position instead of searching all scores for it
+     */
+    template <typename StatsObject, typename Visitor>
+    void visit_eci_stats(const external_id_type& discipline_external_id, Visitor&& visit) const
+    {
+        const auto& db = _app.chain_database();
+        const auto& idx = db->get_index<typename chainbase::get_index_type<StatsObject>::type>().indices().template get<by_discipline_and_eci>();
+
+        const auto range = idx.equal_range(discipline_external_id);
+        const int64_t total = std::distance(range.first, range.second);
+        int64_t below = 0;
+
+        for (auto itr = range.first; itr != range.second;)
+        {
+            auto run_end = itr;
+            int64_t equal = 0;
+            while (run_end != range.second && run_end->eci == itr->eci)
+            {
+                ++run_end;
+                ++equal;
+            }
+
+            const percent percentile_rank = calculate_percentile_rank(below, equal, total);
+            for (; itr != run_end; ++itr)
+            {
+                visit(*itr, percentile_rank);
+            }
+
+            below += equal;
+        }
+    }
+
+    /**
+     * Visits the day or month periods of an object from the one 'from' falls into to the last one starting by 'to'.
+     * Day periods are used unless the step is a month. The period 'to' falls into is cut at 'to', its ECI is summed up
+     * from the history records of the period up to 'to'
+     */
+    template <typename BucketObject, typename ByObjectAndPeriod, typename HistoryObject, typename ByObjectAndTimestamp, typename Key, typename Visitor>
+    void visit_eci_history_buckets(const Key& key,
+                                   const fc::optional<fc::time_point_sec>& from_filter,
+                                   const fc::optional<fc::time_point_sec>& to_filter,
+                                   const fc::optional<uint16_t>& step_filter,
+                                   Visitor&& visit) const
+    {
+        const auto& db = _app.chain_database();
+        const auto& idx = db->get_index<typename chainbase::get_index_type<BucketObject>::type>().indices().template get<ByObjectAndPeriod>();
+
+        // any step other than a month selects days
+        const eci_stat_period_step step = step_filter.valid() && static_cast<eci_stat_period_step>(*step_filter) == eci_stat_period_step::month
+            ? eci_stat_period_step::month
+            : eci_stat_period_step::day;
+        const uint16_t period_step = static_cast<uint16_t>(step);
+        const fc::time_point_sec from = from_filter.valid() ? get_eci_stat_period_start(*from_filter, step) : fc::time_point_sec::min();
+        const fc::time_point_sec to = to_filter.valid() ? *to_filter : fc::time_point_sec::maximum();
+
+        uint32_t limit = DEIP_API_BULK_FETCH_LIMIT;
+        const auto itr_end = idx.upper_bound(std::make_tuple(key, period_step, to));
+        for (auto itr = idx.lower_bound(std::make_tuple(key, period_step, from)); limit-- && itr != itr_end; ++itr)
+        {
+            if (itr->timestamp <= to)
+            {
+                visit(*itr);
+                continue;
+            }
+
+            const auto& hist_idx = db->get_index<typename chainbase::get_index_type<HistoryObject>::type>().indices().template get<ByObjectAndTimestamp>();
+            BucketObject bucket = *itr;
+            bucket.eci = bucket.opening_eci;
+            bucket.timestamp = fc::time_point_sec::min();
+
+            const auto hist_itr_end = hist_idx.upper_bound(std::make_tuple(key, to));
+            for (auto hist_itr = hist_idx.lower_bound(std::make_tuple(key, itr->start)); hist_itr != hist_itr_end; ++hist_itr)
+            {
+                bucket.eci += hist_itr->delta;
+                bucket.timestamp = hist_itr->timestamp;
+            }
+
+            // all records of the period came after 'to'
+            if (bucket.timestamp != fc::time_point_sec::min())
+            {
+                visit(bucket);
+            }
+        }
+    }
+
+    template <typename StatsApiObject> void set_starting_eci(std::vector<StatsApiObject>& history) const
+    {
+        const auto start_point_itr = std::find_if(history.begin(), history.end(),
+            [&](const StatsApiObject& stats) { return stats.eci != share_type(0); });
+
+        for (auto itr = start_point_itr; itr != history.end(); ++itr)
+        {
+            itr->starting_eci = start_point_itr->eci;
+            itr->growth_rate = calculate_growth_rate(start_point_itr->eci, itr->eci);
+        }
+    }
+
+    template <typename StatsObject> const percent get_percentile_rank(const StatsObject& stats) const
+    {
+        const auto& db = _app.chain_database();
+        const auto& idx = db->get_index<typename chainbase::get_index_type<StatsObject>::type>().indices().template get<by_discipline_and_eci>();
+
+        const auto scope = idx.equal_range(stats.discipline_external_id);
+        const auto score = idx.equal_range(std::make_tuple(stats.discipline_external_id, stats.eci));
+
+        return calculate_percentile_rank(std::distance(scope.first, score.first),
+                                         std::distance(score.first, score.second),
+                                         std::distance(scope.first, scope.second));
+    }
+
     const share_type get_modified_eci_delta(const share_type& delta,
                                             const flat_map<uint16_t, assessment_criteria_value>& assessment_criterias,
                                             const fc::optional<uint16_t> assessment_criteria_opt) const
@@ -843,6 +1090,11 @@ private:
         const int R = std::count_if(eci_scores.begin(), eci_scores.end(),
             [&](const share_type& eci_score) { return eci_score == x_score; });
         const int Y = eci_scores.size();
+        return calculate_percentile_rank(M, R, Y);
+    }
+
+    const percent calculate_percentile_rank(const int64_t M, const int64_t R, const int64_t Y) const
+    {
         const share_type percentile_rank = share_type(std::round(((double(M) + (double(0.5) * double(R))) / double(Y)) * double(100) * DEIP_1_PERCENT));
         return percent(percentile_rank);
     }
@@ -1161,6 +1413,24 @@ std::map<external_id_type, std::vector<discipline_eci_stats_api_obj>> eci_histor
         });
 }
 
+std::vector<research_eci_stats_api_obj> eci_history_api::get_research_eci_stats_history(const external_id_type& research_external_id,
+                                                                                        const fc::optional<fc::time_point_sec> from_filter,
+                                                                                        const fc::optional<fc::time_point_sec> to_filter,
+                                                                                        const fc::optional<uint16_t> step_filter) const
+{
+    const auto db = _impl->_app.chain_database();
+    return db->with_read_lock([&]() { return _impl->get_research_eci_stats_history(research_external_id, from_filter, to_filter, step_filter); });
+}
+
+std::vector<account_eci_stats_api_obj> eci_history_api::get_account_eci_stats_history(const account_name_type& account,
+                                                                                      const fc::optional<fc::time_point_sec> from_filter,
+                                                                                      const fc::optional<fc::time_point_sec> to_filter,
+                                                                                      const fc::optional<uint16_t> step_filter) const
+{
+    const auto db = _impl->_app.chain_database();
+    return db->with_read_lock([&]() { return _impl->get_account_eci_stats_history(account, from_filter, to_filter, step_filter); });
+}
+
 std::map<external_id_type, discipline_eci_stats_api_obj> eci_history_api::get_disciplines_eci_last_stats() const
 {
     const auto db = _impl->_app.chain_database();
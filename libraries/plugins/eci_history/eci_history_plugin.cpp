@@ -2,6 +2,7 @@
 #include <deip/chain/database/database.hpp>
 #include <deip/chain/operation_notification.hpp>
 #include <deip/chain/services/dbs_research.hpp>
+#include <deip/chain/services/dbs_research_content.hpp>
 #include <deip/chain/services/dbs_review.hpp>
 #include <deip/chain/services/dbs_review_vote.hpp>
 #include <deip/chain/services/dbs_discipline.hpp>
@@ -13,11 +14,20 @@
 #include <deip/eci_history/research_content_eci_history_object.hpp>
 #include <deip/eci_history/account_eci_history_object.hpp>
 #include <deip/eci_history/discipline_eci_history_object.hpp>
+#include <deip/eci_history/research_eci_stats_object.hpp>
+#include <deip/eci_history/research_content_eci_stats_object.hpp>
+#include <deip/eci_history/account_eci_stats_object.hpp>
+#include <deip/eci_history/discipline_eci_history_bucket_object.hpp>
+#include <deip/eci_history/research_eci_history_bucket_object.hpp>
+#include <deip/eci_history/account_eci_history_bucket_object.hpp>
 
 #include <fc/smart_ref_impl.hpp>
 #include <fc/thread/thread.hpp>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/date_time/gregorian/gregorian.hpp>
+
+#include <algorithm>
 
 namespace deip {
 namespace eci_history {
@@ -25,6 +35,36 @@ namespace eci_history {
 using namespace deip::protocol;
 using namespace deip::chain;
 
+fc::time_point_sec get_eci_stat_period_start(const fc::time_point_sec& timestamp, const eci_stat_period_step& step)
+{
+    const uint32_t seconds_per_day = 60 * 60 * 24;
+    const uint32_t day_start = timestamp.sec_since_epoch() - timestamp.sec_since_epoch() % seconds_per_day;
+
+    if (step == eci_stat_period_step::month)
+    {
+        const boost::gregorian::date day = boost::gregorian::date(1970, 1, 1) + boost::gregorian::days(day_start / seconds_per_day);
+        return fc::time_point_sec(day_start - (day.day() - 1) * seconds_per_day);
+    }
+
+    return fc::time_point_sec(day_start);
+}
+
+void add_eci_stats_contribution(std::vector<std::pair<int64_t, uint16_t>>& contributions,
+                                const std::pair<int64_t, uint16_t>& contribution)
+{
+    if (std::find(contributions.begin(), contributions.end(), contribution) != contributions.end())
+    {
+        return;
+    }
+
+    if (contributions.size() >= eci_stats_max_contributions)
+    {
+        contributions.erase(contributions.begin());
+    }
+
+    contributions.push_back(contribution);
+}
+
 namespace detail {
 
 class eci_history_plugin_impl
@@ -47,9 +87,160 @@ public:
     void pre_operation(const operation_notification& op_obj);
     void post_operation(const operation_notification& op_obj);
 
+    void rebuild_eci_stats();
+
     eci_history_plugin& _self;
+    bool _rebuild_eci_stats = false;
 };
 
+/**
+ * Adds a history record to the stats of its object, once across all disciplines and once within the
+ * record discipline. Stats are keyed by the object key and the discipline external id, empty for all
+ */
+template <typename StatsObject, typename ByObjectAndDiscipline, typename Key, typename Initializer, typename Updater>
+const StatsObject& accumulate_eci_stats(chain::database& db,
+                          const Key& key,
+                          const external_id_type& discipline_external_id,
+                          const share_type& delta,
+                          const std::pair<int64_t, uint16_t>& contribution,
+                          const fc::time_point_sec& timestamp,
+                          Initializer&& init,
+                          Updater&& update)
+{
+    const StatsObject* total = nullptr;
+    for (const external_id_type& scope : { external_id_type(), discipline_external_id })
+    {
+        const StatsObject* stats = db.find<StatsObject, ByObjectAndDiscipline>(std::make_tuple(key, scope));
+        if (stats == nullptr)
+        {
+            stats = &db.create<StatsObject>([&](StatsObject& stats_o) {
+                init(stats_o);
+                stats_o.discipline_external_id = scope;
+            });
+        }
+
+        db.modify(*stats, [&](StatsObject& stats_o) {
+            stats_o.previous_eci = stats_o.eci;
+            stats_o.eci += delta;
+            if (stats_o.starting_eci == share_type(0))
+            {
+                stats_o.starting_eci = stats_o.eci;
+            }
+            stats_o.timestamp = timestamp;
+            add_eci_stats_contribution(stats_o.contributions, contribution);
+            update(stats_o);
+        });
+
+        if (total == nullptr)
+        {
+            total = stats;
+        }
+    }
+
+    return *total;
+}
+
+/**
+ * Rolls the ECI of an object across all disciplines up into its day and month periods
+ */
+template <typename BucketObject, typename ByObjectAndPeriod, typename Key, typename Initializer>
+void accumulate_eci_history_buckets(chain::database& db,
+                                    const Key& key,
+                                    const share_type& eci,
+                                    const share_type& delta,
+                                    const fc::time_point_sec& timestamp,
+                                    Initializer&& init)
+{
+    for (const eci_stat_period_step step : { eci_stat_period_step::day, eci_stat_period_step::month })
+    {
+        const fc::time_point_sec start = get_eci_stat_period_start(timestamp, step);
+        const BucketObject* bucket = db.find<BucketObject, ByObjectAndPeriod>(std::make_tuple(key, static_cast<uint16_t>(step), start));
+        if (bucket == nullptr)
+        {
+            bucket = &db.create<BucketObject>([&](BucketObject& bucket_o) {
+                init(bucket_o);
+                bucket_o.step = static_cast<uint16_t>(step);
+                bucket_o.start = start;
+                bucket_o.opening_eci = eci - delta;
+            });
+        }
+
+        db.modify(*bucket, [&](BucketObject& bucket_o) {
+            bucket_o.eci = eci;
+            bucket_o.timestamp = timestamp;
+        });
+    }
+}
+
+void accumulate_eci_stats(chain::database& db, const research_content_eci_history_object& hist)
+{
+    const auto& research_content_service = db.obtain_service<chain::dbs_research_content>();
+    const auto& research_content = research_content_service.get_research_content(hist.research_content_id);
+
+    accumulate_eci_stats<research_content_eci_stats_object, by_research_content_and_discipline>(
+        db, hist.research_content_id, hist.discipline_external_id, hist.delta,
+        std::make_pair(hist.contribution_id, hist.contribution_type), hist.timestamp,
+        [&](research_content_eci_stats_object& stats_o) {
+            stats_o.research_content_id = hist.research_content_id;
+            stats_o.research_content_external_id = research_content.external_id;
+        },
+        [](research_content_eci_stats_object&) {});
+}
+
+void accumulate_eci_stats(chain::database& db, const research_eci_history_object& hist)
+{
+    const auto& research_service = db.obtain_service<chain::dbs_research>();
+    const auto& research = research_service.get_research(hist.research_id);
+
+    const auto& stats = accumulate_eci_stats<research_eci_stats_object, by_research_and_discipline>(
+        db, hist.research_id, hist.discipline_external_id, hist.delta,
+        std::make_pair(hist.contribution_id, hist.contribution_type), hist.timestamp,
+        [&](research_eci_stats_object& stats_o) {
+            stats_o.research_id = hist.research_id;
+            stats_o.research_external_id = research.external_id;
+        },
+        [](research_eci_stats_object&) {});
+
+    accumulate_eci_history_buckets<research_eci_history_bucket_object, by_research_and_period>(
+        db, hist.research_id, stats.eci, hist.delta, hist.timestamp,
+        [&](research_eci_history_bucket_object& bucket_o) { bucket_o.research_id = hist.research_id; });
+}
+
+void accumulate_eci_stats(chain::database& db, const account_eci_history_object& hist)
+{
+    const auto& stats = accumulate_eci_stats<account_eci_stats_object, by_account_and_discipline>(
+        db, hist.account, hist.discipline_external_id, hist.delta,
+        std::make_pair(hist.contribution_id, hist.contribution_type), hist.timestamp,
+        [&](account_eci_stats_object& stats_o) {
+            stats_o.account = hist.account;
+            stats_o.first_discipline_external_id = hist.discipline_external_id;
+        },
+        [&](account_eci_stats_object& stats_o) {
+            stats_o.researches.insert(hist.researches.begin(), hist.researches.end());
+        });
+
+    accumulate_eci_history_buckets<account_eci_history_bucket_object, by_account_and_period>(
+        db, hist.account, stats.eci, hist.delta, hist.timestamp,
+        [&](account_eci_history_bucket_object& bucket_o) { bucket_o.account = hist.account; });
+}
+
+void accumulate_eci_history_buckets(chain::database& db, const discipline_eci_history_object& hist)
+{
+    for (const eci_stat_period_step step : { eci_stat_period_step::day, eci_stat_period_step::month })
+    {
+        const fc::time_point_sec start = get_eci_stat_period_start(hist.timestamp, step);
+        if (db.find<discipline_eci_history_bucket_object, by_discipline_and_period>(std::make_tuple(hist.discipline_id, static_cast<uint16_t>(step), start)) == nullptr)
+        {
+            db.create<discipline_eci_history_bucket_object>([&](discipline_eci_history_bucket_object& bucket_o) {
+                bucket_o.discipline_id = hist.discipline_id;
+                bucket_o.step = static_cast<uint16_t>(step);
+                bucket_o.start = start;
+                bucket_o.first_record = hist.id;
+            });
+        }
+    }
+}
+
 struct post_operation_visitor
 {
     eci_history_plugin& _plugin;
@@ -71,7 +262,7 @@ struct post_operation_visitor
 
         const auto& discipline = disciplines_service.get_discipline(op.discipline_id);
 
-        _plugin.database().create<research_content_eci_history_object>([&](research_content_eci_history_object& hist_o) {
+        const auto& hist = _plugin.database().create<research_content_eci_history_object>([&](research_content_eci_history_object& hist_o) {
             hist_o.research_content_id = op.research_content_id;
             hist_o.discipline_id = op.discipline_id;
             hist_o.discipline_external_id = discipline.external_id;
@@ -86,6 +277,8 @@ struct post_operation_visitor
                 hist_o.assessment_criterias.insert(std::make_pair(criteria.first, criteria.second));
             }
         });
+
+        accumulate_eci_stats(_plugin.database(), hist);
     }
 
     void operator()(const research_eci_history_operation& op) const
@@ -94,7 +287,7 @@ struct post_operation_visitor
 
         const auto& discipline = disciplines_service.get_discipline(op.discipline_id);
 
-        _plugin.database().create<research_eci_history_object>([&](research_eci_history_object& hist_o) {
+        const auto& hist = _plugin.database().create<research_eci_history_object>([&](research_eci_history_object& hist_o) {
             hist_o.research_id = op.research_id;
             hist_o.discipline_id = op.discipline_id;
             hist_o.discipline_external_id = discipline.external_id;
@@ -109,6 +302,8 @@ struct post_operation_visitor
                 hist_o.assessment_criterias.insert(std::make_pair(criteria.first, criteria.second));
             }
         });
+
+        accumulate_eci_stats(_plugin.database(), hist);
     }
 
     void operator()(const account_eci_history_operation& op) const
@@ -279,7 +474,7 @@ struct post_operation_visitor
         const auto& researches = research_service.get_researches_by_member(op.account);
         const auto& discipline = disciplines_service.get_discipline(op.discipline_id);
 
-        _plugin.database().create<account_eci_history_object>([&](account_eci_history_object& hist_o) {
+        const auto& hist = _plugin.database().create<account_eci_history_object>([&](account_eci_history_object& hist_o) {
             hist_o.account = op.account;
             hist_o.discipline_id = op.discipline_id;
             hist_o.discipline_external_id = discipline.external_id;
@@ -302,6 +497,8 @@ struct post_operation_visitor
                 hist_o.researches.insert(research.external_id);
             }
         });
+
+        accumulate_eci_stats(_plugin.database(), hist);
     }
 
     void operator()(const disciplines_eci_history_operation& op) const
@@ -357,6 +554,8 @@ struct post_operation_visitor
                 }
             });
 
+            accumulate_eci_history_buckets(_plugin.database(), hist);
+
             disciplines_stats.insert(std::make_pair(hist.id, total_eci));
             total_expertise += total_eci;
         }
@@ -388,6 +587,48 @@ void eci_history_plugin_impl::post_operation(const operation_notification& note)
     note.op.visit(post_operation_visitor(_self));
 }
 
+template <typename Index> void remove_objects(chain::database& db)
+{
+    const auto& idx = db.get_index<Index>().indices().template get<by_id>();
+    while (!idx.empty())
+    {
+        db.remove(*idx.begin());
+    }
+}
+
+template <typename HistoryIndex> void accumulate_eci_history(chain::database& db)
+{
+    for (const auto& hist : db.get_index<HistoryIndex>().indices().template get<by_id>())
+    {
+        accumulate_eci_stats(db, hist);
+    }
+}
+
+void accumulate_discipline_eci_history(chain::database& db)
+{
+    for (const auto& hist : db.get_index<discipline_eci_history_index>().indices().get<by_id>())
+    {
+        accumulate_eci_history_buckets(db, hist);
+    }
+}
+
+void eci_history_plugin_impl::rebuild_eci_stats()
+{
+    chain::database& db = database();
+
+    remove_objects<research_content_eci_stats_index>(db);
+    remove_objects<research_eci_stats_index>(db);
+    remove_objects<account_eci_stats_index>(db);
+    remove_objects<discipline_eci_history_bucket_index>(db);
+    remove_objects<research_eci_history_bucket_index>(db);
+    remove_objects<account_eci_history_bucket_index>(db);
+
+    accumulate_eci_history<research_content_eci_history_index>(db);
+    accumulate_eci_history<research_eci_history_index>(db);
+    accumulate_eci_history<account_eci_history_index>(db);
+    accumulate_discipline_eci_history(db);
+}
+
 } // end namespace detail
 
 eci_history_plugin::eci_history_plugin(application* app)
@@ -408,7 +649,11 @@ std::string eci_history_plugin::plugin_name() const
 
 void eci_history_plugin::plugin_set_program_options(boost::program_options::options_description& cli, boost::program_options::options_description& cfg)
 {
-
+    cli.add_options()(
+        "eci-history-rebuild-stats", boost::program_options::bool_switch()->default_value(false),
+        "Rebuild the ECI stats aggregates and the day and month ECI history rollups from the stored ECI history on "
+        "startup. Needed once when the plugin is enabled on a node that already has ECI history without them");
+    cfg.add(cli);
 }
 
 void eci_history_plugin::plugin_initialize(const boost::program_options::variables_map& options)
@@ -421,6 +666,14 @@ void eci_history_plugin::plugin_initialize(const boost::program_options::variabl
     db.add_plugin_index<research_eci_history_index>();
     db.add_plugin_index<research_content_eci_history_index>();
     db.add_plugin_index<discipline_eci_history_index>();
+    db.add_plugin_index<research_content_eci_stats_index>();
+    db.add_plugin_index<research_eci_stats_index>();
+    db.add_plugin_index<account_eci_stats_index>();
+    db.add_plugin_index<discipline_eci_history_bucket_index>();
+    db.add_plugin_index<research_eci_history_bucket_index>();
+    db.add_plugin_index<account_eci_history_bucket_index>();
+
+    my->_rebuild_eci_stats = options.count("eci-history-rebuild-stats") && options["eci-history-rebuild-stats"].as<bool>();
 
     db.pre_apply_operation.connect([&](const operation_notification& note) { my->pre_operation(note); });
     db.post_apply_operation.connect([&](const operation_notification& note) { my->post_operation(note); });
@@ -429,6 +682,13 @@ void eci_history_plugin::plugin_initialize(const boost::program_options::variabl
 void eci_history_plugin::plugin_startup()
 {
     ilog("eci_history plugin: plugin_startup() begin");
+
+    if (my->_rebuild_eci_stats)
+    {
+        ilog("Rebuilding ECI stats and rollups from ECI history");
+        database().with_write_lock([&]() { my->rebuild_eci_stats(); });
+    }
+
     app().register_api_factory<eci_history_api>("eci_history_api");
     ilog("eci_history plugin: plugin_startup() end");
 }
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <boost/multi_index/composite_key.hpp>
+
+using namespace deip::chain;
+using namespace std;
+
+namespace deip {
+namespace eci_history {
+
+using chainbase::allocator;
+
+/**
+ * ECI of an account across all disciplines within a day or a calendar month, rolled up as the
+ * account_eci_history_object records are created
+ */
+class account_eci_history_bucket_object : public object<account_eci_history_bucket_object_type, account_eci_history_bucket_object>
+{
+public:
+    template <typename Constructor, typename Allocator>
+    account_eci_history_bucket_object(Constructor&& c, allocator<Allocator> a)
+    {
+        c(*this);
+    }
+
+    account_eci_history_bucket_object()
+    {
+    }
+
+    account_eci_history_bucket_id_type id;
+
+    account_name_type account;
+    uint16_t step; // eci_stat_period_step
+    fc::time_point_sec start;
+
+    share_type opening_eci; // eci before the first record of the period
+    share_type eci; // eci after the last record of the period
+
+    fc::time_point_sec timestamp; // of the last record of the period
+};
+
+struct by_account_and_period;
+
+typedef chainbase::shared_multi_index_container<account_eci_history_bucket_object,
+  indexed_by<
+    ordered_unique<
+      tag<by_id>,
+         member<
+          account_eci_history_bucket_object,
+          account_eci_history_bucket_id_type,
+          &account_eci_history_bucket_object::id
+        >
+    >,
+    ordered_unique<
+      tag<by_account_and_period>,
+        composite_key<account_eci_history_bucket_object,
+          member<
+            account_eci_history_bucket_object,
+            account_name_type,
+            &account_eci_history_bucket_object::account
+          >,
+          member<
+            account_eci_history_bucket_object,
+            uint16_t,
+            &account_eci_history_bucket_object::step
+          >,
+          member<
+            account_eci_history_bucket_object,
+            fc::time_point_sec,
+            &account_eci_history_bucket_object::start
+          >
+        >
+    >>
+    >
+    account_eci_history_bucket_index;
+
+} // namespace eci_history
+} // namespace deip
+
+FC_REFLECT(deip::eci_history::account_eci_history_bucket_object,
+  (id)
+  (account)
+  (step)
+  (start)
+  (opening_eci)
+  (eci)
+  (timestamp)
+)
+
+CHAINBASE_SET_INDEX_TYPE(deip::eci_history::account_eci_history_bucket_object, deip::eci_history::account_eci_history_bucket_index)
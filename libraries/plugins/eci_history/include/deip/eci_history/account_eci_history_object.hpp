@@ -47,6 +47,7 @@ public:
 struct by_account;
 struct by_account_and_discipline;
 struct by_account_and_cursor;
+struct by_account_and_timestamp;
 
 typedef chainbase::shared_multi_index_container<account_eci_history_object,
   indexed_by<
@@ -95,6 +96,26 @@ typedef chainbase::shared_multi_index_container<account_eci_history_object,
             &account_eci_history_object::id
           >
         >
+    >,
+    ordered_non_unique<
+      tag<by_account_and_timestamp>,
+        composite_key<account_eci_history_object,
+          member<
+            account_eci_history_object,
+            account_name_type,
+            &account_eci_history_object::account
+          >,
+          member<
+            account_eci_history_object,
+            fc::time_point_sec,
+            &account_eci_history_object::timestamp
+          >,
+          member<
+            account_eci_history_object,
+            account_eci_history_id_type,
+            &account_eci_history_object::id
+          >
+        >
     >>
     // , allocator<account_eci_history_object>
     >
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <boost/multi_index/composite_key.hpp>
+
+using namespace deip::chain;
+using namespace std;
+
+namespace deip {
+namespace eci_history {
+
+using chainbase::allocator;
+
+/**
+ * Running totals of account_eci_history_object records for one account, either across all
+ * disciplines (empty discipline_external_id) or within one discipline. Updated with every new history record
+ * so the stats API doesn't have to replay the history.
+ */
+class account_eci_stats_object : public object<account_eci_stats_object_type, account_eci_stats_object>
+{
+public:
+    template <typename Constructor, typename Allocator>
+    account_eci_stats_object(Constructor&& c, allocator<Allocator> a)
+    {
+        c(*this);
+    }
+
+    account_eci_stats_object()
+    {
+    }
+
+    account_eci_stats_id_type id;
+
+    account_name_type account;
+    external_id_type discipline_external_id;
+    external_id_type first_discipline_external_id; // discipline of the first accumulated record
+
+    share_type eci;
+    share_type previous_eci;
+    share_type starting_eci; // first non-zero eci, 0 until there is one
+
+    std::vector<std::pair<int64_t, uint16_t>> contributions; // the latest distinct ones, oldest first
+    flat_set<external_id_type> researches;
+
+    fc::time_point_sec timestamp;
+};
+
+struct by_account_and_discipline;
+struct by_discipline_and_eci;
+
+typedef chainbase::shared_multi_index_container<account_eci_stats_object,
+  indexed_by<
+    ordered_unique<
+      tag<by_id>,
+         member<
+          account_eci_stats_object,
+          account_eci_stats_id_type,
+          &account_eci_stats_object::id
+        >
+    >,
+    ordered_unique<
+      tag<by_account_and_discipline>,
+        composite_key<account_eci_stats_object,
+          member<
+            account_eci_stats_object,
+            account_name_type,
+            &account_eci_stats_object::account
+          >,
+          member<
+            account_eci_stats_object,
+            external_id_type,
+            &account_eci_stats_object::discipline_external_id
+          >
+        >
+    >,
+    ordered_non_unique<
+      tag<by_discipline_and_eci>,
+        composite_key<account_eci_stats_object,
+          member<
+            account_eci_stats_object,
+            external_id_type,
+            &account_eci_stats_object::discipline_external_id
+          >,
+          member<
+            account_eci_stats_object,
+            share_type,
+            &account_eci_stats_object::eci
+          >
+        >
+    >>
+    >
+    account_eci_stats_index;
+
+} // namespace eci_history
+} // namespace deip
+
+FC_REFLECT(deip::eci_history::account_eci_stats_object,
+  (id)
+  (account)
+  (discipline_external_id)
+  (first_discipline_external_id)
+  (eci)
+  (previous_eci)
+  (starting_eci)
+  (contributions)
+  (researches)
+  (timestamp)
+)
+
+CHAINBASE_SET_INDEX_TYPE(deip::eci_history::account_eci_stats_object, deip::eci_history::account_eci_stats_index)
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <boost/multi_index/composite_key.hpp>
+
+using namespace deip::chain;
+using namespace std;
+
+namespace deip {
+namespace eci_history {
+
+using chainbase::allocator;
+
+/**
+ * The first discipline_eci_history_object record of a discipline within a day or a calendar month,
+ * so stats history with a step reads one record per period instead of filtering all of them
+ */
+class discipline_eci_history_bucket_object : public object<discipline_eci_history_bucket_object_type, discipline_eci_history_bucket_object>
+{
+public:
+    template <typename Constructor, typename Allocator>
+    discipline_eci_history_bucket_object(Constructor&& c, allocator<Allocator> a)
+    {
+        c(*this);
+    }
+
+    discipline_eci_history_bucket_object()
+    {
+    }
+
+    discipline_eci_history_bucket_id_type id;
+
+    discipline_id_type discipline_id;
+    uint16_t step; // eci_stat_period_step
+    fc::time_point_sec start;
+
+    discipline_eci_history_id_type first_record;
+};
+
+struct by_discipline_and_period;
+
+typedef chainbase::shared_multi_index_container<discipline_eci_history_bucket_object,
+  indexed_by<
+    ordered_unique<
+      tag<by_id>,
+         member<
+          discipline_eci_history_bucket_object,
+          discipline_eci_history_bucket_id_type,
+          &discipline_eci_history_bucket_object::id
+        >
+    >,
+    ordered_unique<
+      tag<by_discipline_and_period>,
+        composite_key<discipline_eci_history_bucket_object,
+          member<
+            discipline_eci_history_bucket_object,
+            discipline_id_type,
+            &discipline_eci_history_bucket_object::discipline_id
+          >,
+          member<
+            discipline_eci_history_bucket_object,
+            uint16_t,
+            &discipline_eci_history_bucket_object::step
+          >,
+          member<
+            discipline_eci_history_bucket_object,
+            fc::time_point_sec,
+            &discipline_eci_history_bucket_object::start
+          >
+        >
+    >>
+    >
+    discipline_eci_history_bucket_index;
+
+} // namespace eci_history
+} // namespace deip
+
+FC_REFLECT(deip::eci_history::discipline_eci_history_bucket_object,
+  (id)
+  (discipline_id)
+  (step)
+  (start)
+  (first_record)
+)
+
+CHAINBASE_SET_INDEX_TYPE(deip::eci_history::discipline_eci_history_bucket_object, deip::eci_history::discipline_eci_history_bucket_index)
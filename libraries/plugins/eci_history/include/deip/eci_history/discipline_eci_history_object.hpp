@@ -38,6 +38,7 @@ public:
 };
 
 struct by_discipline;
+struct by_discipline_and_timestamp;
 
 
 typedef chainbase::shared_multi_index_container<discipline_eci_history_object,
@@ -57,6 +58,26 @@ typedef chainbase::shared_multi_index_container<discipline_eci_history_object,
           discipline_id_type,
           &discipline_eci_history_object::discipline_id
         >
+    >,
+    ordered_non_unique<
+      tag<by_discipline_and_timestamp>,
+        composite_key<discipline_eci_history_object,
+          member<
+            discipline_eci_history_object,
+            discipline_id_type,
+            &discipline_eci_history_object::discipline_id
+          >,
+          member<
+            discipline_eci_history_object,
+            fc::time_point_sec,
+            &discipline_eci_history_object::timestamp
+          >,
+          member<
+            discipline_eci_history_object,
+            discipline_eci_history_id_type,
+            &discipline_eci_history_object::id
+          >
+        >
     >
     // , allocator<discipline_eci_history_object>
     >>
@@ -20,16 +20,6 @@ namespace detail {
 class eci_history_api_impl;
 }
 
-enum class eci_stat_period_step : uint16_t
-{
-    unknown = 0,
-    day = 1,
-    month = 2,
-
-    FIRST = day,
-    LAST = month
-};
-
 struct eci_filter
 {
     eci_filter()
@@ -155,6 +145,16 @@ public:
                                                                                                             const fc::optional<fc::time_point_sec> to_filter,
                                                                                                             const fc::optional<uint16_t> step_filter) const;
 
+    std::vector<research_eci_stats_api_obj> get_research_eci_stats_history(const external_id_type& research_external_id,
+                                                                           const fc::optional<fc::time_point_sec> from_filter,
+                                                                           const fc::optional<fc::time_point_sec> to_filter,
+                                                                           const fc::optional<uint16_t> step_filter) const;
+
+    std::vector<account_eci_stats_api_obj> get_account_eci_stats_history(const account_name_type& account,
+                                                                         const fc::optional<fc::time_point_sec> from_filter,
+                                                                         const fc::optional<fc::time_point_sec> to_filter,
+                                                                         const fc::optional<uint16_t> step_filter) const;
+
     std::map<external_id_type, discipline_eci_stats_api_obj> get_disciplines_eci_last_stats() const;
 
 private:
@@ -164,13 +164,6 @@ private:
 } // namespace deip
 
 
-FC_REFLECT_ENUM(deip::eci_history::eci_stat_period_step,
-  (unknown)
-  (day)
-  (month)
-)
-
-
 FC_API(deip::eci_history::eci_history_api,
 
   (get_research_content_eci_history)
@@ -185,5 +178,7 @@ FC_API(deip::eci_history::eci_history_api,
   (get_discipline_eci_history)
   (get_disciplines_eci_stats_history)
   (get_disciplines_eci_last_stats)
+  (get_research_eci_stats_history)
+  (get_account_eci_stats_history)
 
 )
\ No newline at end of file
@@ -5,6 +5,9 @@
 #include <deip/eci_history/research_eci_history_object.hpp>
 #include <deip/eci_history/research_content_eci_history_object.hpp>
 #include <deip/eci_history/discipline_eci_history_object.hpp>
+#include <deip/eci_history/research_content_eci_stats_object.hpp>
+#include <deip/eci_history/research_eci_stats_object.hpp>
+#include <deip/eci_history/account_eci_stats_object.hpp>
 
 namespace deip {
 namespace eci_history {
@@ -99,6 +102,22 @@ struct research_content_eci_stats_api_obj
         contributions.insert(contributions_list.begin(), contributions_list.end());
     }
 
+    research_content_eci_stats_api_obj(const research_content_eci_stats_object& stats,
+                                       const percent& percentile_rank,
+                                       const fc::optional<percent>& growth_rate,
+                                       const fc::optional<percent>& last_growth_rate)
+        : research_content_external_id(stats.research_content_external_id)
+        , eci(stats.eci)
+        , previous_eci(stats.previous_eci)
+        , starting_eci(stats.starting_eci)
+        , percentile_rank(percentile_rank)
+        , growth_rate(growth_rate)
+        , last_growth_rate(last_growth_rate)
+        , contributions(stats.contributions.begin(), stats.contributions.end())
+        , timestamp(stats.timestamp)
+    {
+    }
+
     external_id_type research_content_external_id;
     share_type eci;
     share_type previous_eci;
@@ -205,6 +224,22 @@ struct research_eci_stats_api_obj
         contributions.insert(contributions_list.begin(), contributions_list.end());
     }
 
+    research_eci_stats_api_obj(const research_eci_stats_object& stats,
+                               const percent& percentile_rank,
+                               const fc::optional<percent>& growth_rate,
+                               const fc::optional<percent>& last_growth_rate)
+        : research_external_id(stats.research_external_id)
+        , eci(stats.eci)
+        , previous_eci(stats.previous_eci)
+        , starting_eci(stats.starting_eci)
+        , percentile_rank(percentile_rank)
+        , growth_rate(growth_rate)
+        , last_growth_rate(last_growth_rate)
+        , contributions(stats.contributions.begin(), stats.contributions.end())
+        , timestamp(stats.timestamp)
+    {
+    }
+
     external_id_type research_external_id;
     share_type eci;
     share_type previous_eci;
@@ -329,6 +364,24 @@ struct account_eci_stats_api_obj
         researches.insert(researches_list.begin(), researches_list.end());
     }
 
+    account_eci_stats_api_obj(const account_eci_stats_object& stats,
+                              const percent& percentile_rank,
+                              const fc::optional<percent>& growth_rate,
+                              const fc::optional<percent>& last_growth_rate)
+        : discipline_external_id(stats.first_discipline_external_id)
+        , account(stats.account)
+        , eci(stats.eci)
+        , previous_eci(stats.previous_eci)
+        , starting_eci(stats.starting_eci)
+        , percentile_rank(percentile_rank)
+        , growth_rate(growth_rate)
+        , last_growth_rate(last_growth_rate)
+        , contributions(stats.contributions.begin(), stats.contributions.end())
+        , researches(stats.researches.begin(), stats.researches.end())
+        , timestamp(stats.timestamp)
+    {
+    }
+
     external_id_type discipline_external_id;
     account_name_type account;
     share_type eci;
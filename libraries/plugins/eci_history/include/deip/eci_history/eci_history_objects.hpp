@@ -15,18 +15,56 @@ enum eci_history_plugin_object_type
     research_content_eci_history_object_type = (ECI_HISTORY_SPACE_ID << 8),
     research_eci_history_object_type,
     account_eci_history_object_type,
-    discipline_eci_history_object_type
+    discipline_eci_history_object_type,
+    research_content_eci_stats_object_type,
+    research_eci_stats_object_type,
+    account_eci_stats_object_type,
+    discipline_eci_history_bucket_object_type,
+    research_eci_history_bucket_object_type,
+    account_eci_history_bucket_object_type
 };
 
+enum class eci_stat_period_step : uint16_t
+{
+    unknown = 0,
+    day = 1,
+    month = 2,
+
+    FIRST = day,
+    LAST = month
+};
+
+/// Start of the UTC day or calendar month the timestamp falls into, any step other than a month selects the day
+fc::time_point_sec get_eci_stat_period_start(const fc::time_point_sec& timestamp, const eci_stat_period_step& step);
+
+/// Most contributions the ECI stats of an object list, the oldest are dropped first
+const size_t eci_stats_max_contributions = 100;
+
+/// Adds a contribution to the latest contributions of ECI stats, unless it is listed already
+void add_eci_stats_contribution(std::vector<std::pair<int64_t, uint16_t>>& contributions,
+                                const std::pair<int64_t, uint16_t>& contribution);
+
 class account_eci_history_object;
 class research_content_eci_history_object;
 class research_eci_history_object;
 class discipline_eci_history_object;
+class research_content_eci_stats_object;
+class research_eci_stats_object;
+class account_eci_stats_object;
+class discipline_eci_history_bucket_object;
+class research_eci_history_bucket_object;
+class account_eci_history_bucket_object;
 
 typedef oid<research_content_eci_history_object> research_content_eci_history_id_type;
 typedef oid<research_eci_history_object> research_eci_history_id_type;
 typedef oid<account_eci_history_object> account_eci_history_id_type;
 typedef oid<discipline_eci_history_object> discipline_eci_history_id_type;
+typedef oid<research_content_eci_stats_object> research_content_eci_stats_id_type;
+typedef oid<research_eci_stats_object> research_eci_stats_id_type;
+typedef oid<account_eci_stats_object> account_eci_stats_id_type;
+typedef oid<discipline_eci_history_bucket_object> discipline_eci_history_bucket_id_type;
+typedef oid<research_eci_history_bucket_object> research_eci_history_bucket_id_type;
+typedef oid<account_eci_history_bucket_object> account_eci_history_bucket_id_type;
 
 }
 }
@@ -36,4 +74,16 @@ FC_REFLECT_ENUM(deip::eci_history::eci_history_plugin_object_type,
   (research_eci_history_object_type)
   (account_eci_history_object_type)
   (discipline_eci_history_object_type)
+  (research_content_eci_stats_object_type)
+  (research_eci_stats_object_type)
+  (account_eci_stats_object_type)
+  (discipline_eci_history_bucket_object_type)
+  (research_eci_history_bucket_object_type)
+  (account_eci_history_bucket_object_type)
+)
+
+FC_REFLECT_ENUM(deip::eci_history::eci_stat_period_step,
+  (unknown)
+  (day)
+  (month)
 )
\ No newline at end of file
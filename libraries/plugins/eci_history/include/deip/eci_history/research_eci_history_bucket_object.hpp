@@ -0,0 +1,90 @@
+#pragma once
+
+#include <boost/multi_index/composite_key.hpp>
+
+using namespace deip::chain;
+using namespace std;
+
+namespace deip {
+namespace eci_history {
+
+using chainbase::allocator;
+
+/**
+ * ECI of a research across all disciplines within a day or a calendar month, rolled up as the
+ * research_eci_history_object records are created
+ */
+class research_eci_history_bucket_object : public object<research_eci_history_bucket_object_type, research_eci_history_bucket_object>
+{
+public:
+    template <typename Constructor, typename Allocator>
+    research_eci_history_bucket_object(Constructor&& c, allocator<Allocator> a)
+    {
+        c(*this);
+    }
+
+    research_eci_history_bucket_object()
+    {
+    }
+
+    research_eci_history_bucket_id_type id;
+
+    research_id_type research_id;
+    uint16_t step; // eci_stat_period_step
+    fc::time_point_sec start;
+
+    share_type opening_eci; // eci before the first record of the period
+    share_type eci; // eci after the last record of the period
+
+    fc::time_point_sec timestamp; // of the last record of the period
+};
+
+struct by_research_and_period;
+
+typedef chainbase::shared_multi_index_container<research_eci_history_bucket_object,
+  indexed_by<
+    ordered_unique<
+      tag<by_id>,
+         member<
+          research_eci_history_bucket_object,
+          research_eci_history_bucket_id_type,
+          &research_eci_history_bucket_object::id
+        >
+    >,
+    ordered_unique<
+      tag<by_research_and_period>,
+        composite_key<research_eci_history_bucket_object,
+          member<
+            research_eci_history_bucket_object,
+            research_id_type,
+            &research_eci_history_bucket_object::research_id
+          >,
+          member<
+            research_eci_history_bucket_object,
+            uint16_t,
+            &research_eci_history_bucket_object::step
+          >,
+          member<
+            research_eci_history_bucket_object,
+            fc::time_point_sec,
+            &research_eci_history_bucket_object::start
+          >
+        >
+    >>
+    >
+    research_eci_history_bucket_index;
+
+} // namespace eci_history
+} // namespace deip
+
+FC_REFLECT(deip::eci_history::research_eci_history_bucket_object,
+  (id)
+  (research_id)
+  (step)
+  (start)
+  (opening_eci)
+  (eci)
+  (timestamp)
+)
+
+CHAINBASE_SET_INDEX_TYPE(deip::eci_history::research_eci_history_bucket_object, deip::eci_history::research_eci_history_bucket_index)
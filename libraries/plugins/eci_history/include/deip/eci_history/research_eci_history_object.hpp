@@ -42,6 +42,7 @@ public:
 struct by_research_id;
 struct by_research_and_discipline;
 struct by_research_and_cursor;
+struct by_research_and_timestamp;
 
 typedef chainbase::shared_multi_index_container<research_eci_history_object,
   indexed_by<
@@ -90,6 +91,26 @@ typedef chainbase::shared_multi_index_container<research_eci_history_object,
             &research_eci_history_object::id
           >
         >
+    >,
+    ordered_non_unique<
+      tag<by_research_and_timestamp>,
+        composite_key<research_eci_history_object,
+          member<
+            research_eci_history_object,
+            research_id_type,
+            &research_eci_history_object::research_id
+          >,
+          member<
+            research_eci_history_object,
+            fc::time_point_sec,
+            &research_eci_history_object::timestamp
+          >,
+          member<
+            research_eci_history_object,
+            research_eci_history_id_type,
+            &research_eci_history_object::id
+          >
+        >
     >>
     >
     research_eci_history_index;
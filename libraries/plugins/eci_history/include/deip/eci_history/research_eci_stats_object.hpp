@@ -0,0 +1,107 @@
+#pragma once
+
+#include <boost/multi_index/composite_key.hpp>
+
+using namespace deip::chain;
+using namespace std;
+
+namespace deip {
+namespace eci_history {
+
+using chainbase::allocator;
+
+/**
+ * Running totals of research_eci_history_object records for one research, either across all
+ * disciplines (empty discipline_external_id) or within one discipline. Updated with every new history record
+ * so the stats API doesn't have to replay the history.
+ */
+class research_eci_stats_object : public object<research_eci_stats_object_type, research_eci_stats_object>
+{
+public:
+    template <typename Constructor, typename Allocator>
+    research_eci_stats_object(Constructor&& c, allocator<Allocator> a)
+    {
+        c(*this);
+    }
+
+    research_eci_stats_object()
+    {
+    }
+
+    research_eci_stats_id_type id;
+
+    research_id_type research_id;
+    external_id_type research_external_id;
+    external_id_type discipline_external_id;
+
+    share_type eci;
+    share_type previous_eci;
+    share_type starting_eci; // first non-zero eci, 0 until there is one
+
+    std::vector<std::pair<int64_t, uint16_t>> contributions; // the latest distinct ones, oldest first
+
+    fc::time_point_sec timestamp;
+};
+
+struct by_research_and_discipline;
+struct by_discipline_and_eci;
+
+typedef chainbase::shared_multi_index_container<research_eci_stats_object,
+  indexed_by<
+    ordered_unique<
+      tag<by_id>,
+         member<
+          research_eci_stats_object,
+          research_eci_stats_id_type,
+          &research_eci_stats_object::id
+        >
+    >,
+    ordered_unique<
+      tag<by_research_and_discipline>,
+        composite_key<research_eci_stats_object,
+          member<
+            research_eci_stats_object,
+            research_id_type,
+            &research_eci_stats_object::research_id
+          >,
+          member<
+            research_eci_stats_object,
+            external_id_type,
+            &research_eci_stats_object::discipline_external_id
+          >
+        >
+    >,
+    ordered_non_unique<
+      tag<by_discipline_and_eci>,
+        composite_key<research_eci_stats_object,
+          member<
+            research_eci_stats_object,
+            external_id_type,
+            &research_eci_stats_object::discipline_external_id
+          >,
+          member<
+            research_eci_stats_object,
+            share_type,
+            &research_eci_stats_object::eci
+          >
+        >
+    >>
+    >
+    research_eci_stats_index;
+
+} // namespace eci_history
+} // namespace deip
+
+FC_REFLECT(deip::eci_history::research_eci_stats_object,
+  (id)
+  (research_id)
+  (research_external_id)
+  (discipline_external_id)
+  (eci)
+  (previous_eci)
+  (starting_eci)
+  (contributions)
+  (timestamp)
+)
+
+CHAINBASE_SET_INDEX_TYPE(deip::eci_history::research_eci_stats_object, deip::eci_history::research_eci_stats_index)
@@ -43,17 +43,17 @@ get_raw_block_result raw_block_api::get_raw_block(get_raw_block_args args)
     get_raw_block_result result;
     std::shared_ptr<deip::chain::database> db = my->app.chain_database();
 
-    fc::optional<chain::signed_block> block = db->fetch_block_by_number(args.block_num);
+    fc::optional<chain::serialized_block> block = db->fetch_serialized_block_by_number(args.block_num);
     if (!block.valid())
     {
         return result;
     }
-    std::vector<char> serialized_block = fc::raw::pack(*block);
-    result.raw_block
-        = fc::base64_encode(std::string(&serialized_block[0], &serialized_block[0] + serialized_block.size()));
-    result.block_id = block->id();
-    result.previous = block->previous;
-    result.timestamp = block->timestamp;
+    result.raw_block = fc::base64_encode((const unsigned char*)block->data.get(), block->size);
+
+    const chain::signed_block_header header = chain::database::unpack_block_header(*block);
+    result.block_id = header.id();
+    result.previous = header.previous;
+    result.timestamp = header.timestamp;
     return result;
 }
 
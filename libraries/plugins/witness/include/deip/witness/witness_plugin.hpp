@@ -51,7 +51,8 @@ enum block_production_condition_enum
     lag = 6,
     consecutive = 7,
     wait_for_genesis = 8,
-    exception_producing_block = 9
+    exception_producing_block = 9,
+    shared_memory_full = 10
 };
 }
 
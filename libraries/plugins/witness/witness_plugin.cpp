@@ -540,6 +540,9 @@ block_production_condition::block_production_condition_enum witness_plugin::bloc
         break;
     case block_production_condition::wait_for_genesis:
         break;
+    case block_production_condition::shared_memory_full:
+        elog("Not producing block because the shared memory file is full and could not be grown");
+        break;
     }
 
     schedule_production_loop();
@@ -562,6 +565,9 @@ witness_plugin::maybe_produce_block(fc::mutable_variant_object& capture)
             return block_production_condition::not_synced;
     }
 
+    if (db.is_shared_memory_exhausted())
+        return block_production_condition::shared_memory_full;
+
     // is anyone scheduled to produce now or one second in the future?
     uint32_t slot = db.get_slot_at_time(now);
     if (slot == 0)
@@ -75,6 +75,15 @@ struct signed_transaction : public transaction
                           const authority_getter& get_owner,
                           const override_authority_getter& get_active_overrides) const;
 
+    /**
+     * Same as above, but checks authorities against signature keys that were already
+     * recovered (see get_signature_keys), so no public key recovery happens here.
+     */
+    void verify_authority(const flat_set<public_key_type>& signature_keys,
+                          const authority_getter& get_active,
+                          const authority_getter& get_owner,
+                          const override_authority_getter& get_active_overrides) const;
+
     set<public_key_type> minimize_required_signatures(const chain_id_type& chain_id,
                                                       const flat_set<public_key_type>& available_keys,
                                                       const authority_getter& get_active,
@@ -83,7 +92,11 @@ struct signed_transaction : public transaction
 
     flat_set<public_key_type> get_signature_keys(const chain_id_type& chain_id) const;
 
+    optional<public_key_type> get_tenant_signature_key(const chain_id_type& chain_id) const;
+
     void verify_tenant_authority(const chain_id_type& chain_id, const authority_getter& get_tenant) const;
+    void verify_tenant_authority(const optional<public_key_type>& tenant_signature_key,
+                                 const authority_getter& get_tenant) const;
 
     vector<signature_type> signatures;
     optional<tenant_affirmation_type> tenant_signature;
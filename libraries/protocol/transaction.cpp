@@ -282,14 +282,27 @@ flat_set<public_key_type> signed_transaction::get_signature_keys(const chain_id_
     FC_CAPTURE_AND_RETHROW()
 }
 
+optional<public_key_type> signed_transaction::get_tenant_signature_key(const chain_id_type& chain_id) const
+{
+    optional<public_key_type> result;
+    if (tenant_signature.valid())
+        result = public_key_type(fc::ecc::public_key(tenant_signature->signature, sig_digest(chain_id)));
+    return result;
+}
+
 void signed_transaction::verify_tenant_authority(const chain_id_type& chain_id, const authority_getter& get_tenant) const
 {
     DEIP_ASSERT(tenant_signature.valid(), tx_missing_tenant_auth, "Missing Tenant Authority"); // required for now
+    verify_tenant_authority(get_tenant_signature_key(chain_id), get_tenant);
+}
+
+void signed_transaction::verify_tenant_authority(const optional<public_key_type>& tenant_signature_key,
+                                                 const authority_getter& get_tenant) const
+{
+    DEIP_ASSERT(tenant_signature.valid() && tenant_signature_key.valid(), tx_missing_tenant_auth, "Missing Tenant Authority"); // required for now
     const auto& val = *tenant_signature;
-    auto d = sig_digest(chain_id);
-    const public_key_type pub = fc::ecc::public_key(val.signature, d);
     const auto& auth = get_tenant(val.tenant);
-    DEIP_ASSERT(auth.key_auths.find(pub) != auth.key_auths.end(), tx_missing_tenant_auth, "Missing Tenant Authority ${id}", ("id", val.tenant));
+    DEIP_ASSERT(auth.key_auths.find(*tenant_signature_key) != auth.key_auths.end(), tx_missing_tenant_auth, "Missing Tenant Authority ${id}", ("id", val.tenant));
 }
 
 set<public_key_type> signed_transaction::get_required_signatures(const chain_id_type& chain_id,
@@ -374,6 +387,24 @@ void signed_transaction::verify_authority(const chain_id_type& chain_id,
     FC_CAPTURE_AND_RETHROW((*this))
 }
 
+void signed_transaction::verify_authority(const flat_set<public_key_type>& signature_keys,
+                                          const authority_getter& get_active,
+                                          const authority_getter& get_owner,
+                                          const override_authority_getter& get_active_overrides) const
+{
+    try
+    {
+        deip::protocol::verify_authority(
+            operations, 
+            signature_keys, 
+            get_active, 
+            get_owner,
+            get_active_overrides
+        );
+    }
+    FC_CAPTURE_AND_RETHROW((*this))
+}
+
 
 }
 } // deip::protocol
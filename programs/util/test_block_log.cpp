@@ -2,10 +2,91 @@
 #include <deip/protocol/block.hpp>
 #include <fc/io/raw.hpp>
 
+#include <functional>
+#include <iostream>
+#include <string>
+
+/**
+ * Writes a log of `block_count` blocks carrying `trx_per_block` transfers each and compares
+ * index reconstruction by unpacking every block with the back pointer walk.
+ *
+ * Usage: test_block_log --benchmark [block_count] [trx_per_block] [threads]
+ */
+void benchmark_construct_index(uint32_t block_count, uint32_t trx_per_block, uint32_t threads)
+{
+    fc::temp_directory temp_dir(".");
+    const fc::path log_file = temp_dir.path() / "benchmark_log";
+
+    {
+        deip::chain::block_log log;
+        log.open(log_file);
+
+        deip::protocol::transfer_operation op;
+        op.from = "alice";
+        op.to = "bob";
+        op.amount = deip::protocol::asset(1000);
+        op.memo = std::string(64, 'm');
+
+        deip::protocol::signed_transaction trx;
+        trx.operations.push_back(op);
+        trx.signatures.push_back(deip::protocol::signature_type());
+
+        deip::protocol::block_id_type previous;
+        for (uint32_t i = 0; i < block_count; ++i)
+        {
+            deip::protocol::signed_block b;
+            b.previous = previous;
+            b.witness = "initdelegate";
+            b.transactions.assign(trx_per_block, trx);
+            log.append(b);
+            previous = b.id();
+        }
+        log.flush();
+    }
+
+    std::vector<uint64_t> expected;
+    std::vector<std::pair<std::string, fc::microseconds>> results;
+
+    auto run = [&](const std::string& name, std::function<void(deip::chain::block_log&)> construct) {
+        deip::chain::block_log log;
+        log.open(log_file);
+
+        const auto start = fc::time_point::now();
+        construct(log);
+        results.emplace_back(name, fc::time_point::now() - start);
+
+        std::vector<uint64_t> positions;
+        for (uint32_t num = 1; num <= block_count; ++num)
+            positions.push_back(log.get_block_pos(num));
+        if (expected.empty())
+            expected = positions;
+        FC_ASSERT(positions == expected, "${name} produced a different index", ("name", name));
+    };
+
+    run("unpacking", [](deip::chain::block_log& log) { log.construct_index_by_unpacking(); });
+    run("back pointers", [threads](deip::chain::block_log& log) { log.construct_index(threads); });
+
+    const double log_mib = fc::file_size(log_file) / double(1024 * 1024);
+    std::cout << "block_log with " << block_count << " blocks, " << log_mib << " MiB\n";
+    for (const auto& r : results)
+    {
+        const double seconds = std::max<int64_t>(r.second.count(), 1) / 1000000.0;
+        std::cout << r.first << ": " << seconds << " sec, " << uint64_t(block_count / seconds) << " blocks/sec, "
+                  << log_mib / seconds << " MiB/sec\n";
+    }
+}
+
 int main(int argc, char** argv, char** envp)
 {
     try
     {
+        if (argc > 1 && std::string(argv[1]) == "--benchmark")
+        {
+            benchmark_construct_index(argc > 2 ? std::stoul(argv[2]) : 100000, argc > 3 ? std::stoul(argv[3]) : 10,
+                                      argc > 4 ? std::stoul(argv[4]) : 0);
+            return 0;
+        }
+
         // deip::chain::database db;
         deip::chain::block_log log;
 
@@ -50,6 +131,10 @@ int main(int argc, char** argv, char** envp)
         auto r3 = log.read_block(r2.second);
         idump((r3));
     }
+    catch (const fc::exception& e)
+    {
+        edump((e.to_detail_string()));
+    }
     catch (const std::exception& e)
     {
         edump((std::string(e.what())));
@@ -0,0 +1,168 @@
+#include <chainbase/chainbase.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <utility>
+
+using namespace boost::multi_index;
+
+/**
+ * Micro-benchmark of chainbase undo sessions with the pattern block application has: a session per
+ * block holding squashed transaction sessions, touching a few of many indexes, with old revisions
+ * committed as blocks become irreversible.
+ *
+ * Usage: test_undo_session [sessions] [writes_per_session]
+ */
+
+template <uint16_t TypeNumber> struct bench_object : public chainbase::object<TypeNumber, bench_object<TypeNumber>>
+{
+    template <typename Constructor, typename Allocator> bench_object(Constructor&& c, Allocator&&)
+    {
+        c(*this);
+    }
+
+    typename chainbase::object<TypeNumber, bench_object<TypeNumber>>::id_type id;
+    int64_t balance = 0;
+    int64_t counter = 0;
+};
+
+template <uint16_t TypeNumber>
+using bench_index = multi_index_container<
+    bench_object<TypeNumber>,
+    indexed_by<ordered_unique<member<bench_object<TypeNumber>,
+                                     typename bench_object<TypeNumber>::id_type,
+                                     &bench_object<TypeNumber>::id>>,
+               ordered_non_unique<member<bench_object<TypeNumber>, int64_t, &bench_object<TypeNumber>::balance>>>,
+    chainbase::allocator<bench_object<TypeNumber>>>;
+
+namespace chainbase {
+template <uint16_t TypeNumber> struct get_index_type<bench_object<TypeNumber>>
+{
+    typedef bench_index<TypeNumber> type;
+};
+}
+
+class bench_database : public chainbase::database
+{
+};
+
+static const uint32_t objects_per_index = 10000;
+static const uint32_t reversible_revisions = 21;
+
+template <uint16_t... TypeNumbers> struct bench_indexes;
+
+template <> struct bench_indexes<>
+{
+    static void add(bench_database&)
+    {
+    }
+};
+
+template <uint16_t TypeNumber, uint16_t... Rest> struct bench_indexes<TypeNumber, Rest...>
+{
+    static void add(bench_database& db)
+    {
+        db.add_index<bench_index<TypeNumber>>();
+        for (uint32_t i = 0; i < objects_per_index; ++i)
+            db.create<bench_object<TypeNumber>>([&](bench_object<TypeNumber>& o) { o.balance = i; });
+        bench_indexes<Rest...>::add(db);
+    }
+};
+
+/** modifies `count` objects of one index and creates and removes one more, as a transfer would */
+template <uint16_t TypeNumber> void write_objects(bench_database& db, uint32_t first, uint32_t count)
+{
+    typedef bench_object<TypeNumber> object_type;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const auto& o = db.get<object_type>(typename object_type::id_type((first + i) % objects_per_index));
+        db.modify(o, [](object_type& v) {
+            ++v.balance;
+            ++v.counter;
+        });
+    }
+    const auto& created = db.create<object_type>([](object_type& v) { v.balance = -1; });
+    db.remove(created);
+}
+
+template <typename Action> double measure(const std::string& name, uint32_t sessions, Action&& action)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < sessions; ++i)
+        action(i);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    const double seconds = std::max(elapsed.count(), 1e-9);
+    std::cout << name << ": " << uint64_t(sessions / seconds) << " sessions/sec, " << seconds * 1e6 / sessions
+              << " usec/session\n";
+    return seconds;
+}
+
+int main(int argc, char** argv)
+{
+    const uint32_t sessions = argc > 1 ? std::stoul(argv[1]) : 100000;
+    const uint32_t writes = argc > 2 ? std::stoul(argv[2]) : 10;
+
+    const chainbase::bfs::path temp = chainbase::bfs::unique_path();
+    try
+    {
+        bench_database db;
+        db.open(temp, chainbase::database::read_write, 1024ull * 1024 * 1024);
+        bench_indexes<1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20>::add(db);
+
+        std::cout << "20 indexes, " << objects_per_index << " objects each, " << writes
+                  << " writes per session\n";
+
+        auto commit_irreversible = [&]() {
+            if (db.revision() > reversible_revisions)
+                db.commit(db.revision() - reversible_revisions);
+        };
+
+        measure("empty block sessions", sessions, [&](uint32_t) {
+            db.start_undo_session(true).push();
+            commit_irreversible();
+        });
+
+        measure("block sessions", sessions, [&](uint32_t i) {
+            auto block = db.start_undo_session(true);
+            write_objects<1>(db, i * writes, writes);
+            write_objects<2>(db, i, 1);
+            block.push();
+            commit_irreversible();
+        });
+
+        measure("block sessions with squashed transactions", sessions, [&](uint32_t i) {
+            auto block = db.start_undo_session(true);
+            for (uint32_t t = 0; t < writes; ++t)
+            {
+                auto trx = db.start_undo_session(true);
+                write_objects<1>(db, i * writes + t, 1);
+                write_objects<3>(db, i + t, 1);
+                trx.squash();
+            }
+            block.push();
+            commit_irreversible();
+        });
+
+        measure("undone sessions", sessions, [&](uint32_t i) {
+            auto session = db.start_undo_session(true);
+            write_objects<4>(db, i * writes, writes);
+            session.undo();
+        });
+
+        db.undo_all();
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << "\n";
+        chainbase::bfs::remove_all(temp);
+        return 1;
+    }
+    chainbase::bfs::remove_all(temp);
+    return 0;
+}
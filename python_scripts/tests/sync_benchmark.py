@@ -0,0 +1,137 @@
+"""
+This test module will only run on a POSIX system. Windows support *may* be added at some point in the future.
+
+Measures how fast an empty deipd syncs over p2p from several seed nodes on the loopback interface.
+Run it once with --seeds 1 and once with more seeds to see what downloading from multiple peers buys.
+"""
+# Global imports
+import json, os, sys
+
+from argparse import ArgumentParser
+from pathlib import Path
+from shutil import copy2, copytree
+from signal import SIGINT, SIGTERM
+from subprocess import Popen
+from tempfile import TemporaryDirectory
+from time import sleep
+from time import time
+
+# local imports
+from deipapi.deipnoderpc import DeipNodeRPC
+
+P2P_BASE_PORT = 2101
+RPC_BASE_PORT = 8101
+
+def main( ):
+   if( os.name != "posix" ):
+      print( "This script only works on POSIX systems" )
+      return
+
+   parser = ArgumentParser( description='Start several deipd seed nodes on an existing chain and time how long an ' + \
+                              'empty node on the same host takes to sync from them' )
+   parser.add_argument( '--deipd', '-s', type=str, required=True, help='The location of a deipd binary' )
+   parser.add_argument( '--data-dir', '-d', type=str, required=True, help='The location of an existing data directory. ' + \
+                        'Every seed node replays a copy of its blocks. The directory will not be changed.' )
+   parser.add_argument( '--seeds', '-n', type=int, required=False, default=4, help='The number of seed nodes. Default: 4' )
+
+   args = parser.parse_args()
+
+   deipd = Path( args.deipd )
+   if( not deipd.exists() or not deipd.resolve().is_file() ):
+      print( 'Error: deipd does not exist or is not a file.' )
+      return
+   deipd = deipd.resolve()
+
+   data_dir = Path( args.data_dir )
+   if( not data_dir.exists() or not data_dir.resolve().is_dir() ):
+      print( 'Error: data_dir does not exist or is not a directory' )
+      return
+   data_dir = data_dir.resolve()
+
+   temp_dirs = list()
+   processes = list()
+   devnull = open( os.devnull, 'w' )
+
+   try:
+      seed_endpoints = [ '127.0.0.1:' + str( P2P_BASE_PORT + i ) for i in range( args.seeds ) ]
+
+      print( 'Replaying the chain on ' + str( args.seeds ) + ' seed node(s)' )
+      for i in range( args.seeds ):
+         temp_dir = TemporaryDirectory()
+         temp_dirs.append( temp_dir )
+         copy_blockchain( data_dir, Path( temp_dir.name ) )
+         others = [ endpoint for endpoint in seed_endpoints if endpoint != seed_endpoints[ i ] ]
+         processes.append( start_node( deipd, Path( temp_dir.name ), P2P_BASE_PORT + i, RPC_BASE_PORT + i, others, \
+                                       [ '--replay-blockchain' ], devnull ) )
+
+      seed_rpc = wait_for_rpc( RPC_BASE_PORT )
+      head_block_number = get_head_block_number( seed_rpc )
+      for i in range( 1, args.seeds ):
+         wait_for_rpc( RPC_BASE_PORT + i )
+      print( 'Seed nodes are at block ' + str( head_block_number ) )
+
+      sync_dir = TemporaryDirectory()
+      temp_dirs.append( sync_dir )
+      sync_rpc_port = RPC_BASE_PORT + args.seeds
+      print( 'Syncing an empty node from the seed node(s)' )
+      start_time = time()
+      processes.append( start_node( deipd, Path( sync_dir.name ), P2P_BASE_PORT + args.seeds, sync_rpc_port, \
+                                    seed_endpoints, [], devnull ) )
+      sync_rpc = wait_for_rpc( sync_rpc_port )
+
+      while( get_head_block_number( sync_rpc ) < head_block_number ):
+         sleep( 0.5 )
+
+      elapsed = time() - start_time
+      print( 'Synced ' + str( head_block_number ) + ' blocks from ' + str( args.seeds ) + ' seed node(s) in ' + \
+             '%.1f' % elapsed + 's (' + '%.0f' % ( head_block_number / elapsed ) + ' blocks/s)' )
+
+   finally:
+      for process in processes:
+         stop_node( process )
+      for temp_dir in temp_dirs:
+         temp_dir.cleanup()
+      devnull.close()
+
+def copy_blockchain( data_dir, temp_dir ):
+   for child in data_dir.iterdir():
+      if( child.is_dir() ):
+         copytree( str( child ), str( temp_dir / child.name ) )
+
+   db_version = data_dir / 'db_version'
+   if( db_version.exists() and not db_version.is_dir() ):
+      copy2( str( db_version ), str( temp_dir / 'db_version' ) )
+
+def start_node( deipd, temp_dir, p2p_port, rpc_port, seed_nodes, args, output ):
+   config = temp_dir / 'config.ini'
+   config.write_text( "p2p-endpoint = 127.0.0.1:" + str( p2p_port ) + "\n" \
+                      + "rpc-endpoint = 127.0.0.1:" + str( rpc_port ) + "\n" \
+                      + "".join( "seed-node = " + seed_node + "\n" for seed_node in seed_nodes ) \
+                      + "public-api = database_api login_api\n" )
+
+   command = [ str( deipd ), '--data-dir=' + str( temp_dir ) ]
+   command.extend( args )
+   return Popen( command, stdout=output, stderr=output )
+
+def stop_node( process ):
+   process.poll()
+   if( process.returncode is None ):
+      process.send_signal( SIGINT )
+      sleep( 7 )
+      process.poll()
+      if( process.returncode is None ):
+         process.send_signal( SIGTERM )
+
+def wait_for_rpc( rpc_port ):
+   # a replaying node doesn't open its rpc endpoint until the replay is done
+   while( True ):
+      try:
+         return DeipNodeRPC( 'ws://127.0.0.1:' + str( rpc_port ), '', '' )
+      except Exception:
+         sleep( 1 )
+
+def get_head_block_number( rpc ):
+   return rpc.rpcexec( json.loads( '{"jsonrpc": "2.0", "method": "call", "params": [0,"get_dynamic_global_properties",[]], "id": 1}' ) )[ "head_block_number" ]
+
+if __name__ == "__main__":
+   main()
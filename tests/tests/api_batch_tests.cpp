@@ -0,0 +1,193 @@
+#include <boost/test/unit_test.hpp>
+
+#include <deip/app/api.hpp>
+#include <deip/app/database_api.hpp>
+
+#include <fc/network/http/websocket.hpp>
+#include <fc/rpc/websocket_api.hpp>
+
+#include "database_fixture.hpp"
+
+using namespace deip::app;
+
+namespace {
+api_batch_call make_call(const std::string& api, const std::string& method, fc::variants params = {})
+{
+    api_batch_call call;
+    call.api = api;
+    call.method = method;
+    call.params = std::move(params);
+    return call;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(api_batch_tests)
+
+BOOST_AUTO_TEST_CASE(accepts_read_only_calls)
+{
+    const std::vector<api_batch_call> calls
+        = { make_call("database_api", "get_dynamic_global_properties"),
+            make_call("database_api", "get_accounts", { fc::variant(std::vector<std::string>{ "alice" }) }),
+            make_call("blockchain_history_api", "get_ops_history", { fc::variant(0), fc::variant(10) }) };
+
+    BOOST_CHECK_NO_THROW(validate_api_batch(calls, 10));
+}
+
+BOOST_AUTO_TEST_CASE(rejects_reads_mixed_with_a_write)
+{
+    for (const std::string& api : { "debug_node_api", "raw_block_api", "network_broadcast_api", "login_api" })
+    {
+        const std::vector<api_batch_call> calls
+            = { make_call("database_api", "get_dynamic_global_properties"), make_call(api, "any_method"),
+                make_call("database_api", "get_block", { fc::variant(1) }) };
+
+        BOOST_CHECK_THROW(validate_api_batch(calls, 10), fc::assert_exception);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(rejects_unknown_apis)
+{
+    BOOST_CHECK_THROW(validate_api_batch({ make_call("tag_api", "get_tags") }, 10), fc::assert_exception);
+}
+
+BOOST_AUTO_TEST_CASE(rejects_batches_over_the_limit)
+{
+    const std::vector<api_batch_call> calls(3, make_call("database_api", "get_dynamic_global_properties"));
+
+    BOOST_CHECK_NO_THROW(validate_api_batch(calls, 3));
+    BOOST_CHECK_THROW(validate_api_batch(calls, 2), fc::assert_exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#ifdef IS_TEST_NET
+namespace {
+/// connection of a session that never talks to a client, the batch calls are made directly
+class null_websocket_connection : public fc::http::websocket_connection
+{
+public:
+    void send_message(const std::string&) override
+    {
+    }
+};
+
+class api_batch_fixture : public deip::chain::clean_database_fixture
+{
+public:
+    api_batch_fixture()
+        : session(std::make_shared<api_session_data>())
+    {
+        app.register_api_factory<database_api>("database_api");
+
+        session->wsc = std::make_shared<fc::rpc::websocket_api_connection>(connection);
+        fc::api_ptr api = app.create_api_by_name(api_context(app, "database_api", session));
+        session->api_map["database_api"] = api;
+        api->register_api(*session->wsc);
+
+        login = std::make_shared<login_api>(api_context(app, "login_api", session));
+    }
+
+    uint64_t read_locks() const
+    {
+        return db.get_lock_stats().read.locks;
+    }
+
+    null_websocket_connection connection;
+    std::shared_ptr<api_session_data> session;
+    std::shared_ptr<login_api> login;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(api_batch_call_tests, api_batch_fixture)
+
+BOOST_AUTO_TEST_CASE(returns_results_in_call_order)
+{
+    generate_block();
+
+    const auto results = login->call_batch(
+        { make_call("database_api", "get_accounts", { fc::variant(std::set<std::string>{ "initdelegate" }) }),
+          make_call("database_api", "get_dynamic_global_properties"), make_call("database_api", "get_config") });
+
+    BOOST_REQUIRE_EQUAL(results.size(), 3u);
+    for (const api_batch_result& result : results)
+    {
+        BOOST_CHECK(result.result.valid());
+        BOOST_CHECK(!result.error.valid());
+    }
+
+    const auto accounts = results[0].result->as<std::vector<fc::optional<account_api_obj>>>();
+    BOOST_REQUIRE_EQUAL(accounts.size(), 1u);
+    BOOST_REQUIRE(accounts[0].valid());
+    BOOST_CHECK(accounts[0]->name == "initdelegate");
+
+    BOOST_CHECK_EQUAL(results[1].result->get_object()["head_block_number"].as<uint32_t>(), db.head_block_num());
+    BOOST_CHECK(results[2].result->get_object().contains("DEIP_BLOCK_INTERVAL"));
+}
+
+BOOST_AUTO_TEST_CASE(keeps_going_after_a_failing_call)
+{
+    const auto results = login->call_batch({ make_call("database_api", "no_such_method"),
+                                             make_call("eci_history_api", "get_eci_history"),
+                                             make_call("database_api", "get_dynamic_global_properties") });
+
+    BOOST_REQUIRE_EQUAL(results.size(), 3u);
+
+    BOOST_CHECK(results[0].error.valid());
+    BOOST_CHECK(!results[0].result.valid());
+
+    // allowed in a batch, but not registered for this session
+    BOOST_REQUIRE(results[1].error.valid());
+    BOOST_CHECK(results[1].error->find("not available") != std::string::npos);
+
+    BOOST_CHECK(!results[2].error.valid());
+    BOOST_CHECK(results[2].result.valid());
+}
+
+BOOST_AUTO_TEST_CASE(reports_durations_only_with_timing)
+{
+    const std::vector<api_batch_call> calls
+        = { make_call("database_api", "get_config"), make_call("database_api", "no_such_method") };
+
+    for (const api_batch_result& result : login->call_batch(calls))
+        BOOST_CHECK(!result.duration_us.valid());
+
+    app.set_api_batch_options(100, true);
+    for (const api_batch_result& result : login->call_batch(calls))
+    {
+        BOOST_REQUIRE(result.duration_us.valid());
+        BOOST_CHECK_GE(*result.duration_us, 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(takes_the_read_lock_once)
+{
+    const std::vector<api_batch_call> calls(5, make_call("database_api", "get_config"));
+
+    // a single call locks by itself
+    const uint64_t before_single = read_locks();
+    login->call_batch({ calls.front() });
+    BOOST_CHECK_EQUAL(read_locks() - before_single, 1u);
+
+    // the calls of a batch run nested in its read lock and don't take it again
+    const uint64_t before_batch = read_locks();
+    const auto results = login->call_batch(calls);
+    BOOST_CHECK_EQUAL(read_locks() - before_batch, 1u);
+    BOOST_CHECK_EQUAL(results.size(), calls.size());
+
+    // and the lock is released after the batch, the next read takes it again
+    const uint64_t before_read = read_locks();
+    db.with_read_lock([&]() { return db.head_block_num(); });
+    BOOST_CHECK_EQUAL(read_locks() - before_read, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(checks_the_batch_limit)
+{
+    app.set_api_batch_options(2, false);
+
+    const std::vector<api_batch_call> calls(3, make_call("database_api", "get_config"));
+    BOOST_CHECK_THROW(login->call_batch(calls), fc::assert_exception);
+    BOOST_CHECK_EQUAL(login->call_batch(std::vector<api_batch_call>(2, calls.front())).size(), 2u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+#endif
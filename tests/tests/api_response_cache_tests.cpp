@@ -0,0 +1,100 @@
+#include <boost/test/unit_test.hpp>
+
+#include <deip/app/api_response_cache.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace deip::app;
+
+BOOST_AUTO_TEST_SUITE(api_response_cache_tests)
+
+BOOST_AUTO_TEST_CASE(hits_only_the_same_state)
+{
+    api_response_cache cache(1024 * 1024);
+    uint32_t computed = 0;
+    auto compute = [&]() { return std::string("response ") + std::to_string(++computed); };
+
+    BOOST_CHECK_EQUAL(cache.get_or_compute<std::string>(1, "get", { fc::variant("a") }, compute), "response 1");
+    BOOST_CHECK_EQUAL(cache.get_or_compute<std::string>(1, "get", { fc::variant("a") }, compute), "response 1");
+    BOOST_CHECK_EQUAL(cache.get_or_compute<std::string>(1, "get", { fc::variant("b") }, compute), "response 2");
+    BOOST_CHECK_EQUAL(cache.get_or_compute<std::string>(2, "get", { fc::variant("a") }, compute), "response 3");
+    BOOST_CHECK_EQUAL(cache.get_or_compute<std::string>(2, "get", { fc::variant("a") }, compute), "response 3");
+
+    auto stats = cache.get_stats();
+    BOOST_CHECK_EQUAL(stats.hits, 2u);
+    BOOST_CHECK_EQUAL(stats.misses, 3u);
+    BOOST_CHECK_EQUAL(stats.entries, 2u);
+    BOOST_CHECK_EQUAL(stats.methods["get"].hits, 2u);
+
+    cache.clear();
+    BOOST_CHECK_EQUAL(cache.get_or_compute<std::string>(2, "get", { fc::variant("a") }, compute), "response 4");
+    stats = cache.get_stats();
+    BOOST_CHECK_EQUAL(stats.invalidations, 2u);
+    BOOST_CHECK_EQUAL(stats.entries, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(failed_responses_are_not_cached)
+{
+    api_response_cache cache(1024 * 1024);
+    BOOST_CHECK_THROW(cache.get_or_compute<uint64_t>(1, "get", {}, []() -> uint64_t { FC_ASSERT(false); }),
+                      fc::assert_exception);
+    BOOST_CHECK_EQUAL(cache.get_or_compute<uint64_t>(1, "get", {}, []() { return uint64_t(7); }), 7u);
+}
+
+BOOST_AUTO_TEST_CASE(evicts_least_recently_used)
+{
+    // a packed uint64_t takes 8 bytes
+    api_response_cache cache(16);
+    for (uint64_t i : { 1, 2, 1, 3 })
+        cache.get_or_compute<uint64_t>(1, "get", { fc::variant(i) }, [&]() { return i; });
+
+    uint32_t computed = 0;
+    cache.get_or_compute<uint64_t>(1, "get", { fc::variant(1) }, [&]() { return uint64_t(++computed); });
+    cache.get_or_compute<uint64_t>(1, "get", { fc::variant(3) }, [&]() { return uint64_t(++computed); });
+    BOOST_CHECK_EQUAL(computed, 0u);
+    cache.get_or_compute<uint64_t>(1, "get", { fc::variant(2) }, [&]() { return uint64_t(++computed); });
+    BOOST_CHECK_EQUAL(computed, 1u);
+
+    const auto stats = cache.get_stats();
+    BOOST_CHECK_EQUAL(stats.evictions, 2u);
+    BOOST_CHECK_EQUAL(stats.size_in_bytes, 16u);
+}
+
+BOOST_AUTO_TEST_CASE(coalesces_identical_misses)
+{
+    api_response_cache cache(1024 * 1024);
+    std::atomic<uint32_t> computed{ 0 };
+
+    std::vector<uint64_t> responses(8);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < responses.size(); ++i)
+        threads.emplace_back([&, i]() {
+            responses[i] = cache.get_or_compute<uint64_t>(1, "get", {}, [&]() {
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                return uint64_t(++computed);
+            });
+        });
+    for (std::thread& t : threads)
+        t.join();
+
+    BOOST_CHECK_EQUAL(computed.load(), 1u);
+    for (uint64_t response : responses)
+        BOOST_CHECK_EQUAL(response, 1u);
+    const auto stats = cache.get_stats();
+    BOOST_CHECK_EQUAL(stats.misses, 1u);
+    BOOST_CHECK_EQUAL(stats.hits + stats.coalesced, 7u);
+}
+
+BOOST_AUTO_TEST_CASE(disabled_cache_computes_every_response)
+{
+    api_response_cache cache(0);
+    uint32_t computed = 0;
+    cache.get_or_compute<uint64_t>(1, "get", {}, [&]() { return uint64_t(++computed); });
+    cache.get_or_compute<uint64_t>(1, "get", {}, [&]() { return uint64_t(++computed); });
+    BOOST_CHECK_EQUAL(computed, 2u);
+    BOOST_CHECK_EQUAL(cache.get_stats().entries, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
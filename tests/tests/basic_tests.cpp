@@ -333,4 +333,142 @@ BOOST_AUTO_TEST_CASE(format_string)
     BOOST_CHECK(!out.compare(etalon));
 }
 
+BOOST_AUTO_TEST_CASE(transaction_signees_cache_test)
+{
+    const chain_id_type chain_id = fc::sha256::hash("chain");
+    const auto alice_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("alice")));
+    const auto bob_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("bob")));
+
+    signed_transaction trx;
+    trx.ref_block_prefix = 1;
+    trx.sign(alice_key, chain_id);
+
+    auto signees = transaction_signees_cache::recover(trx, chain_id);
+    BOOST_REQUIRE(signees.valid());
+    BOOST_CHECK(signees->signature_keys == flat_set<public_key_type>({ alice_key.get_public_key() }));
+    BOOST_CHECK(!signees->tenant_signature_key.valid());
+
+    transaction_signees_cache cache(1);
+    const auto alice_trx_key = transaction_signees_cache::key(trx);
+    cache.insert(alice_trx_key, *signees);
+    BOOST_CHECK(cache.contains(alice_trx_key));
+
+    // any change of the signatures must miss the cache
+    trx.sign(bob_key, chain_id);
+    const auto alice_and_bob_trx_key = transaction_signees_cache::key(trx);
+    BOOST_CHECK(!cache.contains(alice_and_bob_trx_key));
+
+    // the oldest entry is evicted when the cache is full
+    cache.insert(alice_and_bob_trx_key, *transaction_signees_cache::recover(trx, chain_id));
+    BOOST_CHECK_EQUAL(cache.size(), 1u);
+    BOOST_CHECK(!cache.find(alice_trx_key).valid());
+    BOOST_CHECK_EQUAL(cache.find(alice_and_bob_trx_key)->signature_keys.size(), 2u);
+
+    // duplicate signatures are left to the regular validation path
+    trx.signatures.push_back(trx.signatures.front());
+    BOOST_CHECK(!transaction_signees_cache::recover(trx, chain_id).valid());
+}
+
+BOOST_AUTO_TEST_CASE(block_signee_cache_test)
+{
+    const auto alice_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("alice")));
+    const auto bob_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("bob")));
+
+    signed_block_header header;
+    header.timestamp = fc::time_point_sec(1000);
+    header.witness = "alice";
+    header.sign(alice_key);
+    const auto id = header.id();
+
+    // a key recovered ahead is used as is, bob's key proves the signature is not recovered again
+    block_signee_cache cache(2);
+    cache.insert(id, bob_key.get_public_key());
+    BOOST_CHECK_EQUAL(cache.size(), 1u);
+    BOOST_CHECK(cache.take_or_recover(header, id) == bob_key.get_public_key());
+
+    // the key is taken, the next lookup recovers it from the signature
+    BOOST_CHECK_EQUAL(cache.size(), 0u);
+    BOOST_CHECK(cache.take_or_recover(header, id) == alice_key.get_public_key());
+
+    // a forged header has another id and never gets the key recovered for the original one
+    cache.insert(id, bob_key.get_public_key());
+    signed_block_header forged = header;
+    forged.timestamp = fc::time_point_sec(2000);
+    BOOST_REQUIRE(forged.id() != id);
+    BOOST_CHECK(cache.take_or_recover(forged, forged.id()) == forged.signee());
+    BOOST_CHECK(forged.signee() != bob_key.get_public_key());
+    BOOST_CHECK_EQUAL(cache.size(), 1u);
+
+    // the oldest entry is evicted when the cache is full
+    cache.insert(forged.id(), alice_key.get_public_key());
+    signed_block_header next = header;
+    next.timestamp = fc::time_point_sec(3000);
+    cache.insert(next.id(), alice_key.get_public_key());
+    BOOST_CHECK_EQUAL(cache.size(), 2u);
+    BOOST_CHECK(!cache.take(id).valid());
+    BOOST_CHECK(cache.take(forged.id()).valid());
+    BOOST_CHECK(cache.take(next.id()).valid());
+}
+
+BOOST_AUTO_TEST_CASE(transaction_mempool_test)
+{
+    auto make_transfer = [](const string& from, uint32_t expiration) {
+        transfer_operation op;
+        op.from = from;
+        op.to = "bob";
+        op.amount = asset(1, DEIP_SYMBOL);
+
+        signed_transaction trx;
+        trx.operations.push_back(op);
+        trx.set_expiration(fc::time_point_sec(expiration));
+        return trx;
+    };
+
+    transaction_mempool mempool;
+    mempool.set_limits(3, 1024 * 1024, 2);
+
+    const auto alice_1 = make_transfer("alice", 100);
+    const auto alice_2 = make_transfer("alice", 200);
+    const auto carol_1 = make_transfer("carol", 50);
+
+    mempool.mark_applied(mempool.insert(alice_1, 100), true);
+    mempool.insert(alice_2, 100);
+    mempool.insert(carol_1, 100);
+    BOOST_CHECK_EQUAL(mempool.size(), 3u);
+    BOOST_CHECK_EQUAL(mempool.size_in_bytes(), 300u);
+    BOOST_CHECK_EQUAL(mempool.applied_size_in_bytes(), 100u);
+    BOOST_CHECK_THROW(mempool.insert(alice_1, 100), fc::exception);
+
+    // an account can't have more pending than its limit
+    BOOST_CHECK_THROW(mempool.insert(make_transfer("alice", 300), 100), fc::exception);
+
+    BOOST_REQUIRE_EQUAL(mempool.get_applied().size(), 1u);
+    BOOST_CHECK(mempool.get_applied().front()->id == alice_1.id());
+    BOOST_REQUIRE_EQUAL(mempool.get_unapplied().size(), 2u);
+    BOOST_CHECK(mempool.get_unapplied().front()->id == alice_2.id());
+    BOOST_REQUIRE(mempool.next_unapplied() != nullptr);
+    BOOST_CHECK(mempool.next_unapplied()->id == alice_2.id());
+
+    // a full pool makes room by dropping the newest unapplied transaction of the busiest account
+    const auto dave_1 = make_transfer("dave", 400);
+    mempool.insert(dave_1, 100);
+    BOOST_CHECK_EQUAL(mempool.size(), 3u);
+    BOOST_CHECK(!mempool.contains(alice_2.id()));
+    BOOST_CHECK(mempool.contains(alice_1.id()));
+    BOOST_CHECK_THROW(mempool.insert(make_transfer("erin", 500), 100), fc::exception);
+
+    BOOST_CHECK_EQUAL(mempool.remove_expired(fc::time_point_sec(150)), 2u);
+    BOOST_CHECK(!mempool.contains(carol_1.id()));
+    BOOST_CHECK_EQUAL(mempool.applied_size_in_bytes(), 0u);
+
+    mempool.mark_applied(*mempool.get_all().front(), true);
+    mempool.reset_applied();
+    BOOST_CHECK(mempool.get_applied().empty());
+    BOOST_CHECK(mempool.next_unapplied()->id == dave_1.id());
+
+    mempool.remove(dave_1.id());
+    BOOST_CHECK_EQUAL(mempool.size(), 0u);
+    BOOST_CHECK_EQUAL(mempool.size_in_bytes(), 0u);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -27,6 +27,7 @@
 #include <deip/protocol/exceptions.hpp>
 
 #include <deip/chain/database/database.hpp>
+#include <deip/chain/schema/block_summary_object.hpp>
 #include <deip/chain/schema/deip_objects.hpp>
 #include <deip/blockchain_history/account_history_object.hpp>
 #include <deip/chain/genesis_state.hpp>
@@ -37,6 +38,8 @@
 
 #include <fc/crypto/digest.hpp>
 
+#include <fstream>
+
 #include "database_fixture.hpp"
 
 using namespace deip;
@@ -45,7 +48,7 @@ using namespace deip::protocol;
 
 BOOST_AUTO_TEST_SUITE(block_tests)
 
-void db_setup_and_open(database& db, const fc::path& path)
+genesis_state_type create_test_genesis_state()
 {
     genesis_state_type genesis;
 
@@ -64,8 +67,13 @@ void db_setup_and_open(database& db, const fc::path& path)
     create_initdelegate_for_genesis_state(genesis);
     create_initdelegate_expert_tokens_for_genesis_state(genesis);
 
+    return genesis;
+}
+
+void db_setup_and_open(database& db, const fc::path& path)
+{
     db._log_hardforks = false;
-    db.open(path, path, TEST_SHARED_MEM_SIZE_8MB, chainbase::database::read_write, genesis);
+    db.open(path, path, TEST_SHARED_MEM_SIZE_8MB, chainbase::database::read_write, create_test_genesis_state());
 }
 
 BOOST_AUTO_TEST_CASE(generate_empty_blocks)
@@ -129,6 +137,399 @@ BOOST_AUTO_TEST_CASE(generate_empty_blocks)
     }
 }
 
+BOOST_AUTO_TEST_CASE(serialized_blocks)
+{
+    try
+    {
+        fc::temp_directory data_dir(graphene::utilities::temp_directory_path());
+        auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")));
+
+        database db;
+        db_setup_and_open(db, data_dir.path());
+
+        uint32_t checked_block_num = 0;
+        while (checked_block_num < 50)
+        {
+            db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                              database::skip_nothing);
+
+            // blocks are read back while the block log keeps growing
+            uint32_t head_num = db.head_block_num();
+            for (uint32_t num = checked_block_num + 1; num <= head_num; ++num)
+            {
+                auto block = db.fetch_block_by_number(num);
+                auto serialized = db.fetch_serialized_block_by_number(num);
+                BOOST_REQUIRE(block.valid());
+                BOOST_REQUIRE(serialized.valid());
+
+                auto packed = fc::raw::pack(*block);
+                BOOST_REQUIRE_EQUAL(serialized->size, packed.size());
+                BOOST_CHECK(std::equal(packed.begin(), packed.end(), serialized->data.get()));
+                BOOST_CHECK(database::unpack_block_header(*serialized).id() == block->id());
+
+                auto by_id = db.fetch_serialized_block_by_id(block->id());
+                BOOST_REQUIRE(by_id.valid());
+                BOOST_CHECK_EQUAL(by_id->size, packed.size());
+            }
+
+            checked_block_num = db.get_dynamic_global_properties().last_irreversible_block_num;
+        }
+
+        BOOST_CHECK(!db.fetch_serialized_block_by_number(db.head_block_num() + 1).valid());
+        BOOST_CHECK(!db.fetch_serialized_block_by_id(block_id_type()).valid());
+    }
+    catch (fc::exception& e)
+    {
+        edump((e.to_detail_string()));
+        throw;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(reindex_replays_block_log)
+{
+    try
+    {
+        fc::temp_directory data_dir(graphene::utilities::temp_directory_path());
+        auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")));
+
+        optional<signed_block> last_irreversible_block;
+        {
+            database db;
+            db_setup_and_open(db, data_dir.path());
+            while (db.get_dynamic_global_properties().last_irreversible_block_num < 50)
+                db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                                  database::skip_nothing);
+
+            last_irreversible_block
+                = db.fetch_block_by_number(db.get_dynamic_global_properties().last_irreversible_block_num);
+            BOOST_REQUIRE(last_irreversible_block.valid());
+            db.close();
+        }
+
+        database db;
+        db._log_hardforks = false;
+        db.reindex(data_dir.path(), data_dir.path(), TEST_SHARED_MEM_SIZE_8MB, create_test_genesis_state());
+
+        BOOST_CHECK_EQUAL(db.head_block_num(), last_irreversible_block->block_num());
+        BOOST_CHECK(db.head_block_id() == last_irreversible_block->id());
+        BOOST_CHECK(db.get_dynamic_global_properties().head_block_id == last_irreversible_block->id());
+    }
+    catch (fc::exception& e)
+    {
+        edump((e.to_detail_string()));
+        throw;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(block_log_async_writer)
+{
+    try
+    {
+        fc::temp_directory data_dir(graphene::utilities::temp_directory_path());
+        const fc::path log_file = data_dir.path() / "block_log";
+
+        vector<signed_block> blocks;
+        block_id_type previous;
+        for (uint32_t i = 0; i < 20; ++i)
+        {
+            signed_block b;
+            b.previous = previous;
+            b.timestamp = fc::time_point_sec(TEST_GENESIS_TIMESTAMP + 3 * (i + 1));
+            b.witness = TEST_INIT_DELEGATE_NAME;
+            previous = b.id();
+            blocks.push_back(b);
+        }
+
+        {
+            block_log log;
+            log.open(log_file);
+            log.start_writer(2, block_log::fsync_mode::every_batch);
+
+            BOOST_TEST_MESSAGE("Verify that queued blocks can be read before they are written");
+            for (uint32_t i = 0; i < 10; ++i)
+            {
+                log.append_async(blocks[i]);
+                BOOST_CHECK(log.head()->id() == blocks[i].id());
+                auto b = log.read_block_by_num(i + 1);
+                BOOST_REQUIRE(b.valid());
+                BOOST_CHECK(b->id() == blocks[i].id());
+                auto serialized = log.read_serialized_block_by_num(i + 1);
+                BOOST_REQUIRE(serialized.valid());
+                BOOST_CHECK_EQUAL(serialized->size, fc::raw::pack_size(blocks[i]));
+            }
+
+            log.flush();
+            BOOST_CHECK_EQUAL(log.queued_blocks(), 0u);
+            BOOST_CHECK(log.read_head().id() == blocks[9].id());
+
+            // a synchronous append goes after everything queued
+            log.append_async(blocks[10]);
+            log.append(blocks[11]);
+            BOOST_CHECK(log.read_head().id() == blocks[11].id());
+            log.close();
+        }
+
+        BOOST_TEST_MESSAGE("Verify that a partially written block is cut off when the log is opened");
+        {
+            std::ofstream out(log_file.generic_string(), std::ios::out | std::ios::binary | std::ios::app);
+            const auto packed = fc::raw::pack(blocks[12]);
+            out.write(packed.data(), packed.size() / 2);
+        }
+
+        block_log log;
+        log.open(log_file);
+        BOOST_REQUIRE(log.head().valid());
+        BOOST_CHECK(log.head()->id() == blocks[11].id());
+        BOOST_CHECK(log.read_block_by_num(12)->id() == blocks[11].id());
+        log.append(blocks[12]);
+        BOOST_CHECK(log.read_block_by_num(13)->id() == blocks[12].id());
+    }
+    catch (fc::exception& e)
+    {
+        edump((e.to_detail_string()));
+        throw;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(block_log_reads_between_appends)
+{
+    try
+    {
+        fc::temp_directory data_dir(graphene::utilities::temp_directory_path());
+
+        vector<signed_block> blocks;
+        block_id_type previous;
+        for (uint32_t i = 0; i < 20; ++i)
+        {
+            signed_block b;
+            b.previous = previous;
+            b.timestamp = fc::time_point_sec(TEST_GENESIS_TIMESTAMP + 3 * (i + 1));
+            b.witness = TEST_INIT_DELEGATE_NAME;
+            previous = b.id();
+            blocks.push_back(b);
+        }
+
+        block_log log;
+        log.open(data_dir.path() / "block_log");
+
+        BOOST_TEST_MESSAGE("Verify that every appended block can be read right away");
+        optional<serialized_block> first;
+        for (uint32_t i = 0; i < blocks.size(); ++i)
+        {
+            log.append(blocks[i]);
+            BOOST_CHECK(log.read_block_by_num(i + 1)->id() == blocks[i].id());
+            BOOST_CHECK(log.read_block_by_num(1)->id() == blocks[0].id());
+            if (!first.valid())
+                first = log.read_serialized_block_by_num(1);
+        }
+
+        BOOST_TEST_MESSAGE("Verify that a serialized block outlives the appends after it");
+        BOOST_REQUIRE(first.valid());
+        const auto packed = fc::raw::pack(blocks[0]);
+        BOOST_REQUIRE_EQUAL(first->size, packed.size());
+        BOOST_CHECK(std::equal(packed.begin(), packed.end(), first->data.get()));
+    }
+    catch (fc::exception& e)
+    {
+        edump((e.to_detail_string()));
+        throw;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(open_replays_blocks_the_state_is_behind)
+{
+    try
+    {
+        fc::temp_directory data_dir(graphene::utilities::temp_directory_path());
+        auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")));
+
+        auto open_with_writer = [&](database& db) {
+            db.set_block_log_writer(1000, block_log::fsync_mode::none, block_log::default_fsync_interval_ms);
+            db_setup_and_open(db, data_dir.path());
+        };
+        auto generate_until_irreversible = [&](database& db, uint32_t block_num) {
+            while (db.get_dynamic_global_properties().last_irreversible_block_num < block_num)
+                db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                                  database::skip_nothing);
+        };
+
+        uint32_t written_num = 0;
+        optional<signed_block> log_head;
+        {
+            database db;
+            open_with_writer(db);
+            generate_until_irreversible(db, 20);
+            db.get_block_log().flush();
+            written_num = db.get_block_log().written_head_num();
+            BOOST_REQUIRE_EQUAL(written_num, db.get_dynamic_global_properties().last_irreversible_block_num);
+
+            BOOST_TEST_MESSAGE("Verify that the state is not committed past blocks still queued for the writer");
+            db.get_block_log().hold_writer(true);
+            generate_until_irreversible(db, written_num + 20);
+            BOOST_CHECK_EQUAL(db.get_block_log().written_head_num(), written_num);
+            BOOST_CHECK_GE(db.get_block_log().queued_blocks(), 20u);
+
+            // the writer catches up after the last commit, the log is ahead of the committed state
+            db.get_block_log().hold_writer(false);
+            db.get_block_log().flush();
+            log_head = db.get_block_log().read_head();
+            BOOST_CHECK_GT(log_head->block_num(), written_num);
+            db.close();
+        }
+
+        BOOST_TEST_MESSAGE("Verify that open() replays the blocks the log has ahead of the state");
+        {
+            database db;
+            open_with_writer(db);
+            BOOST_CHECK_EQUAL(db.head_block_num(), log_head->block_num());
+            BOOST_CHECK(db.head_block_id() == log_head->id());
+            BOOST_CHECK(db.get_dynamic_global_properties().head_block_id == log_head->id());
+            const block_summary_id_type summary_id = log_head->block_num() & 0xffff;
+            BOOST_CHECK(db.get<block_summary_object>(summary_id).block_id == log_head->id());
+
+            written_num = log_head->block_num();
+            generate_until_irreversible(db, written_num + 1);
+            db.get_block_log().flush();
+            written_num = db.get_block_log().written_head_num();
+            log_head = db.get_block_log().read_head();
+
+            BOOST_TEST_MESSAGE("Stop the writer with blocks still queued, as a crash would");
+            db.get_block_log().hold_writer(true);
+            generate_until_irreversible(db, written_num + 20);
+            BOOST_REQUIRE_GE(db.get_block_log().queued_blocks(), 20u);
+            db.get_block_log().stop_writer();
+            db.close();
+        }
+
+        BOOST_TEST_MESSAGE("Verify that the state is rewound to the last block the log has");
+        database db;
+        open_with_writer(db);
+        BOOST_CHECK_EQUAL(db.head_block_num(), written_num);
+        BOOST_CHECK(db.head_block_id() == log_head->id());
+        BOOST_CHECK(db.get_dynamic_global_properties().head_block_id == log_head->id());
+        BOOST_CHECK(!db.get_block_log().read_block_by_num(written_num + 1).valid());
+
+        // and the chain goes on from there
+        db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                          database::skip_nothing);
+        BOOST_CHECK_EQUAL(db.head_block_num(), written_num + 1);
+    }
+    catch (fc::exception& e)
+    {
+        edump((e.to_detail_string()));
+        throw;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_export_import)
+{
+    try
+    {
+        fc::temp_directory data_dir(graphene::utilities::temp_directory_path());
+        const fc::path snapshot_file = data_dir.path() / "snapshot.bin";
+        auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")));
+
+        uint32_t snapshot_block_num = 0;
+        {
+            database db;
+            db_setup_and_open(db, data_dir.path());
+            while (db.get_dynamic_global_properties().last_irreversible_block_num < 50)
+                db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                                  database::skip_nothing);
+            db.close();
+
+            // reopening rewinds the state to the last irreversible block, which is in the block log
+            db_setup_and_open(db, data_dir.path());
+            snapshot_block_num = db.head_block_num();
+            db.export_snapshot(snapshot_file);
+
+            while (db.get_dynamic_global_properties().last_irreversible_block_num < snapshot_block_num + 50)
+                db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                                  database::skip_nothing);
+            db.close();
+        }
+
+        block_id_type imported_head_id;
+        size_t imported_accounts = 0;
+        {
+            database db;
+            db._log_hardforks = false;
+            db.import_snapshot(data_dir.path(), data_dir.path(), TEST_SHARED_MEM_SIZE_8MB, create_test_genesis_state(),
+                               snapshot_file);
+
+            BOOST_CHECK_GT(db.head_block_num(), snapshot_block_num);
+            imported_head_id = db.head_block_id();
+            imported_accounts = db.get_index<account_index>().indices().size();
+            db.close();
+        }
+
+        database db;
+        db._log_hardforks = false;
+        db.reindex(data_dir.path(), data_dir.path(), TEST_SHARED_MEM_SIZE_8MB, create_test_genesis_state());
+
+        BOOST_CHECK(db.head_block_id() == imported_head_id);
+        BOOST_CHECK_EQUAL(db.get_index<account_index>().indices().size(), imported_accounts);
+    }
+    catch (fc::exception& e)
+    {
+        edump((e.to_detail_string()));
+        throw;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(shared_memory_growth_and_compaction)
+{
+    try
+    {
+        fc::temp_directory data_dir(graphene::utilities::temp_directory_path());
+        auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")));
+
+        block_id_type head_id;
+        {
+            database db;
+            db_setup_and_open(db, data_dir.path());
+
+            // keep the file growing at every block boundary
+            const uint64_t initial_size = db.get_max_memory();
+            db.set_shared_memory_growth(db.get_max_memory(), 1024 * 1024);
+            while (db.get_dynamic_global_properties().last_irreversible_block_num < 20)
+                db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                                  database::skip_nothing);
+            BOOST_CHECK_GT(db.get_max_memory(), initial_size);
+
+            // undo state survives remapping
+            db.pop_block();
+            db.close();
+        }
+
+        {
+            database db;
+            db_setup_and_open(db, data_dir.path());
+            head_id = db.head_block_id();
+            db.close();
+        }
+
+        const auto file_size = fc::file_size(data_dir.path() / "shared_memory.bin");
+        {
+            database db;
+            db._log_hardforks = false;
+            db.compact(data_dir.path(), data_dir.path(), create_test_genesis_state());
+        }
+        BOOST_CHECK_LT(fc::file_size(data_dir.path() / "shared_memory.bin"), file_size);
+
+        database db;
+        db_setup_and_open(db, data_dir.path());
+        BOOST_CHECK(db.head_block_id() == head_id);
+        db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                          database::skip_nothing);
+    }
+    catch (fc::exception& e)
+    {
+        edump((e.to_detail_string()));
+        throw;
+    }
+}
+
 BOOST_AUTO_TEST_CASE(undo_block)
 {
     try
@@ -564,6 +965,197 @@ BOOST_FIXTURE_TEST_CASE(double_sign_check, clean_database_fixture)
     FC_LOG_AND_RETHROW()
 }
 
+BOOST_FIXTURE_TEST_CASE(preverified_block_transactions, clean_database_fixture)
+{
+    try
+    {
+        create_account("alice", generate_private_key("alice").get_public_key());
+        generate_block();
+
+        auto make_transfer = [&](share_type amount) {
+            signed_transaction trx;
+            transfer_operation t;
+            t.from = TEST_INIT_DELEGATE_NAME;
+            t.to = "alice";
+            t.amount = asset(amount, DEIP_SYMBOL);
+            trx.operations.push_back(t);
+            trx.set_expiration(db.head_block_time() + DEIP_MAX_TIME_UNTIL_EXPIRATION);
+            trx.sign(init_account_priv_key, db.get_chain_id());
+            return trx;
+        };
+
+        const auto verified_trx = make_transfer(1);
+        db.push_transaction(verified_trx, 0);
+
+        signed_block b;
+        b.previous = db.head_block_id();
+        b.transactions.push_back(verified_trx);
+        BOOST_CHECK_EQUAL(db.count_preverified_transactions(b), 1u);
+
+        BOOST_TEST_MESSAGE("Verify that other signatures are verified again");
+        b.transactions.back().signatures.push_back(b.transactions.back().signatures.front());
+        BOOST_CHECK_EQUAL(db.count_preverified_transactions(b), 0u);
+
+        BOOST_TEST_MESSAGE("Verify that transactions pushed without verification are verified again");
+        const auto unverified_trx = make_transfer(2);
+        db.push_transaction(unverified_trx, database::skip_transaction_signatures | database::skip_authority_check);
+        b.transactions = { verified_trx, unverified_trx };
+        BOOST_CHECK_EQUAL(db.count_preverified_transactions(b), 1u);
+
+        BOOST_TEST_MESSAGE("Verify that a block on another head is verified again");
+        b.previous = block_id_type();
+        BOOST_CHECK_EQUAL(db.count_preverified_transactions(b), 0u);
+
+        generate_block();
+        BOOST_CHECK_EQUAL(db.get_mempool().size(), 0u);
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE(generate_block_from_mempool, clean_database_fixture)
+{
+    try
+    {
+        create_account("alice", generate_private_key("alice").get_public_key());
+        generate_block();
+
+        auto make_transfer = [&](share_type amount) {
+            signed_transaction trx;
+            transfer_operation t;
+            t.from = TEST_INIT_DELEGATE_NAME;
+            t.to = "alice";
+            t.amount = asset(amount, DEIP_SYMBOL);
+            trx.operations.push_back(t);
+            trx.set_expiration(db.head_block_time() + DEIP_MAX_TIME_UNTIL_EXPIRATION);
+            trx.sign(init_account_priv_key, db.get_chain_id());
+            return trx;
+        };
+
+        vector<signed_transaction> pushed = { make_transfer(1), make_transfer(2), make_transfer(3) };
+        for (const auto& trx : pushed)
+            db.push_transaction(trx, 0);
+
+        const auto applied = db.get_mempool().get_applied();
+        BOOST_REQUIRE_EQUAL(applied.size(), pushed.size());
+        for (size_t i = 0; i < pushed.size(); ++i)
+            BOOST_CHECK(applied[i]->id == pushed[i].id());
+
+        BOOST_TEST_MESSAGE("Verify that the block takes the applied transactions in the order they were applied");
+        auto b = db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                                   database::skip_witness_signature);
+        BOOST_REQUIRE_EQUAL(b.transactions.size(), pushed.size());
+        for (size_t i = 0; i < pushed.size(); ++i)
+            BOOST_CHECK(b.transactions[i].id() == pushed[i].id());
+        BOOST_CHECK(db.head_block_id() == b.id());
+        BOOST_CHECK_EQUAL(db.get_mempool().size(), 0u);
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_FIXTURE_TEST_CASE(generate_block_rebuilds_failing_candidate, clean_database_fixture)
+{
+    try
+    {
+        create_account("alice", generate_private_key("alice").get_public_key());
+        generate_block();
+
+        auto make_transfer = [&](share_type amount) {
+            signed_transaction trx;
+            transfer_operation t;
+            t.from = TEST_INIT_DELEGATE_NAME;
+            t.to = "alice";
+            t.amount = asset(amount, DEIP_SYMBOL);
+            trx.operations.push_back(t);
+            trx.set_expiration(db.head_block_time() + DEIP_MAX_TIME_UNTIL_EXPIRATION);
+            return trx;
+        };
+
+        auto signed_trx = make_transfer(1);
+        signed_trx.sign(init_account_priv_key, db.get_chain_id());
+        db.push_transaction(signed_trx, 0);
+
+        // accepted only because its signatures are not checked, so the candidate can't be a valid block
+        const auto unsigned_trx = make_transfer(2);
+        db.push_transaction(unsigned_trx, database::skip_transaction_signatures | database::skip_authority_check);
+        BOOST_REQUIRE_EQUAL(db.get_mempool().get_applied().size(), 2u);
+
+        BOOST_TEST_MESSAGE("Verify that a failing candidate is rebuilt from the transactions that still apply");
+        const auto head_num = db.head_block_num();
+        auto b = db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key,
+                                   database::skip_witness_signature);
+        BOOST_CHECK_EQUAL(db.head_block_num(), head_num + 1);
+        BOOST_CHECK(db.head_block_id() == b.id());
+        BOOST_REQUIRE_EQUAL(b.transactions.size(), 1u);
+        BOOST_CHECK(b.transactions.front().id() == signed_trx.id());
+        BOOST_CHECK(!db.get_mempool().contains(unsigned_trx.id()));
+        BOOST_CHECK_EQUAL(db.get_mempool().size(), 0u);
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE(fork_switch_restores_pending_transactions)
+{
+    try
+    {
+        fc::temp_directory dir1(graphene::utilities::temp_directory_path());
+        fc::temp_directory dir2(graphene::utilities::temp_directory_path());
+
+        database db1;
+        db_setup_and_open(db1, dir1.path());
+        database db2;
+        db_setup_and_open(db2, dir2.path());
+
+        auto init_account_priv_key = fc::ecc::private_key::regenerate(fc::sha256::hash(string("init_key")));
+        public_key_type init_account_pub_key = init_account_priv_key.get_public_key();
+
+        signed_transaction trx;
+        create_account_operation cop;
+        cop.new_account_name = "alice";
+        cop.creator = TEST_INIT_DELEGATE_NAME;
+        cop.owner = authority(1, init_account_pub_key, 1);
+        cop.active = cop.owner;
+        cop.fee = asset(30000, DEIP_SYMBOL);
+        trx.operations.push_back(cop);
+        trx.set_expiration(db1.head_block_time() + DEIP_MAX_TIME_UNTIL_EXPIRATION);
+        trx.sign(init_account_priv_key, db1.get_chain_id());
+        PUSH_TX(db1, trx);
+
+        // db1 : A
+        // db2 : B C
+        auto b = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key,
+                                    database::skip_nothing);
+        BOOST_REQUIRE_EQUAL(b.transactions.size(), 1u);
+        BOOST_CHECK_EQUAL(db1.get_mempool().size(), 0u);
+
+        for (int i = 0; i < 2; ++i)
+        {
+            b = db2.generate_block(db2.get_slot_time(1), db2.get_scheduled_witness(1), init_account_priv_key,
+                                   database::skip_nothing);
+            db1.push_block(b);
+        }
+
+        BOOST_TEST_MESSAGE("Verify that the transaction of the abandoned block is pending again");
+        BOOST_CHECK(db1.head_block_id() == db2.head_block_id());
+        BOOST_REQUIRE_EQUAL(db1.get_mempool().size(), 1u);
+        BOOST_REQUIRE_EQUAL(db1.get_mempool().get_applied().size(), 1u);
+        BOOST_CHECK(db1.get_mempool().get_applied().front()->id == trx.id());
+        BOOST_CHECK(db1.get_account("alice").name == "alice");
+
+        BOOST_TEST_MESSAGE("Verify that the next block on the new branch includes it");
+        b = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key,
+                               database::skip_nothing);
+        BOOST_REQUIRE_EQUAL(b.transactions.size(), 1u);
+        BOOST_CHECK(b.transactions.front().id() == trx.id());
+        db2.push_block(b);
+        BOOST_CHECK(db2.get_account("alice").name == "alice");
+    }
+    catch (fc::exception& e)
+    {
+        edump((e.to_detail_string()));
+        throw;
+    }
+}
+
 BOOST_FIXTURE_TEST_CASE(pop_block_twice, clean_database_fixture)
 {
     try
@@ -0,0 +1,520 @@
+#include <boost/test/unit_test.hpp>
+
+#include <deip/app/api_context.hpp>
+#include <deip/chain/schema/expertise_contribution_object.hpp>
+#include <deip/chain/schema/research_content_object.hpp>
+#include <deip/eci_history/eci_history_api.hpp>
+#include <deip/eci_history/eci_history_plugin.hpp>
+#include <deip/eci_history/account_eci_history_object.hpp>
+#include <deip/eci_history/discipline_eci_history_object.hpp>
+#include <deip/eci_history/research_eci_history_object.hpp>
+#include <deip/eci_history/research_content_eci_history_object.hpp>
+
+#include <boost/date_time/gregorian/gregorian.hpp>
+
+#include <chrono>
+#include <map>
+
+#include "database_fixture.hpp"
+
+using namespace deip::eci_history;
+
+namespace {
+
+// a year of discipline history, one record every 10 minutes
+std::vector<fc::time_point_sec> make_year_of_history()
+{
+    std::vector<fc::time_point_sec> timestamps;
+    for (uint32_t sec = 0; sec < 365 * 24 * 60 * 60; sec += 10 * 60)
+        timestamps.push_back(fc::time_point_sec(1546300800 + sec)); // 2019-01-01T00:00:00
+    return timestamps;
+}
+
+// the selection get_disciplines_eci_stats_history did before the rollups
+std::vector<fc::time_point_sec> select_by_iso_string(const std::vector<fc::time_point_sec>& timestamps, eci_stat_period_step step)
+{
+    using namespace boost::gregorian;
+
+    std::vector<fc::time_point_sec> result;
+    std::multimap<int, date> selection;
+    for (const fc::time_point_sec& timestamp : timestamps)
+    {
+        const std::string& hist_timestamp = timestamp.to_non_delimited_iso_string();
+        date hist_date = date_from_iso_string(std::string(hist_timestamp.substr(0, hist_timestamp.find("T"))));
+
+        auto entries_pair = selection.equal_range(0);
+        if (entries_pair.first != entries_pair.second)
+        {
+            auto& last_entry = *(--entries_pair.second);
+            date bound = step == eci_stat_period_step::month ? last_entry.second.end_of_month() : last_entry.second;
+            if (hist_date <= bound)
+                continue;
+        }
+
+        selection.insert(std::make_pair(0, hist_date));
+        result.push_back(timestamp);
+    }
+    return result;
+}
+
+std::vector<fc::time_point_sec> select_by_period(const std::vector<fc::time_point_sec>& timestamps, eci_stat_period_step step)
+{
+    std::vector<fc::time_point_sec> result;
+    fc::time_point_sec last_period;
+    for (const fc::time_point_sec& timestamp : timestamps)
+    {
+        const fc::time_point_sec period = get_eci_stat_period_start(timestamp, step);
+        if (result.empty() || period != last_period)
+        {
+            result.push_back(timestamp);
+            last_period = period;
+        }
+    }
+    return result;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(eci_history_tests)
+
+BOOST_AUTO_TEST_CASE(stat_period_start)
+{
+    const fc::time_point_sec timestamp = fc::time_point_sec::from_iso_string("2020-02-29T13:45:10");
+    BOOST_CHECK(get_eci_stat_period_start(timestamp, eci_stat_period_step::day) == fc::time_point_sec::from_iso_string("2020-02-29T00:00:00"));
+    BOOST_CHECK(get_eci_stat_period_start(timestamp, eci_stat_period_step::month) == fc::time_point_sec::from_iso_string("2020-02-01T00:00:00"));
+    // any other step falls back to days
+    BOOST_CHECK(get_eci_stat_period_start(timestamp, eci_stat_period_step::unknown) == fc::time_point_sec::from_iso_string("2020-02-29T00:00:00"));
+    BOOST_CHECK(get_eci_stat_period_start(timestamp, static_cast<eci_stat_period_step>(7)) == fc::time_point_sec::from_iso_string("2020-02-29T00:00:00"));
+}
+
+BOOST_AUTO_TEST_CASE(stat_period_selection_benchmark)
+{
+    const auto timestamps = make_year_of_history();
+
+    for (const eci_stat_period_step step : { eci_stat_period_step::day, eci_stat_period_step::month })
+    {
+        auto start = std::chrono::steady_clock::now();
+        const auto by_iso_string = select_by_iso_string(timestamps, step);
+        const auto iso_string_elapsed = std::chrono::steady_clock::now() - start;
+
+        start = std::chrono::steady_clock::now();
+        const auto by_period = select_by_period(timestamps, step);
+        const auto period_elapsed = std::chrono::steady_clock::now() - start;
+
+        BOOST_CHECK_EQUAL(by_period.size(), step == eci_stat_period_step::day ? 365u : 12u);
+        BOOST_CHECK(by_period == by_iso_string);
+        BOOST_TEST_MESSAGE(fc::reflector<eci_stat_period_step>::to_string(step)
+                           << " periods of " << timestamps.size() << " records: iso string "
+                           << std::chrono::duration_cast<std::chrono::microseconds>(iso_string_elapsed).count()
+                           << "us, period start "
+                           << std::chrono::duration_cast<std::chrono::microseconds>(period_elapsed).count() << "us");
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#ifdef IS_TEST_NET
+
+#define RESEARCH_EXTERNAL_ID "b7e6f3a1c2d4e5f60718293a4b5c6d7e8f901234"
+#define OTHER_RESEARCH_EXTERNAL_ID "c8f7a4b2d3e5f6a70829304b5c6d7e8f90123456"
+#define RESEARCH_CONTENT_EXTERNAL_ID "d9a8b5c3e4f6a7b8093a415c6d7e8f9012345678"
+#define PHYSICS_EXTERNAL_ID "9f0224709d86e02b9625b5ebf2786b80ba6bed17"
+
+namespace {
+
+fc::time_point_sec at(const std::string& iso_string)
+{
+    return fc::time_point_sec::from_iso_string(iso_string);
+}
+
+uint16_t step_of(eci_stat_period_step step)
+{
+    return static_cast<uint16_t>(step);
+}
+
+// the history path is taken for any filter other than the discipline, one that matches every record
+const fc::optional<fc::time_point_sec> every_record = fc::time_point_sec::min();
+
+template <typename StatsApiObject>
+void check_same_eci_stats(const StatsApiObject& aggregated, const StatsApiObject& replayed)
+{
+    BOOST_CHECK_EQUAL(aggregated.eci, replayed.eci);
+    BOOST_CHECK_EQUAL(aggregated.previous_eci, replayed.previous_eci);
+    BOOST_CHECK_EQUAL(aggregated.starting_eci, replayed.starting_eci);
+    BOOST_CHECK_EQUAL(aggregated.percentile_rank.amount, replayed.percentile_rank.amount);
+    BOOST_REQUIRE_EQUAL(aggregated.growth_rate.valid(), replayed.growth_rate.valid());
+    if (aggregated.growth_rate.valid())
+        BOOST_CHECK_EQUAL(aggregated.growth_rate->amount, replayed.growth_rate->amount);
+    BOOST_CHECK(aggregated.contributions == replayed.contributions);
+    BOOST_CHECK(aggregated.timestamp == replayed.timestamp);
+}
+
+class eci_history_fixture : public deip::chain::database_fixture
+{
+public:
+    eci_history_fixture()
+    {
+        plugin = app.register_plugin<eci_history_plugin>();
+
+        // the rollups are built from the records pushed below when the plugin starts
+        boost::program_options::variables_map options;
+        options.insert(std::make_pair("eci-history-rebuild-stats", boost::program_options::variable_value(true, false)));
+        plugin->plugin_initialize(options);
+
+        open_database();
+
+        physics = &db.obtain_service<dbs_discipline>().get_discipline(external_id_type(PHYSICS_EXTERNAL_ID));
+        research = &db.create<research_object>([&](research_object& r) {
+            r.external_id = RESEARCH_EXTERNAL_ID;
+            r.created_at = db.head_block_time();
+            r.review_share_last_update = db.head_block_time();
+        });
+        other_research = &db.create<research_object>([&](research_object& r) {
+            r.external_id = OTHER_RESEARCH_EXTERNAL_ID;
+            r.created_at = db.head_block_time();
+            r.review_share_last_update = db.head_block_time();
+        });
+        research_content = &db.create<research_content_object>([&](research_content_object& rc) {
+            rc.external_id = RESEARCH_CONTENT_EXTERNAL_ID;
+            rc.research_id = research->id;
+            rc.research_external_id = research->external_id;
+        });
+    }
+
+    ~eci_history_fixture()
+    {
+        if (data_dir)
+            db.close();
+    }
+
+    void push_discipline_history(const std::string& timestamp, const share_type& eci)
+    {
+        db.create<discipline_eci_history_object>([&](discipline_eci_history_object& hist_o) {
+            hist_o.discipline_id = physics->id;
+            hist_o.discipline_external_id = physics->external_id;
+            hist_o.eci = eci;
+            hist_o.total_eci = eci;
+            hist_o.timestamp = at(timestamp);
+        });
+    }
+
+    void push_research_history(const std::string& timestamp,
+                               const share_type& delta,
+                               int64_t contribution_id = 0,
+                               const research_object* for_research = nullptr)
+    {
+        db.create<research_eci_history_object>([&](research_eci_history_object& hist_o) {
+            hist_o.research_id = for_research ? for_research->id : research->id;
+            hist_o.discipline_id = physics->id;
+            hist_o.discipline_external_id = physics->external_id;
+            hist_o.delta = delta;
+            hist_o.contribution_type = static_cast<uint16_t>(expertise_contribution_type::review);
+            hist_o.contribution_id = contribution_id;
+            hist_o.timestamp = at(timestamp);
+        });
+    }
+
+    void push_research_content_history(const std::string& timestamp, const share_type& delta, int64_t contribution_id)
+    {
+        db.create<research_content_eci_history_object>([&](research_content_eci_history_object& hist_o) {
+            hist_o.research_content_id = research_content->id;
+            hist_o.discipline_id = physics->id;
+            hist_o.discipline_external_id = physics->external_id;
+            hist_o.delta = delta;
+            hist_o.contribution_type = static_cast<uint16_t>(expertise_contribution_type::review);
+            hist_o.contribution_id = contribution_id;
+            hist_o.timestamp = at(timestamp);
+        });
+    }
+
+    void push_account_history(const std::string& timestamp, const share_type& delta, int64_t contribution_id = 0)
+    {
+        db.create<account_eci_history_object>([&](account_eci_history_object& hist_o) {
+            hist_o.account = "initdelegate";
+            hist_o.discipline_id = physics->id;
+            hist_o.discipline_external_id = physics->external_id;
+            hist_o.delta = delta;
+            hist_o.contribution_type = static_cast<uint16_t>(expertise_contribution_type::review);
+            hist_o.contribution_id = contribution_id;
+            hist_o.timestamp = at(timestamp);
+        });
+    }
+
+    void apply_research_eci_operation(const std::string& timestamp, const share_type& previous_eci, const share_type& eci)
+    {
+        const eci_diff diff(previous_eci, eci, at(timestamp), static_cast<uint16_t>(expertise_contribution_type::review), 1, {});
+        db.push_virtual_operation(research_eci_history_operation(research->id._id, physics->id._id, diff));
+    }
+
+    void apply_account_eci_operation(const std::string& timestamp, const share_type& previous_eci, const share_type& eci)
+    {
+        const eci_diff diff(previous_eci, eci, at(timestamp), static_cast<uint16_t>(expertise_contribution_type::publication), 1, {});
+        db.push_virtual_operation(account_eci_history_operation("initdelegate", physics->id._id, static_cast<uint16_t>(reward_recipient_type::author), diff));
+    }
+
+    std::shared_ptr<eci_history_api> start_api()
+    {
+        plugin->plugin_startup();
+        return std::make_shared<eci_history_api>(deip::app::api_context(app, "eci_history_api", std::weak_ptr<deip::app::api_session_data>()));
+    }
+
+    std::shared_ptr<eci_history_plugin> plugin;
+    const discipline_object* physics = nullptr;
+    const research_object* research = nullptr;
+    const research_object* other_research = nullptr;
+    const research_content_object* research_content = nullptr;
+};
+}
+
+BOOST_FIXTURE_TEST_SUITE(eci_history_rollup_tests, eci_history_fixture)
+
+BOOST_AUTO_TEST_CASE(research_eci_stats_history_across_periods)
+{
+    // ECI 10, 15 | 35, 42 | 38 with day and month changes in between
+    push_research_history("2020-01-31T22:00:00", 10);
+    push_research_history("2020-01-31T23:30:00", 5);
+    push_research_history("2020-02-01T00:30:00", 20);
+    push_research_history("2020-02-01T12:00:00", 7);
+    push_research_history("2020-02-02T09:00:00", -4);
+    const auto api = start_api();
+    const external_id_type research_external_id(RESEARCH_EXTERNAL_ID);
+
+    auto days = api->get_research_eci_stats_history(research_external_id, at("2020-01-31T12:00:00"), {}, step_of(eci_stat_period_step::day));
+    BOOST_REQUIRE_EQUAL(days.size(), 3u);
+    BOOST_CHECK_EQUAL(days[0].previous_eci, 0);
+    BOOST_CHECK_EQUAL(days[0].eci, 15);
+    BOOST_CHECK(days[0].timestamp == at("2020-01-31T23:30:00"));
+    BOOST_CHECK_EQUAL(days[1].previous_eci, 15);
+    BOOST_CHECK_EQUAL(days[1].eci, 42);
+    BOOST_CHECK_EQUAL(days[2].previous_eci, 42);
+    BOOST_CHECK_EQUAL(days[2].eci, 38);
+    BOOST_CHECK_EQUAL(days[2].starting_eci, 15);
+
+    // 'to' in the middle of a day leaves out the records of the day after it
+    days = api->get_research_eci_stats_history(research_external_id, at("2020-01-31T12:00:00"), at("2020-02-01T06:00:00"), step_of(eci_stat_period_step::day));
+    BOOST_REQUIRE_EQUAL(days.size(), 2u);
+    BOOST_CHECK_EQUAL(days[1].previous_eci, 15);
+    BOOST_CHECK_EQUAL(days[1].eci, 35);
+    BOOST_CHECK(days[1].timestamp == at("2020-02-01T00:30:00"));
+
+    auto months = api->get_research_eci_stats_history(research_external_id, {}, {}, step_of(eci_stat_period_step::month));
+    BOOST_REQUIRE_EQUAL(months.size(), 2u);
+    BOOST_CHECK_EQUAL(months[0].eci, 15);
+    BOOST_CHECK_EQUAL(months[1].previous_eci, 15);
+    BOOST_CHECK_EQUAL(months[1].eci, 38);
+    BOOST_CHECK(months[1].timestamp == at("2020-02-02T09:00:00"));
+
+    months = api->get_research_eci_stats_history(research_external_id, {}, at("2020-02-01T06:00:00"), step_of(eci_stat_period_step::month));
+    BOOST_REQUIRE_EQUAL(months.size(), 2u);
+    BOOST_CHECK_EQUAL(months[1].eci, 35);
+    BOOST_CHECK(months[1].timestamp == at("2020-02-01T00:30:00"));
+
+    // a period with all of its records after 'to' is left out
+    months = api->get_research_eci_stats_history(research_external_id, {}, at("2020-02-01T00:10:00"), step_of(eci_stat_period_step::month));
+    BOOST_REQUIRE_EQUAL(months.size(), 1u);
+    BOOST_CHECK_EQUAL(months[0].eci, 15);
+}
+
+BOOST_AUTO_TEST_CASE(account_eci_stats_history_across_periods)
+{
+    push_account_history("2020-03-31T23:00:00", 100);
+    push_account_history("2020-04-01T01:00:00", 50);
+    push_account_history("2020-04-15T10:00:00", 25);
+    const auto api = start_api();
+
+    auto months = api->get_account_eci_stats_history("initdelegate", {}, at("2020-04-10T00:00:00"), step_of(eci_stat_period_step::month));
+    BOOST_REQUIRE_EQUAL(months.size(), 2u);
+    BOOST_CHECK_EQUAL(months[0].eci, 100);
+    BOOST_CHECK_EQUAL(months[1].previous_eci, 100);
+    BOOST_CHECK_EQUAL(months[1].eci, 150);
+    BOOST_CHECK(months[1].timestamp == at("2020-04-01T01:00:00"));
+
+    const auto days = api->get_account_eci_stats_history("initdelegate", at("2020-04-01T00:00:00"), {}, step_of(eci_stat_period_step::day));
+    BOOST_REQUIRE_EQUAL(days.size(), 2u);
+    BOOST_CHECK_EQUAL(days[0].previous_eci, 100);
+    BOOST_CHECK_EQUAL(days[0].eci, 150);
+    BOOST_CHECK_EQUAL(days[1].previous_eci, 150);
+    BOOST_CHECK_EQUAL(days[1].eci, 175);
+    BOOST_CHECK(days[1].timestamp == at("2020-04-15T10:00:00"));
+
+    BOOST_CHECK(api->get_account_eci_stats_history("unknown", {}, {}, {}).empty());
+}
+
+BOOST_AUTO_TEST_CASE(disciplines_eci_stats_history_across_periods)
+{
+    push_discipline_history("2020-01-31T23:00:00", 100);
+    push_discipline_history("2020-02-01T01:00:00", 110);
+    push_discipline_history("2020-02-01T05:00:00", 120);
+    push_discipline_history("2020-02-03T00:00:00", 130);
+    const auto api = start_api();
+    const external_id_type physics_external_id(PHYSICS_EXTERNAL_ID);
+
+    auto history = api->get_disciplines_eci_stats_history({}, {}, step_of(eci_stat_period_step::month)).at(physics_external_id);
+    BOOST_REQUIRE_EQUAL(history.size(), 2u);
+    BOOST_CHECK_EQUAL(history[0].eci, 100);
+    BOOST_CHECK_EQUAL(history[1].eci, 110);
+    BOOST_CHECK_EQUAL(history[1].previous_eci, 100);
+
+    history = api->get_disciplines_eci_stats_history({}, {}, step_of(eci_stat_period_step::day)).at(physics_external_id);
+    BOOST_REQUIRE_EQUAL(history.size(), 3u);
+    BOOST_CHECK_EQUAL(history[1].eci, 110);
+    BOOST_CHECK_EQUAL(history[2].eci, 130);
+
+    // the first record at or after 'from' starts the range, a period starting after 'to' is left out
+    history = api->get_disciplines_eci_stats_history(at("2020-01-31T23:30:00"), at("2020-02-02T00:00:00"), step_of(eci_stat_period_step::day)).at(physics_external_id);
+    BOOST_REQUIRE_EQUAL(history.size(), 1u);
+    BOOST_CHECK_EQUAL(history[0].eci, 110);
+    BOOST_CHECK(history[0].timestamp == at("2020-02-01T01:00:00"));
+
+    history = api->get_disciplines_eci_stats_history(at("2020-02-01T00:00:00"), at("2020-02-01T05:00:00"), {}).at(physics_external_id);
+    BOOST_REQUIRE_EQUAL(history.size(), 2u);
+    BOOST_CHECK_EQUAL(history[0].eci, 110);
+    BOOST_CHECK_EQUAL(history[1].eci, 120);
+    BOOST_CHECK_EQUAL(history[1].previous_eci, 110);
+}
+
+BOOST_AUTO_TEST_CASE(research_eci_stats_aggregates_match_history)
+{
+    // ECI 0, 10, 15, 11 for one research and 30 for the other, with a repeated contribution
+    push_research_history("2020-01-31T22:00:00", 0, 1);
+    push_research_history("2020-01-31T23:30:00", 10, 2);
+    push_research_history("2020-02-01T00:30:00", 5, 3);
+    push_research_history("2020-02-02T09:00:00", -4, 3);
+    push_research_history("2020-02-01T12:00:00", 30, 4, other_research);
+    const auto api = start_api();
+    const external_id_type research_external_id(RESEARCH_EXTERNAL_ID);
+    const external_id_type other_research_external_id(OTHER_RESEARCH_EXTERNAL_ID);
+    const external_id_type physics_external_id(PHYSICS_EXTERNAL_ID);
+
+    const auto aggregated = api->get_research_eci_stats(research_external_id, {}, {}, {}, {}, {});
+    const auto replayed = api->get_research_eci_stats(research_external_id, {}, every_record, {}, {}, {});
+    BOOST_REQUIRE(aggregated.valid() && replayed.valid());
+    check_same_eci_stats(*aggregated, *replayed);
+    BOOST_CHECK_EQUAL(aggregated->eci, 11);
+    BOOST_CHECK_EQUAL(aggregated->previous_eci, 15);
+    BOOST_CHECK_EQUAL(aggregated->starting_eci, 10);
+    BOOST_CHECK_EQUAL(aggregated->contributions.size(), 3u);
+
+    for (const fc::optional<external_id_type>& discipline : { fc::optional<external_id_type>(), fc::optional<external_id_type>(physics_external_id) })
+    {
+        const auto all_aggregated = api->get_researches_eci_stats(discipline, {}, {}, {}, {});
+        const auto all_replayed = api->get_researches_eci_stats(discipline, every_record, {}, {}, {});
+        BOOST_REQUIRE_EQUAL(all_aggregated.size(), 2u);
+        BOOST_REQUIRE_EQUAL(all_replayed.size(), 2u);
+        for (const external_id_type& id : { research_external_id, other_research_external_id })
+            check_same_eci_stats(all_aggregated.at(id), all_replayed.at(id));
+
+        // one of two scores below, none equal: (0 + 0.5) / 2 and (1 + 0.5) / 2
+        BOOST_CHECK_EQUAL(all_aggregated.at(research_external_id).percentile_rank.amount, 25 * DEIP_1_PERCENT);
+        BOOST_CHECK_EQUAL(all_aggregated.at(other_research_external_id).percentile_rank.amount, 75 * DEIP_1_PERCENT);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(research_content_and_account_eci_stats_aggregates_match_history)
+{
+    push_research_content_history("2020-03-01T10:00:00", 20, 1);
+    push_research_content_history("2020-03-02T10:00:00", -5, 2);
+    push_account_history("2020-03-01T10:00:00", 7, 1);
+    push_account_history("2020-03-03T10:00:00", 3, 2);
+    const auto api = start_api();
+    const external_id_type research_content_external_id(RESEARCH_CONTENT_EXTERNAL_ID);
+
+    const auto content_aggregated = api->get_research_content_eci_stats(research_content_external_id, {}, {}, {}, {}, {});
+    const auto content_replayed = api->get_research_content_eci_stats(research_content_external_id, {}, every_record, {}, {}, {});
+    BOOST_REQUIRE(content_aggregated.valid() && content_replayed.valid());
+    check_same_eci_stats(*content_aggregated, *content_replayed);
+    BOOST_CHECK_EQUAL(content_aggregated->eci, 15);
+    BOOST_CHECK_EQUAL(content_aggregated->starting_eci, 20);
+
+    const auto account_aggregated = api->get_account_eci_stats("initdelegate", {}, {}, {}, {}, {});
+    const auto account_replayed = api->get_account_eci_stats("initdelegate", {}, every_record, {}, {}, {});
+    BOOST_REQUIRE(account_aggregated.valid() && account_replayed.valid());
+    check_same_eci_stats(*account_aggregated, *account_replayed);
+    BOOST_CHECK_EQUAL(account_aggregated->eci, 10);
+    BOOST_CHECK_EQUAL(account_aggregated->previous_eci, 7);
+
+    const auto accounts_aggregated = api->get_accounts_eci_stats({}, {}, {}, {}, {});
+    const auto accounts_replayed = api->get_accounts_eci_stats({}, every_record, {}, {}, {});
+    BOOST_REQUIRE_EQUAL(accounts_aggregated.size(), 1u);
+    BOOST_REQUIRE_EQUAL(accounts_replayed.size(), 1u);
+    check_same_eci_stats(accounts_aggregated.at("initdelegate"), accounts_replayed.at("initdelegate"));
+}
+
+BOOST_AUTO_TEST_CASE(eci_stats_keep_latest_contributions)
+{
+    const int64_t contributions_count = static_cast<int64_t>(eci_stats_max_contributions) + 10;
+    for (int64_t contribution_id = 1; contribution_id <= contributions_count; ++contribution_id)
+        push_research_history("2020-01-31T22:00:00", 1, contribution_id);
+    const auto api = start_api();
+    const external_id_type research_external_id(RESEARCH_EXTERNAL_ID);
+
+    const auto aggregated = api->get_research_eci_stats(research_external_id, {}, {}, {}, {}, {});
+    const auto replayed = api->get_research_eci_stats(research_external_id, {}, every_record, {}, {}, {});
+    BOOST_REQUIRE(aggregated.valid() && replayed.valid());
+    check_same_eci_stats(*aggregated, *replayed);
+    BOOST_REQUIRE_EQUAL(aggregated->contributions.size(), eci_stats_max_contributions);
+    BOOST_CHECK_EQUAL(aggregated->contributions.begin()->first, 11);
+    BOOST_CHECK_EQUAL(aggregated->contributions.rbegin()->first, contributions_count);
+}
+
+BOOST_AUTO_TEST_CASE(eci_history_rollups_follow_operations)
+{
+    const auto api = start_api();
+    const external_id_type research_external_id(RESEARCH_EXTERNAL_ID);
+
+    // the same ECI 10, 15 | 35, 42 | 38 as above, this time recorded by the plugin as the operations are applied
+    apply_research_eci_operation("2020-01-31T22:00:00", 0, 10);
+    apply_research_eci_operation("2020-01-31T23:30:00", 10, 15);
+    apply_research_eci_operation("2020-02-01T00:30:00", 15, 35);
+    apply_research_eci_operation("2020-02-01T12:00:00", 35, 42);
+    apply_research_eci_operation("2020-02-02T09:00:00", 42, 38);
+    apply_account_eci_operation("2020-03-31T23:00:00", 0, 100);
+    apply_account_eci_operation("2020-04-01T01:00:00", 100, 150);
+
+    auto days = api->get_research_eci_stats_history(research_external_id, {}, {}, step_of(eci_stat_period_step::day));
+    BOOST_REQUIRE_EQUAL(days.size(), 3u);
+    BOOST_CHECK_EQUAL(days[0].eci, 15);
+    BOOST_CHECK_EQUAL(days[1].previous_eci, 15);
+    BOOST_CHECK_EQUAL(days[1].eci, 42);
+    BOOST_CHECK_EQUAL(days[2].eci, 38);
+    BOOST_CHECK(days[2].timestamp == at("2020-02-02T09:00:00"));
+
+    const auto months = api->get_research_eci_stats_history(research_external_id, {}, {}, step_of(eci_stat_period_step::month));
+    BOOST_REQUIRE_EQUAL(months.size(), 2u);
+    BOOST_CHECK_EQUAL(months[0].eci, 15);
+    BOOST_CHECK_EQUAL(months[1].eci, 38);
+
+    // an unknown step selects days, as it did before the rollups
+    const auto unknown_step = api->get_research_eci_stats_history(research_external_id, {}, {}, 7);
+    BOOST_REQUIRE_EQUAL(unknown_step.size(), days.size());
+    for (size_t i = 0; i < days.size(); ++i)
+        BOOST_CHECK_EQUAL(unknown_step[i].eci, days[i].eci);
+
+    const auto account_months = api->get_account_eci_stats_history("initdelegate", {}, {}, step_of(eci_stat_period_step::month));
+    BOOST_REQUIRE_EQUAL(account_months.size(), 2u);
+    BOOST_CHECK_EQUAL(account_months[0].eci, 100);
+    BOOST_CHECK_EQUAL(account_months[1].eci, 150);
+
+    const auto stats = api->get_research_eci_stats(research_external_id, {}, {}, {}, {}, {});
+    BOOST_REQUIRE(stats.valid());
+    BOOST_CHECK_EQUAL(stats->eci, 38);
+    BOOST_CHECK_EQUAL(stats->previous_eci, 42);
+    BOOST_CHECK_EQUAL(stats->starting_eci, 10);
+
+    BOOST_TEST_MESSAGE("Verify that rebuilding the rollups from the history gives the same periods");
+    plugin->plugin_startup();
+    const auto rebuilt_days = api->get_research_eci_stats_history(research_external_id, {}, {}, step_of(eci_stat_period_step::day));
+    BOOST_REQUIRE_EQUAL(rebuilt_days.size(), days.size());
+    for (size_t i = 0; i < days.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(rebuilt_days[i].eci, days[i].eci);
+        BOOST_CHECK_EQUAL(rebuilt_days[i].previous_eci, days[i].previous_eci);
+        BOOST_CHECK(rebuilt_days[i].timestamp == days[i].timestamp);
+    }
+    const auto rebuilt_stats = api->get_research_eci_stats(research_external_id, {}, {}, {}, {}, {});
+    BOOST_REQUIRE(rebuilt_stats.valid());
+    check_same_eci_stats(*stats, *rebuilt_stats);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif
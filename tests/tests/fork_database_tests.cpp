@@ -0,0 +1,162 @@
+#include <boost/test/unit_test.hpp>
+
+#include <deip/chain/database/fork_database.hpp>
+
+#include <fc/time.hpp>
+
+#include <chrono>
+
+using namespace deip::chain;
+using deip::protocol::block_id_type;
+using deip::protocol::signed_block;
+
+namespace {
+
+signed_block make_block(const block_id_type& previous, const std::string& witness)
+{
+    signed_block b;
+    b.previous = previous;
+    b.timestamp = fc::time_point_sec(1000000 + 3 * b.block_num());
+    b.witness = witness;
+    return b;
+}
+
+// pushes count blocks building on top of previous and returns the id of the last one
+block_id_type push_blocks(fork_database& fork_db, block_id_type previous, uint32_t count, const std::string& witness)
+{
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const auto b = make_block(previous, witness);
+        fork_db.push_block(b);
+        previous = b.id();
+    }
+    return previous;
+}
+
+std::string witness_on_main_branch(const fork_database& fork_db, uint32_t num)
+{
+    return fork_db.fetch_block_on_main_branch_by_number(num)->data.witness;
+}
+}
+
+BOOST_AUTO_TEST_SUITE(fork_database_tests)
+
+BOOST_AUTO_TEST_CASE(main_branch_follows_head)
+{
+    fork_database fork_db;
+    const auto genesis = make_block(block_id_type(), "initdelegate");
+    fork_db.start_block(genesis);
+
+    const auto fork_point = push_blocks(fork_db, genesis.id(), 10, "alice");
+    const auto alice_head = push_blocks(fork_db, fork_point, 5, "alice");
+    BOOST_CHECK(fork_db.head()->id == alice_head);
+
+    // a shorter fork leaves the head alone
+    const auto bob_head = push_blocks(fork_db, fork_point, 3, "bob");
+    BOOST_CHECK(fork_db.head()->id == alice_head);
+    BOOST_CHECK_EQUAL(witness_on_main_branch(fork_db, 13), "alice");
+    BOOST_CHECK(!fork_db.is_on_main_branch(fork_db.fetch_block(bob_head)));
+
+    auto branches = fork_db.fetch_branch_from(bob_head, alice_head);
+    BOOST_CHECK_EQUAL(branches.first.size(), 3u);
+    BOOST_CHECK_EQUAL(branches.second.size(), 5u);
+    BOOST_CHECK(branches.first.back()->previous_id() == fork_point);
+    BOOST_CHECK(branches.second.back()->previous_id() == fork_point);
+
+    // once it is longer the main branch switches over
+    const auto new_head = push_blocks(fork_db, bob_head, 3, "bob");
+    BOOST_CHECK(fork_db.head()->id == new_head);
+    BOOST_CHECK_EQUAL(witness_on_main_branch(fork_db, 13), "bob");
+    BOOST_CHECK_EQUAL(witness_on_main_branch(fork_db, 11), "alice");
+    BOOST_CHECK(!fork_db.fetch_block_on_main_branch_by_number(18));
+
+    branches = fork_db.fetch_branch_from(new_head, alice_head);
+    BOOST_CHECK_EQUAL(branches.first.size(), 6u);
+    BOOST_CHECK_EQUAL(branches.second.size(), 5u);
+    BOOST_CHECK(branches.first.front()->id == new_head);
+    BOOST_CHECK(branches.second.front()->id == alice_head);
+
+    fork_db.set_head(fork_db.fetch_block(alice_head));
+    BOOST_CHECK_EQUAL(witness_on_main_branch(fork_db, 13), "alice");
+    fork_db.pop_block();
+    BOOST_CHECK_EQUAL(fork_db.head()->num, 15u);
+    BOOST_CHECK(!fork_db.fetch_block_on_main_branch_by_number(16));
+}
+
+BOOST_AUTO_TEST_CASE(max_fork_bytes_keeps_main_branch)
+{
+    fork_database fork_db;
+    const auto genesis = make_block(block_id_type(), "initdelegate");
+    fork_db.start_block(genesis);
+
+    const auto fork_point = push_blocks(fork_db, genesis.id(), 5, "alice");
+    push_blocks(fork_db, fork_point, 20, "alice");
+    const auto bob_head = push_blocks(fork_db, fork_point, 10, "bob");
+    const auto main_bytes = fork_db.size_in_bytes() - 10 * fork_db.fetch_block(bob_head)->packed_size;
+
+    fork_db.set_max_fork_bytes(0);
+    BOOST_CHECK(!fork_db.is_known_block(bob_head));
+    BOOST_CHECK_EQUAL(fork_db.size_in_bytes(), main_bytes);
+    for (uint32_t num = 1; num <= 26; ++num)
+        BOOST_REQUIRE(fork_db.fetch_block_on_main_branch_by_number(num));
+
+    fork_db.set_max_size(10);
+    BOOST_CHECK(!fork_db.fetch_block_on_main_branch_by_number(15));
+    BOOST_CHECK(fork_db.fetch_block_on_main_branch_by_number(16));
+}
+
+BOOST_AUTO_TEST_CASE(removed_head_gives_way_to_replacement)
+{
+    fork_database fork_db;
+    const auto genesis = make_block(block_id_type(), "initdelegate");
+    fork_db.start_block(genesis);
+
+    const auto previous = push_blocks(fork_db, genesis.id(), 5, "alice");
+    const auto rejected = make_block(previous, "alice");
+    fork_db.push_block(rejected);
+    BOOST_REQUIRE_EQUAL(fork_db.head()->num, 7u);
+
+    fork_db.remove(rejected.id());
+    BOOST_CHECK(fork_db.head()->id == previous);
+    BOOST_CHECK(!fork_db.is_known_block(rejected.id()));
+    BOOST_CHECK(!fork_db.fetch_block_on_main_branch_by_number(7));
+
+    const auto replacement = make_block(previous, "bob");
+    fork_db.push_block(replacement);
+    BOOST_CHECK(fork_db.head()->id == replacement.id());
+    BOOST_REQUIRE(fork_db.fetch_block_on_main_branch_by_number(7));
+    BOOST_CHECK(fork_db.fetch_block_on_main_branch_by_number(7)->id == replacement.id());
+    BOOST_CHECK_EQUAL(witness_on_main_branch(fork_db, 7), "bob");
+}
+
+BOOST_AUTO_TEST_CASE(fork_switch_benchmark)
+{
+    for (uint32_t depth : { 1, 10, 100, 1000 })
+    {
+        fork_database fork_db;
+        fork_db.set_max_size(4 * depth + 16);
+        const auto genesis = make_block(block_id_type(), "initdelegate");
+        fork_db.start_block(genesis);
+
+        const auto fork_point = push_blocks(fork_db, genesis.id(), depth, "initdelegate");
+        const auto old_head = push_blocks(fork_db, fork_point, depth, "alice");
+        const auto last_bob = push_blocks(fork_db, fork_point, depth, "bob");
+
+        // the block that makes the fork the longest one, and everything database::_push_block asks for
+        const auto b = make_block(last_bob, "bob");
+        const auto start = std::chrono::steady_clock::now();
+        const auto new_head = fork_db.push_block(b);
+        const auto branches = fork_db.fetch_branch_from(new_head->id, old_head);
+        for (uint32_t num = depth + 1; num <= new_head->num; ++num)
+            fork_db.fetch_block_on_main_branch_by_number(num);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        BOOST_CHECK_EQUAL(branches.first.size(), depth + 1);
+        BOOST_CHECK_EQUAL(branches.second.size(), depth);
+        BOOST_TEST_MESSAGE("fork switch of depth " << depth << ": "
+                                                  << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+                                                  << "us");
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
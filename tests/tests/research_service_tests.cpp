@@ -55,6 +55,36 @@ public:
         });
     }
 
+    const research_object& create_research_with_members(const research_group_object& research_group,
+                                                        const std::string& external_id,
+                                                        const flat_set<account_name_type>& members)
+    {
+        return data_service.create_research(research_group, external_id, RESEARCH_TITLE, {}, optional<percent>(),
+                                            optional<percent>(), false, false, members, db.head_block_time());
+    }
+
+    const research_object& update_members(const research_object& research,
+                                          const flat_set<account_name_type>& members)
+    {
+        return data_service.update_research(research, fc::to_string(research.description), research.is_private,
+                                            research.review_share, research.compensation_share, members);
+    }
+
+    std::vector<research_id_type> researches_of(const account_name_type& member) const
+    {
+        std::vector<research_id_type> ids;
+        for (const research_object& research : data_service.get_researches_by_member(member))
+            ids.push_back(research.id);
+        return ids;
+    }
+
+    size_t indexed_members(const research_id_type& research_id) const
+    {
+        const auto& idx = db.get_index<research_member_index>().indicies().get<by_research_and_member>();
+        auto range = idx.equal_range(research_id);
+        return std::distance(range.first, range.second);
+    }
+
     dbs_research& data_service;
 };
 
@@ -112,6 +142,95 @@ BOOST_AUTO_TEST_CASE(get_research)
     FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE(create_research_indexes_members)
+{
+    try
+    {
+        const auto& research_group = research_group_create(RESEARCH_GROUP_ID, "group", "group", 0, false, false);
+
+        const auto& first = create_research_with_members(research_group, "first", { "alice", "bob" });
+        const auto& second = create_research_with_members(research_group, "second", { "bob" });
+        create_research_with_members(research_group, "third", {});
+
+        BOOST_CHECK(researches_of("alice") == std::vector<research_id_type>({ first.id }));
+        BOOST_CHECK(researches_of("bob") == std::vector<research_id_type>({ first.id, second.id }));
+        BOOST_CHECK(researches_of("carol").empty());
+
+        BOOST_CHECK_EQUAL(indexed_members(first.id), 2u);
+        BOOST_CHECK_EQUAL(indexed_members(second.id), 1u);
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE(update_research_syncs_members)
+{
+    try
+    {
+        const auto& research_group = research_group_create(RESEARCH_GROUP_ID, "group", "group", 0, false, false);
+
+        const auto& first = create_research_with_members(research_group, "first", { "alice", "bob", "dave" });
+        const auto& second = create_research_with_members(research_group, "second", { "bob" });
+
+        // alice and dave leave, carol and erin join, bob stays
+        update_members(first, { "bob", "carol", "erin" });
+
+        BOOST_CHECK(first.members == flat_set<account_name_type>({ "bob", "carol", "erin" }));
+        BOOST_CHECK(researches_of("alice").empty());
+        BOOST_CHECK(researches_of("dave").empty());
+        BOOST_CHECK(researches_of("carol") == std::vector<research_id_type>({ first.id }));
+        BOOST_CHECK(researches_of("erin") == std::vector<research_id_type>({ first.id }));
+        BOOST_CHECK(researches_of("bob") == std::vector<research_id_type>({ first.id, second.id }));
+        BOOST_CHECK_EQUAL(indexed_members(first.id), 3u);
+
+        // the same members again change nothing
+        update_members(first, { "bob", "carol", "erin" });
+        BOOST_CHECK_EQUAL(indexed_members(first.id), 3u);
+        BOOST_CHECK_EQUAL(indexed_members(second.id), 1u);
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE(member_leaving_is_removed_from_all_researches)
+{
+    try
+    {
+        const auto& research_group = research_group_create(RESEARCH_GROUP_ID, "group", "group", 0, false, false);
+
+        create_research_with_members(research_group, "first", { "alice", "bob" });
+        create_research_with_members(research_group, "second", { "bob" });
+
+        // as the leave evaluator does, every research of the group is updated without the member
+        for (const research_object& research : data_service.get_researches_by_research_group(research_group.id))
+        {
+            flat_set<account_name_type> members;
+            for (const auto& member : research.members)
+                if (member != "bob")
+                    members.insert(member);
+            update_members(research, members);
+        }
+
+        BOOST_CHECK(researches_of("bob").empty());
+        BOOST_CHECK_EQUAL(researches_of("alice").size(), 1u);
+    }
+    FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE(get_researches_by_member_is_ordered_by_research_id)
+{
+    try
+    {
+        const auto& first_group = research_group_create(1, "first group", "group", 0, false, false);
+        const auto& second_group = research_group_create(2, "second group", "group", 0, false, false);
+
+        // the researches come in research id order, not in the order of the groups the member is in
+        const auto& first = create_research_with_members(second_group, "first", { "alice" });
+        const auto& second = create_research_with_members(first_group, "second", { "alice" });
+        const auto& third = create_research_with_members(second_group, "third", { "alice" });
+
+        BOOST_CHECK(researches_of("alice") == std::vector<research_id_type>({ first.id, second.id, third.id }));
+    }
+    FC_LOG_AND_RETHROW()
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 